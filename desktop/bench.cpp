@@ -0,0 +1,160 @@
+// bankra-bench: renders a few playing situations and reports the processing
+// time of each profiler stage in ns per output frame. Stage times are
+// inclusive (copy contains varispeed, which contains the mixer ...). Then the
+// import of a bank is timed per file format and the delay with its line in
+// each memory region.
+//
+//   bankra-bench --sd DIR [--generate] [--no-psram] [--seconds N]
+//
+// The formats are read from DIR/1.wav .. 6.wav, DIR/ima/*.wav (written by
+// --generate), DIR/mp3/*.mp3 and DIR/flac/*.flac, e.g. converted with
+// ffmpeg -i 1.wav mp3/1.mp3 (MP3 and FLAC need -DUSE_SAMPLE_CODECS=true).
+#include <chrono>
+#include <string>
+#include "harness.h"
+
+struct Scenario {
+  const char* name;
+  const char* setup;  // events at 0 ms
+  const char* buttons;  // pressed in turn, 250 ms each
+};
+
+static const Scenario kScenarios[] = {
+    {"ram", "", "12346"},
+    {"streamed", "", "5"},
+    {"effects", "0 send on\n0 filter on\n0 set comp 1\n0 set wet 0.6\n", "12346"},
+    {"idle", "0 send off\n0 filter off\n0 set comp 0\n", ""},
+};
+
+static std::string scenarioScript(const Scenario& scenario, uint32_t seconds) {
+  std::string text = scenario.setup;
+  size_t count = strlen(scenario.buttons);
+  uint32_t endMs = seconds * 1000;
+  for (uint32_t ms = 0, n = 0; count > 0 && ms < endMs; ms += 250, ++n) {
+    char button = scenario.buttons[n % count];
+    text += std::to_string(ms) + " press " + button + "\n";
+    text += std::to_string(ms + 240) + " release " + button + "\n";
+  }
+  text += std::to_string(endMs) + " end\n";
+  return text;
+}
+
+static void report(const char* name, uint64_t frames, double wallNs) {
+  AudioProfiler& profiler = AudioProfiler::instance();
+  double realtimeNs = 1e9 / outputInfo().sample_rate;
+  printf("\n%s: %.1f s of audio, %.1f ns/frame, %.0fx realtime\n", name,
+         frames / float(outputInfo().sample_rate), wallNs / frames,
+         realtimeNs * frames / wallNs);
+  printf("%-10s %10s %12s %10s\n", "stage", "calls", "avg ns/call", "ns/frame");
+  for (int j = 0; j < profiler.size(); ++j) {
+    ProfileStage& stage = profiler[j];
+    if (stage.size() == 0) continue;
+    printf("%-10s %10u %12u %10.1f\n", stage.name(), (unsigned)stage.size(),
+           (unsigned)stage.avgNs(), double(stage.sumNs()) / frames);
+  }
+}
+
+struct SampleFormat {
+  const char* name;
+  const char* dir;
+  const char* extension;
+  bool built;
+};
+
+static const SampleFormat kFormats[] = {
+    {"WAV", "", ".wav", true},
+    {"IMA ADPCM", "/ima", ".wav", true},
+    {"MP3", "/mp3", ".mp3", USE_SAMPLE_CODECS},
+    {"FLAC", "/flac", ".flac", USE_SAMPLE_CODECS},
+};
+
+// What the sample loader does for a bank of each format, without the limit
+// of the cache: decoding and conversion to the output format
+static void benchmarkSampleFormats() {
+  printf("\nbank import per format\n");
+  printf("%-10s %6s %10s %9s %9s %8s %10s\n", "format", "files", "file KB", "audio s",
+         "load ms", "MB/s", "x realtime");
+  for (const SampleFormat& format : kFormats) {
+    if (!format.built) {
+      printf("%-10s not built (USE_SAMPLE_CODECS)\n", format.name);
+      continue;
+    }
+    unsigned files = 0;
+    uint64_t fileBytes = 0, frames = 0;
+    double ns = 0;
+    for (int n = 1; n <= BUTTON_COUNT; ++n) {
+      std::string path = std::string(format.dir) + "/" + std::to_string(n) + format.extension;
+      if (!SD.exists(path.c_str())) continue;
+      File file = SD.open(path.c_str());
+      fileBytes += file.size();
+      file.close();
+      SampleSlot slot;
+      auto start = std::chrono::steady_clock::now();
+      bool loaded = sampleBank.import(slot, path.c_str(), nullptr, SIZE_MAX);
+      auto end = std::chrono::steady_clock::now();
+      if (!loaded) {
+        printf("%-10s %s could not be imported\n", format.name, path.c_str());
+        continue;
+      }
+      ns += std::chrono::duration<double, std::nano>(end - start).count();
+      frames += slot.frames;
+      ++files;
+    }
+    if (files == 0) {
+      printf("%-10s no files in %s\n", format.name, *format.dir ? format.dir : "/");
+      continue;
+    }
+    double audioSeconds = double(frames) / outputInfo().sample_rate;
+    printf("%-10s %6u %10.0f %9.1f %9.1f %8.1f %10.0f\n", format.name, files,
+           fileBytes / 1024.0, audioSeconds, ns / 1e6, fileBytes / (ns / 1e3),
+           audioSeconds * 1e9 / ns);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const char* sd = nullptr;
+  bool generate = false;
+  bool psram = true;
+  uint32_t seconds = 10;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--sd" && i + 1 < argc) sd = argv[++i];
+    else if (arg == "--seconds" && i + 1 < argc) seconds = atoi(argv[++i]);
+    else if (arg == "--generate") generate = true;
+    else if (arg == "--no-psram") psram = false;
+    else {
+      fprintf(stderr, "usage: bankra-bench --sd DIR [--generate] [--no-psram] [--seconds N]\n");
+      return 2;
+    }
+  }
+  if (sd == nullptr || seconds == 0) return 2;
+  if (generate && !generateSamples(sd)) {
+    fprintf(stderr, "cannot write the samples to %s\n", sd);
+    return 1;
+  }
+  SD.setRoot(sd);
+  CaptureStream capture;
+  capture.setKeepSamples(false);
+  beginEngine(capture, psram);
+
+  for (const Scenario& scenario : kScenarios) {
+    Script script;
+    std::string error;
+    if (!script.parse(scenarioScript(scenario, seconds), error)) {
+      fprintf(stderr, "%s: %s\n", scenario.name, error.c_str());
+      return 1;
+    }
+    AudioProfiler::instance().reset();
+    uint64_t startFrames = capture.frames();
+    auto start = std::chrono::steady_clock::now();
+    script.run(capture);
+    auto end = std::chrono::steady_clock::now();
+    report(scenario.name, capture.frames() - startFrames,
+           std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  benchmarkSampleFormats();
+  // on the host both regions are the same heap: compare on the board
+  printf("\n");
+  benchmarkDelayPlacement(Serial, outputInfo().sample_rate, MEMORY_BENCHMARK_LINE_MS);
+  return 0;
+}
@@ -0,0 +1,636 @@
+#include "harness.h"
+
+#include <SD.h>
+#include <math.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// Live effect state, changed by the script like by the pots and the menu
+static EffectParams liveParams = defaultEffectParams();
+
+AudioInfo outputInfo() {
+  return AudioInfo(44100, 2, 16);
+}
+
+size_t CaptureStream::write(const uint8_t* buffer, size_t len) {
+  AUDIO_PROFILE_SCOPE("i2s");
+  const int16_t* samples = reinterpret_cast<const int16_t*>(buffer);
+  size_t count = len / sizeof(int16_t);
+  if (keepSamples) data.insert(data.end(), samples, samples + count);
+  frameCount += count / audioInfo().channels;
+  return len;
+}
+
+static void writeLE16(FILE* file, uint16_t value) {
+  uint8_t bytes[2] = {uint8_t(value), uint8_t(value >> 8)};
+  fwrite(bytes, 1, 2, file);
+}
+
+static void writeLE32(FILE* file, uint32_t value) {
+  uint8_t bytes[4] = {uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16),
+                      uint8_t(value >> 24)};
+  fwrite(bytes, 1, 4, file);
+}
+
+bool writeWAVFile(const std::string& path, const std::vector<int16_t>& samples,
+                  int channels, uint32_t rate, uint32_t loopStart, uint32_t loopEnd) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) return false;
+  uint32_t dataBytes = samples.size() * sizeof(int16_t);
+  uint32_t smplBytes = loopEnd > loopStart ? 36 + 24 : 0;
+  fwrite("RIFF", 1, 4, file);
+  writeLE32(file, 4 + 24 + (smplBytes ? 8 + smplBytes : 0) + 8 + dataBytes);
+  fwrite("WAVEfmt ", 1, 8, file);
+  writeLE32(file, 16);
+  writeLE16(file, 1);
+  writeLE16(file, channels);
+  writeLE32(file, rate);
+  writeLE32(file, rate * channels * 2);
+  writeLE16(file, channels * 2);
+  writeLE16(file, 16);
+  if (smplBytes) {
+    fwrite("smpl", 1, 4, file);
+    writeLE32(file, smplBytes);
+    for (int j = 0; j < 7; j++) writeLE32(file, 0);
+    writeLE32(file, 1);  // loops
+    writeLE32(file, 0);  // sampler data
+    writeLE32(file, 0);  // cue point id
+    writeLE32(file, 0);  // forward
+    writeLE32(file, loopStart);
+    writeLE32(file, loopEnd - 1);
+    writeLE32(file, 0);  // fraction
+    writeLE32(file, 0);  // play count: infinite
+  }
+  fwrite("data", 1, 4, file);
+  writeLE32(file, dataBytes);
+  fwrite(samples.data(), 1, dataBytes, file);
+  return fclose(file) == 0;
+}
+
+// One 4 bit IMA ADPCM code; predictor and index follow the decoder
+static uint8_t encodeIMA(int16_t sample, int32_t& predictor, int& index) {
+  int32_t step = ima_step_table[index];
+  int32_t diff = sample - predictor;
+  uint8_t code = 0;
+  if (diff < 0) {
+    code = 8;
+    diff = -diff;
+  }
+  int32_t delta = step >> 3;
+  if (diff >= step) {
+    code |= 4;
+    diff -= step;
+    delta += step;
+  }
+  if (diff >= step >> 1) {
+    code |= 2;
+    diff -= step >> 1;
+    delta += step >> 1;
+  }
+  if (diff >= step >> 2) {
+    code |= 1;
+    delta += step >> 2;
+  }
+  predictor += (code & 8) ? -delta : delta;
+  if (predictor > 32767) predictor = 32767;
+  if (predictor < -32768) predictor = -32768;
+  index += ima_index_table[code];
+  index = index < 0 ? 0 : (index > 88 ? 88 : index);
+  return code;
+}
+
+// IMA ADPCM WAV (format 0x11) in blocks of 256 bytes per channel; the last
+// block is padded with silence
+static bool writeIMAFile(const std::string& path, const std::vector<int16_t>& samples,
+                         int channels, uint32_t rate) {
+  const uint32_t blockAlign = 256 * channels;
+  const uint32_t blockFrames = (blockAlign - 4 * channels) * 2 / channels + 1;
+  uint32_t frames = samples.size() / channels;
+  uint32_t blocks = (frames + blockFrames - 1) / blockFrames;
+  uint32_t dataBytes = blocks * blockAlign;
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) return false;
+  fwrite("RIFF", 1, 4, file);
+  writeLE32(file, 4 + 28 + 12 + 8 + dataBytes);
+  fwrite("WAVEfmt ", 1, 8, file);
+  writeLE32(file, 20);
+  writeLE16(file, 0x11);
+  writeLE16(file, channels);
+  writeLE32(file, rate);
+  writeLE32(file, rate * blockAlign / blockFrames);
+  writeLE16(file, blockAlign);
+  writeLE16(file, 4);
+  writeLE16(file, 2);
+  writeLE16(file, blockFrames);
+  fwrite("fact", 1, 4, file);
+  writeLE32(file, 4);
+  writeLE32(file, frames);
+  fwrite("data", 1, 4, file);
+  writeLE32(file, dataBytes);
+
+  auto sampleAt = [&](uint32_t frame, int ch) -> int16_t {
+    return frame < frames ? samples[frame * channels + ch] : 0;
+  };
+  int32_t predictor[2] = {0, 0};
+  int index[2] = {0, 0};
+  std::vector<uint8_t> block(blockAlign);
+  for (uint32_t b = 0; b < blocks; ++b) {
+    uint32_t first = b * blockFrames;
+    uint8_t* out = block.data();
+    // header per channel: the exact first frame and the step index
+    for (int ch = 0; ch < channels; ++ch) {
+      predictor[ch] = sampleAt(first, ch);
+      *out++ = uint8_t(predictor[ch]);
+      *out++ = uint8_t(predictor[ch] >> 8);
+      *out++ = uint8_t(index[ch]);
+      *out++ = 0;
+    }
+    // then 8 frames per channel in turn, low nibble first
+    for (uint32_t f = first + 1; f < first + blockFrames; f += 8) {
+      for (int ch = 0; ch < channels; ++ch) {
+        for (uint32_t j = 0; j < 8; j += 2) {
+          uint8_t low = encodeIMA(sampleAt(f + j, ch), predictor[ch], index[ch]);
+          uint8_t high = encodeIMA(sampleAt(f + j + 1, ch), predictor[ch], index[ch]);
+          *out++ = uint8_t(low | (high << 4));
+        }
+      }
+    }
+    fwrite(block.data(), 1, blockAlign, file);
+  }
+  return fclose(file) == 0;
+}
+
+// PCM for the engine, IMA ADPCM in ima/ for the benchmark of the formats
+static bool writeSample(const std::string& root, const char* name,
+                        const std::vector<int16_t>& samples, int channels, uint32_t rate,
+                        uint32_t loopStart = 0, uint32_t loopEnd = 0) {
+  bool ok = writeWAVFile(root + "/" + name, samples, channels, rate, loopStart, loopEnd);
+  return writeIMAFile(root + "/ima/" + name, samples, channels, rate) && ok;
+}
+
+void CaptureStream::reserveFrames(uint64_t frames) {
+  if (keepSamples) data.reserve(data.size() + frames * audioInfo().channels);
+}
+
+bool CaptureStream::writeWAV(const char* path) {
+  return writeWAVFile(path, data, audioInfo().channels, audioInfo().sample_rate);
+}
+
+// Reproducible noise in -1..1
+static float noise(uint32_t& seed) {
+  seed = seed * 1664525 + 1013904223;
+  return static_cast<int32_t>(seed) / 2147483648.0f;
+}
+
+static int16_t toSample(float value) {
+  if (value > 1.0f) value = 1.0f;
+  if (value < -1.0f) value = -1.0f;
+  return static_cast<int16_t>(lroundf(value * 32767.0f));
+}
+
+bool generateSamples(const char* dir) {
+  std::string root = dir;
+  std::vector<int16_t> data;
+  uint32_t seed = 1;
+  bool ok = true;
+  mkdir((root + "/ima").c_str(), 0755);
+
+  // 1: kick, stereo 44.1 kHz
+  data.clear();
+  for (int j = 0; j < 22050; j++) {
+    float t = j / 44100.0f;
+    float value = 0.9f * expf(-t * 12.0f) * sinf(2.0f * M_PI * (50.0f + 80.0f * expf(-t * 30.0f)) * t);
+    data.push_back(toSample(value));
+    data.push_back(toSample(value));
+  }
+  ok &= writeSample(root, "1.wav", data, 2, 44100);
+
+  // 2: snare, mono 22.05 kHz: converted when loaded
+  data.clear();
+  for (int j = 0; j < 8820; j++) {
+    float t = j / 22050.0f;
+    float value = expf(-t * 18.0f) * (0.5f * noise(seed) + 0.3f * sinf(2.0f * M_PI * 180.0f * t));
+    data.push_back(toSample(value));
+  }
+  ok &= writeSample(root, "2.wav", data, 1, 22050);
+
+  // 3: chord, stereo with different voices per channel
+  data.clear();
+  for (int j = 0; j < 66150; j++) {
+    float t = j / 44100.0f;
+    float env = t < 0.01f ? t / 0.01f : expf(-(t - 0.01f) * 1.5f);
+    float left = sinf(2.0f * M_PI * 220.0f * t) + 0.7f * sinf(2.0f * M_PI * 277.2f * t);
+    float right = sinf(2.0f * M_PI * 329.6f * t) + 0.5f * sinf(2.0f * M_PI * 440.0f * t);
+    data.push_back(toSample(0.4f * env * left));
+    data.push_back(toSample(0.4f * env * right));
+  }
+  ok &= writeSample(root, "3.wav", data, 2, 44100);
+
+  // 4: sweep with noise at 48 kHz
+  data.clear();
+  for (int j = 0; j < 48000; j++) {
+    float t = j / 48000.0f;
+    float value = 0.5f * sinf(2.0f * M_PI * (100.0f * t + 1950.0f * t * t)) + 0.1f * noise(seed);
+    data.push_back(toSample(value));
+    data.push_back(toSample(value));
+  }
+  ok &= writeSample(root, "4.wav", data, 2, 48000);
+
+  // 5: pad which is larger than the cache: always streamed
+  data.clear();
+  for (int j = 0; j < 44100 * 20; j++) {
+    float t = j / 44100.0f;
+    float lfo = 0.5f + 0.5f * sinf(2.0f * M_PI * 0.5f * t);
+    data.push_back(toSample(0.3f * sinf(2.0f * M_PI * 110.0f * t) * lfo));
+    data.push_back(toSample(0.3f * sinf(2.0f * M_PI * 110.5f * t) * (1.0f - lfo)));
+  }
+  ok &= writeSample(root, "5.wav", data, 2, 44100);
+
+  // 6: forward loop between 0.25 and 0.75 s
+  data.clear();
+  for (int j = 0; j < 44100; j++) {
+    float t = j / 44100.0f;
+    float value = 0.4f * sinf(2.0f * M_PI * 330.0f * t) * (0.6f + 0.4f * sinf(2.0f * M_PI * 4.0f * t));
+    data.push_back(toSample(value));
+    data.push_back(toSample(value));
+  }
+  ok &= writeSample(root, "6.wav", data, 2, 44100, 11025, 33075);
+
+  // impulse response: decaying noise
+  data.clear();
+  for (int j = 0; j < 8192; j++) {
+    data.push_back(toSample(0.5f * expf(-j / 1500.0f) * noise(seed)));
+  }
+  ok &= writeWAVFile(root + "/ir.wav", data, 1, 44100);
+
+  remove((root + SAMPLE_MANIFEST_PATH).c_str());
+  std::filesystem::remove_all(root + RECORD_DIR);
+  return ok;
+}
+
+static void applyFilterSwitchState(bool enabled) {
+  mixerStream.setInputLowPassSlewRate(liveParams.filterSlewHzPerSec);
+  mixerStream.configureMasterLowPass(liveParams.filterCutoffHz,
+                                     liveParams.filterQ, enabled);
+}
+
+// Line in of the recorder: a sine which is produced at the rate of the
+// capture, like an I2S input with the clock of the output. What the engine
+// did not read yet is available, up to the DMA buffers: older frames are
+// overwritten.
+class ToneInput : public Stream {
+public:
+  void begin(const CaptureStream& output) {
+    clock = &output;
+    produced = output.frames();
+  }
+
+  int available() override {
+    if (clock == nullptr) return 0;
+    uint64_t dmaFrames = I2S_BUFFER_COUNT * I2S_BUFFER_SIZE / kFrameBytes;
+    if (clock->frames() - produced > dmaFrames) produced = clock->frames() - dmaFrames;
+    return static_cast<int>((clock->frames() - produced) * kFrameBytes);
+  }
+
+  size_t readBytes(uint8_t* data, size_t len) override {
+    size_t frames = std::min<size_t>(len, available()) / kFrameBytes;
+    int16_t* out = reinterpret_cast<int16_t*>(data);
+    for (size_t i = 0; i < frames; ++i) {
+      float value = 8000.0f * sinf(kTwoPi * 440.0f * (produced + i) / outputInfo().sample_rate);
+      out[2 * i] = out[2 * i + 1] = static_cast<int16_t>(value);
+    }
+    produced += frames;
+    return frames * kFrameBytes;
+  }
+
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  static constexpr size_t kFrameBytes = 2 * sizeof(int16_t);
+  static constexpr float kTwoPi = 6.28318531f;
+  const CaptureStream* clock = nullptr;
+  uint64_t produced = 0;
+};
+
+static ToneInput lineIn;
+
+void beginEngine(CaptureStream& capture, bool psram) {
+  if (!psram) ESP.psramSize = 0;
+  AudioToolsLogger.begin(Serial, AudioToolsLogLevel::Warning);
+  capture.setAudioInfo(outputInfo());
+  capture.begin();
+  liveParams = defaultEffectParams();
+  initAudio(capture, outputInfo(), liveParams);
+  const char* paths[BUTTON_COUNT] = {"/1.wav", "/2.wav", "/3.wav",
+                                     "/4.wav", "/5.wav", "/6.wav"};
+  initSampleBank(paths);
+  initConvolver();
+  // the script starts with everything loaded, as it would a while after boot
+  while (updateSampleLoader()) delay(1);
+  lineIn.begin(capture);
+  setRecordInput(&lineIn);
+  // the script feeds midiInput directly, without its task
+  setMidiEffectParams(&liveParams, nullptr);
+  mixerStream.setEffectActive(true);
+  mixerStream.setSendActive(false);
+  applyFilterSwitchState(false);
+}
+
+// Effect parameters which can be set by name
+struct ParamName {
+  const char* name;
+  float EffectParams::*field;
+};
+
+static const ParamName kParams[] = {
+    {"delay_time", &EffectParams::delayTimeMs},
+    {"delay_depth", &EffectParams::delayDepth},
+    {"delay_feedback", &EffectParams::delayFeedback},
+    {"filter_cutoff", &EffectParams::filterCutoffHz},
+    {"filter_q", &EffectParams::filterQ},
+    {"filter_slew", &EffectParams::filterSlewHzPerSec},
+    {"dry", &EffectParams::dryMix},
+    {"wet", &EffectParams::wetMix},
+    {"comp_attack", &EffectParams::compAttackMs},
+    {"comp_release", &EffectParams::compReleaseMs},
+    {"comp_hold", &EffectParams::compHoldMs},
+    {"comp_threshold", &EffectParams::compThresholdPercent},
+    {"comp_ratio", &EffectParams::compRatio},
+    {"eq_low", &EffectParams::eqLowDb},
+    {"eq_mid", &EffectParams::eqMidDb},
+    {"eq_high", &EffectParams::eqHighDb},
+};
+
+static bool isParam(const std::string& name) {
+  if (name == "comp") return true;
+  for (const ParamName& param : kParams) {
+    if (name == param.name) return true;
+  }
+  return false;
+}
+
+bool Script::parse(const std::string& text, std::string& error) {
+  events.clear();
+  std::istringstream lines(text);
+  std::string line;
+  int number = 0;
+  while (std::getline(lines, line)) {
+    ++number;
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') continue;
+    std::istringstream in(line);
+    ScriptEvent event;
+    std::string arg;
+    bool ok = static_cast<bool>(in >> event.ms >> event.command);
+    if (ok && (event.command == "press" || event.command == "release")) {
+      int button = 0;
+      ok = static_cast<bool>(in >> button) && button >= 1 && button <= (int)BUTTON_COUNT;
+      event.value = button - 1;
+    } else if (ok && (event.command == "volume" || event.command == "cutoff")) {
+      ok = static_cast<bool>(in >> event.value);
+    } else if (ok && (event.command == "filter" || event.command == "send")) {
+      ok = static_cast<bool>(in >> arg) && (arg == "on" || arg == "off");
+      event.value = arg == "on" ? 1.0f : 0.0f;
+    } else if (ok && event.command == "record") {
+      // pad, or off; value -1 stops
+      ok = static_cast<bool>(in >> arg);
+      int pad = arg == "off" ? 0 : atoi(arg.c_str());
+      ok = ok && (arg == "off" || (pad >= 1 && pad <= (int)BUTTON_COUNT));
+      event.value = pad - 1;
+      if (ok && in >> event.name) ok = event.name == "input";
+    } else if (ok && event.command == "midi") {
+      while (in >> arg) {
+        char* end = nullptr;
+        unsigned long byte = strtoul(arg.c_str(), &end, 16);
+        ok = ok && *end == '\0' && byte <= 0xFF;
+        event.midi.push_back(static_cast<uint8_t>(byte));
+      }
+      ok = ok && !event.midi.empty();
+    } else if (ok && event.command == "clock") {
+      float bpm = 0.0f, jitterMs = 0.0f;
+      uint32_t untilMs = 0;
+      ok = static_cast<bool>(in >> bpm >> jitterMs >> untilMs) && bpm > 0.0f &&
+           jitterMs >= 0.0f && untilMs > event.ms;
+      if (ok) addClockTicks(event.ms, bpm, jitterMs, untilMs);
+    } else if (ok && event.command == "set") {
+      ok = static_cast<bool>(in >> event.name >> event.value) && isParam(event.name);
+      in >> event.morphMs;
+    } else if (ok && event.command != "tap" && event.command != "end") {
+      ok = false;
+    }
+    if (!ok) {
+      error = "line " + std::to_string(number) + ": " + line;
+      return false;
+    }
+    if (event.command != "clock") events.push_back(event);
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const ScriptEvent& a, const ScriptEvent& b) { return a.ms < b.ms; });
+  return true;
+}
+
+// One midi event per tick (24 per quarter note) from startMs to untilMs;
+// the jitter comes from a fixed LCG, so the golden stays the same
+void Script::addClockTicks(uint32_t startMs, float bpm, float jitterMs, uint32_t untilMs) {
+  double periodUs = 60e6 / (bpm * 24.0);
+  uint32_t seed = 12345;
+  for (uint32_t tick = 0;; ++tick) {
+    seed = seed * 1664525u + 1013904223u;
+    double jitter = (seed / 4294967296.0 * 2.0 - 1.0) * jitterMs * 1000.0;
+    double us = startMs * 1000.0 + tick * periodUs + jitter;
+    if (us >= untilMs * 1000.0) break;
+    if (us < 0.0) continue;
+    ScriptEvent event;
+    uint64_t arrivalUs = static_cast<uint64_t>(us + 0.5);
+    event.ms = static_cast<uint32_t>(arrivalUs / 1000);
+    event.offsetUs = static_cast<uint32_t>(arrivalUs % 1000);
+    event.command = "midi";
+    event.midi.push_back(0xF8);
+    events.push_back(event);
+  }
+}
+
+bool Script::load(const char* path, std::string& error) {
+  std::ifstream file(path);
+  if (!file) {
+    error = std::string("cannot read ") + path;
+    return false;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  return parse(text.str(), error);
+}
+
+// Without an end event the tails get two seconds after the last event
+uint32_t Script::durationMs() const {
+  for (const ScriptEvent& event : events) {
+    if (event.command == "end") return event.ms;
+  }
+  return events.empty() ? 0 : events.back().ms + 2000;
+}
+
+// Same reactions as in loop() on the board
+void Script::apply(const ScriptEvent& event) {
+  size_t button = event.value > 0 ? static_cast<size_t>(event.value) : 0;
+  if (event.command == "press") {
+    char path[8];
+    snprintf(path, sizeof(path), "/%u.wav", static_cast<unsigned>(button + 1));
+    if (playSample(button, path)) activeButton = static_cast<int>(button);
+  } else if (event.command == "release") {
+    if (activeButton == static_cast<int>(button)) {
+      releaseSample();
+      activeButton = -1;
+    }
+  } else if (event.command == "volume") {
+    mixerStream.setInputGain(event.value);
+  } else if (event.command == "cutoff") {
+    liveParams.filterCutoffHz = event.value;
+    mixerStream.setInputLowPassCutoff(event.value);
+  } else if (event.command == "filter") {
+    applyFilterSwitchState(event.value != 0.0f);
+  } else if (event.command == "send") {
+    mixerStream.setSendActive(event.value != 0.0f);
+  } else if (event.command == "record") {
+    if (event.value < 0) {
+      stopRecording();
+    } else if (!startRecording(button, event.name == "input" ? RecordSource::Input
+                                                              : RecordSource::Output)) {
+      printf("cannot record into pad %u\n", static_cast<unsigned>(button + 1));
+    }
+  } else if (event.command == "midi") {
+    // stamped on the clock of the capture, as the MIDI task does with micros()
+    uint64_t arrivalUs = uint64_t(event.ms) * 1000 + event.offsetUs;
+    for (uint8_t byte : event.midi) {
+      midiInput.receive(byte, arrivalUs);
+      arrivalUs += MIDI_BYTE_US;
+    }
+  } else if (event.command == "tap") {
+    tapTempo();
+  } else if (event.command == "set") {
+    if (event.name == "comp") liveParams.compEnabled = event.value != 0.0f ? 1 : 0;
+    for (const ParamName& param : kParams) {
+      if (event.name == param.name) liveParams.*param.field = event.value;
+    }
+    mixerStream.setParams(liveParams, static_cast<uint32_t>(event.morphMs));
+  }
+}
+
+// The audio clock of the script: the time of the capture since its start
+static const CaptureStream* clockCapture = nullptr;
+static uint64_t clockStartFrame = 0;
+
+static uint64_t captureClockUs() {
+  return (clockCapture->frames() - clockStartFrame) * 1000000ull / outputInfo().sample_rate;
+}
+
+void Script::run(CaptureStream& capture) {
+  uint32_t rate = capture.audioInfo().sample_rate;
+  uint64_t startFrame = capture.frames();
+  clockCapture = &capture;
+  clockStartFrame = startFrame;
+  setAudioClock(captureClockUs);
+  uint64_t endFrame = startFrame + uint64_t(durationMs()) * rate / 1000;
+  // the capture stands in for the DMA buffers: it must not allocate in the
+  // audio thread, one copy may run past the end
+  capture.reserveFrames(endFrame - startFrame + DEFAULT_BUFFER_SIZE);
+  size_t next = 0;
+  activeButton = -1;
+  while (capture.frames() < endFrame) {
+    uint64_t now = capture.frames() - startFrame;
+    while (next < events.size() && uint64_t(events[next].ms) * rate / 1000 <= now) {
+      apply(events[next++]);
+    }
+    processAudio();
+    if (!isSamplePlaying()) activeButton = -1;
+  }
+}
+
+bool checkMidiTiming() {
+  printMidiReport(Serial);
+  const MidiTiming& timing = midiTiming();
+  if (timing.notes == 0) return true;
+  int32_t frameUs = 1000000 / outputInfo().sample_rate;
+  return timing.late == 0 && timing.maxUs - timing.minUs <= frameUs;
+}
+
+RecordStatus finishRecording() {
+  while (sampleRecorder.status().saving) delay(1);
+  RecordStatus status = sampleRecorder.status();
+  if (status.frames > 0) {
+    printf("last take: pad %u, %u frames, dropped %u, input behind %u\n",
+           static_cast<unsigned>(status.pad + 1), static_cast<unsigned>(status.frames),
+           static_cast<unsigned>(status.dropped), static_cast<unsigned>(status.inputBehind));
+  }
+  return status;
+}
+
+static const size_t kFingerprintFrames = 2048;
+static const float kSilenceDb = -100.0f;
+
+std::string fingerprint(CaptureStream& capture) {
+  const std::vector<int16_t>& data = capture.samples();
+  int channels = capture.audioInfo().channels;
+  size_t frames = data.size() / channels;
+  std::string result = "frames " + std::to_string(frames) + "\n";
+  char line[64];
+  for (size_t start = 0; start < frames; start += kFingerprintFrames) {
+    size_t end = std::min(frames, start + kFingerprintFrames);
+    double sum[2] = {0, 0};
+    for (size_t frame = start; frame < end; ++frame) {
+      for (int ch = 0; ch < channels && ch < 2; ++ch) {
+        double value = data[frame * channels + ch] / 32768.0;
+        sum[ch] += value * value;
+      }
+    }
+    float db[2];
+    for (int ch = 0; ch < 2; ++ch) {
+      double rms = sqrt(sum[ch] / (end - start));
+      db[ch] = rms > 0 ? std::max<float>(kSilenceDb, 20.0 * log10(rms)) : kSilenceDb;
+    }
+    snprintf(line, sizeof(line), "%.2f %.2f\n", db[0], db[1]);
+    result += line;
+  }
+  return result;
+}
+
+// Loud blocks must match within 0.5 dB; near silence only roughly, as the
+// noise floor depends on rounding.
+static float toleranceDb(float level) {
+  return level > -60.0f ? 0.5f : 6.0f;
+}
+
+bool compareFingerprints(const std::string& expected, const std::string& actual,
+                         std::string& error) {
+  std::istringstream a(expected), b(actual);
+  std::string word;
+  size_t framesA = 0, framesB = 0;
+  a >> word >> framesA;
+  b >> word >> framesB;
+  if (framesA != framesB) {
+    error = "frames: expected " + std::to_string(framesA) + ", got " + std::to_string(framesB);
+    return false;
+  }
+  for (size_t block = 0; block * kFingerprintFrames < framesA; ++block) {
+    for (int ch = 0; ch < 2; ++ch) {
+      float levelA = kSilenceDb, levelB = kSilenceDb;
+      a >> levelA;
+      b >> levelB;
+      float limit = toleranceDb(std::max(levelA, levelB));
+      if (fabsf(levelA - levelB) > limit) {
+        char text[128];
+        snprintf(text, sizeof(text), "block %u (%.2f s) channel %d: expected %.2f dB, got %.2f dB",
+                 static_cast<unsigned>(block),
+                 block * kFingerprintFrames / float(outputInfo().sample_rate), ch,
+                 levelA, levelB);
+        error = text;
+        return false;
+      }
+    }
+  }
+  return true;
+}
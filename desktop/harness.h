@@ -0,0 +1,104 @@
+// harness.h - runs the engine without hardware: a host directory is the SD
+// card, a capture takes the place of the I2S output and a script plays the
+// buttons and pots.
+#pragma once
+
+#include <string>
+#include <vector>
+#include "audio_engine.h"
+
+// Output format of the I2S stream on the board
+AudioInfo outputInfo();
+
+// Collects the mixed output in place of the I2S stream
+class CaptureStream : public AudioStream {
+public:
+  size_t write(const uint8_t* data, size_t len) override;
+  int availableForWrite() override { return DEFAULT_BUFFER_SIZE; }
+
+  // The benchmark only counts the frames
+  void setKeepSamples(bool keep) { keepSamples = keep; }
+  uint64_t frames() const { return frameCount; }
+  const std::vector<int16_t>& samples() const { return data; }
+  // Makes room for the indicated frames in advance
+  void reserveFrames(uint64_t frames);
+  bool writeWAV(const char* path);
+
+private:
+  std::vector<int16_t> data;
+  uint64_t frameCount = 0;
+  bool keepSamples = true;
+};
+
+// 16 bit PCM; a forward loop (end exclusive) is written as smpl chunk
+bool writeWAVFile(const std::string& path, const std::vector<int16_t>& samples,
+                  int channels, uint32_t rate, uint32_t loopStart = 0,
+                  uint32_t loopEnd = 0);
+
+// Writes the button samples /1.wav .. /6.wav (and as IMA ADPCM in /ima) and
+// the impulse response /ir.wav into dir and removes a stale manifest and the
+// takes of the recorder
+bool generateSamples(const char* dir);
+
+// Starts the engine like setup() does on the board; psram false limits the
+// sample cache as on a module without PSRAM.
+void beginEngine(CaptureStream& capture, bool psram);
+
+// One line of a script: "<ms> <command> [args]", e.g.
+//   0 press 1
+//   250 release 1
+//   300 volume 0.5          (volume pot, 0..1)
+//   400 cutoff 800          (pot in filter mode, Hz)
+//   500 filter on           (filter switch)
+//   500 send on             (delay send switch)
+//   600 set wet 0.6 200     (effect parameter, optional morph in ms)
+//   700 record 6            (live sampling into a pad; "record 6 input" takes
+//                            the line in, a sine at the rate of the output)
+//   900 record off
+//   1000 midi 90 24 64      (bytes in hex which arrive from 1000 ms on, one
+//                            per MIDI byte time, e.g. note on C1 -> pad 1)
+//   2000 clock 120 2 4000   (MIDI clock ticks at 120 bpm, each off by up to
+//                            +-2 ms, until 4000 ms)
+//   4500 tap                (tap tempo, as the combo of the pads on the board)
+//   5000 end
+// Empty lines and lines starting with # are ignored.
+struct ScriptEvent {
+  uint32_t ms = 0;
+  std::string command;
+  std::string name;
+  float value = 0.0f;
+  float morphMs = 0.0f;
+  std::vector<uint8_t> midi;
+  uint32_t offsetUs = 0;  // arrival of the midi bytes after ms
+};
+
+class Script {
+public:
+  bool parse(const std::string& text, std::string& error);
+  bool load(const char* path, std::string& error);
+  // Renders until the end of the script
+  void run(CaptureStream& capture);
+  uint32_t durationMs() const;
+
+private:
+  std::vector<ScriptEvent> events;
+  int activeButton = -1;
+  void apply(const ScriptEvent& event);
+  void addClockTicks(uint32_t startMs, float bpm, float jitterMs, uint32_t untilMs);
+};
+
+// Scheduling lateness of the MIDI notes; false when a note started late or
+// the spread exceeds one frame. The script stamps the arrival of the bytes
+// itself, so only the scheduling is checked, not the estimate of the arrival
+// in the MIDI task.
+bool checkMidiTiming();
+
+// Waits until the last take is saved; prints and returns its counters
+RecordStatus finishRecording();
+
+// Level per block of the capture in dBFS (left and right) for golden tests
+std::string fingerprint(CaptureStream& capture);
+
+// Compares two fingerprints; describes the first difference in error
+bool compareFingerprints(const std::string& expected, const std::string& actual,
+                         std::string& error);
@@ -0,0 +1,99 @@
+// bankra-render: plays a script of button and pot events through the engine
+// and writes the output as WAV and/or checks it against a golden fingerprint.
+//
+//   bankra-render --sd DIR [--generate] [--no-psram] --script FILE
+//                 [--out OUT.wav] [--check GOLDEN | --update GOLDEN]
+// --check also fails when processAudio() allocated on the heap, a recording
+// dropped frames or a MIDI note did not start at its frame.
+#include <fstream>
+#include <sstream>
+#include "harness.h"
+
+static int usage() {
+  fprintf(stderr,
+          "usage: bankra-render --sd DIR [--generate] [--no-psram] --script FILE\n"
+          "                     [--out OUT.wav] [--check GOLDEN | --update GOLDEN]\n");
+  return 2;
+}
+
+int main(int argc, char* argv[]) {
+  const char* sd = nullptr;
+  const char* scriptPath = nullptr;
+  const char* outPath = nullptr;
+  const char* checkPath = nullptr;
+  const char* updatePath = nullptr;
+  bool generate = false;
+  bool psram = true;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--sd" && hasValue) sd = argv[++i];
+    else if (arg == "--script" && hasValue) scriptPath = argv[++i];
+    else if (arg == "--out" && hasValue) outPath = argv[++i];
+    else if (arg == "--check" && hasValue) checkPath = argv[++i];
+    else if (arg == "--update" && hasValue) updatePath = argv[++i];
+    else if (arg == "--generate") generate = true;
+    else if (arg == "--no-psram") psram = false;
+    else return usage();
+  }
+  if (sd == nullptr || scriptPath == nullptr) return usage();
+
+  std::string error;
+  Script script;
+  if (!script.load(scriptPath, error)) {
+    fprintf(stderr, "script: %s\n", error.c_str());
+    return 1;
+  }
+  if (generate && !generateSamples(sd)) {
+    fprintf(stderr, "cannot write the samples to %s\n", sd);
+    return 1;
+  }
+  SD.setRoot(sd);
+  CaptureStream capture;
+  beginEngine(capture, psram);
+  script.run(capture);
+  printf("rendered %.2f s\n", capture.frames() / float(outputInfo().sample_rate));
+  RecordStatus take = finishRecording();
+  bool midiOnTime = checkMidiTiming();
+  printTempoReport(Serial);
+  printAudioMemoryReport(Serial);
+
+  if (outPath != nullptr && !capture.writeWAV(outPath)) {
+    fprintf(stderr, "cannot write %s\n", outPath);
+    return 1;
+  }
+  std::string actual = fingerprint(capture);
+  if (updatePath != nullptr) {
+    std::ofstream(updatePath) << actual;
+    printf("updated %s\n", updatePath);
+  }
+  if (checkPath != nullptr) {
+    std::ifstream file(checkPath);
+    if (!file) {
+      fprintf(stderr, "cannot read %s\n", checkPath);
+      return 1;
+    }
+    std::stringstream expected;
+    expected << file.rdbuf();
+    if (!compareFingerprints(expected.str(), actual, error)) {
+      fprintf(stderr, "golden mismatch: %s\n", error.c_str());
+      return 1;
+    }
+    printf("matches %s\n", checkPath);
+    // the engine must not touch the heap while it renders
+    if (AllocationGuard::instance().count() > 0) {
+      fprintf(stderr, "heap allocations in processAudio()\n");
+      return 1;
+    }
+    // the recorder never waits: a take which fits loses nothing
+    if (take.dropped > 0) {
+      fprintf(stderr, "recording dropped %u frames\n", static_cast<unsigned>(take.dropped));
+      return 1;
+    }
+    if (!midiOnTime) {
+      fprintf(stderr, "MIDI notes started late or spread over more than a frame\n");
+      return 1;
+    }
+  }
+  return 0;
+}
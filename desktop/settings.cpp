@@ -0,0 +1,95 @@
+// bankra-settings: reads settings blobs of the current and of the previous
+// version, as the firmware does with /settings.bin after an update.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "settings_blob.h"
+
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+static void put(std::vector<uint8_t>& data, const void* value, size_t len) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+  data.insert(data.end(), bytes, bytes + len);
+}
+
+static EffectParams testParams(int index) {
+  EffectParams p = defaultEffectParams();
+  p.delayTimeMs = 100.0f + index;
+  p.wetMix = 0.01f * index;
+  p.compEnabled = index % 2;
+  p.eqLowDb = 3.0f;
+  return p;
+}
+
+// version 2 wrote the EffectParams without the EQ gains
+static std::vector<uint8_t> blobV2(const PersistedSettings& settings) {
+  const size_t paramsSize = offsetof(EffectParams, eqLowDb);
+  std::vector<uint8_t> payload;
+  put(payload, &settings.zoom, sizeof(settings.zoom));
+  put(payload, &settings.live, paramsSize);
+  put(payload, &settings.presetUsedMask, sizeof(settings.presetUsedMask));
+  for (const EffectParams& preset : settings.presets) put(payload, &preset, paramsSize);
+  std::vector<uint8_t> data;
+  uint32_t magic = kSettingsMagic;
+  uint16_t version = 2;
+  uint16_t payloadSize = payload.size();
+  put(data, &magic, sizeof(magic));
+  put(data, &version, sizeof(version));
+  put(data, &payloadSize, sizeof(payloadSize));
+  put(data, payload.data(), payload.size());
+  uint32_t crc = settingsCrc32(data.data(), data.size());
+  put(data, &crc, sizeof(crc));
+  return data;
+}
+
+static bool sameWithoutEq(const EffectParams& a, const EffectParams& b) {
+  return memcmp(&a, &b, offsetof(EffectParams, eqLowDb)) == 0;
+}
+
+static bool defaultEq(const EffectParams& p) {
+  return p.eqLowDb == MASTER_EQ_DEFAULT_DB && p.eqMidDb == MASTER_EQ_DEFAULT_DB &&
+         p.eqHighDb == MASTER_EQ_DEFAULT_DB;
+}
+
+int main() {
+  PersistedSettings settings;
+  fillDefaultSettings(settings);
+  settings.zoom = 2.5f;
+  settings.live = testParams(0);
+  settings.presetUsedMask = 0x5;
+  for (size_t i = 0; i < PRESET_SLOT_COUNT; ++i) settings.presets[i] = testParams(i + 1);
+
+  // current version: everything comes back
+  SettingsBlob blob;
+  encodeSettingsBlob(settings, blob);
+  PersistedSettings loaded;
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(&blob);
+  check(decodeSettingsBlob(data, sizeof(blob), loaded) == kSettingsVersion, "current version");
+  check(memcmp(&loaded, &settings, sizeof(settings)) == 0, "current payload");
+  check(decodeSettingsBlob(data, sizeof(blob) - 1, loaded) == 0, "short blob");
+
+  // version 2: the presets are kept, the EQ gains are at their default
+  std::vector<uint8_t> v2 = blobV2(settings);
+  check(decodeSettingsBlob(v2.data(), v2.size(), loaded) == 2, "version 2");
+  check(loaded.zoom == settings.zoom, "v2 zoom");
+  check(loaded.presetUsedMask == settings.presetUsedMask, "v2 used presets");
+  check(sameWithoutEq(loaded.live, settings.live) && defaultEq(loaded.live), "v2 live");
+  for (size_t i = 0; i < PRESET_SLOT_COUNT; ++i) {
+    check(sameWithoutEq(loaded.presets[i], settings.presets[i]), "v2 preset");
+    check(defaultEq(loaded.presets[i]), "v2 preset EQ");
+  }
+
+  v2[20] ^= 1;
+  check(decodeSettingsBlob(v2.data(), v2.size(), loaded) == 0, "v2 CRC");
+  v2[20] ^= 1;
+  v2[4] = 1;
+  check(decodeSettingsBlob(v2.data(), v2.size(), loaded) == 0, "unknown version");
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,41 @@
+// Arduino.h for the desktop build: the AudioTools desktop emulation plus the
+// few Arduino and ESP32 parts that the engine uses.
+#pragma once
+
+#include <AudioTools.h>
+#include <string>
+
+// Arduino String, as far as the AudioTools SD index needs it
+class String : public std::string {
+public:
+  String() = default;
+  String(const char* str) : std::string(str != nullptr ? str : "") {}
+  String(const std::string& str) : std::string(str) {}
+
+  bool endsWith(const char* suffix) const {
+    size_t len = strlen(suffix);
+    return size() >= len && compare(size() - len, len, suffix) == 0;
+  }
+  char charAt(size_t index) const { return index < size() ? (*this)[index] : 0; }
+};
+
+// ESP32 memory queries; the defaults are those of a WROVER module. The
+// profiler reports nanoseconds, so the CPU frequency makes one "cycle" 1 ns.
+class EspClass {
+public:
+  size_t psramSize = 4 * 1024 * 1024;
+  size_t maxAllocPsram = 4 * 1024 * 1024 - 128 * 1024;
+  size_t maxAllocHeap = 110 * 1024;
+  size_t heapSize = 320 * 1024;
+  size_t freeHeap = 180 * 1024;
+
+  size_t getPsramSize() { return psramSize; }
+  size_t getFreePsram() { return psramSize > 0 ? maxAllocPsram : 0; }
+  size_t getMaxAllocPsram() { return psramSize > 0 ? maxAllocPsram : 0; }
+  size_t getHeapSize() { return heapSize; }
+  size_t getFreeHeap() { return freeHeap; }
+  size_t getMaxAllocHeap() { return maxAllocHeap; }
+  uint32_t getCpuFreqMHz() { return 1000; }
+};
+
+extern EspClass ESP;
@@ -0,0 +1,69 @@
+// SD.h for the desktop build: the card is a host directory (SD.setRoot()) and
+// a File shares its handle between copies like the ESP32 File does.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "SPI.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class File : public Stream {
+public:
+  File() = default;
+
+  size_t write(uint8_t ch) override { return write(&ch, 1); }
+  size_t write(const uint8_t* data, size_t len) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(uint8_t* data, size_t len) override;
+  int read(uint8_t* data, size_t len) { return readBytes(data, len); }
+  size_t readBytesUntil(char terminator, char* buffer, size_t length);
+  void flush() override;
+
+  bool seek(uint32_t pos);
+  size_t position();
+  size_t size();
+  void close();
+  // path on the card, e.g. "/1.wav"
+  const char* name() const;
+
+  bool isDirectory() const;
+  File openNextFile();
+  void rewindDirectory();
+
+  operator bool() const { return handle != nullptr; }
+
+private:
+  friend class SDClass;
+  struct Handle;
+  std::shared_ptr<Handle> handle;
+};
+
+class SDClass {
+public:
+  // Host directory which is the root of the card
+  void setRoot(const char* dir) { root = dir; }
+  const char* getRoot() const { return root.c_str(); }
+
+  bool begin(int cs = PIN_CS) { return true; }
+  bool begin(int cs, SPIClass& spi, uint32_t frequency = 0) { return true; }
+  void end() {}
+
+  File open(const char* path, const char* mode = FILE_READ);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  bool mkdir(const char* path);
+
+private:
+  std::string root = ".";
+  std::string hostPath(const char* path) const;
+};
+
+extern SDClass SD;
@@ -0,0 +1,16 @@
+// SPI.h for the desktop build: the SD card is a host directory
+#pragma once
+
+#include "Arduino.h"
+
+#ifndef PIN_CS
+#  define PIN_CS -1
+#endif
+
+class SPIClass {
+public:
+  void begin(int sck = -1, int miso = -1, int mosi = -1, int ss = -1) {}
+  void end() {}
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,153 @@
+#include "SD.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+EspClass ESP;
+SPIClass SPI;
+SDClass SD;
+
+struct File::Handle {
+  FILE* fp = nullptr;
+  std::string path;                  // on the card
+  std::string host;                  // on the host
+  bool directory = false;
+  std::vector<std::string> entries;  // sorted, so the order is reproducible
+  size_t next = 0;
+
+  ~Handle() {
+    if (fp != nullptr) fclose(fp);
+  }
+};
+
+size_t File::write(const uint8_t* data, size_t len) {
+  if (!handle || handle->fp == nullptr) return 0;
+  return fwrite(data, 1, len, handle->fp);
+}
+
+int File::available() {
+  if (!handle || handle->fp == nullptr) return 0;
+  return static_cast<int>(size() - position());
+}
+
+int File::read() {
+  if (!handle || handle->fp == nullptr) return -1;
+  return fgetc(handle->fp);
+}
+
+int File::peek() {
+  int ch = read();
+  if (ch != EOF) ungetc(ch, handle->fp);
+  return ch;
+}
+
+size_t File::readBytes(uint8_t* data, size_t len) {
+  if (!handle || handle->fp == nullptr) return 0;
+  return fread(data, 1, len, handle->fp);
+}
+
+size_t File::readBytesUntil(char terminator, char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int ch = read();
+    if (ch < 0 || ch == terminator) break;
+    buffer[count++] = static_cast<char>(ch);
+  }
+  return count;
+}
+
+void File::flush() {
+  if (handle && handle->fp != nullptr) fflush(handle->fp);
+}
+
+bool File::seek(uint32_t pos) {
+  if (!handle || handle->fp == nullptr) return false;
+  return fseek(handle->fp, pos, SEEK_SET) == 0;
+}
+
+size_t File::position() {
+  if (!handle || handle->fp == nullptr) return 0;
+  return ftell(handle->fp);
+}
+
+size_t File::size() {
+  if (!handle) return 0;
+  struct stat info;
+  if (handle->fp != nullptr) fflush(handle->fp);
+  return stat(handle->host.c_str(), &info) == 0 ? info.st_size : 0;
+}
+
+void File::close() {
+  handle.reset();
+}
+
+const char* File::name() const {
+  return handle ? handle->path.c_str() : "";
+}
+
+bool File::isDirectory() const {
+  return handle && handle->directory;
+}
+
+File File::openNextFile() {
+  if (!isDirectory() || handle->next >= handle->entries.size()) return File();
+  std::string path = handle->path;
+  if (path.empty() || path.back() != '/') path += "/";
+  path += handle->entries[handle->next++];
+  return SD.open(path.c_str());
+}
+
+void File::rewindDirectory() {
+  if (handle) handle->next = 0;
+}
+
+std::string SDClass::hostPath(const char* path) const {
+  std::string result = root;
+  if (path[0] != '/') result += "/";
+  return result + path;
+}
+
+File SDClass::open(const char* path, const char* mode) {
+  File file;
+  auto handle = std::make_shared<File::Handle>();
+  handle->path = path;
+  handle->host = hostPath(path);
+  struct stat info;
+  if (stat(handle->host.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+    DIR* dir = opendir(handle->host.c_str());
+    if (dir == nullptr) return file;
+    while (dirent* entry = readdir(dir)) {
+      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+      handle->entries.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(handle->entries.begin(), handle->entries.end());
+    handle->directory = true;
+  } else {
+    // binary, and "r" must not create the file
+    std::string binary = std::string(mode) + "b";
+    handle->fp = fopen(handle->host.c_str(), binary.c_str());
+    if (handle->fp == nullptr) return file;
+  }
+  file.handle = handle;
+  return file;
+}
+
+bool SDClass::exists(const char* path) {
+  return access(hostPath(path).c_str(), F_OK) == 0;
+}
+
+bool SDClass::remove(const char* path) {
+  return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool SDClass::rename(const char* from, const char* to) {
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool SDClass::mkdir(const char* path) {
+  return ::mkdir(hostPath(path).c_str(), 0777) == 0;
+}
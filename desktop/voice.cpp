@@ -0,0 +1,188 @@
+// bankra-voice: plays looped samples from the SampleBank with the SampleVoice
+// and checks the wrap at loopEnd, the turns of a ping-pong loop, the end of a
+// hold loop and retriggers faster than the fade.
+//
+//   bankra-voice DIR      (DIR is the SD card, the test samples are written)
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "harness.h"
+#include "sample_bank.h"
+
+static const uint32_t kRate = 44100;
+static const size_t kFrames = 44100;
+static const size_t kLoopStart = 11000;
+static const size_t kLoopEnd = 33000;  // 164.6 periods: not continuous by itself
+// largest step of the sine between two frames, with some room for the seam
+static const int kMaxStep = 1000;
+
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// Collects the left channel of the voice
+class Collector : public Print {
+public:
+  size_t write(uint8_t ch) override { return 0; }
+  size_t write(const uint8_t* data, size_t len) override {
+    const int16_t* samples = reinterpret_cast<const int16_t*>(data);
+    for (size_t i = 0; i < len / sizeof(int16_t); i += 2) left.push_back(samples[i]);
+    return len;
+  }
+  std::vector<int16_t> left;
+};
+
+static SampleBank bank;
+static std::vector<int16_t> original;
+
+static void writeSource(const std::string& path, bool dc) {
+  original.clear();
+  std::vector<int16_t> data;
+  for (size_t j = 0; j < kFrames; ++j) {
+    double sine = 10000.0 * sin(2.0 * M_PI * 330.0 * j / kRate);
+    int16_t value = dc ? 10000 : static_cast<int16_t>(lround(sine));
+    original.push_back(value);
+    data.push_back(value);
+    data.push_back(value);
+  }
+  check(writeWAVFile(path, data, 2, kRate), "write sample");
+}
+
+// Imports the file with the loop of the entry, as the manifest defines it
+static void load(SampleSlot& slot, const char* path, LoopMode mode) {
+  File file = SD.open(path);
+  ManifestEntry entry;
+  entry.fileSize = file.size();
+  file.close();
+  entry.sampleRate = kRate;
+  entry.frames = kFrames;
+  entry.sliceCount = 1;
+  entry.loopMode = mode;
+  entry.loopStart = kLoopStart;
+  entry.loopEnd = kLoopEnd;
+  check(bank.import(slot, path, &entry, 1024 * 1024), "import");
+  check(slot.loopMode == mode, "loop mode");
+  check(mode == LoopMode::OneShot || slot.loopEnd == kLoopEnd, "loop points");
+}
+
+// Renders frames (or until the voice ends with frames = 0)
+static void render(SampleVoice& voice, size_t frames) {
+  size_t done = 0;
+  while (voice.isActive() && (frames == 0 || done < frames)) {
+    size_t n = SAMPLE_VOICE_BLOCK_FRAMES;
+    if (frames > 0 && frames - done < n) n = frames - done;
+    done += voice.copy(n) / (2 * sizeof(int16_t));
+  }
+}
+
+static int maxStep(const std::vector<int16_t>& out, size_t from, size_t to) {
+  int result = 0;
+  for (size_t j = from + 1; j < to && j < out.size(); ++j) {
+    result = std::max(result, std::abs(out[j] - out[j - 1]));
+  }
+  return result;
+}
+
+// 3 cycles of the loop: every wrap to loopStart is continuous
+static void testForward(SampleSlot& slot) {
+  check(slot.seamFrames > 0, "seam");
+  Collector out;
+  SampleVoice voice;
+  voice.begin(out, AudioInfo(kRate, 2, 16), BUTTON_FADE_MS);
+  voice.play(slot);
+  render(voice, kLoopEnd + 3 * (kLoopEnd - kLoopStart));
+  printf("forward: largest step %d\n", maxStep(out.left, 0, out.left.size()));
+  check(maxStep(out.left, 0, out.left.size()) < kMaxStep, "forward wrap");
+  // after the wrap the loop starts again with the original frames
+  for (size_t j = 0; j < 100; ++j) {
+    check(out.left[kLoopEnd + j] == original[kLoopStart + j], "forward loopStart");
+  }
+}
+
+// The turns repeat the frames in the opposite direction
+static void testPingPong(SampleSlot& slot) {
+  Collector out;
+  SampleVoice voice;
+  voice.begin(out, AudioInfo(kRate, 2, 16), BUTTON_FADE_MS);
+  voice.play(slot);
+  render(voice, kLoopEnd + 3 * (kLoopEnd - kLoopStart));
+  check(maxStep(out.left, 0, out.left.size()) < kMaxStep, "ping-pong steps");
+  // kLoopEnd - 1 is played once, then kLoopEnd - 2 ...
+  for (size_t j = 0; j < 100; ++j) {
+    check(out.left[kLoopEnd + j] == original[kLoopEnd - 2 - j], "top turn");
+  }
+  size_t bottom = kLoopEnd + (kLoopEnd - 2 - kLoopStart);
+  check(out.left[bottom] == original[kLoopStart], "bottom turn");
+  for (size_t j = 1; j < 100; ++j) {
+    check(out.left[bottom + j] == original[kLoopStart + j], "after bottom turn");
+  }
+}
+
+// After the release the hold loop plays the rest of the sample and ends
+static void testHold(SampleSlot& slot) {
+  Collector out;
+  SampleVoice voice;
+  voice.begin(out, AudioInfo(kRate, 2, 16), BUTTON_FADE_MS);
+  voice.play(slot);
+  const size_t held = kLoopEnd + 7000;
+  render(voice, held);
+  voice.noteOff();
+  render(voice, 0);
+  check(!voice.isActive(), "hold ends");
+  check(maxStep(out.left, 0, out.left.size()) < kMaxStep, "hold steps");
+  // the loop is left at kLoopStart + 7000, in front of the seam
+  check(out.left.size() == held + kFrames - (kLoopStart + 7000), "hold length");
+  for (size_t j = 1; j <= 100; ++j) {
+    check(out.left[out.left.size() - j] == original[kFrames - j], "hold end");
+  }
+}
+
+// A retrigger while the previous tail still fades: the fades continue
+static void testRetrigger(SampleSlot& slot) {
+  Collector out;
+  SampleVoice voice;
+  voice.begin(out, AudioInfo(kRate, 2, 16), BUTTON_FADE_MS);
+  size_t fadeFrames = kRate * BUTTON_FADE_MS / 1000;
+  for (int j = 0; j < 20; ++j) {
+    voice.play(slot, 0, slot.frames);
+    render(voice, j % 2 ? 60 : 20);
+  }
+  render(voice, 2000);
+  // each ramp changes the level by 10000 / fadeFrames per frame: a main
+  // attack and at most two fades at once
+  int step = maxStep(out.left, 0, out.left.size());
+  printf("retrigger: largest step %d, ramp %d per frame\n", step,
+         static_cast<int>(10000 / fadeFrames));
+  check(step <= 4 * static_cast<int>(10000 / fadeFrames + 1), "retrigger without click");
+  check(out.left.back() == 10000, "level after the retriggers");
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    printf("usage: bankra-voice DIR\n");
+    return 1;
+  }
+  SD.setRoot(argv[1]);
+  bank.begin(AudioInfo(kRate, 2, 16), 4 * 1024 * 1024);
+  std::string root = argv[1];
+
+  writeSource(root + "/loop.wav", false);
+  SampleSlot slot;
+  load(slot, "/loop.wav", LoopMode::Forward);
+  testForward(slot);
+  load(slot, "/loop.wav", LoopMode::PingPong);
+  testPingPong(slot);
+  load(slot, "/loop.wav", LoopMode::Hold);
+  testHold(slot);
+
+  writeSource(root + "/dc.wav", true);
+  load(slot, "/dc.wav", LoopMode::OneShot);
+  testRetrigger(slot);
+  printf("ok\n");
+  return 0;
+}
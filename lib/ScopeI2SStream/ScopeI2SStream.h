@@ -45,6 +45,7 @@ class ScopeI2SStream : public I2SStream {
      * Override write() om samples te capturen voor scope display
      */
     size_t write(const uint8_t *data, size_t len) override {
+      AUDIO_PROFILE_SCOPE("i2s");
       captureForScope(data, len);
       // Schrijf data door naar I2S hardware
       return I2SStream::write(data, len);
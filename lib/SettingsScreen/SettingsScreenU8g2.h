@@ -28,6 +28,11 @@ public:
 		ITEM_COMP_HOLD,
 		ITEM_COMP_THRESHOLD,
 		ITEM_COMP_RATIO,
+		ITEM_PRESET_SLOT,
+		ITEM_PRESET_MORPH,
+		ITEM_PRESET_RECALL,
+		ITEM_PRESET_STORE,
+		ITEM_CPU_LOAD,
 		ITEM_COUNT
 	};
 
@@ -49,6 +54,8 @@ public:
 	void setCompressorThresholdCallback(std::function<void(float)> cb) { compThresholdCallback = cb; }
 	void setCompressorRatioCallback(std::function<void(float)> cb) { compRatioCallback = cb; }
 	void setCompressorEnabledCallback(std::function<void(bool)> cb) { compEnabledCallback = cb; }
+	void setPresetRecallCallback(std::function<void(uint8_t, float)> cb) { presetRecallCallback = cb; }
+	void setPresetStoreCallback(std::function<void(uint8_t)> cb) { presetStoreCallback = cb; }
 
 	void begin() {}
 
@@ -141,6 +148,32 @@ public:
 	void setCompressorHoldMs(float ms) { compHoldMs = clampValue(ms, MASTER_COMPRESSOR_HOLD_MIN_MS, MASTER_COMPRESSOR_HOLD_MAX_MS); markDirty(); notifyCompressorHoldChanged(); }
 	void setCompressorThresholdPercent(float pct) { compThresholdPercent = clampValue(pct, MASTER_COMPRESSOR_THRESHOLD_MIN, MASTER_COMPRESSOR_THRESHOLD_MAX); markDirty(); notifyCompressorThresholdChanged(); }
 	void setCompressorRatio(float ratio) { compRatio = clampValue(ratio, MASTER_COMPRESSOR_RATIO_MIN, MASTER_COMPRESSOR_RATIO_MAX); markDirty(); notifyCompressorRatioChanged(); }
+
+	uint8_t getPresetSlot() const { return presetSlot; }
+	float getPresetMorphMs() const { return presetMorphMs; }
+	void setPresetMorphMs(float ms) { presetMorphMs = clampValue(ms, PRESET_MORPH_MIN_MS, PRESET_MORPH_MAX_MS); markDirty(); }
+
+	// Which slots hold a stored preset (bit per slot), for display only.
+	void setPresetUsedMask(uint32_t mask) { presetUsedMask = mask; markDirty(); }
+
+	// Audio block processing time (p99) in percent of the block duration, for
+	// display only. Only redraws when the shown value changes. Until it is set
+	// (e.g. the profiler is compiled out) the item shows "n/a".
+	void setCpuLoadPercent(float pct) {
+		if (cpuLoadPercent >= 0.0f && (int)(pct + 0.5f) == (int)(cpuLoadPercent + 0.5f)) return;
+		cpuLoadPercent = pct;
+		markDirty();
+	}
+
+	// Runs fn with change callbacks muted, e.g. to mirror a recalled preset on
+	// screen without pushing every value back into the engine one by one.
+	template <typename Fn>
+	void withCallbacksMuted(Fn fn) {
+		bool previous = callbacksMuted;
+		callbacksMuted = true;
+		fn();
+		callbacksMuted = previous;
+	}
 private:
 	U8G2 &u8g2;
 	bool active = false;
@@ -164,6 +197,11 @@ private:
 	float compHoldMs = MASTER_COMPRESSOR_HOLD_MS;
 	float compThresholdPercent = MASTER_COMPRESSOR_THRESHOLD_PERCENT;
 	float compRatio = MASTER_COMPRESSOR_RATIO;
+	uint8_t presetSlot = 0;
+	float presetMorphMs = PRESET_MORPH_DEFAULT_MS;
+	uint32_t presetUsedMask = 0;
+	float cpuLoadPercent = -1.0f;  // < 0: not measured
+	bool callbacksMuted = false;
 
 	std::function<void(float)> zoomCallback;
 	std::function<void(float)> filterCutoffCallback;
@@ -180,24 +218,26 @@ private:
 	std::function<void(float)> compThresholdCallback;
 	std::function<void(float)> compRatioCallback;
 	std::function<void(bool)> compEnabledCallback;
+	std::function<void(uint8_t, float)> presetRecallCallback;
+	std::function<void(uint8_t)> presetStoreCallback;
 
 	void markDirty() { dirty = true; }
 
-	void notifyZoomChanged() { if (zoomCallback) zoomCallback(zoom); }
-	void notifyDelayTimeChanged() { if (delayTimeCallback) delayTimeCallback(delayTimeMs); }
-	void notifyDelayDepthChanged() { if (delayDepthCallback) delayDepthCallback(delayDepth); }
-	void notifyDelayFeedbackChanged() { if (delayFeedbackCallback) delayFeedbackCallback(delayFeedback); }
-	void notifyFilterCutoffChanged() { if (filterCutoffCallback) filterCutoffCallback(filterCutoffHz); }
-	void notifyFilterQChanged() { if (filterQCallback) filterQCallback(filterQ); }
-	void notifyFilterSlewChanged() { if (filterSlewCallback) filterSlewCallback(filterSlewHzPerSec); }
-	void notifyDryMixChanged() { if (dryMixCallback) dryMixCallback(dryMix); }
-	void notifyWetMixChanged() { if (wetMixCallback) wetMixCallback(wetMix); }
-	void notifyCompressorEnabledChanged() { if (compEnabledCallback) compEnabledCallback(compEnabled); }
-	void notifyCompressorAttackChanged() { if (compAttackCallback) compAttackCallback(compAttackMs); }
-	void notifyCompressorReleaseChanged() { if (compReleaseCallback) compReleaseCallback(compReleaseMs); }
-	void notifyCompressorHoldChanged() { if (compHoldCallback) compHoldCallback(compHoldMs); }
-	void notifyCompressorThresholdChanged() { if (compThresholdCallback) compThresholdCallback(compThresholdPercent); }
-	void notifyCompressorRatioChanged() { if (compRatioCallback) compRatioCallback(compRatio); }
+	void notifyZoomChanged() { if (!callbacksMuted && zoomCallback) zoomCallback(zoom); }
+	void notifyDelayTimeChanged() { if (!callbacksMuted && delayTimeCallback) delayTimeCallback(delayTimeMs); }
+	void notifyDelayDepthChanged() { if (!callbacksMuted && delayDepthCallback) delayDepthCallback(delayDepth); }
+	void notifyDelayFeedbackChanged() { if (!callbacksMuted && delayFeedbackCallback) delayFeedbackCallback(delayFeedback); }
+	void notifyFilterCutoffChanged() { if (!callbacksMuted && filterCutoffCallback) filterCutoffCallback(filterCutoffHz); }
+	void notifyFilterQChanged() { if (!callbacksMuted && filterQCallback) filterQCallback(filterQ); }
+	void notifyFilterSlewChanged() { if (!callbacksMuted && filterSlewCallback) filterSlewCallback(filterSlewHzPerSec); }
+	void notifyDryMixChanged() { if (!callbacksMuted && dryMixCallback) dryMixCallback(dryMix); }
+	void notifyWetMixChanged() { if (!callbacksMuted && wetMixCallback) wetMixCallback(wetMix); }
+	void notifyCompressorEnabledChanged() { if (!callbacksMuted && compEnabledCallback) compEnabledCallback(compEnabled); }
+	void notifyCompressorAttackChanged() { if (!callbacksMuted && compAttackCallback) compAttackCallback(compAttackMs); }
+	void notifyCompressorReleaseChanged() { if (!callbacksMuted && compReleaseCallback) compReleaseCallback(compReleaseMs); }
+	void notifyCompressorHoldChanged() { if (!callbacksMuted && compHoldCallback) compHoldCallback(compHoldMs); }
+	void notifyCompressorThresholdChanged() { if (!callbacksMuted && compThresholdCallback) compThresholdCallback(compThresholdPercent); }
+	void notifyCompressorRatioChanged() { if (!callbacksMuted && compRatioCallback) compRatioCallback(compRatio); }
 
 	void adjustCurrentItem(int delta) {
 		auto coarseMult = [](float fine) { return fine * 5.0f; };
@@ -251,6 +291,24 @@ private:
 			case ITEM_COMP_RATIO:
 				applyAdjustment(compRatio, delta, MASTER_COMPRESSOR_RATIO_MIN, MASTER_COMPRESSOR_RATIO_MAX, MASTER_COMPRESSOR_RATIO_STEP, coarseMult(MASTER_COMPRESSOR_RATIO_STEP), [this]{ notifyCompressorRatioChanged(); });
 				break;
+			case ITEM_PRESET_SLOT:
+				if (delta != 0) {
+					int next = static_cast<int>(presetSlot) + (delta > 0 ? 1 : -1);
+					if (next < 0) next = PRESET_SLOT_COUNT - 1;
+					if (next >= static_cast<int>(PRESET_SLOT_COUNT)) next = 0;
+					presetSlot = static_cast<uint8_t>(next);
+					markDirty();
+				}
+				break;
+			case ITEM_PRESET_MORPH:
+				applyAdjustment(presetMorphMs, delta, PRESET_MORPH_MIN_MS, PRESET_MORPH_MAX_MS, PRESET_MORPH_STEP_MS, PRESET_MORPH_STEP_MS * 10.0f, nullptr);
+				break;
+			case ITEM_PRESET_RECALL:
+				if (delta != 0 && presetRecallCallback) presetRecallCallback(presetSlot, presetMorphMs);
+				break;
+			case ITEM_PRESET_STORE:
+				if (delta != 0 && presetStoreCallback) presetStoreCallback(presetSlot);
+				break;
 			
 		}
 	}
@@ -272,7 +330,8 @@ private:
 		static const char* const labels[ITEM_COUNT] = {
 			"Zoom","Delay ms","Delay depth","Delay fb","Filter Hz",
 			"Filter Q","Filter slew","Dry mix","Wet mix","Comp on",
-			"Comp atk","Comp rel","Comp hold","Comp thr","Comp ratio"
+			"Comp atk","Comp rel","Comp hold","Comp thr","Comp ratio",
+			"Preset","Morph ms","Recall","Store","CPU"
 		};
 		const int rowHeight = 10;
 		const int highlightHeight = rowHeight + 2;
@@ -324,6 +383,17 @@ private:
 					snprintf(valbuf, sizeof(valbuf), "1:%.1f", displayRatio);
 					break;
 				}
+				case ITEM_PRESET_SLOT:
+					snprintf(valbuf, sizeof(valbuf), "%u%s", presetSlot + 1,
+					         (presetUsedMask & (1u << presetSlot)) ? "" : " -");
+					break;
+				case ITEM_PRESET_MORPH: snprintf(valbuf, sizeof(valbuf), "%.0fms", presetMorphMs); break;
+				case ITEM_PRESET_RECALL:
+				case ITEM_PRESET_STORE: snprintf(valbuf, sizeof(valbuf), "P%u", presetSlot + 1); break;
+				case ITEM_CPU_LOAD:
+					if (cpuLoadPercent < 0.0f) snprintf(valbuf, sizeof(valbuf), "n/a");
+					else snprintf(valbuf, sizeof(valbuf), "%.0f%%", cpuLoadPercent);
+					break;
 			}
 			int vx = u8g2.getDisplayWidth() - (int)strlen(valbuf) * 6 - 4;
 			u8g2.drawStr(vx, baseline, valbuf);
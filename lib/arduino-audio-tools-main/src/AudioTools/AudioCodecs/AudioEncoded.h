@@ -7,6 +7,7 @@
 #include "AudioTools/CoreAudio/AudioOutput.h"
 #include "AudioTools/CoreAudio/AudioStreams.h"
 #include "AudioTools/CoreAudio/AudioTypes.h"
+#include "AudioTools/CoreAudio/AudioProfiler.h"
 
 namespace audio_tools {
 
@@ -191,6 +192,7 @@ class EncodedAudioOutput : public ModifyingOutput {
 
   /// encoder decode the data
   virtual size_t write(const uint8_t *data, size_t len) override {
+    AUDIO_PROFILE_SCOPE("decoder");
     if (len == 0) {
       // LOGI("write: %d", 0);
       return 0;
@@ -32,6 +32,14 @@ struct WAVAudioInfo : AudioInfo {
   uint32_t data_length = 0;
   uint32_t file_size = 0;
   int offset = 0;
+  /// position of the first PCM byte in the file
+  uint32_t data_start = 0;
+  /// first loop of the 'smpl' chunk: frames, the end is inclusive
+  bool has_loop = false;
+  uint32_t loop_start = 0;
+  uint32_t loop_end = 0;
+  /// 0 forward, 1 alternating (ping-pong), 2 backward
+  uint32_t loop_type = 0;
 };
 
 static const char *wav_mime = "audio/wav";
@@ -72,6 +80,13 @@ class WAVHeader {
     headerInfo.bits_per_sample = read_int16();
     if (!setPos("data")) return false;
     headerInfo.data_length = read_int32();
+    headerInfo.data_start = tell();
+    // optional sampler chunk, if it is located in front of the data
+    int smpl_pos = indexOf("smpl");
+    if (smpl_pos > 0 && smpl_pos < indexOf("data")) {
+      parseSampleChunk(buffer.data() + smpl_pos + 8,
+                       buffer.available() - smpl_pos - 8, headerInfo);
+    }
     if (headerInfo.data_length == 0 || headerInfo.data_length >= 0x7fff0000) {
       headerInfo.is_streamed = true;
       headerInfo.data_length = ~0;
@@ -82,6 +97,19 @@ class WAVHeader {
     return true;
   }
 
+  /// Reads the first loop of a 'smpl' chunk: data points behind the chunk id
+  /// and size. Use it also for chunks which follow the PCM data.
+  static bool parseSampleChunk(const uint8_t *data, size_t len,
+                               WAVAudioInfo &info) {
+    // 36 bytes sampler data followed by 24 bytes per loop
+    if (len < 60 || readLE32(data + 28) == 0) return false;
+    info.loop_type = readLE32(data + 40);
+    info.loop_start = readLE32(data + 44);
+    info.loop_end = readLE32(data + 48);
+    info.has_loop = info.loop_end > info.loop_start;
+    return info.has_loop;
+  }
+
   /// Returns true if the header is complete (containd data tag)
   bool isDataComplete() {
     int pos = getDataPos();
@@ -171,6 +199,11 @@ class WAVHeader {
 
   uint32_t getChar32() { return getChar(); }
 
+  static uint32_t readLE32(const uint8_t *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+           ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+  }
+
   uint32_t read_int32() {
     uint32_t value = 0;
     value |= getChar32() << 0;
@@ -354,10 +387,10 @@ class WAVDecoder : public AudioDecoder {
         if (data_start == 0) return len;
         // process the outstanding data
         result = data_start +
-                 write_out((uint8_t *)data + data_start, len - data_start);
+                 write_data((uint8_t *)data + data_start, len - data_start);
 
       } else if (isValid) {
-        result = write_out((uint8_t *)data, len);
+        result = write_data((uint8_t *)data, len);
       }
     }
     return result;
@@ -381,6 +414,7 @@ class WAVDecoder : public AudioDecoder {
   bool isFirst = true;
   bool isValid = true;
   bool active = false;
+  uint32_t data_remaining = 0;
   AudioFormat decoder_format = AudioFormat::PCM;
   AudioDecoderExt *p_decoder = nullptr;
   EncodedAudioOutput dec_out;
@@ -392,6 +426,15 @@ class WAVDecoder : public AudioDecoder {
 
   Print &out() { return p_decoder == nullptr ? *p_print : dec_out; }
 
+  /// Writes the data chunk only: chunks which follow it (e.g. LIST, smpl)
+  /// are not audio and are dropped
+  size_t write_data(const uint8_t *in_ptr, size_t in_size) {
+    size_t len = in_size < data_remaining ? in_size : data_remaining;
+    size_t written = len > 0 ? write_out(in_ptr, len) : 0;
+    data_remaining -= written;
+    return written < len ? written : in_size;
+  }
+
   virtual size_t write_out(const uint8_t *in_ptr, size_t in_size) {
     // check if we need to convert int24 data from 3 bytes to 4 bytes
     size_t result = 0;
@@ -458,6 +501,7 @@ class WAVDecoder : public AudioDecoder {
   int decodeHeader(uint8_t *in_ptr, size_t in_size) {
     int result = in_size;
     // we expect at least the full header
+    int buffered = header.available();
     int written = header.write(in_ptr, in_size);
     if (!header.isDataComplete()) {
       LOGW("WAV header misses 'data' section in len: %d",
@@ -465,6 +509,8 @@ class WAVDecoder : public AudioDecoder {
       header.dumpHeader();
       return 0;
     }
+    // parse() clears the header buffer: determine the data start in in_ptr
+    int data_start = header.getDataPos() - buffered;
     // parse header
     if (!header.parse()) {
       LOGE("WAV header parsing failed");
@@ -473,6 +519,9 @@ class WAVDecoder : public AudioDecoder {
 
     isFirst = false;
     isValid = header.audioInfo().is_valid;
+    data_remaining = header.audioInfo().is_streamed
+                         ? 0xFFFFFFFF
+                         : header.audioInfo().data_length;
 
     LOGI("WAV sample_rate: %d", (int)header.audioInfo().sample_rate);
     LOGI("WAV data_length: %u", (unsigned)header.audioInfo().data_length);
@@ -495,7 +544,7 @@ class WAVDecoder : public AudioDecoder {
     } else {
       LOGE("WAV format not supported: %d", (int)format);
     }
-    return header.getDataPos();
+    return data_start;
   }
 
   void setupEncodedAudio() {
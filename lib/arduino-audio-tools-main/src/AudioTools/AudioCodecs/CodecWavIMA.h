@@ -55,7 +55,7 @@ struct IMAState {
     int step_index = 0;
 };
 
-const char* wav_ima_mime = "audio/x-wav";
+static const char* wav_ima_mime = "audio/x-wav";
 
 /**
  * @brief Parser for Wav header data adjusted for IMA ADPCM format - partially based on CodecWAV.h
@@ -335,6 +335,8 @@ class WavIMADecoder : public AudioDecoder {
             ima_states[1].step_index = 0;
             isFirst = true;
             active = true;
+            // a stream which was stopped in the middle of a block
+            input_pos = 0;
             header.clearHeader();
             return true;
         }
@@ -423,10 +425,10 @@ class WavIMADecoder : public AudioDecoder {
 
     protected:
         WavIMAHeader header;
-        Print *out;
+        Print *out = nullptr;
         bool isFirst = true;
         bool isValid = true;
-        bool active;
+        bool active = false;
         uint8_t *input_buffer = nullptr;
         int32_t input_pos = 0;
         size_t remaining_bytes = 0;
@@ -207,6 +207,8 @@ class MultiDecoder : public AudioDecoder {
           actual_decoder.decoder->begin();
           LOGI("Decoder %s started", actual_decoder.mime);
         }
+        // closed again by end()
+        actual_decoder.is_open = true;
         result = true;
         selected_mime = mime;
         break;
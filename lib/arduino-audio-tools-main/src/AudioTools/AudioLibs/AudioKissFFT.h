@@ -36,6 +36,7 @@ class FFTDriverKissFFT : public FFTDriver {
         }
         void setValue(int idx, float value) override {
             k_data[idx].r  = value; 
+            k_data[idx].i  = 0.0f;
         }
 
         void fft() override {
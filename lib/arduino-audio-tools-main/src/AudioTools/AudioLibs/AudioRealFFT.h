@@ -58,7 +58,9 @@ class FFTDriverRealFFT : public FFTDriver {
 
         /// magnitude w/o sqrt
         float magnitudeFast(int idx) override {
-            return ((v_x[idx] * v_x[idx]) + (v_f[idx] * v_f[idx]));
+            FFTBin bin;
+            if (!getBin(idx, bin)) return 0.0f;
+            return ((bin.real * bin.real) + (bin.img * bin.img));
         }
 
         bool isValid() override{ return p_fft_object!=nullptr; }
@@ -66,16 +68,23 @@ class FFTDriverRealFFT : public FFTDriver {
         /// get Real value
         float getValue(int idx) override { return v_x[idx];}
 
+        /// FFTReal stores the bins 0..len/2 packed: f[k] = real and f[len/2+k] =
+        /// -img. The bins above len/2 are the conjugates and are implied.
         bool setBin(int pos, float real, float img) override {
             if (pos < 0 || pos >= len) return false;
-            v_x[pos] = real;
-            v_f[pos] = img;
+            int half = len / 2;
+            if (pos > half) return true;
+            v_f[pos] = real;
+            if (pos > 0 && pos < half) v_f[half + pos] = -img;
             return true;
         }
         bool getBin(int pos, FFTBin &bin) override { 
-            if (pos>=len) return false;
-            bin.real = v_x[pos];
-            bin.img = v_f[pos];
+            if (pos < 0 || pos >= len) return false;
+            int half = len / 2;
+            int k = pos > half ? len - pos : pos;
+            bin.real = v_f[k];
+            bin.img = (k > 0 && k < half) ? -v_f[half + k] : 0.0f;
+            if (pos > half) bin.conjugate();
             return true;
         }
 
@@ -15,6 +15,7 @@
 #  error We should not get here!
 #endif
 #include <ctype.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -121,6 +122,15 @@ class Print {
     return print(value, fmt) + println();
   }
 
+  int printf(const char *fmt, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    return print(buffer);
+  }
+
 #endif
 
   virtual size_t write(const uint8_t *data, size_t len) {
@@ -20,12 +20,12 @@ inline uint32_t millis(){
 }
 
 // sleep ms milliseconds
-void delay(unsigned long ms){
+inline void delay(unsigned long ms){
     std::this_thread::sleep_for(std::chrono::milliseconds(ms));    
 }
 
 // sleep us milliseconds
-void delayMicroseconds(unsigned int us){
+inline void delayMicroseconds(unsigned int us){
     std::this_thread::sleep_for(std::chrono::microseconds(us));        
 }
 
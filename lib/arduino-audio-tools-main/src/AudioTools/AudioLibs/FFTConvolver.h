@@ -0,0 +1,311 @@
+#pragma once
+
+#include "AudioTools/AudioLibs/AudioFFT.h"
+#include "AudioTools/AudioCodecs/CodecWAV.h"
+#include "AudioTools/CoreAudio/AudioEffects/AudioEffect.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Uniformly partitioned overlap-save convolution (e.g. with the impulse
+ * response of a cabinet or a room). The impulse response is split into
+ * partitions of the block size and the spectra of the last input blocks are
+ * kept in a frequency domain delay line, so that each block needs one fft and
+ * one inverse fft of 2 * block size and one complex multiply-add per
+ * partition. The latency is one block.
+ *
+ * Any FFTDriver can be used (e.g. FFTDriverRealFFT, FFTDriverKissFFT or
+ * FFTDriverESP32FFT) as long as getBin()/setBin() provide the standard bins
+ * 0..len/2: this is checked in setIR(). The spectra are allocated with the
+ * DefaultAllocator, which uses PSRAM when available.
+ * @ingroup effects
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FFTConvolver : public AudioEffect {
+ public:
+  FFTConvolver(FFTDriver &driver, int blockSize = 256) {
+    p_driver = &driver;
+    block_size = blockSize;
+  }
+
+  /// Defines the partition size (power of 2): call before setIR()
+  void setBlockSize(int size) { block_size = size; }
+
+  int blockSize() { return block_size; }
+
+  /// Delay between input and output in samples
+  int latency() { return block_size; }
+
+  /// Output gain which is applied to the convolution result
+  void setGain(float value) { gain = value; }
+
+  float getGain() { return gain; }
+
+  /// Number of samples of the active impulse response
+  size_t size() { return (size_t)partitions * block_size; }
+
+  /// Memory in bytes which is needed for an impulse response with the
+  /// indicated number of samples
+  static size_t memoryNeeded(size_t irLen, int blockSize = 256) {
+    size_t partitions = (irLen + blockSize - 1) / blockSize;
+    size_t spectrum = (blockSize + 1) * 2 * sizeof(float);
+    return 2 * partitions * spectrum + 6 * blockSize * sizeof(float);
+  }
+
+  /// Defines the impulse response with float values (-1.0 to 1.0)
+  bool setIR(const float *ir, size_t len) {
+    TRACEI();
+    partitions = 0;
+    if (ir == nullptr || len == 0 || !setupDriver()) return false;
+    int b = block_size;
+    int spectrum_size = (b + 1) * 2;
+    int count = (len + b - 1) / b;
+    ir_spectra.resize(count * spectrum_size);
+    fdl.resize(count * spectrum_size);
+    memset(fdl.data(), 0, fdl.size() * sizeof(float));
+    for (int p = 0; p < count; p++) {
+      for (int j = 0; j < 2 * b; j++) {
+        size_t idx = (size_t)p * b + j;
+        p_driver->setValue(j, j < b && idx < len ? ir[idx] : 0.0f);
+      }
+      p_driver->fft();
+      readSpectrum(ir_spectra.data() + p * spectrum_size);
+    }
+    partitions = count;
+    fdl_head = 0;
+    reset();
+    LOGI("FFTConvolver: %d partitions of %d samples", partitions, b);
+    return true;
+  }
+
+  /// Loads the impulse response from a 16 bit PCM WAV file: only the first
+  /// channel is used. Use maxLen to limit the memory.
+  bool loadWAV(Stream &wav, size_t maxLen = 0) {
+    TRACEI();
+    Vector<float> ir;
+    AudioInfo info;
+    IRCollector collector(ir, info, maxLen);
+    WAVDecoder decoder;
+    decoder.setOutput(collector);
+    decoder.addNotifyAudioChange(collector);
+    decoder.begin();
+    uint8_t buffer[512];
+    while (!collector.isFull()) {
+      size_t len = wav.readBytes(buffer, sizeof(buffer));
+      if (len == 0) break;
+      decoder.write(buffer, len);
+    }
+    decoder.end();
+    ir.resize(collector.size());
+    if (info.bits_per_sample != 16) {
+      LOGE("FFTConvolver: unsupported bits_per_sample %d",
+           info.bits_per_sample);
+      return false;
+    }
+    LOGI("FFTConvolver: ir with %d samples", ir.size());
+    return setIR(ir.data(), ir.size());
+  }
+
+  /// Releases the impulse response: the input is passed through until the
+  /// next setIR()
+  void end() {
+    partitions = 0;
+    pos = 0;
+    ir_spectra.reset();
+    fdl.reset();
+    accumulator.reset();
+    time_buffer.reset();
+    output_block.reset();
+  }
+
+  /// Clears the input history
+  void reset() {
+    pos = 0;
+    memset(time_buffer.data(), 0, time_buffer.size() * sizeof(float));
+    memset(output_block.data(), 0, output_block.size() * sizeof(float));
+    memset(fdl.data(), 0, fdl.size() * sizeof(float));
+  }
+
+  effect_t process(effect_t input) override {
+    if (!active() || partitions == 0) return input;
+    effect_t result = output_block[pos];
+    time_buffer[block_size + pos] = input;
+    if (++pos == block_size) processPartition();
+    return result;
+  }
+
+  void processBlock(const effect_t *in, effect_t *out, size_t n) override {
+    if (!active() || partitions == 0) return bypass(in, out, n);
+    float *input = time_buffer.data() + block_size;
+    float *output = output_block.data();
+    size_t done = 0;
+    while (done < n) {
+      size_t len = block_size - pos;
+      if (len > n - done) len = n - done;
+      for (size_t j = 0; j < len; j++) {
+        effect_t sample = in[done + j];
+        out[done + j] = output[pos + j];
+        input[pos + j] = sample;
+      }
+      pos += len;
+      done += len;
+      if (pos == block_size) processPartition();
+    }
+  }
+
+  FFTConvolver *clone() override { return new FFTConvolver(*this); }
+
+ protected:
+  FFTDriver *p_driver = nullptr;
+  int block_size = 256;
+  int partitions = 0;
+  int fdl_head = 0;
+  int pos = 0;
+  float gain = 1.0f;
+  float scale = 1.0f;
+  Vector<float> ir_spectra{0};  // partitions * (block_size + 1) bins
+  Vector<float> fdl{0};         // spectra of the last input blocks
+  Vector<float> accumulator{0};
+  Vector<float> time_buffer{0};  // last 2 blocks of input
+  Vector<float> output_block{0};
+
+  /// Collects the first channel of the decoded 16 bit samples as float
+  class IRCollector : public AudioOutput {
+   public:
+    IRCollector(Vector<float> &ir, AudioInfo &info, size_t maxLen)
+        : ir(ir), info(info), max_len(maxLen) {}
+    void setAudioInfo(AudioInfo newInfo) override { info = newInfo; }
+    bool isFull() { return max_len > 0 && count >= max_len; }
+    size_t size() { return count; }
+    size_t write(const uint8_t *data, size_t len) override {
+      if (info.bits_per_sample != 16 || info.channels <= 0) return len;
+      const int16_t *samples = (const int16_t *)data;
+      size_t sample_count = len / sizeof(int16_t);
+      for (size_t j = 0; j < sample_count; j += info.channels) {
+        if (isFull()) break;
+        if (count >= (size_t)ir.size()) grow();
+        ir[count++] = samples[j] / 32768.0f;
+      }
+      return len;
+    }
+
+   protected:
+    Vector<float> &ir;
+    AudioInfo &info;
+    size_t max_len;
+    size_t count = 0;
+
+    void grow() {
+      size_t new_size = ir.size() < 1024 ? 1024 : ir.size() * 2;
+      if (max_len > 0 && new_size > max_len) new_size = max_len;
+      ir.resize(new_size);
+    }
+  };
+
+  /// (re)starts the driver with 2 * block_size and checks its bin layout and
+  /// scaling with an impulse
+  bool setupDriver() {
+    int n = 2 * block_size;
+    if (block_size <= 0 || (block_size & (block_size - 1)) != 0) {
+      LOGE("FFTConvolver: block size must be a power of 2");
+      return false;
+    }
+    p_driver->end();
+    if (!p_driver->begin(n) || !p_driver->isReverseFFT()) {
+      LOGE("FFTConvolver: fft driver not available");
+      return false;
+    }
+    accumulator.resize((block_size + 1) * 2);
+    time_buffer.resize(n);
+    output_block.resize(block_size);
+
+    // impulse at 1: bin k must be e^(-2 pi i k / n) (or its conjugate)
+    for (int j = 0; j < n; j++) p_driver->setValue(j, j == 1 ? 1.0f : 0.0f);
+    p_driver->fft();
+    FFTBin bin1, nyquist;
+    p_driver->getBin(1, bin1);
+    p_driver->getBin(block_size, nyquist);
+    float angle = 2.0f * PI / n;
+    if (fabsf(bin1.real - cosf(angle)) > 0.001f ||
+        fabsf(fabsf(bin1.img) - sinf(angle)) > 0.001f ||
+        fabsf(nyquist.real + 1.0f) > 0.001f) {
+      LOGE("FFTConvolver: unsupported bin layout of the fft driver");
+      return false;
+    }
+    readSpectrum(accumulator.data());
+    writeSpectrum(accumulator.data());
+    p_driver->rfft();
+    float value = p_driver->getValue(1);
+    if (fabsf(value) < 0.000001f) {
+      LOGE("FFTConvolver: inverse fft failed");
+      return false;
+    }
+    // samples are kept as int16 values in the time buffer
+    scale = 1.0f / value;
+    return true;
+  }
+
+  void readSpectrum(float *spectrum) {
+    FFTBin bin;
+    for (int k = 0; k <= block_size; k++) {
+      p_driver->getBin(k, bin);
+      spectrum[2 * k] = bin.real;
+      spectrum[2 * k + 1] = bin.img;
+    }
+  }
+
+  void writeSpectrum(const float *spectrum) {
+    int n = 2 * block_size;
+    for (int k = 0; k <= block_size; k++) {
+      p_driver->setBin(k, spectrum[2 * k], spectrum[2 * k + 1]);
+    }
+    // drivers with a complex fft need the conjugate bins for a real result
+    for (int k = 1; k < block_size; k++) {
+      p_driver->setBin(n - k, spectrum[2 * k], -spectrum[2 * k + 1]);
+    }
+  }
+
+  /// Called when a full block of input is available
+  void processPartition() {
+    int b = block_size;
+    int n = 2 * b;
+    int spectrum_size = (b + 1) * 2;
+
+    // spectrum of the last 2 input blocks into the delay line
+    float *samples = time_buffer.data();
+    for (int j = 0; j < n; j++) p_driver->setValue(j, samples[j]);
+    p_driver->fft();
+    fdl_head = fdl_head == 0 ? partitions - 1 : fdl_head - 1;
+    readSpectrum(fdl.data() + fdl_head * spectrum_size);
+
+    // sum of the input spectra multiplied with the ir partitions
+    float *acc = accumulator.data();
+    memset(acc, 0, spectrum_size * sizeof(float));
+    for (int p = 0; p < partitions; p++) {
+      int slot = fdl_head + p;
+      if (slot >= partitions) slot -= partitions;
+      const float *x = fdl.data() + slot * spectrum_size;
+      const float *h = ir_spectra.data() + p * spectrum_size;
+      for (int k = 0; k < spectrum_size; k += 2) {
+        acc[k] += x[k] * h[k] - x[k + 1] * h[k + 1];
+        acc[k + 1] += x[k] * h[k + 1] + x[k + 1] * h[k];
+      }
+    }
+    writeSpectrum(acc);
+    p_driver->rfft();
+
+    // overlap-save: the second half is the valid part
+    float factor = scale * gain;
+    for (int j = 0; j < b; j++) {
+      float value = p_driver->getValue(b + j) * factor;
+      if (value > 32767.0f) value = 32767.0f;
+      if (value < -32768.0f) value = -32768.0f;
+      output_block[j] = lroundf(value);
+    }
+    memmove(samples, samples + b, b * sizeof(float));
+    pos = 0;
+  }
+};
+
+}  // namespace audio_tools
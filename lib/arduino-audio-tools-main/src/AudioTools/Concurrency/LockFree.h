@@ -1,3 +1,4 @@
 #pragma once
 #include "AudioTools/Concurrency/LockFree/QueueLockFree.h"
 #include "AudioTools/Concurrency/LockFree/ListLockFree.h"
+#include "AudioTools/Concurrency/LockFree/TripleBuffer.h"
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+
+#include <atomic>
+
+namespace audio_tools {
+
+/**
+ * @brief Hands the latest value of a struct from one writer task to one
+ * reader task without locks. The writer fills back() and publishes it, the
+ * reader takes the latest published value with update(): values which were
+ * published in between are skipped, so the writer can publish as often as it
+ * likes. Each of the three buffers belongs to one side at a time, so a value
+ * is never read while it is written (no tearing). Both sides are wait-free:
+ * e.g. for the parameters of an audio callback, which takes them over once
+ * per block.
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+  TripleBuffer(const T &initial) {
+    for (int j = 0; j < 3; j++) buffers[j] = initial;
+  }
+
+  /// Writer: the buffer to fill. After publish() it holds an older value.
+  T &back() { return buffers[back_index]; }
+
+  /// Writer: makes back() the latest value; an unread value is replaced
+  void publish() {
+    uint8_t old = middle.exchange(back_index | FRESH, std::memory_order_acq_rel);
+    back_index = old & INDEX;
+  }
+
+  /// Writer: copies and publishes the value
+  void write(const T &value) {
+    back() = value;
+    publish();
+  }
+
+  /// Reader: true when a value was published since the last call; front()
+  /// is then the latest one
+  bool update() {
+    if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+    uint8_t old = middle.exchange(front_index, std::memory_order_acq_rel);
+    front_index = old & INDEX;
+    return true;
+  }
+
+  /// Reader: the value taken by the last update()
+  const T &front() const { return buffers[front_index]; }
+
+  /// Reader: copies the latest value, if there is a new one
+  bool read(T &value) {
+    if (!update()) return false;
+    value = front();
+    return true;
+  }
+
+ protected:
+  static constexpr uint8_t INDEX = 0x3;
+  static constexpr uint8_t FRESH = 0x4;
+  T buffers[3];
+  // index of the buffer in the middle and whether it was published
+  std::atomic<uint8_t> middle{1};
+  uint8_t back_index = 0;
+  uint8_t front_index = 2;
+};
+
+}  // namespace audio_tools
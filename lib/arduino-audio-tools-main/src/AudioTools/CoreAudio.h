@@ -11,12 +11,19 @@
 #include "AudioTools/CoreAudio/AudioIO.h"
 #include "AudioTools/CoreAudio/ResampleStream.h"
 #include "AudioTools/CoreAudio/ResampleStreamT.h"
+#include "AudioTools/CoreAudio/VarispeedStream.h"
+#include "AudioTools/CoreAudio/SampleImporter.h"
+#include "AudioTools/CoreAudio/OnsetDetector.h"
+#include "AudioTools/CoreAudio/BlockCompressedPCM.h"
 #include "AudioTools/CoreAudio/StreamCopy.h"
 #include "AudioTools/CoreAudio/MusicalNotes.h"
+#include "AudioTools/CoreAudio/MidiParser.h"
 #include "AudioTools/CoreAudio/Fade.h"
 #include "AudioTools/CoreAudio/Pipeline.h"
 #include "AudioTools/CoreAudio/AudioPlayer.h"
 #include "AudioTools/CoreAudio/AudioTimer.h"
+#include "AudioTools/CoreAudio/AudioProfiler.h"
+#include "AudioTools/CoreAudio/AllocationGuard.h"
 #include "AudioTools/CoreAudio/AudioFilter.h"
 #include "AudioTools/CoreAudio/I2SStream.h"
 #include "AudioTools/CoreAudio/AudioPWM/PWMAudioOutput.h"
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "AudioToolsConfig.h"
+#include "AudioTools/CoreAudio/AudioLogger.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Detects heap allocations in real-time code: the audio task marks
+ * its render call with the AUDIO_REALTIME_SCOPE() macro and every allocation
+ * of the same task within that scope is counted (or trapped with abort() to
+ * get a backtrace). The Allocator reports its allocations; an application
+ * can also report operator new. Allocations of other tasks are not counted.
+ * Everything compiles to nothing unless USE_ALLOCATION_GUARD is true.
+ * @ingroup memorymgmt
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AllocationGuard {
+ public:
+  static AllocationGuard &instance() {
+    static AllocationGuard self;
+    return self;
+  }
+
+  /// Marks the start of the real-time section of the calling task
+  void enter() { depth()++; }
+
+  /// Marks the end of the real-time section of the calling task
+  void exit() { depth()--; }
+
+  /// True if the calling task is in a real-time section
+  bool isActive() { return depth() > 0; }
+
+  /// Called for each allocation: only counted in a real-time section
+  void onAllocate(size_t size) {
+    if (depth() == 0) return;
+    alloc_count++;
+    alloc_bytes += size;
+    if (size > max_size) max_size = size;
+    if (is_trap) {
+      LOGE("Allocation of %u bytes in real-time code", (unsigned)size);
+      abort();
+    }
+  }
+
+  /// abort() at the first allocation in a real-time section
+  void setTrap(bool trap) { is_trap = trap; }
+
+  /// Number of allocations in real-time sections
+  uint32_t count() { return alloc_count; }
+
+  /// Sum of the allocated bytes in real-time sections
+  uint32_t bytes() { return alloc_bytes; }
+
+  /// Largest single allocation in a real-time section
+  uint32_t maxSize() { return max_size; }
+
+  void reset() {
+    alloc_count = 0;
+    alloc_bytes = 0;
+    max_size = 0;
+  }
+
+ protected:
+  volatile uint32_t alloc_count = 0;
+  volatile uint32_t alloc_bytes = 0;
+  volatile uint32_t max_size = 0;
+  bool is_trap = false;
+
+  AllocationGuard() = default;
+
+  static int &depth() {
+    static thread_local int value = 0;
+    return value;
+  }
+};
+
+/**
+ * @brief Real-time section from the construction to the destruction
+ * @ingroup memorymgmt
+ */
+class AllocationGuardScope {
+ public:
+  AllocationGuardScope() { AllocationGuard::instance().enter(); }
+  ~AllocationGuardScope() { AllocationGuard::instance().exit(); }
+};
+
+}  // namespace audio_tools
+
+#if USE_ALLOCATION_GUARD
+#  define AUDIO_REALTIME_SCOPE() \
+    audio_tools::AllocationGuardScope audio_realtime_scope
+#else
+#  define AUDIO_REALTIME_SCOPE()
+#endif
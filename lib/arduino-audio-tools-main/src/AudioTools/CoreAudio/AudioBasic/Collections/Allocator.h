@@ -1,6 +1,7 @@
 #pragma once
 #include <stdlib.h>
 
+#include "AudioTools/CoreAudio/AllocationGuard.h"
 #include "AudioTools/CoreAudio/AudioLogger.h"
 #include "AudioTools/CoreAudio/AudioRuntime.h"
 #include "AudioToolsConfig.h"
@@ -68,6 +69,9 @@ class Allocator {
 
   /// Allocates memory
   virtual void* allocate(size_t size) {
+#if USE_ALLOCATION_GUARD
+    AllocationGuard::instance().onAllocate(size);
+#endif
     void* result = do_allocate(size);
     if (result == nullptr) {
       LOGE("Allocateation failed for %zu bytes", size);
@@ -176,4 +180,176 @@ class AllocatorPSRAM : public Allocator {
 static AllocatorExt DefaultAllocator;
 static Allocator DefaultAllocatorRAM;
 
+/**
+ * @brief Allocator which hands out the memory of one fixed block (the arena)
+ * that is reserved once, e.g. at boot for all objects of an audio engine: no
+ * heap fragmentation and no heap calls afterwards. Freed memory is reused
+ * (first fit, free neighbours are merged). When the arena is full, the memory
+ * comes from the fallback allocator and fallbackCount() counts this. Not
+ * thread safe: allocate from one task only.
+ * @ingroup memorymgmt
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AllocatorArena : public Allocator {
+ public:
+  AllocatorArena(Allocator& fallback = DefaultAllocatorRAM) {
+    p_fallback = &fallback;
+  }
+
+  ~AllocatorArena() { end(); }
+
+  /// Reserves the arena with the source allocator
+  bool begin(size_t size, Allocator& source = DefaultAllocatorRAM) {
+    end();
+    void* memory = source.allocate(size);
+    if (memory == nullptr) return false;
+    begin(memory, size);
+    p_source = &source;
+    return true;
+  }
+
+  /// Uses the indicated memory as arena
+  bool begin(void* memory, size_t size) {
+    end();
+    size_t offset = (ALIGN - ((uintptr_t)memory % ALIGN)) % ALIGN;
+    if (memory == nullptr || size < offset + 2 * HEADER) return false;
+    p_memory = memory;
+    p_start = (uint8_t*)memory + offset;
+    arena_size = (size - offset) / ALIGN * ALIGN;
+    Header* first = header(p_start);
+    first->size = arena_size;
+    first->prev = 0;
+    used_bytes = 0;
+    peak_bytes = 0;
+    fallback_count = 0;
+    return true;
+  }
+
+  /// Releases the arena: all memory handed out from it becomes invalid
+  void end() {
+    if (p_source != nullptr) p_source->free(p_memory);
+    p_source = nullptr;
+    p_memory = nullptr;
+    p_start = nullptr;
+    arena_size = 0;
+    used_bytes = 0;
+  }
+
+  /// Defines the allocator which is used when the arena is full (nullptr: the
+  /// allocation fails)
+  void setFallback(Allocator* fallback) { p_fallback = fallback; }
+
+  void* allocate(size_t size) override {
+    void* result = allocateInArena(size);
+    if (result != nullptr) return result;
+    if (p_fallback == nullptr) {
+      LOGE("Arena: allocation of %u bytes failed", (unsigned)size);
+      return nullptr;
+    }
+    fallback_count++;
+    return p_fallback->allocate(size);
+  }
+
+  void free(void* memory) override {
+    if (memory == nullptr) return;
+    if (!contains(memory)) {
+      if (p_fallback != nullptr) p_fallback->free(memory);
+      return;
+    }
+    Header* block = header((uint8_t*)memory - HEADER);
+    if (!isUsed(block)) return;
+    block->size &= ~USED;
+    used_bytes -= block->size;
+    // merge with the free neighbours
+    Header* next = nextBlock(block);
+    if (next != nullptr && !isUsed(next)) join(block, next);
+    if (block->prev > 0) {
+      Header* prev = header((uint8_t*)block - block->prev);
+      if (!isUsed(prev)) join(prev, block);
+    }
+  }
+
+  /// True if the memory belongs to the arena
+  bool contains(const void* memory) {
+    return p_start != nullptr && (const uint8_t*)memory >= p_start &&
+           (const uint8_t*)memory < p_start + arena_size;
+  }
+
+  /// Size of the arena in bytes
+  size_t size() { return arena_size; }
+
+  /// Bytes in use (including the block headers)
+  size_t used() { return used_bytes; }
+
+  /// Max bytes in use since begin() or resetPeak()
+  size_t peak() { return peak_bytes; }
+
+  void resetPeak() { peak_bytes = used_bytes; }
+
+  /// Number of allocations which did not fit into the arena
+  uint32_t fallbackCount() { return fallback_count; }
+
+ protected:
+  struct Header {
+    uint32_t size;  // block size including the header; bit 0: used
+    uint32_t prev;  // size of the previous block (0 for the first)
+  };
+  static constexpr uint32_t USED = 1;
+  static constexpr size_t ALIGN = 8;
+  static constexpr size_t HEADER = sizeof(Header);
+  Allocator* p_fallback = nullptr;
+  Allocator* p_source = nullptr;
+  void* p_memory = nullptr;
+  uint8_t* p_start = nullptr;
+  size_t arena_size = 0;
+  size_t used_bytes = 0;
+  size_t peak_bytes = 0;
+  uint32_t fallback_count = 0;
+
+  static Header* header(void* addr) { return (Header*)addr; }
+
+  static bool isUsed(Header* block) { return block->size & USED; }
+
+  static uint32_t blockSize(Header* block) { return block->size & ~USED; }
+
+  Header* nextBlock(Header* block) {
+    uint8_t* next = (uint8_t*)block + blockSize(block);
+    return next < p_start + arena_size ? header(next) : nullptr;
+  }
+
+  // first fit; the rest of the block is split off if it can hold data
+  void* allocateInArena(size_t size) {
+    if (p_start == nullptr) return nullptr;
+    size_t needed = HEADER + (size + ALIGN - 1) / ALIGN * ALIGN;
+    if (size == 0) needed += ALIGN;
+    for (Header* block = header(p_start); block != nullptr;
+         block = nextBlock(block)) {
+      if (isUsed(block) || block->size < needed) continue;
+      if (block->size >= needed + HEADER + ALIGN) {
+        Header* rest = header((uint8_t*)block + needed);
+        rest->size = block->size - needed;
+        rest->prev = needed;
+        Header* next = nextBlock(rest);
+        if (next != nullptr) next->prev = rest->size;
+        block->size = needed;
+      }
+      used_bytes += block->size;
+      if (used_bytes > peak_bytes) peak_bytes = used_bytes;
+      block->size |= USED;
+      void* result = (uint8_t*)block + HEADER;
+      memset(result, 0, blockSize(block) - HEADER);
+      return result;
+    }
+    return nullptr;
+  }
+
+  // appends the free block second to the free block first
+  void join(Header* first, Header* second) {
+    first->size += second->size;
+    Header* next = nextBlock(first);
+    if (next != nullptr) next->prev = first->size;
+  }
+};
+
 }  // namespace audio_tools
\ No newline at end of file
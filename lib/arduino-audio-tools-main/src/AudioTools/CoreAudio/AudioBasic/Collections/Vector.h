@@ -349,6 +349,7 @@ class Vector {
     shrink_to_fit();
     deleteArray(p_data, size());  // delete [] this->p_data;
     p_data = nullptr;
+    bufferLen = 0;
   }
 
  protected:
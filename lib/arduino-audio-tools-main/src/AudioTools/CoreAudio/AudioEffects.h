@@ -3,3 +3,4 @@
 #include "AudioTools/CoreAudio/AudioEffects/SoundGenerator.h"
 #include "AudioTools/CoreAudio/AudioEffects/AudioEffects.h"
 #include "AudioTools/CoreAudio/AudioEffects/PitchShift.h"
+#include "AudioTools/CoreAudio/AudioEffects/Reverb.h"
@@ -1,6 +1,7 @@
 #pragma once
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "AudioLogger.h"
 #include "AudioParameters.h"
@@ -28,6 +29,14 @@ class AudioEffect {
   /// calculates the effect output from the input
   virtual effect_t process(effect_t in) = 0;
 
+  /// calculates the effect output for n samples: in and out may be the same
+  /// buffer. Subclasses override this to avoid a virtual call per sample.
+  virtual void processBlock(const effect_t* in, effect_t* out, size_t n) {
+    for (size_t j = 0; j < n; j++) {
+      out[j] = process(in[j]);
+    }
+  }
+
   /// sets the effect active/inactive
   virtual void setActive(bool value) { active_flag = value; }
 
@@ -51,6 +60,11 @@ class AudioEffect {
     active_flag = copy->active_flag;
   }
 
+  /// processBlock() of an inactive effect
+  void bypass(const effect_t* in, effect_t* out, size_t n) {
+    if (in != out) memmove(out, in, n * sizeof(effect_t));
+  }
+
   /// generic clipping method
   int16_t clip(int32_t in, int16_t clipLimit = 32767,
                int16_t resultLimit = 32767) {
@@ -88,6 +102,15 @@ class Boost : public AudioEffect, public VolumeSupport {
     return clip(result);
   }
 
+  void processBlock(const effect_t* in, effect_t* out, size_t n) override {
+    if (!active()) return bypass(in, out, n);
+    float factor = volume();
+    for (size_t j = 0; j < n; j++) {
+      int32_t result = factor * in[j];
+      out[j] = clip(result);
+    }
+  }
+
   Boost* clone() { return new Boost(*this); }
 };
 
@@ -123,6 +146,13 @@ class Distortion : public AudioEffect {
     return clip(input, p_clip_threashold, max_input);
   }
 
+  void processBlock(const effect_t* in, effect_t* out, size_t n) override {
+    if (!active()) return bypass(in, out, n);
+    for (size_t j = 0; j < n; j++) {
+      out[j] = clip(in[j], p_clip_threashold, max_input);
+    }
+  }
+
   Distortion* clone() { return new Distortion(*this); }
 
  protected:
@@ -162,6 +192,15 @@ class Fuzz : public AudioEffect {
     return map(result * v, -32768, +32767, -max_out, max_out);
   }
 
+  void processBlock(const effect_t* in, effect_t* out, size_t n) override {
+    if (!active()) return bypass(in, out, n);
+    float v = p_effect_value;
+    for (size_t j = 0; j < n; j++) {
+      int32_t result = clip(v * in[j]);
+      out[j] = map(result * v, -32768, +32767, -max_out, max_out);
+    }
+  }
+
   Fuzz* clone() { return new Fuzz(*this); }
 
  protected:
@@ -224,6 +263,24 @@ class Tremolo : public AudioEffect {
     return clip(out);
   }
 
+  void processBlock(const effect_t* in, effect_t* out, size_t n) override {
+    if (!active()) return bypass(in, out, n);
+    float tremolo_depth = p_percent > 100 ? 1.0 : 0.01 * p_percent;
+    float signal_depth = (100.0 - p_percent) / 100.0;
+    float tremolo_factor = tremolo_depth / rate_count_half;
+    for (size_t j = 0; j < n; j++) {
+      effect_t input = in[j];
+      int32_t result = (signal_depth * input) + (tremolo_factor * count * input);
+      count += inc;
+      if (count >= rate_count_half) {
+        inc = -1;
+      } else if (count <= 0) {
+        inc = +1;
+      }
+      out[j] = clip(result);
+    }
+  }
+
   Tremolo* clone() { return new Tremolo(*this); }
 
  protected:
@@ -239,6 +296,11 @@ class Tremolo : public AudioEffect {
  * @brief Delay/Echo AudioEffect. See
  * https://wiki.analog.com/resources/tools-software/sharc-audio-module/baremetal/delay-effect-tutorial
  * Howver the dry value and wet value were replace by the depth parameter.
+ * The line is a ring buffer of the max duration which is read at a
+ * fractional distance behind the write position (linear interpolation), so
+ * the delay can be any number of samples, e.g. an exact beat division, and a
+ * change does not touch the buffer. With setGlide() the read head moves to a
+ * new delay smoothly, like the tape head of a tape echo, instead of jumping.
  * @ingroup effects
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -255,18 +317,58 @@ class Delay : public AudioEffect {
   }
 
   Delay(const Delay& copy) {
+    max_duration = copy.max_duration;
+    setGlide(copy.glide_samples);
     setSampleRate(copy.sampleRate);
     setFeedback(copy.feedback);
     setDepth(copy.depth);
     setDuration(copy.duration);
   };
 
-  void setDuration(int16_t dur) {
-    duration = dur;
+  /// Delay in ms; fractions of a sample are kept
+  void setDuration(float ms) {
+    duration = ms;
+    updateBufferSize();
+  }
+
+  float getDuration() { return duration; }
+
+  /// Delay as a number of samples, e.g. a beat division at a tempo
+  void setDelaySamples(double samples) {
+    if (sampleRate <= 0) return;
+    duration = samples * 1000.0 / sampleRate;
+    updateBufferSize(samples);
+  }
+
+  /// Delay which the read head moves to, in samples
+  double getDelaySamples() { return target_samples; }
+
+  /// Time constant in samples in which the read head follows a new delay:
+  /// the echoes glide in pitch instead of clicking. 0 (default) jumps, as
+  /// does any change before the first sample was processed.
+  void setGlide(float samples) {
+    glide_samples = samples;
+    glide_coef = samples > 1.0f ? 1.0f / samples : 1.0f;
+  }
+
+  /// Preallocates the delay line for durations up to the indicated ms, so that
+  /// subsequent setDuration() calls within that range do not allocate. The
+  /// line starts empty.
+  void setMaxDuration(uint16_t ms) {
+    max_duration = ms;
+    // keeps the capacity: no allocation when it already fits
+    buffer.clear();
     updateBufferSize();
   }
 
-  int16_t getDuration() { return duration; }
+  uint16_t getMaxDuration() { return max_duration; }
+
+  /// Defines where the delay line is allocated, e.g. in an AllocatorArena
+  void setAllocator(Allocator& allocator) {
+    buffer.reset();
+    buffer.setAllocator(allocator);
+    updateBufferSize();
+  }
 
   void setDepth(float value) {
     depth = value;
@@ -293,36 +395,42 @@ class Delay : public AudioEffect {
 
   effect_t process(effect_t input) {
     if (!active()) return input;
+    if (buffer.size() == 0 || target_samples <= 0) return input;
+    running = true;
+    return processSample(buffer.data(), input);
+  }
 
-    size_t available = buffer.size();
-    if (available == 0 || delay_len_samples == 0) {
-      return input;
+  void processBlock(const effect_t* in, effect_t* out, size_t n) override {
+    if (!active() || buffer.size() == 0 || target_samples <= 0) {
+      return bypass(in, out, n);
     }
-
-    if (delay_line_index >= delay_len_samples) {
-      delay_line_index = 0;
+    effect_t* line = buffer.data();
+    running = true;
+    if (glide_offset != 0.0f) {
+      for (size_t j = 0; j < n; j++) out[j] = processSample(line, in[j]);
+      return;
     }
-
-    // Read last audio sample in each delay line
-    int32_t delayed_value = buffer[delay_line_index];
-
-    // Mix the above with current audio and write the results back to output
-    int32_t out = ((1.0f - depth) * input) + (depth * delayed_value);
-
-    // Update each delay line
-    // write = input + feedback * delayed_value (typical delay feedback)
-    float write_val = (float)input + feedback * (float)delayed_value;
-    // round to nearest integer to avoid truncation bias
-    int32_t write_int = (int32_t)roundf(write_val);
-    // clip to allowed range and store
-    buffer[delay_line_index] = clip(write_int);
-
-    // Finally, update the delay line index
-    delay_line_index++;
-    if (delay_line_index >= delay_len_samples) {
-      delay_line_index = 0;
+    // the read head stands still: one position and weight for the block
+    size_t len = buffer.size();
+    size_t distance = target_distance;
+    float fraction = target_fraction;
+    size_t idx = write_index;
+    size_t read = idx >= distance ? idx - distance : idx + len - distance;
+    size_t older = read == 0 ? len - 1 : read - 1;
+    float dry = 1.0f - depth;
+    for (size_t j = 0; j < n; j++) {
+      effect_t input = in[j];
+      float delayed = line[read];
+      if (fraction > 0.0f) delayed += (line[older] - delayed) * fraction;
+      int32_t result = (dry * input) + (depth * delayed);
+      float write_val = (float)input + feedback * delayed;
+      line[idx] = clip((int32_t)roundf(write_val));
+      if (++idx >= len) idx = 0;
+      older = read;
+      if (++read >= len) read = 0;
+      out[j] = clip(result);
     }
-    return clip(out);
+    write_index = idx;
   }
 
   Delay* clone() { return new Delay(*this); }
@@ -330,19 +438,76 @@ class Delay : public AudioEffect {
  protected:
   Vector<effect_t> buffer{0};
   float feedback = 0.0f, duration = 0.0f, sampleRate = 0.0f, depth = 0.0f;
-  size_t delay_len_samples = 0;
-  size_t delay_line_index = 0;
+  // distance of the read head behind the write position, in samples: the
+  // target split in whole samples and a fraction, and the remaining glide
+  // relative to it, which is small enough for a float
+  double target_samples = 0.0;
+  size_t target_distance = 0;
+  float target_fraction = 0.0f;
+  float glide_offset = 0.0f;
+  float glide_samples = 0.0f;
+  float glide_coef = 1.0f;
+  size_t write_index = 0;
+  uint16_t max_duration = 0;
+  bool running = false;
+
+  effect_t processSample(effect_t* line, effect_t input) {
+    size_t len = buffer.size();
+    size_t distance = target_distance;
+    float fraction = target_fraction;
+    if (glide_offset != 0.0f) {
+      // ends at the target once it is a hundredth of a sample away
+      glide_offset -= glide_offset * glide_coef;
+      if (fabsf(glide_offset) < 1.0e-2f) glide_offset = 0.0f;
+      float position = target_fraction + glide_offset;
+      int32_t whole = static_cast<int32_t>(position);
+      if (position < whole) whole--;
+      distance = target_distance + whole;
+      fraction = position - whole;
+    }
+    size_t read = write_index >= distance ? write_index - distance
+                                          : write_index + len - distance;
+    float delayed = line[read];
+    if (fraction > 0.0f) {
+      // one sample further back
+      size_t older = read == 0 ? len - 1 : read - 1;
+      delayed += (line[older] - delayed) * fraction;
+    }
+    int32_t result = ((1.0f - depth) * input) + (depth * delayed);
+    float write_val = (float)input + feedback * delayed;
+    line[write_index] = clip((int32_t)roundf(write_val));
+    if (++write_index >= len) write_index = 0;
+    return clip(result);
+  }
 
+  // The line holds the max duration (or the delay when it is longer) plus the
+  // sample which is needed for the interpolation; it is only cleared when it
+  // has to grow.
   void updateBufferSize() {
-    if (sampleRate > 0 && duration > 0) {
-      size_t newSampleCount = sampleRate * duration / 1000;
-      if (newSampleCount != delay_len_samples) {
-        delay_len_samples = newSampleCount;
-        buffer.resize(delay_len_samples);
-        memset(buffer.data(), 0, delay_len_samples * sizeof(effect_t));
-        LOGD("sample_count: %u", (unsigned)delay_len_samples);
-      }
+    updateBufferSize(static_cast<double>(sampleRate) * duration / 1000.0);
+  }
+
+  void updateBufferSize(double samples) {
+    if (sampleRate <= 0 || samples <= 0) return;
+    // where the read head is now, the glide continues from there
+    double position = target_samples + glide_offset;
+    bool jump = glide_samples <= 0.0f || target_samples <= 0.0 || !running;
+    target_samples = samples;
+    size_t needed = static_cast<size_t>(target_samples) + 1;
+    size_t reserved = static_cast<size_t>(sampleRate * max_duration / 1000) + 1;
+    if (reserved > needed) needed = reserved;
+    if (needed > (size_t)buffer.size()) {
+      buffer.resize(needed);
+      memset(buffer.data(), 0, needed * sizeof(effect_t));
+      write_index = 0;
+      jump = true;
+      LOGD("sample_count: %u", (unsigned)needed);
     }
+    if (target_samples > buffer.size() - 1) target_samples = buffer.size() - 1;
+    if (target_samples < 1.0) target_samples = 1.0;
+    target_distance = static_cast<size_t>(target_samples);
+    target_fraction = static_cast<float>(target_samples - target_distance);
+    glide_offset = jump ? 0.0f : static_cast<float>(position - target_samples);
   }
 };
 
@@ -403,6 +568,13 @@ class ADSRGain : public AudioEffect {
     return result;
   }
 
+  void processBlock(const effect_t* in, effect_t* out, size_t n) override {
+    if (!active()) return bypass(in, out, n);
+    for (size_t j = 0; j < n; j++) {
+      out[j] = factor * adsr->tick() * in[j];
+    }
+  }
+
   bool isActive() { return adsr->isActive(); }
 
   ADSRGain* clone() { return new ADSRGain(*this); }
@@ -521,7 +693,7 @@ class Compressor : public AudioEffect {
 
   /// Defines the compression ratio from 0 to 1
   void setCompressionRatio(float compressionRatio) {
-    if (compressionRatio < 1.0f) {
+    if (compressionRatio <= 1.0f) {
       gainreduce = compressionRatio;
     }
     recalculate();
@@ -533,6 +705,13 @@ class Compressor : public AudioEffect {
     return compress(input);
   }
 
+  void processBlock(const effect_t* in, effect_t* out, size_t n) override {
+    if (!active()) return bypass(in, out, n);
+    for (size_t j = 0; j < n; j++) {
+      out[j] = compress(in[j]);
+    }
+  }
+
   Compressor* clone() { return new Compressor(*this); }
 
  protected:
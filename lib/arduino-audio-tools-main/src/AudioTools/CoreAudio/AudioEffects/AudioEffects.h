@@ -197,6 +197,8 @@ class AudioEffects : public SoundGenerator<effect_t> {
  * @brief EffectsStreamT: the template class describes an input or output stream to which one or multiple 
  * effects are applied. The number of channels are used to merge the samples of one frame into one sample
  * before outputting the result as a frame (by repeating the result sample for each channel).
+ * With setMultiChannel(true) each channel is processed separately by its own copy of the effects (see
+ * effect(idx, channel)). The effects are applied to the whole block with AudioEffect::processBlock().
  * Currently only int16_t values are supported, so I recommend to use the __AudioEffectStream__ class which is defined as 
  * using AudioEffectStream = AudioEffectStreamT<effect_t>;
   
@@ -217,6 +219,13 @@ class AudioEffectStreamT : public ModifyingStream {
         setOutput(out);
     }
 
+    AudioEffectStreamT(const AudioEffectStreamT&) = delete;
+    AudioEffectStreamT& operator=(const AudioEffectStreamT&) = delete;
+
+    virtual ~AudioEffectStreamT() {
+        releaseChannelEffects();
+    }
+
     AudioInfo defaultConfig() {
         AudioInfo cfg;
         cfg.sample_rate = 44100;
@@ -238,9 +247,27 @@ class AudioEffectStreamT : public ModifyingStream {
             LOGE("bits_per_sample not consistent: %d",info.bits_per_sample);
             active = false;
         }
+        // the blocks are processed in pieces of this size: no allocation in write()
+        int block_frames = DEFAULT_BUFFER_SIZE / sizeof(T);
+        work.resize(block_frames);
+        out_buffer.resize(block_frames * info.channels);
+        updateChannelEffects();
         return active;
     }
 
+    /// Process each channel separately instead of mixing the frame down to mono. The
+    /// effects are cloned for the additional channels in begin(). Parameters which are
+    /// set afterwards on an effect (your own object, operator[] or findEffect()) only
+    /// change channel 0: set them on effect(idx, channel) for each channel.
+    void setMultiChannel(bool flag){
+        multi_channel = flag;
+        updateChannelEffects();
+    }
+
+    bool isMultiChannel() {
+        return multi_channel;
+    }
+
     void end() override {
         active = false;
     }
@@ -266,29 +293,10 @@ class AudioEffectStreamT : public ModifyingStream {
         // read data from source
         size_t result = p_io->readBytes((uint8_t*)data, len);
         int frames = result / sizeof(T) / info.channels;
-        T* samples = (T*) data;
-
-        for (int count=0;count<frames;count++){
-            // determine sample by combining all channels in frame
-            T result_sample = 0;
-            for (int ch=0;ch<info.channels;ch++){
-                T sample = *samples++;
-                //p_io->readBytes((uint8_t*)&sample, sizeof(T));
-                result_sample += sample / info.channels;
-            }
-
-            // apply effects
-            for (int j=0; j<size(); j++){
-                result_sample = effects[j]->process(result_sample);
-            }
 
-            // write result multiplying channels 
-            T* p_buffer = ((T*)data)+(count*info.channels);
-            for (int ch=0;ch<info.channels;ch++){
-                p_buffer[ch] = result_sample;
-                result_size += sizeof(T);
-            }
-        }
+        // process in place
+        processFrames((T*)data, (T*)data, frames);
+        result_size = frames * info.channels * sizeof(T);
         return result_size;
     }
 
@@ -301,31 +309,22 @@ class AudioEffectStreamT : public ModifyingStream {
         // length must be multple of channels
         assert(len % (sizeof(T)*info.channels)==0);
         int frames = len / sizeof(T) / info.channels;
-        size_t result_size = 0;
-
-        // process all samples
-        for (int j=0;j<frames;j++){
-            // calculate sample for frame
-            T* p_buffer = ((T*)data) + (j*info.channels);
-            T sample=0;
-            for (int ch=0;ch<info.channels;ch++){
-                sample += p_buffer[ch] / info.channels;
-                result_size += sizeof(T);
-            }
-
-            // apply effects
-            for (int j=0; j<size(); j++){
-                sample = effects[j]->process(sample);
-            }
-
-            // wite result channel times to output defined in constructor
-            for (int ch=0;ch<info.channels;ch++){
-                if (p_io!=nullptr){
-                    p_io->write((uint8_t*)&sample, sizeof(T));
-
-                } else if (p_print!=nullptr){
-                    p_print->write((uint8_t*)&sample, sizeof(T));
-                }
+        size_t result_size = frames * info.channels * sizeof(T);
+        const T* in = (const T*)data;
+        int block_frames = out_buffer.size() / info.channels;
+        if (block_frames <= 0) return 0;
+
+        // process the samples in pieces of the output buffer
+        for (int done = 0; done < frames; done += block_frames){
+            int n = frames - done;
+            if (n > block_frames) n = block_frames;
+            processFrames(in + done * info.channels, out_buffer.data(), n);
+            // write result to output defined in constructor
+            size_t bytes = n * info.channels * sizeof(T);
+            if (p_io!=nullptr){
+                p_io->write((uint8_t*)out_buffer.data(), bytes);
+            } else if (p_print!=nullptr){
+                p_print->write((uint8_t*)out_buffer.data(), bytes);
             }
         }
         return result_size;
@@ -346,12 +345,14 @@ class AudioEffectStreamT : public ModifyingStream {
     void addEffect(AudioEffect &effect){
         TRACED();
         effects.addEffect(&effect);
+        updateChannelEffects();
     }
 
     /// Adds an effect using a pointer
     void addEffect(AudioEffect *effect){
         TRACED();
         effects.addEffect(effect);
+        updateChannelEffects();
         LOGI("addEffect -> Number of effects: %d", (int) size());
     }
 
@@ -359,6 +360,7 @@ class AudioEffectStreamT : public ModifyingStream {
     void clear() {
         TRACED();
         effects.clear();
+        releaseChannelEffects();
     }
 
     /// Provides the actual number of defined effects
@@ -371,6 +373,13 @@ class AudioEffectStreamT : public ModifyingStream {
         return effects[idx];
     }
 
+    /// Provides the effect which is used for the indicated channel: in multi channel
+    /// mode the channels > 0 use a copy of the effect which was created in begin()
+    AudioEffect* effect(int idx, int channel){
+        if (channel == 0 || channel * size() > (size_t)channel_effects.size()) return effects[idx];
+        return channel_effects[(channel - 1) * size() + idx];
+    }
+
     /// Finds an effect by id
     AudioEffect* findEffect(int id){
         return effects.findEffect(id);
@@ -378,9 +387,82 @@ class AudioEffectStreamT : public ModifyingStream {
 
   protected:
     AudioEffectCommon effects;
+    Vector<AudioEffect*> channel_effects;
+    Vector<effect_t> work;
+    Vector<T> out_buffer;
     bool active = false;
+    bool multi_channel = false;
     Stream *p_io=nullptr;
     Print *p_print=nullptr;
+
+    /// applies the effects to the interleaved frames: in and out may be the same buffer
+    void processFrames(const T* in, T* out, int frames) {
+        int channels = info.channels;
+        // in pieces of the work buffer which was sized in begin()
+        int block_frames = work.size();
+        while (frames > block_frames && block_frames > 0){
+            processFrames(in, out, block_frames);
+            in += block_frames * channels;
+            out += block_frames * channels;
+            frames -= block_frames;
+        }
+        if (frames <= 0 || frames > block_frames) return;
+        effect_t* p_work = work.data();
+
+        if (!multi_channel || channels == 1) {
+            // determine sample by combining all channels in frame
+            for (int f=0; f<frames; f++){
+                T sample = 0;
+                for (int ch=0; ch<channels; ch++){
+                    sample += in[f*channels+ch] / channels;
+                }
+                p_work[f] = sample;
+            }
+            applyEffects(0, p_work, frames);
+            // write result multiplying channels
+            for (int f=0; f<frames; f++){
+                for (int ch=0; ch<channels; ch++){
+                    out[f*channels+ch] = p_work[f];
+                }
+            }
+            return;
+        }
+
+        for (int ch=0; ch<channels; ch++){
+            for (int f=0; f<frames; f++){
+                p_work[f] = in[f*channels+ch];
+            }
+            applyEffects(ch, p_work, frames);
+            for (int f=0; f<frames; f++){
+                out[f*channels+ch] = p_work[f];
+            }
+        }
+    }
+
+    void applyEffects(int channel, effect_t* data, int frames) {
+        int count = size();
+        for (int j=0; j<count; j++){
+            effect(j, channel)->processBlock(data, data, frames);
+        }
+    }
+
+    /// (re)creates the copies of the effects for the channels > 0
+    void updateChannelEffects() {
+        releaseChannelEffects();
+        if (!multi_channel || info.channels <= 1) return;
+        for (int ch=1; ch<info.channels; ch++){
+            for (int j=0; j<size(); j++){
+                channel_effects.push_back(effects[j]->clone());
+            }
+        }
+    }
+
+    void releaseChannelEffects() {
+        for (int j=0; j<channel_effects.size(); j++){
+            delete channel_effects[j];
+        }
+        channel_effects.clear();
+    }
 };
 
 #if defined(USE_VARIANTS) && __cplusplus >= 201703L || defined(DOXYGEN)
@@ -1,4 +1,6 @@
 #pragma once
+#include <math.h>
+#include <stdint.h>
 #include "AudioTools/CoreAudio/AudioLogger.h"
 
 namespace audio_tools {
@@ -189,4 +191,145 @@ class ScaledParameter : public AbstractParameter {
 };
 
 
+/**
+ * @brief A parameter which moves smoothly to a new target value to avoid
+ * zipper noise: either with a linear ramp or with a one pole low pass. Call
+ * next() per sample or skip() per block. Both only do some work while the
+ * value is moving: so check isSmoothing() to avoid any per sample processing
+ * when the value has settled.
+ * @ingroup effects
+ */
+class SmoothedParameter : public AbstractParameter {
+    public:
+        enum Mode { Linear, OnePole };
+
+        SmoothedParameter(float value = 0.0f, Mode mode = Linear) {
+            act_value = value;
+            target_value = value;
+            this->mode = mode;
+        }
+
+        /// Defines the sample rate and the smoothing time: the ramp duration
+        /// for Linear or the time constant for OnePole
+        void begin(float sampleRate, float timeMs) {
+            sample_rate = sampleRate;
+            setSmoothingTime(timeMs);
+        }
+
+        void setSmoothingTime(float timeMs) {
+            float frames = sample_rate * timeMs / 1000.0f;
+            ramp_frames = frames < 1.0f ? 1 : (uint32_t)frames;
+            coeff = 1.0f - expf(-1.0f / (float)ramp_frames);
+        }
+
+        void setMode(Mode mode) { this->mode = mode; }
+
+        /// Defines the distance to the target below which a OnePole is settled
+        void setTolerance(float tolerance) { this->tolerance = tolerance; }
+
+        /// Moves to the target with the defined smoothing time: repeating the
+        /// current target does not restart the ramp
+        void setTarget(float target) {
+            if (target == target_value && remaining > 0) return;
+            setTarget(target, ramp_frames);
+        }
+
+        /// Moves to the target over the indicated number of frames (Linear) or
+        /// with the indicated time constant in frames (OnePole). The frames
+        /// only apply to this move, the smoothing time stays as it is.
+        void setTarget(float target, uint32_t frames) {
+            target_value = target;
+            if (frames == 0 || target == act_value) {
+                setValue(target);
+                return;
+            }
+            if (mode == Linear) {
+                step = (target_value - act_value) / (float)frames;
+                remaining = frames;
+            } else {
+                move_coeff = onePoleCoeff(frames);
+                remaining = 1;
+            }
+        }
+
+        /// Jumps to the value
+        void setValue(float value) {
+            act_value = value;
+            target_value = value;
+            remaining = 0;
+        }
+
+        float target() const { return target_value; }
+
+        float value() override { return act_value; }
+
+        /// Returns true while the value is moving to the target
+        bool isSmoothing() const { return remaining > 0; }
+
+        /// Provides the value for the next sample
+        inline float next() {
+            if (remaining == 0) return act_value;
+            if (mode == Linear) {
+                act_value += step;
+                if (--remaining == 0) act_value = target_value;
+            } else {
+                act_value += move_coeff * (target_value - act_value);
+                checkSettled();
+            }
+            return act_value;
+        }
+
+        /// Advances by the indicated number of frames and provides the value at
+        /// the end: for parameters which are only updated once per block
+        float skip(uint32_t frames) {
+            if (remaining == 0 || frames == 0) return act_value;
+            if (mode == Linear) {
+                if (frames >= remaining) {
+                    setValue(target_value);
+                } else {
+                    act_value += step * (float)frames;
+                    remaining -= frames;
+                }
+            } else {
+                act_value = target_value + (act_value - target_value) *
+                                               powf(1.0f - move_coeff, (float)frames);
+                checkSettled();
+            }
+            return act_value;
+        }
+
+    protected:
+        Mode mode = Linear;
+        float target_value = 0.0f;
+        float step = 0.0f;
+        float coeff = 1.0f;           // of the smoothing time
+        float move_coeff = 1.0f;      // of the current move
+        float other_coeff = 1.0f;     // of the last other time constant
+        uint32_t other_frames = 0;
+        float tolerance = 0.0001f;
+        float sample_rate = 44100.0f;
+        uint32_t ramp_frames = 1;
+        uint32_t remaining = 0;
+
+        float update() override { return next(); }
+
+        /// Coefficient for a time constant in frames: expf() only runs when
+        /// it differs from the smoothing time and the previous one
+        float onePoleCoeff(uint32_t frames) {
+            if (frames == ramp_frames) return coeff;
+            if (frames != other_frames) {
+                other_coeff = 1.0f - expf(-1.0f / (float)frames);
+                other_frames = frames;
+            }
+            return other_coeff;
+        }
+
+        void checkSettled() {
+            if (fabsf(target_value - act_value) <= tolerance) {
+                setValue(target_value);
+            }
+        }
+};
+
+
 }
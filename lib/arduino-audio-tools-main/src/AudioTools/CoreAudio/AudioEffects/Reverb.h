@@ -0,0 +1,349 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "AudioEffect.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Stereo Schroeder reverb with the Freeverb topology (8 parallel
+ * damped combs followed by 4 allpasses per channel) in Q15 fixed point. All
+ * delay lines are int16_t and live in one arena which is allocated in begin():
+ * when the arena of the full Freeverb tuning does not fit into the memory
+ * budget, the lines are shortened and the comb feedback is raised so that the
+ * decay time is kept (with a lower echo density). Nothing is allocated after
+ * begin().
+ *
+ * The input is mono (e.g. an effect send) and processStereo() provides the
+ * left and right output for a whole block. process() and processBlock()
+ * return the mono sum.
+ * @ingroup effects
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class Reverb : public AudioEffect {
+ public:
+  static constexpr int COMBS = 8;
+  static constexpr int ALLPASSES = 4;
+  /// Frames which are processed per pass over the lines
+  static constexpr int MAX_BLOCK = 64;
+
+  /// budgetBytes: max size of the delay line arena (0 = full size)
+  Reverb(size_t budgetBytes = 0) { budget = budgetBytes; }
+
+  /// Defines the max size of the delay line arena: call before begin()
+  void setMemoryBudget(size_t bytes) { budget = bytes; }
+
+  size_t memoryBudget() { return budget; }
+
+  /// Defines where the delay lines are allocated: call before begin()
+  void setAllocator(Allocator &allocator) {
+    arena.reset();
+    arena.setAllocator(allocator);
+  }
+
+  /// Bytes of the arena which is currently allocated
+  size_t memoryUsed() { return (size_t)arena.size() * sizeof(int16_t); }
+
+  /// Bytes of the full size arena at the indicated sample rate
+  static size_t memoryNeeded(int sampleRate) {
+    return lineSamples(sampleRate / 44100.0f) * sizeof(int16_t);
+  }
+
+  /// Ratio of the line lengths to the full Freeverb tuning (1.0 = full size)
+  float sizeFactor() { return size_factor; }
+
+  /// Allocates the arena for the indicated sample rate within the budget
+  bool begin(int sampleRate) {
+    TRACEI();
+    if (sampleRate <= 0) return false;
+    float rate_factor = sampleRate / 44100.0f;
+    size_t needed = lineSamples(rate_factor);
+    size_factor = 1.0f;
+    size_t budget_samples = budget / sizeof(int16_t);
+    if (budget > 0 && needed > budget_samples) {
+      size_factor = (float)budget_samples / needed;
+    }
+    size_t total = lineSamples(rate_factor * size_factor);
+    if (budget > 0 && total > budget_samples) {
+      LOGE("Reverb: budget of %u bytes is too small", (unsigned)budget);
+      return false;
+    }
+    arena.resize(total);
+
+    // the lines are consecutive slices of the arena
+    float factor = rate_factor * size_factor;
+    int spread = STEREO_SPREAD * factor;
+    size_t offset = 0;
+    for (int j = 0; j < COMBS; j++) {
+      offset = setupLine(comb_left[j], offset, combTuning(j), factor, 0);
+      offset = setupLine(comb_right[j], offset, combTuning(j), factor, spread);
+    }
+    for (int j = 0; j < ALLPASSES; j++) {
+      offset = setupLine(allpass_left[j], offset, allpassTuning(j), factor, 0);
+      offset =
+          setupLine(allpass_right[j], offset, allpassTuning(j), factor, spread);
+    }
+    updateParameters();
+    reset();
+    LOGI("Reverb: %u bytes, size factor %.2f", (unsigned)memoryUsed(),
+         size_factor);
+    return true;
+  }
+
+  /// Releases the arena
+  void end() {
+    arena.reset();
+  }
+
+  /// Room size 0.0 - 1.0: determines the decay time
+  void setRoomSize(float value) {
+    room_size = clampUnit(value);
+    updateParameters();
+  }
+
+  float roomSize() { return room_size; }
+
+  /// High frequency damping 0.0 - 1.0
+  void setDamping(float value) {
+    damping = clampUnit(value);
+    updateParameters();
+  }
+
+  float getDamping() { return damping; }
+
+  /// Stereo width 0.0 (mono) - 1.0
+  void setWidth(float value) {
+    width = clampUnit(value);
+    updateParameters();
+  }
+
+  float getWidth() { return width; }
+
+  /// Output level 0.0 - 1.0
+  void setLevel(float value) {
+    level = clampUnit(value);
+    updateParameters();
+  }
+
+  float getLevel() { return level; }
+
+  /// Clears the delay lines
+  void reset() {
+    if (arena.size() > 0) memset(arena.data(), 0, memoryUsed());
+    for (int j = 0; j < COMBS; j++) {
+      comb_left[j].pos = comb_right[j].pos = 0;
+      comb_left[j].store = comb_right[j].store = 0;
+    }
+    for (int j = 0; j < ALLPASSES; j++) {
+      allpass_left[j].pos = allpass_right[j].pos = 0;
+    }
+  }
+
+  effect_t process(effect_t input) override {
+    if (!active() || arena.size() == 0) return input;
+    effect_t left, right;
+    processStereo(&input, &left, &right, 1);
+    return ((int32_t)left + right) / 2;
+  }
+
+  void processBlock(const effect_t *in, effect_t *out, size_t n) override {
+    if (!active() || arena.size() == 0) return bypass(in, out, n);
+    effect_t right[MAX_BLOCK];
+    for (size_t done = 0; done < n; done += MAX_BLOCK) {
+      size_t len = n - done < MAX_BLOCK ? n - done : MAX_BLOCK;
+      processStereo(in + done, out + done, right, len);
+      for (size_t j = 0; j < len; j++) {
+        out[done + j] = ((int32_t)out[done + j] + right[j]) / 2;
+      }
+    }
+  }
+
+  /// Calculates the left and right output of n frames from the mono input:
+  /// left may be the same buffer as in. An inactive reverb returns silence.
+  void processStereo(const effect_t *in, effect_t *left, effect_t *right,
+                     size_t n) {
+    if (!active() || arena.size() == 0) {
+      memset(left, 0, n * sizeof(effect_t));
+      memset(right, 0, n * sizeof(effect_t));
+      return;
+    }
+    for (size_t done = 0; done < n; done += MAX_BLOCK) {
+      size_t len = n - done < MAX_BLOCK ? n - done : MAX_BLOCK;
+      processChunk(in + done, left + done, right + done, len);
+    }
+  }
+
+  Reverb *clone() override { return new Reverb(*this); }
+
+ protected:
+  struct Line {
+    int16_t *data(Vector<int16_t> &arena) { return arena.data() + offset; }
+    size_t offset = 0;
+    uint32_t len = 0;
+    uint32_t pos = 0;
+    int32_t store = 0;  // damping filter of the combs
+  };
+
+  // offset of the right channel lines in samples at 44.1 kHz
+  static constexpr int STEREO_SPREAD = 23;
+  static constexpr int MIN_LINE = 16;
+  // 0.015 in Q15
+  static constexpr int32_t INPUT_GAIN = 492;
+
+  Vector<int16_t> arena{0};
+  size_t budget = 0;
+  float size_factor = 1.0f;
+  float room_size = 0.5f;
+  float damping = 0.5f;
+  float width = 1.0f;
+  float level = 1.0f / 3.0f;
+  Line comb_left[COMBS];
+  Line comb_right[COMBS];
+  Line allpass_left[ALLPASSES];
+  Line allpass_right[ALLPASSES];
+  // Q15 coefficients
+  int32_t feedback = 0;
+  int32_t damp1 = 0;
+  int32_t damp2 = 0;
+  // Q12 output gains: the comb sum is divided by 8 before the allpasses
+  int32_t wet1 = 0;
+  int32_t wet2 = 0;
+  int32_t input_buffer[MAX_BLOCK];
+  int32_t sum_left[MAX_BLOCK];
+  int32_t sum_right[MAX_BLOCK];
+
+  /// Freeverb tuning in samples at 44.1 kHz
+  static int combTuning(int idx) {
+    static const int16_t tuning[COMBS] = {1116, 1188, 1277, 1356,
+                                          1422, 1491, 1557, 1617};
+    return tuning[idx];
+  }
+
+  static int allpassTuning(int idx) {
+    static const int16_t tuning[ALLPASSES] = {556, 441, 341, 225};
+    return tuning[idx];
+  }
+
+  static float clampUnit(float value) {
+    if (value < 0.0f) return 0.0f;
+    if (value > 1.0f) return 1.0f;
+    return value;
+  }
+
+  static inline int32_t saturate(int32_t value) {
+    return value > 32767 ? 32767 : (value < -32768 ? -32768 : value);
+  }
+
+  /// Q15 product which rounds towards zero, so that the feedback loops decay
+  /// to digital silence instead of ending in a limit cycle
+  static inline int32_t mulQ15(int32_t a, int32_t b) { return (a * b) / 32768; }
+
+  static uint32_t lineLength(int tuning, float factor, int spread) {
+    int32_t len = (int32_t)(tuning * factor) + spread;
+    return len < MIN_LINE ? MIN_LINE : len;
+  }
+
+  static size_t lineSamples(float factor) {
+    int spread = STEREO_SPREAD * factor;
+    size_t result = 0;
+    for (int j = 0; j < COMBS; j++) {
+      result += lineLength(combTuning(j), factor, 0);
+      result += lineLength(combTuning(j), factor, spread);
+    }
+    for (int j = 0; j < ALLPASSES; j++) {
+      result += lineLength(allpassTuning(j), factor, 0);
+      result += lineLength(allpassTuning(j), factor, spread);
+    }
+    return result;
+  }
+
+  static size_t setupLine(Line &line, size_t offset, int tuning, float factor,
+                          int spread) {
+    line.offset = offset;
+    line.len = lineLength(tuning, factor, spread);
+    line.pos = 0;
+    line.store = 0;
+    return offset + line.len;
+  }
+
+  void updateParameters() {
+    // Freeverb: feedback 0.7 - 0.98; shorter lines need more feedback for the
+    // same decay time: g' = g ^ size_factor
+    float g = 0.7f + 0.28f * room_size;
+    if (size_factor < 1.0f) g = powf(g, size_factor);
+    if (g > 0.995f) g = 0.995f;
+    feedback = lroundf(g * 32768.0f);
+    damp1 = lroundf(damping * 0.4f * 32768.0f);
+    damp2 = 32768 - damp1;
+    float gain = level * 8.0f * 4096.0f;
+    wet1 = lroundf(gain * (width / 2.0f + 0.5f));
+    wet2 = lroundf(gain * ((1.0f - width) / 2.0f));
+  }
+
+  void processChunk(const effect_t *in, effect_t *left, effect_t *right,
+                    size_t n) {
+    for (size_t j = 0; j < n; j++) {
+      input_buffer[j] = mulQ15(in[j], INPUT_GAIN);
+    }
+    memset(sum_left, 0, n * sizeof(int32_t));
+    memset(sum_right, 0, n * sizeof(int32_t));
+    for (int j = 0; j < COMBS; j++) {
+      processComb(comb_left[j], sum_left, n);
+      processComb(comb_right[j], sum_right, n);
+    }
+    for (size_t j = 0; j < n; j++) {
+      sum_left[j] /= COMBS;
+      sum_right[j] /= COMBS;
+    }
+    for (int j = 0; j < ALLPASSES; j++) {
+      processAllpass(allpass_left[j], sum_left, n);
+      processAllpass(allpass_right[j], sum_right, n);
+    }
+    for (size_t j = 0; j < n; j++) {
+      int32_t l = saturate(sum_left[j]);
+      int32_t r = saturate(sum_right[j]);
+      left[j] = saturate((l * wet1 + r * wet2) / 4096);
+      right[j] = saturate((r * wet1 + l * wet2) / 4096);
+    }
+  }
+
+  /// Lowpass feedback comb: one pass over the block keeps the state in
+  /// registers
+  void processComb(Line &line, int32_t *sum, size_t n) {
+    int16_t *buffer = line.data(arena);
+    uint32_t pos = line.pos;
+    uint32_t len = line.len;
+    int32_t store = line.store;
+    int32_t fb = feedback, d1 = damp1, d2 = damp2;
+    for (size_t j = 0; j < n; j++) {
+      int32_t out = buffer[pos];
+      store = (out * d2 + store * d1) / 32768;
+      buffer[pos] = saturate(input_buffer[j] + mulQ15(store, fb));
+      if (++pos == len) pos = 0;
+      sum[j] += out;
+    }
+    line.pos = pos;
+    line.store = store;
+  }
+
+  /// Freeverb allpass with a feedback of 0.5 (in place)
+  void processAllpass(Line &line, int32_t *data, size_t n) {
+    int16_t *buffer = line.data(arena);
+    uint32_t pos = line.pos;
+    uint32_t len = line.len;
+    for (size_t j = 0; j < n; j++) {
+      int32_t delayed = buffer[pos];
+      int32_t input = data[j];
+      data[j] = delayed - input;
+      buffer[pos] = saturate(input + delayed / 2);
+      if (++pos == len) pos = 0;
+    }
+    line.pos = pos;
+  }
+};
+
+}  // namespace audio_tools
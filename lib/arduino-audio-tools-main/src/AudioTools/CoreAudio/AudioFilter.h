@@ -1,5 +1,7 @@
 #pragma once
 
 #include "AudioTools/CoreAudio/AudioFilter/Filter.h"
+#include "AudioTools/CoreAudio/AudioFilter/BiQuadCascade.h"
 #include "AudioTools/CoreAudio/AudioFilter/Equalizer.h"
+#include "AudioTools/CoreAudio/AudioFilter/BlockEqualizer.h"
 #include "AudioTools/CoreAudio/AudioFilter/MedianFilter.h"
@@ -0,0 +1,196 @@
+#pragma once
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/AudioFilter/Filter.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Cascade of biquad sections which processes a whole interleaved block
+ * in one call. Coefficients and states are kept in separate arrays (struct of
+ * arrays) and all channels of a frame are filtered in lockstep, so that the
+ * inner loop over the CH channels can be vectorized by the compiler. Each
+ * section is applied to the complete block before the next one, which keeps
+ * the state in registers.
+ *
+ * DF2 gives the same results as BiQuadDF2 / SOSFilter; TDF2 (transposed direct
+ * form II) is the better choice for float because the state does not need
+ * the large intermediate values of DF2.
+ * @ingroup filter
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T float or double
+ * @tparam CH number of interleaved channels
+ */
+template <typename T, int CH = 2>
+class BiQuadCascade {
+ public:
+  enum Structure { DF2, TDF2 };
+
+  BiQuadCascade() = default;
+
+  BiQuadCascade(int sections, Structure structure = TDF2) {
+    begin(sections, structure);
+  }
+
+  /// Defines the number of sections: all sections pass the signal unchanged
+  /// until they are defined with setSection()
+  bool begin(int sections, Structure structure = TDF2) {
+    if (sections <= 0) return false;
+    this->structure = structure;
+    section_count = sections;
+    b0.resize(sections);
+    b1.resize(sections);
+    b2.resize(sections);
+    a1.resize(sections);
+    a2.resize(sections);
+    z1.resize(sections * CH);
+    z2.resize(sections * CH);
+    for (int s = 0; s < sections; s++) {
+      T b[3] = {1, 0, 0};
+      T a[2] = {0, 0};
+      setSection(s, b, a);
+    }
+    reset();
+    return true;
+  }
+
+  /// Defines a section with normalized coefficients (a0 = 1)
+  void setSection(int idx, const T (&b)[3], const T (&a)[2], T gain = 1) {
+    if (idx < 0 || idx >= section_count) return;
+    b0[idx] = gain * b[0];
+    b1[idx] = gain * b[1];
+    b2[idx] = gain * b[2];
+    a1[idx] = a[0];
+    a2[idx] = a[1];
+  }
+
+  /// Defines a section: the coefficients are divided by a[0]
+  void setSection(int idx, const T (&b)[3], const T (&a)[3], T gain = 1) {
+    T bn[3] = {gain * b[0] / a[0], gain * b[1] / a[0], gain * b[2] / a[0]};
+    T an[2] = {a[1] / a[0], a[2] / a[0]};
+    setSection(idx, bn, an);
+  }
+
+  /// Copies the coefficients of a filter (e.g. LowPassFilter, LowShelfFilter)
+  void setSection(int idx, const BiQuadDF2<T> &filter) {
+    T b[3], a[2];
+    filter.coefficients(b, a);
+    setSection(idx, b, a);
+  }
+
+  /// Defines all sections from a SOS matrix (b0 b1 b2 a0 a1 a2) as used by
+  /// SOSFilter
+  template <size_t N>
+  void setSOS(const T (&sos)[N][6], const T (&gain)[N]) {
+    for (size_t s = 0; s < N; s++) {
+      T b[3] = {sos[s][0], sos[s][1], sos[s][2]};
+      T a[3] = {sos[s][3], sos[s][4], sos[s][5]};
+      setSection(s, b, a, gain[s]);
+    }
+  }
+
+  /// Clears the state of all sections
+  void reset() {
+    for (int j = 0; j < section_count * CH; j++) {
+      z1[j] = 0;
+      z2[j] = 0;
+    }
+  }
+
+  /// Clears the state of one section
+  void reset(int section) {
+    if (section < 0 || section >= section_count) return;
+    for (int c = 0; c < CH; c++) {
+      z1[section * CH + c] = 0;
+      z2[section * CH + c] = 0;
+    }
+  }
+
+  int sections() { return section_count; }
+
+  static constexpr int channels() { return CH; }
+
+  Structure getStructure() { return structure; }
+
+  /// Filters frames of CH interleaved samples in place
+  void process(T *data, size_t frames) {
+    for (int s = 0; s < section_count; s++) processSection(s, data, frames);
+  }
+
+  /// Applies only one section: e.g. to skip sections which are not needed
+  void processSection(int s, T *data, size_t frames) {
+    if (s < 0 || s >= section_count) return;
+    if (structure == DF2) {
+      processDF2(s, data, frames);
+    } else {
+      processTDF2(s, data, frames);
+    }
+  }
+
+  /// Filters a single frame of CH samples in place
+  void process(T (&frame)[CH]) { process(frame, 1); }
+
+ protected:
+  Structure structure = TDF2;
+  int section_count = 0;
+  // coefficients per section
+  Vector<T> b0{0};
+  Vector<T> b1{0};
+  Vector<T> b2{0};
+  Vector<T> a1{0};
+  Vector<T> a2{0};
+  // states per section and channel: DF2 w[n-1], w[n-2]; TDF2 s1, s2
+  Vector<T> z1{0};
+  Vector<T> z2{0};
+
+  /// w = x - a1*w1 - a2*w2; y = b0*w + b1*w1 + b2*w2 (same order as BiQuadDF2)
+  void processDF2(int s, T *data, size_t frames) {
+    const T c_b0 = b0[s], c_b1 = b1[s], c_b2 = b2[s];
+    const T c_a1 = a1[s], c_a2 = a2[s];
+    T w1[CH], w2[CH];
+    for (int c = 0; c < CH; c++) {
+      w1[c] = z1[s * CH + c];
+      w2[c] = z2[s * CH + c];
+    }
+    for (size_t f = 0; f < frames; f++) {
+      T *x = data + f * CH;
+      for (int c = 0; c < CH; c++) {
+        T w0 = x[c] - c_a1 * w1[c] - c_a2 * w2[c];
+        x[c] = c_b0 * w0 + c_b1 * w1[c] + c_b2 * w2[c];
+        w2[c] = w1[c];
+        w1[c] = w0;
+      }
+    }
+    for (int c = 0; c < CH; c++) {
+      z1[s * CH + c] = w1[c];
+      z2[s * CH + c] = w2[c];
+    }
+  }
+
+  /// y = b0*x + s1; s1 = b1*x - a1*y + s2; s2 = b2*x - a2*y
+  void processTDF2(int s, T *data, size_t frames) {
+    const T c_b0 = b0[s], c_b1 = b1[s], c_b2 = b2[s];
+    const T c_a1 = a1[s], c_a2 = a2[s];
+    T s1[CH], s2[CH];
+    for (int c = 0; c < CH; c++) {
+      s1[c] = z1[s * CH + c];
+      s2[c] = z2[s * CH + c];
+    }
+    for (size_t f = 0; f < frames; f++) {
+      T *x = data + f * CH;
+      for (int c = 0; c < CH; c++) {
+        T in = x[c];
+        T y = c_b0 * in + s1[c];
+        s1[c] = c_b1 * in - c_a1 * y + s2[c];
+        s2[c] = c_b2 * in - c_a2 * y;
+        x[c] = y;
+      }
+    }
+    for (int c = 0; c < CH; c++) {
+      z1[s * CH + c] = s1[c];
+      z2[s * CH + c] = s2[c];
+    }
+  }
+};
+
+}  // namespace audio_tools
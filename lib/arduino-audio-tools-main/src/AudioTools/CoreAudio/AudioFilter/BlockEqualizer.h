@@ -0,0 +1,261 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#include "AudioTools/CoreAudio/AudioEffects/AudioParameters.h"
+#include "AudioTools/CoreAudio/AudioFilter/BiQuadCascade.h"
+#include "AudioTools/CoreAudio/AudioFilter/Filter.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Equalizer for 16 bit interleaved blocks which can be embedded in
+ * another processing stage (no stream of its own): a low shelf, a high shelf
+ * and optional parametric (peaking) mids. The gains are in dB and move
+ * smoothly to new values; while a gain is moving the coefficients are
+ * recalculated every SMOOTHING_FRAMES frames.
+ *
+ * The filters run either in float (transposed DF2 with a BiQuadCascade) or
+ * in fixed point (DF1 with Q28 coefficients and 24 bit states) for
+ * processors without FPU. With an FPU fixed point is not the cheaper option:
+ * on a desktop both take about the same time. Bands at 0 dB are skipped:
+ * with all gains at 0 dB the block is passed unchanged.
+ * @ingroup equilizer
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam CH number of interleaved channels
+ */
+template <int CH = 2>
+class BlockEqualizer {
+ public:
+  /// Band index for setGain(): the mids follow with Mid, Mid + 1 ...
+  enum Band { Low = 0, High = 1, Mid = 2 };
+  static constexpr int MAX_MIDS = 4;
+  static constexpr float MAX_GAIN_DB = 12.0f;
+  static constexpr int SMOOTHING_FRAMES = 32;
+
+  /// Defines the sample rate, the number of parametric mids and the
+  /// arithmetic
+  bool begin(float sampleRate, int mids = 0, bool fixedPoint = false) {
+    if (sampleRate <= 0 || mids < 0 || mids > MAX_MIDS) return false;
+    sample_rate = sampleRate;
+    mid_count = mids;
+    fixed_point = fixedPoint;
+    int sections = 2 + mids;
+    if (!fixed_point) cascade.begin(sections, BiQuadCascade<float, CH>::TDF2);
+    for (int b = 0; b < sections; b++) gains[b].begin(sampleRate, smoothing_ms);
+    updateCoefficients();
+    reset();
+    return true;
+  }
+
+  /// Corner frequency of the low shelf
+  void setLowFrequency(float hz) {
+    freq[Low] = hz;
+    updateCoefficients();
+  }
+
+  /// Corner frequency of the high shelf
+  void setHighFrequency(float hz) {
+    freq[High] = hz;
+    updateCoefficients();
+  }
+
+  /// Center frequency and bandwidth of a parametric mid (0 .. mids-1)
+  void setMid(int idx, float hz, float q = 1.0f) {
+    if (idx < 0 || idx >= MAX_MIDS) return;
+    freq[Mid + idx] = hz;
+    this->q[Mid + idx] = q;
+    updateCoefficients();
+  }
+
+  /// Moves the gain in dB with the smoothing time
+  void setGain(int band, float db) {
+    if (band < 0 || band >= 2 + mid_count) return;
+    gains[band].setTarget(clampGain(db));
+  }
+
+  /// Moves the gain in dB over the indicated frames (0 = immediately)
+  void setGain(int band, float db, uint32_t frames) {
+    if (band < 0 || band >= 2 + mid_count) return;
+    gains[band].setTarget(clampGain(db), frames);
+    if (frames == 0) updateCoefficients();
+  }
+
+  float gain(int band) { return gains[band].value(); }
+
+  /// Time in ms to move to a new gain
+  void setSmoothingTime(float ms) {
+    smoothing_ms = ms;
+    for (int b = 0; b < 2 + MAX_MIDS; b++) gains[b].setSmoothingTime(ms);
+  }
+
+  bool isFixedPoint() { return fixed_point; }
+
+  /// true if all gains are 0 dB: process() does not change the data
+  bool isFlat() { return flat && !isSmoothing(); }
+
+  /// Clears the filter states
+  void reset() {
+    cascade.reset();
+    memset(state, 0, sizeof(state));
+  }
+
+  /// Filters frames of CH interleaved samples in place
+  void process(int16_t *data, size_t frames) {
+    if (isFlat()) return;
+    while (frames > 0) {
+      size_t n = frames < BLOCK_FRAMES ? frames : BLOCK_FRAMES;
+      if (isSmoothing()) {
+        if (n > SMOOTHING_FRAMES) n = SMOOTHING_FRAMES;
+        for (int b = 0; b < 2 + mid_count; b++) gains[b].skip(n);
+        updateCoefficients();
+      }
+      if (fixed_point) {
+        processFixed(data, n);
+      } else {
+        processFloat(data, n);
+      }
+      data += n * CH;
+      frames -= n;
+    }
+  }
+
+ protected:
+  static constexpr int BLOCK_FRAMES = 64;
+  static constexpr int SECTIONS = 2 + MAX_MIDS;
+  static constexpr int COEF_BITS = 28;
+  static constexpr int STATE_BITS = 8;  // extra resolution of the states
+  float sample_rate = 44100.0f;
+  float smoothing_ms = 20.0f;
+  int mid_count = 0;
+  bool fixed_point = false;
+  bool flat = true;
+  bool active[SECTIONS] = {false};
+  float freq[SECTIONS] = {250.0f, 4000.0f, 500.0f, 1000.0f, 2000.0f, 3000.0f};
+  float q[SECTIONS] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+  SmoothedParameter gains[SECTIONS];
+  BiQuadCascade<float, CH> cascade;
+  // fixed point: b0 b1 b2 a1 a2 per section and x1 x2 y1 y2 per channel
+  int32_t coef[SECTIONS][5];
+  int32_t state[SECTIONS][CH][4];
+
+  static float clampGain(float db) {
+    if (db > MAX_GAIN_DB) return MAX_GAIN_DB;
+    if (db < -MAX_GAIN_DB) return -MAX_GAIN_DB;
+    return db;
+  }
+
+  bool isSmoothing() {
+    for (int b = 0; b < 2 + mid_count; b++) {
+      if (gains[b].isSmoothing()) return true;
+    }
+    return false;
+  }
+
+  void updateCoefficients() {
+    flat = true;
+    for (int s = 0; s < 2 + mid_count; s++) {
+      float db = gains[s].value();
+      // at 0 dB a section is an identity: the state which is left when it is
+      // used again does not fit to the signal any more
+      bool is_active = db != 0.0f || gains[s].isSmoothing();
+      if (is_active && !active[s]) {
+        cascade.reset(s);
+        memset(state[s], 0, sizeof(state[s]));
+      }
+      active[s] = is_active;
+      if (is_active) flat = false;
+      if (s == Low) {
+        setSection(s, LowShelfFilter<float>(freq[s], sample_rate, db));
+      } else if (s == High) {
+        setSection(s, HighShelfFilter<float>(freq[s], sample_rate, db));
+      } else {
+        setSection(s, PeakingFilter<float>(freq[s], sample_rate, db, q[s]));
+      }
+    }
+  }
+
+  void setSection(int s, const BiQuadDF2<float> &filter) {
+    if (!fixed_point) {
+      cascade.setSection(s, filter);
+      return;
+    }
+    float b[3], a[2];
+    filter.coefficients(b, a);
+    const float scale = (float)(1 << COEF_BITS);
+    coef[s][0] = lroundf(b[0] * scale);
+    coef[s][1] = lroundf(b[1] * scale);
+    coef[s][2] = lroundf(b[2] * scale);
+    coef[s][3] = lroundf(a[0] * scale);
+    coef[s][4] = lroundf(a[1] * scale);
+  }
+
+  void processFloat(int16_t *data, size_t frames) {
+    float buffer[BLOCK_FRAMES * CH];
+    size_t samples = frames * CH;
+    for (size_t j = 0; j < samples; j++) buffer[j] = data[j];
+    for (int s = 0; s < 2 + mid_count; s++) {
+      if (active[s]) cascade.processSection(s, buffer, frames);
+    }
+    for (size_t j = 0; j < samples; j++) {
+      float value = buffer[j];
+      data[j] = clip((int32_t)(value < 0 ? value - 0.5f : value + 0.5f));
+    }
+  }
+
+  /// DF1 per section over the whole block: the states keep STATE_BITS more
+  /// bits than the samples. The channels are filtered side by side, so that
+  /// their recursions overlap, and each product is a 32x32 -> 64 bit multiply.
+  void processFixed(int16_t *data, size_t frames) {
+    int32_t buffer[BLOCK_FRAMES * CH];
+    size_t samples = frames * CH;
+    for (size_t j = 0; j < samples; j++) buffer[j] = data[j] * (1 << STATE_BITS);
+    for (int s = 0; s < 2 + mid_count; s++) {
+      if (!active[s]) continue;
+      const int32_t b0 = coef[s][0], b1 = coef[s][1], b2 = coef[s][2];
+      const int32_t a1 = coef[s][3], a2 = coef[s][4];
+      int32_t x1[CH], x2[CH], y1[CH], y2[CH];
+      for (int c = 0; c < CH; c++) {
+        x1[c] = state[s][c][0];
+        x2[c] = state[s][c][1];
+        y1[c] = state[s][c][2];
+        y2[c] = state[s][c][3];
+      }
+      int32_t *x = buffer;
+      for (size_t f = 0; f < frames; f++, x += CH) {
+        for (int c = 0; c < CH; c++) {
+          int32_t in = x[c];
+          // the term of the last output comes last: the shortest recursion
+          int64_t acc = (int64_t)b0 * in + (int64_t)b1 * x1[c] +
+                        (int64_t)b2 * x2[c] - (int64_t)a2 * y2[c] +
+                        (1 << (COEF_BITS - 1));
+          acc -= (int64_t)a1 * y1[c];
+          int32_t y = (int32_t)(acc >> COEF_BITS);
+          x2[c] = x1[c];
+          x1[c] = in;
+          y2[c] = y1[c];
+          y1[c] = y;
+          x[c] = y;
+        }
+      }
+      for (int c = 0; c < CH; c++) {
+        state[s][c][0] = x1[c];
+        state[s][c][1] = x2[c];
+        state[s][c][2] = y1[c];
+        state[s][c][3] = y2[c];
+      }
+    }
+    for (size_t j = 0; j < samples; j++) {
+      data[j] = clip((buffer[j] + (1 << (STATE_BITS - 1))) >> STATE_BITS);
+    }
+  }
+
+  static inline int16_t clip(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+  }
+};
+
+}  // namespace audio_tools
@@ -278,6 +278,15 @@ class BiQuadDF2 : public Filter<T> {
     return y;
   }
 
+  /// Provides the normalized coefficients (a0 = 1)
+  void coefficients(T (&b)[3], T (&a)[2]) const {
+    b[0] = b_0;
+    b[1] = b_1;
+    b[2] = b_2;
+    a[0] = a_1;
+    a[1] = a_2;
+  }
+
  protected:
   T b_0 = 0;
   T b_1 = 0;
@@ -514,6 +523,39 @@ class HighShelfFilter : public BiQuadDF2<T> {
   }
 };
 
+/**
+ * @brief Biquad DF2 Peaking EQ Filter: boosts or cuts (gain in dB) a band
+ * around the frequency; q defines the bandwidth. Coefficients from the RBJ
+ * Audio EQ Cookbook. Use float or double (and not a integer type) as type
+ * parameter
+ * @ingroup filter
+ * @author pschatzmann
+ * @copyright GNU General Public License v3.0
+ * @tparam T
+ */
+
+template <typename T>
+class PeakingFilter : public BiQuadDF2<T> {
+ public:
+  PeakingFilter() = default;
+  PeakingFilter(float frequency, float sampleRate, float gain, float q = 1.0f)
+      : BiQuadDF2<T>() {
+    begin(frequency, sampleRate, gain, q);
+  }
+  void begin(float frequency, float sampleRate, float gain, float q = 1.0f) {
+    T a = pow(10.0, gain / 40.0f);
+    T w0 = frequency * (2.0f * PI / sampleRate);
+    T alpha = sin(w0) / ((float)q * 2.0);
+    T cosW0 = cos(w0);
+    T scale = 1.0 / (1.0 + alpha / a);
+    BiQuadDF2<T>::b_0 = (1.0 + alpha * a) * scale;
+    BiQuadDF2<T>::b_1 = (-2.0 * cosW0) * scale;
+    BiQuadDF2<T>::b_2 = (1.0 - alpha * a) * scale;
+    BiQuadDF2<T>::a_1 = BiQuadDF2<T>::b_1;
+    BiQuadDF2<T>::a_2 = (1.0 - alpha / a) * scale;
+  }
+};
+
 /**
  * @brief Second Order Filter: Instead of manually cascading BiQuad filters, you
  * can use a Second Order Sections filter (SOS). converted from
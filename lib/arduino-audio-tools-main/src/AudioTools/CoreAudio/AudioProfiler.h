@@ -0,0 +1,244 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "AudioToolsConfig.h"
+
+#if defined(ESP32) && defined(ARDUINO)
+#  include <Esp.h>
+#elif defined(IS_DESKTOP) || defined(IS_MIN_DESKTOP)
+#  include <chrono>
+#endif
+
+#ifndef AUDIO_PROFILER_MAX_STAGES
+#  define AUDIO_PROFILER_MAX_STAGES 8
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Timing statistics of one processing stage: count, min, max, sum and
+ * a fixed histogram with 8 bins per octave from 1us to 67ms, which provides
+ * percentiles with an error of less than 10%. No memory is allocated.
+ * @ingroup basic
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class ProfileStage {
+ public:
+  static constexpr int BINS = 16 * 8;
+
+  void begin(const char *name) {
+    stage_name = name;
+    reset();
+  }
+
+  void reset() {
+    count = 0;
+    min_ns = UINT32_MAX;
+    max_ns = 0;
+    sum_ns = 0;
+    memset(histogram, 0, sizeof(histogram));
+  }
+
+  /// Records one measurement
+  void add(uint32_t ns) {
+    count++;
+    sum_ns += ns;
+    if (ns < min_ns) min_ns = ns;
+    if (ns > max_ns) max_ns = ns;
+    histogram[bin(ns)]++;
+  }
+
+  const char *name() const { return stage_name; }
+  uint32_t size() const { return count; }
+  uint32_t minNs() const { return count == 0 ? 0 : min_ns; }
+  uint32_t maxNs() const { return max_ns; }
+  uint32_t avgNs() const { return count == 0 ? 0 : sum_ns / count; }
+  uint64_t sumNs() const { return sum_ns; }
+
+  /// Provides the upper limit of the histogram bin which contains the
+  /// indicated percentile (e.g. 99.0)
+  uint32_t percentileNs(float percent) const {
+    if (count == 0) return 0;
+    uint32_t limit = (uint64_t)count * percent / 100.0f;
+    uint32_t total = 0;
+    for (int j = 0; j < BINS; j++) {
+      total += histogram[j];
+      if (total > limit || total == count) {
+        uint32_t upper = binUpperNs(j);
+        return upper < max_ns ? upper : max_ns;
+      }
+    }
+    return max_ns;
+  }
+
+ protected:
+  const char *stage_name = "";
+  uint32_t count = 0;
+  uint32_t min_ns = UINT32_MAX;
+  uint32_t max_ns = 0;
+  uint64_t sum_ns = 0;
+  uint32_t histogram[BINS];
+
+  static int msb(uint32_t value) {
+    int result = 0;
+    while (value >>= 1) result++;
+    return result;
+  }
+
+  /// 8 bins per octave starting at 1024ns
+  static int bin(uint32_t ns) {
+    if (ns < 1024) return 0;
+    int octave = msb(ns);
+    int sub = (ns >> (octave - 3)) & 7;
+    int result = (octave - 10) * 8 + sub;
+    return result < BINS ? result : BINS - 1;
+  }
+
+  static uint32_t binUpperNs(int bin) {
+    int octave = bin / 8 + 10;
+    int sub = bin % 8;
+    return (uint32_t)(8 + sub + 1) << (octave - 3);
+  }
+};
+
+/**
+ * @brief Collects the processing times of the stages of the audio pipeline.
+ * Use the AUDIO_PROFILE_SCOPE("name") macro at the beginning of a method: it
+ * records the time until the end of the block and compiles to nothing unless
+ * USE_AUDIO_PROFILER is true. Nested scopes report inclusive times.
+ * @ingroup basic
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioProfiler {
+ public:
+  static AudioProfiler &instance() {
+    static AudioProfiler self;
+    return self;
+  }
+
+  /// Provides the stage with the indicated name: returns nullptr if all
+  /// AUDIO_PROFILER_MAX_STAGES are used
+  ProfileStage *stage(const char *name) {
+    for (int j = 0; j < stage_count; j++) {
+      if (strcmp(stages[j].name(), name) == 0) return &stages[j];
+    }
+    if (stage_count >= AUDIO_PROFILER_MAX_STAGES) return nullptr;
+    stages[stage_count].begin(name);
+    return &stages[stage_count++];
+  }
+
+  int size() { return stage_count; }
+
+  ProfileStage &operator[](int idx) { return stages[idx]; }
+
+  /// Defines the time which is available per block (e.g. 11610us for 512
+  /// frames at 44100Hz) to report the load in percent
+  void setBudgetUs(uint32_t us) { budget_us = us; }
+
+  uint32_t budgetUs() { return budget_us; }
+
+  /// Provides the p99 of the indicated stage in percent of the budget
+  float loadPercent(const char *name) {
+    for (int j = 0; j < stage_count; j++) {
+      if (strcmp(stages[j].name(), name) == 0 && budget_us > 0) {
+        return 100.0f * stages[j].percentileNs(99.0f) / 1000.0f / budget_us;
+      }
+    }
+    return 0.0f;
+  }
+
+  void reset() {
+    for (int j = 0; j < stage_count; j++) stages[j].reset();
+  }
+
+  /// Prints a table with the statistics in us
+  void printReport(Print &out) {
+    char line[96];
+    snprintf(line, sizeof(line), "%-10s %8s %8s %8s %8s %8s %6s", "stage",
+             "count", "min", "avg", "max", "p99", "load");
+    out.println(line);
+    for (int j = 0; j < stage_count; j++) {
+      ProfileStage &s = stages[j];
+      float load =
+          budget_us > 0 ? 100.0f * s.percentileNs(99.0f) / 1000.0f / budget_us
+                        : 0.0f;
+      snprintf(line, sizeof(line), "%-10s %8u %8u %8u %8u %8u %5.1f%%",
+               s.name(), (unsigned)s.size(), (unsigned)(s.minNs() / 1000),
+               (unsigned)(s.avgNs() / 1000), (unsigned)(s.maxNs() / 1000),
+               (unsigned)(s.percentileNs(99.0f) / 1000), load);
+      out.println(line);
+    }
+  }
+
+  /// Current time in ticks (CPU cycles on the ESP32)
+  static inline uint32_t ticks() {
+#if defined(ESP32) && defined(ARDUINO)
+    return ESP.getCycleCount();
+#elif defined(IS_DESKTOP) || defined(IS_MIN_DESKTOP)
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#else
+    return micros();
+#endif
+  }
+
+  /// Converts a tick difference to nanoseconds
+  static inline uint32_t ticksToNs(uint32_t ticks) {
+#if defined(ESP32) && defined(ARDUINO)
+    static uint32_t cpu_mhz = ESP.getCpuFreqMHz();
+    return (uint64_t)ticks * 1000 / cpu_mhz;
+#elif defined(IS_DESKTOP) || defined(IS_MIN_DESKTOP)
+    return ticks;
+#else
+    return ticks * 1000;
+#endif
+  }
+
+ protected:
+  ProfileStage stages[AUDIO_PROFILER_MAX_STAGES];
+  int stage_count = 0;
+  uint32_t budget_us = 0;
+
+  AudioProfiler() = default;
+};
+
+/**
+ * @brief Measures the time from the construction to the destruction
+ * @ingroup basic
+ */
+class ProfileScope {
+ public:
+  ProfileScope(ProfileStage *stage) {
+    p_stage = stage;
+    start = AudioProfiler::ticks();
+  }
+  ~ProfileScope() {
+    if (p_stage != nullptr) {
+      p_stage->add(AudioProfiler::ticksToNs(AudioProfiler::ticks() - start));
+    }
+  }
+
+ protected:
+  ProfileStage *p_stage;
+  uint32_t start;
+};
+
+}  // namespace audio_tools
+
+#define AUDIO_PROFILE_CONCAT_(a, b) a##b
+#define AUDIO_PROFILE_CONCAT(a, b) AUDIO_PROFILE_CONCAT_(a, b)
+
+#if USE_AUDIO_PROFILER
+#  define AUDIO_PROFILE_SCOPE(name)                                         \
+    static audio_tools::ProfileStage *AUDIO_PROFILE_CONCAT(                 \
+        profile_stage_, __LINE__) =                                         \
+        audio_tools::AudioProfiler::instance().stage(name);                 \
+    audio_tools::ProfileScope AUDIO_PROFILE_CONCAT(profile_scope_, __LINE__)( \
+        AUDIO_PROFILE_CONCAT(profile_stage_, __LINE__))
+#else
+#  define AUDIO_PROFILE_SCOPE(name)
+#endif
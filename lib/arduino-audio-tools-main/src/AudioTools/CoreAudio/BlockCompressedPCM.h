@@ -0,0 +1,430 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/AudioOutput.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Keeps 16 bit PCM in memory in independent blocks of BLOCK_FRAMES
+ * frames, optionally compressed, so that any block can be decoded on its own
+ * (random access for slices and loops) into a small buffer of the player:
+ * - PCM: uncompressed (the reference)
+ * - IMA_ADPCM: 4 bit per sample (about 1:4, lossy). Each block starts with
+ *   the exact first sample and the step index of every channel.
+ * - Lossless: per block and channel the best fixed predictor of order 0, 1
+ *   or 2 (as in FLAC) and the residuals packed with a common bit width.
+ *   Decoding is a bit extraction and an addition per sample.
+ *
+ * Use it as output of a SampleImporter: write() takes interleaved 16 bit
+ * samples in the channels of begin(); call end() for the last block. Data
+ * beyond setMaxBytes() is dropped and isOverflow() returns true.
+ * @ingroup buffers
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BlockCompressedPCM : public AudioOutput {
+ public:
+  enum Format { PCM = 0, IMA_ADPCM = 1, Lossless = 2 };
+  static constexpr int BLOCK_FRAMES = 256;
+  static constexpr int MAX_CHANNELS = 2;
+
+  BlockCompressedPCM() = default;
+
+  /// Starts to collect new data: mono or stereo
+  bool begin(Format format, int channels) {
+    if (channels < 1 || channels > MAX_CHANNELS) {
+      LOGE("BlockCompressedPCM: unsupported channels %d", channels);
+      return false;
+    }
+    fmt = format;
+    channel_count = channels;
+    data.reset();
+    offsets.reset();
+    pending.resize(BLOCK_FRAMES * channels);
+    frame_count = 0;
+    pending_bytes = 0;
+    overflow = false;
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) step_index[ch] = 0;
+    return true;
+  }
+
+  /// Encodes the last (short) block and releases unused memory
+  void end() {
+    if (pendingFrames() > 0 && !overflow) encodeBlock();
+    pending.reset();
+    pending_bytes = 0;
+    if (data.capacity() > data.size()) data.shrink_to_fit();
+    if (offsets.capacity() > offsets.size()) offsets.shrink_to_fit();
+  }
+
+  /// Releases all memory
+  void clear() {
+    data.reset();
+    offsets.reset();
+    pending.reset();
+    pending_bytes = 0;
+    frame_count = 0;
+  }
+
+  /// Exchanges the content with other without copying, e.g. to hand over
+  /// blocks which were encoded in another task
+  void swap(BlockCompressedPCM &other) {
+    swapValue(fmt, other.fmt);
+    swapValue(channel_count, other.channel_count);
+    data.swap(other.data);
+    offsets.swap(other.offsets);
+    swapValue(frame_count, other.frame_count);
+    swapValue(max_bytes, other.max_bytes);
+    swapValue(overflow, other.overflow);
+    pending.swap(other.pending);
+    swapValue(pending_bytes, other.pending_bytes);
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      swapValue(step_index[ch], other.step_index[ch]);
+    }
+  }
+
+  /// Max memory in bytes (0 = unlimited)
+  void setMaxBytes(size_t bytes) { max_bytes = bytes; }
+
+  /// true if data was dropped because of the max size
+  bool isOverflow() { return overflow; }
+
+  /// Adds interleaved 16 bit samples
+  size_t write(const uint8_t *bytes, size_t len) override {
+    size_t result = len;
+    size_t block_bytes = pending.size() * sizeof(int16_t);
+    // collect a block: the data might end within a frame
+    while (len > 0 && block_bytes > 0 && !overflow) {
+      size_t n = block_bytes - pending_bytes;
+      if (n > len) n = len;
+      memcpy((uint8_t *)pending.data() + pending_bytes, bytes, n);
+      pending_bytes += n;
+      bytes += n;
+      len -= n;
+      if (pending_bytes == block_bytes) encodeBlock();
+    }
+    return result;
+  }
+
+  /// Decodes a block into out (BLOCK_FRAMES interleaved frames); returns
+  /// the number of frames of the block
+  size_t decode(size_t block, int16_t *out) {
+    if (block >= blocks()) return 0;
+    size_t frames = blockFrames(block);
+    const uint8_t *in = data.data() + offsets[block];
+    switch (fmt) {
+      case IMA_ADPCM:
+        decodeIMA(in, frames, out);
+        break;
+      case Lossless:
+        decodeLossless(in, frames, out);
+        break;
+      default:
+        memcpy(out, in, frames * channel_count * sizeof(int16_t));
+        break;
+    }
+    return frames;
+  }
+
+  /// Number of encoded frames
+  size_t frames() { return frame_count; }
+
+  size_t blocks() { return offsets.size(); }
+
+  /// Frames of a block: BLOCK_FRAMES except for the last one
+  size_t blockFrames(size_t block) {
+    size_t start = block * BLOCK_FRAMES;
+    if (start >= frame_count) return 0;
+    size_t rest = frame_count - start;
+    return rest < BLOCK_FRAMES ? rest : BLOCK_FRAMES;
+  }
+
+  Format format() { return fmt; }
+
+  int channels() { return channel_count; }
+
+  /// Allocated memory in bytes (data and block offsets)
+  size_t memoryUsed() {
+    return (size_t)data.capacity() + offsets.capacity() * sizeof(uint32_t);
+  }
+
+  /// Size of the same frames as PCM
+  size_t pcmBytes() { return frame_count * channel_count * sizeof(int16_t); }
+
+ protected:
+  // lossless: at most 16 bit residuals and 5 bytes header per channel
+  static constexpr int MAX_BLOCK_BYTES =
+      BLOCK_FRAMES * MAX_CHANNELS * 2 + 5 * MAX_CHANNELS;
+  Format fmt = PCM;
+  int channel_count = 2;
+  Vector<uint8_t> data{0};
+  Vector<uint32_t> offsets{0};  // byte offset of each block
+  size_t frame_count = 0;
+  size_t max_bytes = 0;
+  bool overflow = false;
+  Vector<int16_t> pending{0};  // block to encode: only between begin and end
+  size_t pending_bytes = 0;
+  int step_index[MAX_CHANNELS] = {0};  // IMA state over the blocks
+
+  template <class T>
+  static void swapValue(T &a, T &b) {
+    T tmp = a;
+    a = b;
+    b = tmp;
+  }
+
+  static const int16_t *stepTable() {
+    static const int16_t table[89] = {
+        7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+        19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+        50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+        130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+        337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+        876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+        2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+        5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+        15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+    return table;
+  }
+
+  static const int8_t *indexTable() {
+    static const int8_t table[16] = {-1, -1, -1, -1, 2, 4, 6, 8,
+                                     -1, -1, -1, -1, 2, 4, 6, 8};
+    return table;
+  }
+
+  size_t pendingFrames() {
+    return pending_bytes / (channel_count * sizeof(int16_t));
+  }
+
+  void encodeBlock() {
+    uint8_t encoded[MAX_BLOCK_BYTES];
+    size_t frames = pendingFrames();
+    size_t len;
+    switch (fmt) {
+      case IMA_ADPCM:
+        len = encodeIMA(pending.data(), frames, encoded);
+        break;
+      case Lossless:
+        len = encodeLossless(pending.data(), frames, encoded);
+        break;
+      default:
+        len = frames * channel_count * sizeof(int16_t);
+        memcpy(encoded, pending.data(), len);
+        break;
+    }
+    pending_bytes = 0;
+    size_t used = data.size();
+    size_t needed = used + len;
+    size_t index_bytes = (offsets.size() + 1) * sizeof(uint32_t);
+    if (max_bytes > 0 && needed + index_bytes > max_bytes) {
+      overflow = true;
+      return;
+    }
+    if (needed > (size_t)data.capacity()) {
+      // grow by 50%: end() releases what is not used
+      size_t capacity = needed + needed / 2;
+      if (max_bytes > 0 && capacity > max_bytes) capacity = max_bytes;
+      data.resize(capacity);
+    }
+    data.resize(needed);
+    memcpy(data.data() + used, encoded, len);
+    size_t block = offsets.size();
+    if (block + 1 > (size_t)offsets.capacity()) offsets.resize(block + block / 2 + 16);
+    offsets.resize(block + 1);
+    offsets[block] = used;
+    frame_count += frames;
+  }
+
+  /// Header per channel: first sample and step index; then one nibble per
+  /// sample, interleaved like the frames
+  size_t encodeIMA(const int16_t *pcm, size_t frames, uint8_t *out) {
+    const int16_t *steps = stepTable();
+    const int8_t *indexes = indexTable();
+    int32_t predictor[MAX_CHANNELS];
+    uint8_t *pos = out;
+    for (int ch = 0; ch < channel_count; ch++) {
+      predictor[ch] = pcm[ch];
+      *pos++ = pcm[ch] & 0xFF;
+      *pos++ = (pcm[ch] >> 8) & 0xFF;
+      *pos++ = step_index[ch];
+      *pos++ = 0;
+    }
+    size_t nibble = 0;
+    for (size_t f = 1; f < frames; f++) {
+      for (int ch = 0; ch < channel_count; ch++) {
+        int32_t diff = pcm[f * channel_count + ch] - predictor[ch];
+        int32_t step = steps[step_index[ch]];
+        uint8_t code = 0;
+        if (diff < 0) {
+          code = 8;
+          diff = -diff;
+        }
+        // the same reconstruction as the decoder
+        int32_t delta = step >> 3;
+        if (diff >= step) {
+          code |= 4;
+          diff -= step;
+          delta += step;
+        }
+        if (diff >= step >> 1) {
+          code |= 2;
+          diff -= step >> 1;
+          delta += step >> 1;
+        }
+        if (diff >= step >> 2) {
+          code |= 1;
+          delta += step >> 2;
+        }
+        predictor[ch] = clip(code & 8 ? predictor[ch] - delta
+                                      : predictor[ch] + delta);
+        int index = step_index[ch] + indexes[code];
+        step_index[ch] = index < 0 ? 0 : (index > 88 ? 88 : index);
+        if (nibble & 1) {
+          *pos++ |= code << 4;
+        } else {
+          *pos = code;
+        }
+        nibble++;
+      }
+    }
+    if (nibble & 1) pos++;
+    return pos - out;
+  }
+
+  void decodeIMA(const uint8_t *in, size_t frames, int16_t *out) {
+    const int16_t *steps = stepTable();
+    const int8_t *indexes = indexTable();
+    int32_t predictor[MAX_CHANNELS];
+    int index[MAX_CHANNELS];
+    for (int ch = 0; ch < channel_count; ch++) {
+      predictor[ch] = (int16_t)(in[0] | (in[1] << 8));
+      index[ch] = in[2];
+      in += 4;
+      *out++ = predictor[ch];
+    }
+    size_t nibble = 0;
+    for (size_t f = 1; f < frames; f++) {
+      for (int ch = 0; ch < channel_count; ch++) {
+        uint8_t code = nibble & 1 ? *in++ >> 4 : *in & 0x0F;
+        nibble++;
+        int32_t step = steps[index[ch]];
+        int32_t delta = step >> 3;
+        if (code & 4) delta += step;
+        if (code & 2) delta += step >> 1;
+        if (code & 1) delta += step >> 2;
+        predictor[ch] = clip(code & 8 ? predictor[ch] - delta
+                                      : predictor[ch] + delta);
+        index[ch] += indexes[code];
+        if (index[ch] < 0) index[ch] = 0;
+        if (index[ch] > 88) index[ch] = 88;
+        *out++ = predictor[ch];
+      }
+    }
+  }
+
+  static inline int32_t predict(int order, int32_t x1, int32_t x2) {
+    switch (order) {
+      case 0:
+        return 0;
+      case 1:
+        return x1;
+      default:
+        return 2 * x1 - x2;
+    }
+  }
+
+  static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  }
+
+  /// Per channel: order and bit width, the first two samples and the
+  /// residuals of the following samples with the bit width
+  size_t encodeLossless(const int16_t *pcm, size_t frames, uint8_t *out) {
+    uint8_t *pos = out;
+    for (int ch = 0; ch < channel_count; ch++) {
+      const int16_t *x = pcm + ch;
+      int stride = channel_count;
+      // the order with the smallest max residual
+      int best_order = 0;
+      int best_width = 32;
+      for (int order = 0; order <= 2; order++) {
+        uint32_t bits = 0;
+        for (size_t f = 2; f < frames; f++) {
+          int32_t residual = x[f * stride] - predict(order, x[(f - 1) * stride],
+                                                     x[(f - 2) * stride]);
+          bits |= zigzag(residual);
+        }
+        int width = 0;
+        while (bits >> width) width++;
+        if (width < best_width) {
+          best_width = width;
+          best_order = order;
+        }
+      }
+      *pos++ = (best_order << 5) | best_width;
+      for (size_t f = 0; f < 2; f++) {
+        int16_t value = f < frames ? x[f * stride] : 0;
+        *pos++ = value & 0xFF;
+        *pos++ = (value >> 8) & 0xFF;
+      }
+      uint32_t acc = 0;
+      int acc_bits = 0;
+      for (size_t f = 2; f < frames; f++) {
+        int32_t residual = x[f * stride] - predict(best_order, x[(f - 1) * stride],
+                                                   x[(f - 2) * stride]);
+        acc |= zigzag(residual) << acc_bits;
+        acc_bits += best_width;
+        while (acc_bits >= 8) {
+          *pos++ = acc & 0xFF;
+          acc >>= 8;
+          acc_bits -= 8;
+        }
+      }
+      if (acc_bits > 0) *pos++ = acc & 0xFF;
+    }
+    return pos - out;
+  }
+
+  void decodeLossless(const uint8_t *in, size_t frames, int16_t *out) {
+    for (int ch = 0; ch < channel_count; ch++) {
+      int order = in[0] >> 5;
+      int width = in[0] & 0x1F;
+      uint32_t mask = width < 32 ? (1u << width) - 1 : 0xFFFFFFFF;
+      int32_t x2 = (int16_t)(in[1] | (in[2] << 8));
+      int32_t x1 = (int16_t)(in[3] | (in[4] << 8));
+      in += 5;
+      int16_t *y = out + ch;
+      int stride = channel_count;
+      y[0] = x2;
+      if (frames > 1) y[stride] = x1;
+      uint32_t acc = 0;
+      int acc_bits = 0;
+      for (size_t f = 2; f < frames; f++) {
+        while (acc_bits < width) {
+          acc |= (uint32_t)*in++ << acc_bits;
+          acc_bits += 8;
+        }
+        uint32_t value = acc & mask;
+        acc >>= width;
+        acc_bits -= width;
+        int32_t residual = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+        int32_t sample = predict(order, x1, x2) + residual;
+        y[f * stride] = sample;
+        x2 = x1;
+        x1 = sample;
+      }
+    }
+  }
+
+  static inline int32_t clip(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return value;
+  }
+};
+
+}  // namespace audio_tools
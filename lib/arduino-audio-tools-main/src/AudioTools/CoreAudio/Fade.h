@@ -1,6 +1,7 @@
 #pragma once
 #include "AudioToolsConfig.h"
 #include "AudioStreams.h"
+#include "AudioProfiler.h"
 
 namespace audio_tools {
 
@@ -329,6 +330,7 @@ public:
   int available() override { return p_io == nullptr ? 0 : p_io->available(); }
 
   size_t write(const uint8_t *data, size_t len) override {
+    AUDIO_PROFILE_SCOPE("fade");
     if (p_out==nullptr) return 0;
     if (!active) {
       LOGE("%s", error_msg);
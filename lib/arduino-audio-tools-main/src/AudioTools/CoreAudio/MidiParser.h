@@ -0,0 +1,102 @@
+#pragma once
+#include <stdint.h>
+
+namespace audio_tools {
+
+/// Kind of a MidiMessage
+enum class MidiType : uint8_t {
+  None = 0,
+  NoteOff = 0x80,
+  NoteOn = 0x90,
+  PolyPressure = 0xA0,
+  ControlChange = 0xB0,
+  ProgramChange = 0xC0,
+  ChannelPressure = 0xD0,
+  PitchBend = 0xE0,
+  Clock = 0xF8,
+  Start = 0xFA,
+  Continue = 0xFB,
+  Stop = 0xFC,
+};
+
+/// One complete MIDI message. channel is 0..15 (0 for real time messages),
+/// a pitch bend has its 14 bit value in data1 (lsb) and data2 (msb).
+struct MidiMessage {
+  MidiType type = MidiType::None;
+  uint8_t channel = 0;
+  uint8_t data1 = 0;
+  uint8_t data2 = 0;
+};
+
+/**
+ * @brief Turns the bytes of a serial MIDI stream (e.g. a UART with 31250 baud)
+ * into messages, one byte at a time and without any allocation, so it can be
+ * called for each received byte from an interrupt or a task. It handles
+ * running status, real time messages (clock, start, stop) in the middle of
+ * another message and skips system exclusive and the other system common
+ * messages. A note on with velocity 0 is reported as note off.
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MidiParser {
+ public:
+  /// Feeds one byte; returns true when it completes a message
+  bool parse(uint8_t byte, MidiMessage &result) {
+    if (byte >= 0xF8) return parseRealTime(byte, result);
+    if (byte & 0x80) {
+      // system common messages end the running status
+      status = byte < 0xF0 ? byte : 0;
+      count = 0;
+      return false;
+    }
+    // data byte: ignored without status (e.g. in a sysex)
+    if (status == 0) return false;
+    data[count++] = byte;
+    if (count < dataLength(status)) return false;
+    count = 0;
+    result.type = static_cast<MidiType>(status & 0xF0);
+    result.channel = status & 0x0F;
+    result.data1 = data[0];
+    result.data2 = dataLength(status) > 1 ? data[1] : 0;
+    if (result.type == MidiType::NoteOn && result.data2 == 0) {
+      result.type = MidiType::NoteOff;
+    }
+    return true;
+  }
+
+  /// Forgets a partial message and the running status
+  void reset() {
+    status = 0;
+    count = 0;
+  }
+
+ protected:
+  uint8_t status = 0;
+  uint8_t data[2] = {0, 0};
+  uint8_t count = 0;
+
+  static uint8_t dataLength(uint8_t status) {
+    uint8_t type = status & 0xF0;
+    return type == 0xC0 || type == 0xD0 ? 1 : 2;
+  }
+
+  bool parseRealTime(uint8_t byte, MidiMessage &result) {
+    switch (byte) {
+      case 0xF8:
+      case 0xFA:
+      case 0xFB:
+      case 0xFC:
+        result.type = static_cast<MidiType>(byte);
+        result.channel = 0;
+        result.data1 = 0;
+        result.data2 = 0;
+        return true;
+      default:
+        // active sensing, reset: the running message goes on
+        return false;
+    }
+  }
+};
+
+}  // namespace audio_tools
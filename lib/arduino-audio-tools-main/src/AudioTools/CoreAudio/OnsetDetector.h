@@ -0,0 +1,234 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/AudioOutput.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Finds the transients (onsets) in PCM data, e.g. to chop a drum loop
+ * into slices. Use it as output of a decoder: the channels are mixed to mono
+ * and the energy is measured in short blocks, once for the signal and once
+ * for its first difference (high frequencies). An onset is reported when the
+ * level of a block in one of them rises by more than the threshold above the
+ * envelope of the previous blocks (positive energy flux in dB), the block is
+ * above the floor and the last onset is at least the minimum gap ago. The
+ * position is then refined to the first frame of the block which clearly
+ * exceeds the envelope, minus a short pre-roll so that the attack is not cut.
+ *
+ * The result is a list of frame offsets which always starts with 0. Only a
+ * block of mono samples is kept, so a file of any length can be analyzed.
+ * - 8, 16, 24 (3 bytes) and 32 bit input
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class OnsetDetector : public AudioOutput {
+ public:
+  OnsetDetector() = default;
+
+  /// Starts a new analysis: the format is defined with setAudioInfo()
+  bool begin() {
+    onset_list.clear();
+    onset_list.push_back(0);
+    frame_count = 0;
+    block_pos = 0;
+    partial_len = 0;
+    envelope_db[0] = envelope_db[1] = -120.0f;
+    last_sample = 0;
+    primed = false;
+    return setupBlock();
+  }
+
+  /// Starts a new analysis of data in the indicated format
+  bool begin(AudioInfo info) {
+    cfg = info;
+    return begin();
+  }
+
+  /// Defines the format of the data
+  void setAudioInfo(AudioInfo from) override {
+    cfg = from;
+    setupBlock();
+  }
+
+  /// Length of the analysis blocks in ms (default 3 ms)
+  void setBlockMs(float ms) { block_ms = ms; }
+
+  /// Rise of a block above the envelope in dB which counts as onset
+  void setThreshold(float db) { threshold_db = db; }
+
+  /// Blocks below this level (dB full scale) are ignored
+  void setFloor(float dbfs) { floor_db = dbfs; }
+
+  /// Release of the envelope in dB per second: the level of a new onset is
+  /// compared with the decayed level of the previous one
+  void setDecay(float dbPerSecond) { decay_db_per_sec = dbPerSecond; }
+
+  /// Minimum distance of two onsets in ms
+  void setMinGapMs(float ms) { min_gap_ms = ms; }
+
+  /// The onset is moved this much in front of the detected attack
+  void setPreRollMs(float ms) { pre_roll_ms = ms; }
+
+  /// Maximum number of reported onsets (including the start at 0)
+  void setMaxOnsets(size_t count) { max_onsets = count; }
+
+  /// Analyzes the PCM data
+  size_t write(const uint8_t *data, size_t len) override {
+    int bytes = cfg.bits_per_sample / 8;
+    int channels = cfg.channels;
+    if (bytes < 1 || bytes > 4 || channels <= 0 || channels > MAX_CHANNELS ||
+        block.size() == 0) {
+      return len;
+    }
+    int frame_bytes = bytes * channels;
+    size_t result = len;
+    if (partial_len > 0) {
+      size_t missing = frame_bytes - partial_len;
+      if (missing > len) missing = len;
+      memcpy(partial + partial_len, data, missing);
+      partial_len += missing;
+      data += missing;
+      len -= missing;
+      if (partial_len < (size_t)frame_bytes) return result;
+      addFrame(partial, bytes, channels);
+      partial_len = 0;
+    }
+    size_t frames = len / frame_bytes;
+    for (size_t f = 0; f < frames; f++, data += frame_bytes) {
+      addFrame(data, bytes, channels);
+    }
+    partial_len = len % frame_bytes;
+    memcpy(partial, data, partial_len);
+    return result;
+  }
+
+  /// Frame offsets of the onsets: the first entry is always 0
+  Vector<uint32_t> &onsets() { return onset_list; }
+
+  /// Number of analyzed frames
+  uint32_t frames() { return frame_count; }
+
+ protected:
+  static constexpr int MAX_CHANNELS = 8;
+  static constexpr size_t MAX_BLOCK_FRAMES = 1024;
+  static constexpr int BANDS = 2;
+  float block_ms = 3.0f;
+  float threshold_db = 9.0f;
+  float floor_db = -45.0f;
+  float min_gap_ms = 80.0f;
+  float pre_roll_ms = 1.0f;
+  float decay_db_per_sec = 200.0f;
+  size_t max_onsets = 64;
+  Vector<uint32_t> onset_list;
+  Vector<int16_t> block{0};  // mono samples of the current block
+  size_t block_frames = 0;
+  size_t block_pos = 0;
+  uint32_t frame_count = 0;
+  // level envelopes in dB of the signal and of its first difference
+  float envelope_db[BANDS] = {-120.0f, -120.0f};
+  float decay_db = 0.0f;  // per block
+  int16_t last_sample = 0;  // of the previous block
+  bool primed = false;
+  uint8_t partial[4 * MAX_CHANNELS];
+  size_t partial_len = 0;
+
+  bool setupBlock() {
+    if (cfg.sample_rate <= 0) return false;
+    block_frames = (size_t)(cfg.sample_rate * block_ms / 1000.0f);
+    if (block_frames < 16) block_frames = 16;
+    if (block_frames > MAX_BLOCK_FRAMES) block_frames = MAX_BLOCK_FRAMES;
+    block.resize(block_frames);
+    block_pos = 0;
+    // peak envelope: follows a rising level immediately and decays slowly,
+    // so that zero crossings of low frequencies in a block do not count
+    decay_db = decay_db_per_sec * block_frames / cfg.sample_rate;
+    return true;
+  }
+
+  void addFrame(const uint8_t *frame, int bytes, int channels) {
+    int32_t sum = 0;
+    for (int ch = 0; ch < channels; ch++) {
+      sum += readSample(frame + ch * bytes, bytes);
+    }
+    block[block_pos++] = (int16_t)(sum / channels);
+    frame_count++;
+    if (block_pos == block_frames) {
+      analyzeBlock();
+      block_pos = 0;
+    }
+  }
+
+  /// Sample of a band: the signal or the difference to the previous sample,
+  /// which emphasizes the high frequencies (a hi-hat over a bass drum)
+  inline int32_t bandSample(int band, size_t j) {
+    if (band == 0) return block[j];
+    int32_t previous = j > 0 ? block[j - 1] : last_sample;
+    return (block[j] - previous) / 2;
+  }
+
+  void analyzeBlock() {
+    uint32_t block_start = frame_count - block_frames;
+    int onset_band = -1;
+    float level_db[BANDS];
+    for (int band = 0; band < BANDS; band++) {
+      int64_t energy = 0;
+      for (size_t j = 0; j < block_frames; j++) {
+        int32_t value = bandSample(band, j);
+        energy += value * value;
+      }
+      float mean = (float)energy / block_frames / (32768.0f * 32768.0f);
+      level_db[band] = 10.0f * log10f(mean + 1.0e-12f);
+      if (primed && onset_band < 0 && level_db[band] >= floor_db &&
+          level_db[band] - envelope_db[band] >= threshold_db) {
+        onset_band = band;
+      }
+    }
+    if (onset_band >= 0 && onset_list.size() < max_onsets) {
+      uint32_t onset = block_start + attackOffset(onset_band);
+      uint32_t pre_roll = cfg.sample_rate * pre_roll_ms / 1000.0f;
+      onset = onset > pre_roll ? onset - pre_roll : 0;
+      uint32_t min_gap = cfg.sample_rate * min_gap_ms / 1000.0f;
+      uint32_t last = onset_list[onset_list.size() - 1];
+      if (onset >= last + min_gap) onset_list.push_back(onset);
+    }
+    for (int band = 0; band < BANDS; band++) {
+      envelope_db[band] -= decay_db;
+      if (!primed || level_db[band] > envelope_db[band]) {
+        envelope_db[band] = level_db[band];
+      }
+    }
+    last_sample = block[block_frames - 1];
+    primed = true;
+  }
+
+  /// First frame of the block which is 3x (10 dB) above the envelope
+  size_t attackOffset(int band) {
+    float limit = 3.0f * 32768.0f * powf(10.0f, envelope_db[band] / 20.0f);
+    if (limit < 1.0f) limit = 1.0f;
+    for (size_t j = 0; j < block_frames; j++) {
+      if (fabsf((float)bandSample(band, j)) >= limit) return j;
+    }
+    return 0;
+  }
+
+  /// Reads one sample as 16 bit value
+  static inline int32_t readSample(const uint8_t *ptr, int bytes) {
+    switch (bytes) {
+      case 1:
+        return ((int32_t)ptr[0] - 128) * 256;
+      case 2:
+        return (int16_t)(ptr[0] | (ptr[1] << 8));
+      case 3:
+        return (int16_t)(ptr[1] | (ptr[2] << 8));
+      default:
+        return (int16_t)(ptr[2] | (ptr[3] << 8));
+    }
+  }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,304 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/AudioOutput.h"
+#include "AudioTools/CoreAudio/VarispeedStream.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Converts decoded PCM once into the native format of an engine
+ * (sample rate, number of channels and 16 bit samples) and collects the
+ * result in memory, so that playback never needs to convert. Use it as output
+ * of a decoder: the source format is provided with setAudioInfo().
+ *
+ * - 8, 16, 24 (3 bytes) and 32 bit input
+ * - channels: mono is duplicated, additional channels are mixed down
+ * - bit depth reduction with TPDF dither
+ * - sample rate conversion with the windowed sinc VarispeedResampler
+ *
+ * The memory is allocated with the DefaultAllocator (PSRAM when available).
+ * Define the expected input size with setExpectedBytes() to allocate the
+ * result only once, and a limit with setMaxBytes(): data beyond the limit is
+ * dropped and isOverflow() returns true. With setOutput() the frames are
+ * passed on instead, e.g. to be compressed on the way.
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class SampleImporter : public AudioOutput {
+ public:
+  SampleImporter() = default;
+
+  /// Starts a new import into the indicated target format (bits_per_sample
+  /// must be 16)
+  bool begin(AudioInfo target) {
+    if (target.bits_per_sample != 16 || target.channels <= 0 ||
+        target.channels > MAX_CHANNELS || target.sample_rate <= 0) {
+      LOGE("SampleImporter: unsupported target format");
+      return false;
+    }
+    target_info = target;
+    source_info.clear();
+    pcm.clear();
+    frame_count = 0;
+    // an incomplete frame of the previous import is dropped
+    partial_len = 0;
+    overflow = false;
+    resampling = false;
+    p_out = nullptr;
+    return true;
+  }
+
+  /// Completes the import: provides the last frames of the resampler
+  void end() {
+    if (resampling) {
+      // push the lookahead of the kernel out with silence
+      int16_t silence[BLOCK_FRAMES * MAX_CHANNELS] = {0};
+      size_t remaining = resampler.latency();
+      while (remaining > 0) {
+        size_t n = remaining < BLOCK_FRAMES ? remaining : BLOCK_FRAMES;
+        appendResampled(silence, n);
+        remaining -= n;
+      }
+      resampling = false;
+    }
+  }
+
+  /// Size of the input (e.g. the file size) to allocate the result at once
+  void setExpectedBytes(size_t bytes) { expected_bytes = bytes; }
+
+  /// Writes the converted frames to out (e.g. a BlockCompressedPCM) instead
+  /// of collecting them: call it after begin()
+  void setOutput(Print &out) { p_out = &out; }
+
+  /// Max size of the result in bytes (0 = unlimited)
+  void setMaxBytes(size_t bytes) { max_bytes = bytes; }
+
+  /// true if data was dropped because of the max size
+  bool isOverflow() { return overflow; }
+
+  /// Format of the imported data
+  AudioInfo audioInfoOut() override { return target_info; }
+
+  /// Format of the source
+  AudioInfo sourceInfo() { return source_info; }
+
+  /// Defines the format of the source
+  void setAudioInfo(AudioInfo from) override {
+    // the bytes of an incomplete frame do not fit another frame size
+    if (from.channels != source_info.channels ||
+        from.bits_per_sample != source_info.bits_per_sample) {
+      partial_len = 0;
+    }
+    source_info = from;
+    cfg = from;
+    resampling = from.sample_rate != target_info.sample_rate;
+    if (resampling) {
+      float step = (float)from.sample_rate / target_info.sample_rate;
+      resampler.begin(target_info.channels, VarispeedResampler::Sinc,
+                      step > 1.0f ? step : 1.0f);
+      resampler.setStep(step);
+    }
+    reserve();
+  }
+
+  /// Converts the decoded PCM data
+  size_t write(const uint8_t *data, size_t len) override {
+    int bytes = source_info.bits_per_sample / 8;
+    int channels = source_info.channels;
+    if (bytes < 1 || bytes > 4 || channels <= 0 || channels > MAX_CHANNELS) {
+      return len;
+    }
+    int frame_bytes = bytes * channels;
+    // keep incomplete frames for the next write
+    size_t result = len;
+    if (partial_len > 0) {
+      size_t missing = frame_bytes - partial_len;
+      if (missing > len) missing = len;
+      memcpy(partial + partial_len, data, missing);
+      partial_len += missing;
+      data += missing;
+      len -= missing;
+      if (partial_len == (size_t)frame_bytes) {
+        convert(partial, 1);
+        partial_len = 0;
+      }
+    }
+    size_t frames = len / frame_bytes;
+    const uint8_t *pos = data;
+    while (frames > 0) {
+      size_t n = frames < BLOCK_FRAMES ? frames : BLOCK_FRAMES;
+      convert(pos, n);
+      pos += n * frame_bytes;
+      frames -= n;
+    }
+    partial_len = len % frame_bytes;
+    memcpy(partial, pos, partial_len);
+    return result;
+  }
+
+  /// Number of imported frames
+  size_t frames() { return frame_count; }
+
+  /// Imported interleaved samples (without setOutput()): move them to keep
+  /// them
+  Vector<int16_t> &samples() { return pcm; }
+
+  /// Allocated memory of the result in bytes
+  size_t memoryUsed() { return (size_t)pcm.capacity() * sizeof(int16_t); }
+
+ protected:
+  static constexpr int BLOCK_FRAMES = 64;
+  static constexpr int MAX_CHANNELS = 8;
+  AudioInfo target_info;
+  AudioInfo source_info;
+  Vector<int16_t> pcm{0};
+  Print *p_out = nullptr;
+  VarispeedResampler resampler;
+  size_t frame_count = 0;
+  size_t expected_bytes = 0;
+  size_t max_bytes = 0;
+  bool overflow = false;
+  bool resampling = false;
+  uint32_t seed = 22222;
+  uint8_t partial[4 * MAX_CHANNELS];
+  size_t partial_len = 0;
+  int16_t converted[BLOCK_FRAMES * MAX_CHANNELS];
+  int16_t resampled[BLOCK_FRAMES * MAX_CHANNELS];
+
+  void reserve() {
+    if (expected_bytes == 0 || source_info.bits_per_sample < 8 || p_out) return;
+    int source_frame = source_info.bits_per_sample / 8 * source_info.channels;
+    float ratio = (float)target_info.sample_rate / source_info.sample_rate;
+    size_t samples =
+        (size_t)(expected_bytes / source_frame * ratio + resampler.latency() +
+                 64) *
+        target_info.channels;
+    if (max_bytes > 0 && samples * sizeof(int16_t) > max_bytes) {
+      samples = max_bytes / sizeof(int16_t);
+    }
+    if ((size_t)pcm.capacity() < samples) {
+      size_t used = pcm.size();
+      pcm.resize(samples);
+      pcm.resize(used);
+    }
+  }
+
+  /// Reads one sample as 32 bit value
+  static inline int32_t readSample(const uint8_t *ptr, int bytes) {
+    switch (bytes) {
+      case 1:
+        return (int32_t)((uint32_t)(ptr[0] ^ 0x80) << 24);
+      case 2:
+        return (int32_t)((uint32_t)ptr[0] << 16 | (uint32_t)ptr[1] << 24);
+      case 3:
+        return (int32_t)((uint32_t)ptr[0] << 8 | (uint32_t)ptr[1] << 16 |
+                         (uint32_t)ptr[2] << 24);
+      default:
+        return (int32_t)((uint32_t)ptr[0] | (uint32_t)ptr[1] << 8 |
+                         (uint32_t)ptr[2] << 16 | (uint32_t)ptr[3] << 24);
+    }
+  }
+
+  inline uint32_t nextRandom() {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+  /// 32 bit to 16 bit: TPDF dither of +-1 LSB when bits are removed
+  inline int16_t reduce(int64_t value, bool dither) {
+    if (dither) {
+      value += (int64_t)(nextRandom() >> 16) - (int64_t)(nextRandom() >> 16);
+    }
+    value = (value + 32768) >> 16;
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+  }
+
+  /// channel layout and sample type
+  void convert(const uint8_t *data, size_t frames) {
+    int bytes = source_info.bits_per_sample / 8;
+    int channels = source_info.channels;
+    int out_channels = target_info.channels;
+    // 8 and 16 bit samples are copied exactly, more bits are dithered
+    bool exact = bytes <= 2;
+    bool dither = bytes > 2;
+    int16_t values[MAX_CHANNELS];
+    int16_t *out = converted;
+    for (size_t f = 0; f < frames; f++) {
+      const uint8_t *frame = data + f * bytes * channels;
+      if (channels <= out_channels) {
+        // mono to all channels, stereo to the first two ...
+        for (int in = 0; in < channels; in++) {
+          int32_t value = readSample(frame + in * bytes, bytes);
+          values[in] = exact ? value >> 16 : reduce(value, dither);
+        }
+        for (int ch = 0; ch < out_channels; ch++) {
+          *out++ = values[ch % channels];
+        }
+      } else {
+        // mix down the channels which map to the same output
+        for (int ch = 0; ch < out_channels; ch++) {
+          int64_t sum = 0;
+          int count = 0;
+          for (int in = ch; in < channels; in += out_channels) {
+            sum += readSample(frame + in * bytes, bytes);
+            count++;
+          }
+          *out++ = reduce(sum / count, dither);
+        }
+      }
+    }
+    if (resampling) {
+      appendResampled(converted, frames);
+    } else {
+      append(converted, frames);
+    }
+  }
+
+  void appendResampled(const int16_t *data, size_t frames) {
+    size_t n;
+    int max_frames = BLOCK_FRAMES;
+    while ((n = resampler.process(data, frames, resampled, max_frames)) > 0) {
+      append(resampled, n);
+      frames = 0;
+    }
+  }
+
+  void append(const int16_t *data, size_t frames) {
+    int channels = target_info.channels;
+    if (p_out != nullptr) {
+      p_out->write((const uint8_t *)data, frames * channels * sizeof(int16_t));
+      frame_count += frames;
+      return;
+    }
+    size_t used = pcm.size();
+    size_t needed = used + frames * channels;
+    if (max_bytes > 0 && needed * sizeof(int16_t) > max_bytes) {
+      overflow = true;
+      size_t limit = max_bytes / sizeof(int16_t);
+      frames = used < limit ? (limit - used) / channels : 0;
+      needed = used + frames * channels;
+    }
+    if (frames == 0) return;
+    if (needed > (size_t)pcm.capacity()) {
+      // grow by 50% when the expected size was not known
+      size_t capacity = needed + needed / 2;
+      if (max_bytes > 0 && capacity * sizeof(int16_t) > max_bytes) {
+        capacity = max_bytes / sizeof(int16_t);
+      }
+      pcm.resize(capacity);
+    }
+    pcm.resize(needed);
+    memcpy(pcm.data() + used, data, frames * channels * sizeof(int16_t));
+    frame_count += frames;
+  }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,494 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/AudioProfiler.h"
+#include "AudioTools/CoreAudio/AudioStreams.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Block based resampler for interleaved int16_t frames with a
+ * fractional step (input frames per output frame) which can glide to a new
+ * value, e.g. to play a sample at a different pitch. The position is kept in
+ * 32.32 fixed point, so the pitch does not drift.
+ *
+ * Kernels:
+ * - Linear: 2 points, cheapest but with audible aliasing and high frequency
+ *   loss
+ * - Hermite: 4 point cubic Hermite
+ * - Sinc: Kaiser windowed sinc with 8 zero crossings on each side from a
+ *   precomputed table. For steps > 1 the kernel is stretched so that its
+ *   cutoff follows the new Nyquist frequency (no aliasing); this needs
+ *   16 * step taps.
+ *
+ * A step of exactly 1 copies the input. The output is delayed by the lookahead
+ * of the kernel (1, 2 or 8 * max step frames).
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class VarispeedResampler {
+ public:
+  enum Kernel { Linear, Hermite, Sinc };
+
+  static constexpr int SINC_ZERO_CROSSINGS = 8;
+  static constexpr int SINC_RESOLUTION = 128;
+
+  /// maxStep: upper limit of setStep() which determines the lookahead
+  bool begin(int channels, Kernel kernel = Hermite, float maxStep = 2.0f) {
+    if (channels <= 0 || maxStep <= 0.0f) return false;
+    channel_count = channels;
+    kernel_type = kernel;
+    max_step = maxStep;
+    switch (kernel) {
+      case Linear:
+        pad_left = 0;
+        pad_right = 1;
+        break;
+      case Hermite:
+        pad_left = 1;
+        pad_right = 2;
+        break;
+      case Sinc:
+        pad_left = pad_right =
+            ceilf(SINC_ZERO_CROSSINGS * (max_step > 1.0f ? max_step : 1.0f)) + 1;
+        setupSincTable();
+        coefficients.resize(pad_left + pad_right + 1);
+        break;
+    }
+    reset();
+    return true;
+  }
+
+  /// Preallocates the history for process() calls with up to the indicated
+  /// input frames, so that processing does not allocate
+  void reserve(size_t inFrames) {
+    if (channel_count == 0) return;
+    size_t len = buffer.size();
+    buffer.resize((pad_left + pad_right + 2 + inFrames) * channel_count);
+    buffer.resize(len);
+  }
+
+  /// Defines where the history and the sinc coefficients are allocated, e.g.
+  /// in internal RAM: call before begin()
+  void setAllocator(Allocator &allocator) {
+    buffer.reset();
+    buffer.setAllocator(allocator);
+    coefficients.reset();
+    coefficients.setAllocator(allocator);
+  }
+
+  /// Clears the history: the next input starts at the beginning
+  void reset() {
+    buffer.resize(pad_left * channel_count);
+    if (pad_left > 0) {
+      memset(buffer.data(), 0, pad_left * channel_count * sizeof(int16_t));
+    }
+    buffer_frames = pad_left;
+    index = pad_left;
+    frac = 0;
+    ramp_frames = 0;
+  }
+
+  /// Defines the input frames per output frame (2.0 = one octave up): the
+  /// step glides linearly over the indicated number of output frames
+  void setStep(float value, uint32_t frames = 0) {
+    if (value > max_step) value = max_step;
+    if (value < MIN_STEP) value = MIN_STEP;
+    uint64_t target = (uint64_t)((double)value * 4294967296.0);
+    if (frames == 0) {
+      step = target;
+      ramp_frames = 0;
+    } else {
+      step_target = target;
+      step_delta = ((int64_t)target - (int64_t)step) / (int64_t)frames;
+      ramp_frames = frames;
+    }
+  }
+
+  float getStep() { return step / 4294967296.0f; }
+
+  bool isRamping() { return ramp_frames > 0; }
+
+  Kernel kernel() { return kernel_type; }
+
+  int channels() { return channel_count; }
+
+  /// Frames between input and output
+  int latency() { return pad_right; }
+
+  /// Adds the input frames and provides up to maxOutFrames output frames.
+  /// Call again with inFrames = 0 until 0 is returned to get all output.
+  size_t process(const int16_t *in, size_t inFrames, int16_t *out,
+                 size_t maxOutFrames) {
+    if (channel_count == 0) return 0;
+    if (inFrames > 0) append(in, inFrames);
+    size_t result = 0;
+    if (isIdentity()) {
+      result = copyFrames(out, maxOutFrames);
+    } else {
+      switch (kernel_type) {
+        case Linear:
+          result = processLinear(out, maxOutFrames);
+          break;
+        case Hermite:
+          result = processHermite(out, maxOutFrames);
+          break;
+        case Sinc:
+          result = processSinc(out, maxOutFrames);
+          break;
+      }
+    }
+    compact();
+    return result;
+  }
+
+ protected:
+  static constexpr float MIN_STEP = 1.0f / 16.0f;
+  static constexpr uint64_t ONE = 0x100000000ull;
+  Vector<int16_t> buffer{0};
+  Vector<float> coefficients{0};
+  int channel_count = 0;
+  Kernel kernel_type = Hermite;
+  float max_step = 2.0f;
+  int pad_left = 0;
+  int pad_right = 0;
+  size_t buffer_frames = 0;  // valid frames in buffer
+  size_t index = 0;          // integer part of the read position
+  uint32_t frac = 0;         // fractional part of the read position (Q32)
+  uint64_t step = ONE;       // 32.32 fixed point
+  uint64_t step_target = ONE;
+  int64_t step_delta = 0;
+  uint32_t ramp_frames = 0;
+
+  /// Right half of the windowed sinc: shared by all instances
+  static Vector<float> &sincTable() {
+    static Vector<float> table{0};
+    return table;
+  }
+
+  static float besselI0(float x) {
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 20; k++) {
+      term *= (x / (2.0f * k)) * (x / (2.0f * k));
+      sum += term;
+    }
+    return sum;
+  }
+
+  static void setupSincTable() {
+    Vector<float> &table = sincTable();
+    int len = SINC_ZERO_CROSSINGS * SINC_RESOLUTION + 2;
+    if (table.size() == len) return;
+    // cutoff slightly below Nyquist so that the transition band ends there
+    const float cutoff = 0.9f;
+    const float beta = 8.0f;
+    float norm = besselI0(beta);
+    table.resize(len);
+    for (int j = 0; j < len; j++) {
+      float t = (float)j / SINC_RESOLUTION;
+      float x = t / SINC_ZERO_CROSSINGS;
+      float window =
+          x >= 1.0f ? 0.0f : besselI0(beta * sqrtf(1.0f - x * x)) / norm;
+      float arg = PI * cutoff * t;
+      float sinc = j == 0 ? 1.0f : sinf(arg) / arg;
+      table[j] = cutoff * sinc * window;
+    }
+  }
+
+  bool isIdentity() { return step == ONE && frac == 0 && ramp_frames == 0; }
+
+  void append(const int16_t *in, size_t frames) {
+    size_t pos = buffer_frames * channel_count;
+    buffer.resize((buffer_frames + frames) * channel_count);
+    memcpy(buffer.data() + pos, in, frames * channel_count * sizeof(int16_t));
+    buffer_frames += frames;
+  }
+
+  /// Drops the frames which are not needed any more
+  void compact() {
+    if (index <= (size_t)pad_left) return;
+    size_t drop = index - pad_left;
+    if (drop > buffer_frames) drop = buffer_frames;
+    size_t keep = buffer_frames - drop;
+    memmove(buffer.data(), buffer.data() + drop * channel_count,
+            keep * channel_count * sizeof(int16_t));
+    buffer_frames = keep;
+    index -= drop;
+    buffer.resize(keep * channel_count);
+  }
+
+  inline bool available() { return index + pad_right < buffer_frames; }
+
+  inline void advance() {
+    if (ramp_frames > 0) {
+      step += step_delta;
+      if (--ramp_frames == 0) step = step_target;
+    }
+    uint64_t pos = (uint64_t)frac + step;
+    index += pos >> 32;
+    frac = (uint32_t)pos;
+  }
+
+  size_t copyFrames(int16_t *out, size_t maxOutFrames) {
+    size_t frames = 0;
+    if (available()) frames = buffer_frames - pad_right - index;
+    if (frames > maxOutFrames) frames = maxOutFrames;
+    memcpy(out, buffer.data() + index * channel_count,
+           frames * channel_count * sizeof(int16_t));
+    index += frames;
+    return frames;
+  }
+
+  size_t processLinear(int16_t *out, size_t maxOutFrames) {
+    const int16_t *data = buffer.data();
+    int channels = channel_count;
+    size_t result = 0;
+    while (result < maxOutFrames && available()) {
+      const int16_t *x = data + index * channels;
+      int32_t f = frac >> 17;  // Q15
+      for (int ch = 0; ch < channels; ch++) {
+        int32_t x0 = x[ch];
+        int32_t x1 = x[ch + channels];
+        *out++ = x0 + (((x1 - x0) * f) >> 15);
+      }
+      result++;
+      advance();
+    }
+    return result;
+  }
+
+  size_t processHermite(int16_t *out, size_t maxOutFrames) {
+    const int16_t *data = buffer.data();
+    int channels = channel_count;
+    size_t result = 0;
+    while (result < maxOutFrames && available()) {
+      const int16_t *x = data + index * channels;
+      float t = frac * (1.0f / 4294967296.0f);
+      for (int ch = 0; ch < channels; ch++) {
+        float xm1 = x[ch - channels];
+        float x0 = x[ch];
+        float x1 = x[ch + channels];
+        float x2 = x[ch + 2 * channels];
+        float c1 = 0.5f * (x1 - xm1);
+        float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        *out++ = clip(((c3 * t + c2) * t + c1) * t + x0);
+      }
+      result++;
+      advance();
+    }
+    return result;
+  }
+
+  size_t processSinc(int16_t *out, size_t maxOutFrames) {
+    const int16_t *data = buffer.data();
+    const float *table = sincTable().data();
+    float *coef = coefficients.data();
+    int channels = channel_count;
+    size_t result = 0;
+    while (result < maxOutFrames && available()) {
+      // kernel positions in table units: stretched for steps > 1
+      float current = step / 4294967296.0f;
+      float scale = current > 1.0f ? 1.0f / current : 1.0f;
+      float increment = scale * SINC_RESOLUTION;
+      float t = frac * (1.0f / 4294967296.0f);
+      const float limit = SINC_ZERO_CROSSINGS * SINC_RESOLUTION;
+      // left side: x[index - k] at distance t + k
+      int left = 0;
+      for (float pos = t * increment; pos < limit && left < pad_left + 1;
+           pos += increment) {
+        coef[left++] = scale * tableValue(table, pos);
+      }
+      // right side: x[index + 1 + k] at distance 1 - t + k
+      int right = 0;
+      for (float pos = (1.0f - t) * increment; pos < limit && right < pad_right;
+           pos += increment) {
+        coef[pad_left + 1 + right++] = scale * tableValue(table, pos);
+      }
+      // normalize to a gain of 1 at DC
+      float total = 0.0f;
+      for (int k = 0; k < left; k++) total += coef[k];
+      for (int k = 0; k < right; k++) total += coef[pad_left + 1 + k];
+      float norm = total > 0.0f ? 1.0f / total : 1.0f;
+      const int16_t *x = data + index * channels;
+      for (int ch = 0; ch < channels; ch++) {
+        float sum = 0.0f;
+        for (int k = 0; k < left; k++) sum += coef[k] * x[ch - k * channels];
+        for (int k = 0; k < right; k++)
+          sum += coef[pad_left + 1 + k] * x[ch + (k + 1) * channels];
+        *out++ = clip(sum * norm);
+      }
+      result++;
+      advance();
+    }
+    return result;
+  }
+
+  static inline float tableValue(const float *table, float pos) {
+    int idx = (int)pos;
+    float f = pos - idx;
+    return table[idx] + f * (table[idx + 1] - table[idx]);
+  }
+
+  static inline int16_t clip(float value) {
+    if (value > 32767.0f) return 32767;
+    if (value < -32768.0f) return -32768;
+    return (int16_t)lroundf(value);
+  }
+};
+
+/**
+ * @brief Plays the audio which is written to it at a different speed and
+ * pitch (varispeed) with a VarispeedResampler: e.g. between the AudioPlayer
+ * and the output. The audio format is not changed. Only 16 bit samples are
+ * supported.
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class VarispeedStream : public ModifyingStream {
+ public:
+  VarispeedStream() = default;
+  VarispeedStream(Print &out) { setOutput(out); }
+
+  void setStream(Stream &io) override {
+    p_out = &io;
+    p_notify = nullptr;
+  }
+
+  void setOutput(Print &out) override {
+    p_out = &out;
+    p_notify = nullptr;
+  }
+
+  /// Defines the output which is also informed about audio format changes
+  void setOutput(AudioStream &out) {
+    p_out = &out;
+    p_notify = &out;
+  }
+
+  /// Defines the output which is also informed about audio format changes
+  void setOutput(AudioOutput &out) {
+    p_out = &out;
+    p_notify = &out;
+  }
+
+  void setKernel(VarispeedResampler::Kernel kernel) { kernel_type = kernel; }
+
+  /// Upper limit of the speed
+  void setMaxSpeed(float speed) { max_speed = speed; }
+
+  /// Defines where the history of the resampler is allocated
+  void setAllocator(Allocator &allocator) {
+    resampler.setAllocator(allocator);
+    if (resampler.channels() > 0) begin();
+  }
+
+  bool begin(AudioInfo info) {
+    setAudioInfo(info);
+    return begin();
+  }
+
+  bool begin() override {
+    float speed = resampler.getStep();
+    bool result = resampler.begin(info.channels, kernel_type, max_speed);
+    if (result) resampler.reserve(BLOCK_FRAMES / info.channels);
+    pending_pos = pending_end = 0;
+    resampler.setStep(speed);
+    return result && AudioStream::begin();
+  }
+
+  void setAudioInfo(AudioInfo newInfo) override {
+    bool changed = newInfo.channels != info.channels;
+    AudioStream::setAudioInfo(newInfo);
+    if (changed || resampler.channels() == 0) begin();
+    if (p_notify != nullptr) p_notify->setAudioInfo(newInfo);
+  }
+
+  /// Playback speed (2.0 = one octave up) which is reached after the
+  /// indicated number of frames
+  void setSpeed(float speed, uint32_t frames = 0) {
+    resampler.setStep(speed, frames);
+  }
+
+  /// Speed from a pitch change in semitones
+  void setSemitones(float semitones, uint32_t frames = 0) {
+    setSpeed(powf(2.0f, semitones / 12.0f), frames);
+  }
+
+  float speed() { return resampler.getStep(); }
+
+  /// Clears the history, e.g. before a new sample is played
+  void reset() {
+    resampler.reset();
+    pending_pos = pending_end = 0;
+  }
+
+  VarispeedResampler &resamplerRef() { return resampler; }
+
+  /// Returns the input bytes which were used: when the output accepts less,
+  /// the rest of the resampled block is kept and passed on by the next call
+  size_t write(const uint8_t *data, size_t len) override {
+    AUDIO_PROFILE_SCOPE("varispeed");
+    if (p_out == nullptr || info.bits_per_sample != 16) return 0;
+    size_t frame_bytes = info.channels * sizeof(int16_t);
+    size_t block_frames = BLOCK_FRAMES / info.channels;
+    size_t remaining = len / frame_bytes;
+    const int16_t *in = (const int16_t *)data;
+    if (!drain()) return 0;
+    // the input is passed on in blocks: the history never grows beyond the
+    // size reserved in begin()
+    size_t used = 0;
+    while (remaining > 0) {
+      size_t frames = remaining < block_frames ? remaining : block_frames;
+      pending_pos = 0;
+      pending_end =
+          resampler.process(in, frames, out_block, block_frames) * frame_bytes;
+      in += frames * info.channels;
+      remaining -= frames;
+      used += frames * frame_bytes;
+      if (!drain()) break;
+    }
+    return used;
+  }
+
+  int availableForWrite() override {
+    return p_out == nullptr ? 0 : p_out->availableForWrite();
+  }
+
+ protected:
+  static constexpr int BLOCK_FRAMES = 512;  // samples of all channels
+  VarispeedResampler resampler;
+  VarispeedResampler::Kernel kernel_type = VarispeedResampler::Hermite;
+  float max_speed = 2.0f;
+  Print *p_out = nullptr;
+  AudioInfoSupport *p_notify = nullptr;
+  int16_t out_block[BLOCK_FRAMES];
+  size_t pending_pos = 0;  // bytes of out_block not yet accepted by p_out
+  size_t pending_end = 0;
+
+  /// Passes on the pending output and everything the resampler still
+  /// provides: false if the output did not accept it all
+  bool drain() {
+    size_t frame_bytes = info.channels * sizeof(int16_t);
+    while (true) {
+      while (pending_pos < pending_end) {
+        size_t written = p_out->write((const uint8_t *)out_block + pending_pos,
+                                      pending_end - pending_pos);
+        if (written == 0) return false;
+        pending_pos += written;
+      }
+      size_t produced = resampler.process(nullptr, 0, out_block,
+                                          BLOCK_FRAMES / info.channels);
+      if (produced == 0) return true;
+      pending_pos = 0;
+      pending_end = produced * frame_bytes;
+    }
+  }
+};
+
+}  // namespace audio_tools
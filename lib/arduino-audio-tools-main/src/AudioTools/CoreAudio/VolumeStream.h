@@ -4,6 +4,7 @@
 #include "AudioTools/CoreAudio/AudioOutput.h"
 #include "AudioTools/CoreAudio/VolumeControl.h"
 #include "AudioTools/CoreAudio/AudioTypes.h"
+#include "AudioTools/CoreAudio/AudioProfiler.h"
 
 namespace audio_tools {
 
@@ -142,6 +143,7 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
 
         /// Writes raw PCM audio data, which will be the input for the volume control 
         virtual size_t write(const uint8_t *data, size_t len) override {
+            AUDIO_PROFILE_SCOPE("volume");
             LOGD("VolumeStream::write: %zu", len);
             if (data==nullptr || p_out==nullptr){
                 LOGE("NPE");
@@ -4,6 +4,7 @@
 #include "AudioTools/Disk/AudioSource.h"
 #include "AudioTools/AudioLibs/Desktop/File.h"
 #include "AudioTools/CoreAudio/AudioBasic/StrView.h"
+#include "AudioTools/Disk/SDIndexTable.h"
 #include <filesystem>
 
 namespace audio_tools {
@@ -28,6 +29,9 @@ public:
   virtual bool begin() override {
     TRACED();
     idx_pos = 0;
+    if (index_dir != nullptr) {
+      setupIndex();
+    }
     return true;
   }
 
@@ -91,8 +95,25 @@ public:
   /// Allows to "correct" the start path if not defined in the constructor
   virtual void setPath(const char *p) { start_path = p; }
 
+  /// Stores an index (idx.txt and idx.bin) in the indicated directory, so that
+  /// the files can be accessed by index without walking the directory tree.
+  /// The index is updated in begin().
+  void setIndexDirectory(const char *dir) { index_dir = dir; }
+
+  /// Provides the index of the indicated file name or -1 if not found
+  int indexOf(const char *name) {
+    if (idx_table.isValid()) return idx_table.indexOf(name);
+    for (int j = 0; j < size(); j++) {
+      const char *fn = get(j);
+      if (fn != nullptr && StrView(fn).endsWith(name)) return j;
+    }
+    return -1;
+  }
+
   /// Provides the number of files (The max index is size()-1): WARNING this is very slow if you have a lot of files in many subdirectories
+  /// unless you use an index
   long size() {
+    if (idx_table.isValid()) return idx_table.size();
     if (count == 0){
       for (auto const& dir_entry : fs::recursive_directory_iterator(start_path)){
           if (isValidAudioFile(dir_entry))
@@ -112,8 +133,11 @@ protected:
   const char *file_name_pattern = "*";
   fs::directory_entry entry;
   long count = 0;
+  const char *index_dir = nullptr;
+  SDIndexTable<FS, File> idx_table{SD};
 
   const char* get(int idx){
+      if (idx_table.isValid()) return idx_table[idx];
       int count = 0;
       const char* result = nullptr;
       for (auto const& dir_entry : fs::recursive_directory_iterator(start_path)){
@@ -129,6 +153,36 @@ protected:
       return result;
   }
 
+  /// Appends new files to the index or rebuilds it if files have changed
+  void setupIndex() {
+    std::string dir = index_dir;
+    if (!dir.empty() && dir.back() != '/') dir += "/";
+    std::string names = dir + "idx.txt";
+    std::string table = dir + "idx.bin";
+    std::string key = std::string(start_path) + "|" + exension + "|" +
+                      file_name_pattern;
+    idx_table.begin(names.c_str(), table.c_str(),
+                    idx_table.hash(key.c_str()));
+    idx_table.beginUpdate();
+    listDir(idx_table);
+    if (!idx_table.endUpdate()) {
+      LOGW("Creating index file");
+      idx_table.beginRebuild();
+      listDir(idx_table);
+      idx_table.endUpdate();
+    }
+    LOGI("Index with %d files", (int)idx_table.size());
+  }
+
+  /// Writes the valid audio files (one per line)
+  void listDir(Print &out) {
+    for (auto const& dir_entry : fs::recursive_directory_iterator(start_path)){
+      if (isValidAudioFile(dir_entry)) {
+        out.println(dir_entry.path().string().c_str());
+      }
+    }
+  }
+
   /// checks if the file is a valid audio file
   bool isValidAudioFile(fs::directory_entry file) {
     const std::filesystem::path path = file.path();
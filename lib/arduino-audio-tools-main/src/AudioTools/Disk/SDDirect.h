@@ -30,19 +30,24 @@ class SDDirect {
     this->ext = extension;
     this->file_name_pattern = file_name_pattern;
     this->max_idx = -1;
+    this->result_idx = -1;
   }
 
-  /// Access file name by index
+  /// Access file name by index: this walks the directory tree, so use
+  /// SDIndex if you need fast random access to a big number of files
   const char *operator[](int idx) {
     if (max_idx != -1 && idx > max_idx) {
       return nullptr;
     }
+    // repeated access to the same file
+    if (idx == result_idx) return result.c_str();
 
     requested_idx = idx;
     actual_idx = -1;
     found = false;
     listDir(start_dir);
     if (!found) return nullptr;
+    result_idx = idx;
     return result.c_str();
   }
 
@@ -65,6 +70,7 @@ class SDDirect {
   int32_t actual_idx;
   size_t requested_idx;
   long max_idx = -1;
+  long result_idx = -1;
   bool found = false;
   List<String> file_path_stack;
   String file_path_str;
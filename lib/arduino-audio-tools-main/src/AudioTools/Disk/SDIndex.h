@@ -2,6 +2,7 @@
 
 #include "AudioTools/CoreAudio/AudioBasic/Str.h"
 #include "AudioTools/CoreAudio/AudioBasic/Collections/List.h"
+#include "AudioTools/Disk/SDIndexTable.h"
 
 #define MAX_FILE_LEN 256
 
@@ -14,33 +15,49 @@ namespace audio_tools {
 
 /**
  * @brief We store all the relevant file names in an sequential index
- * file. Form there we can access them via an index
+ * file. Form there we can access them via an index: The binary idx.bin
+ * side file contains the offset of each name, so that a lookup by index or
+ * by name only needs a few seeks. When the index is set up, the directory is
+ * compared with the existing index and new files are appended; the index is
+ * only rebuilt when existing files have been changed or removed.
  */
 template <class SDT, class FileT>
 class SDIndex {
  public:
-  SDIndex(SDT &sd) { p_sd = &sd; };
+  SDIndex(SDT &sd) : table(sd) { p_sd = &sd; };
   void begin(const char *startDir, const char *extension,
              const char *file_name_pattern, bool setupIndex = true) {
     TRACED();
     this->start_dir = startDir;
     this->ext = extension;
     this->file_name_pattern = file_name_pattern;
+    this->max_idx = -1;
     idx_path = filePathString(startDir, "idx.txt");
-    idx_defpath = filePathString(startDir, "idx-def.txt");
+    idx_binpath = filePathString(startDir, "idx.bin");
     int idx_file_size = indexFileTSize();
     LOGI("Index file size: %d", idx_file_size);
     String keyNew =
         String(startDir) + "|" + extension + "|" + file_name_pattern;
-    String keyOld = getIndexDef();
-    if (setupIndex && (keyNew != keyOld || idx_file_size == 0)) {
-      FileT idxfile = p_sd->open(idx_path.c_str(), FILE_WRITE);
-      LOGW("Creating index file");
-      listDir(idxfile, startDir);
-      LOGI("Indexing completed");
-      idxfile.close();
-      // update index definition file
-      saveIndexDef(keyNew);
+    bool is_valid = table.begin(idx_path.c_str(), idx_binpath.c_str(),
+                                table.hash(keyNew.c_str()));
+    if (setupIndex) {
+      // append new files or detect changes
+      table.beginUpdate();
+      listDir(table, startDir);
+      is_valid = table.endUpdate();
+      if (!is_valid) {
+        LOGW("Creating index file");
+        table.beginRebuild();
+        listDir(table, startDir);
+        is_valid = table.endUpdate();
+        LOGI("Indexing completed");
+      }
+    } else if (!is_valid && idx_file_size > 0) {
+      // index file was provided: just determine the offsets
+      is_valid = table.importNames();
+    }
+    if (!is_valid) {
+      LOGW("No index table: using sequential search");
     }
   }
 
@@ -56,6 +73,8 @@ class SDIndex {
 
   /// Access file name by index
   const char *operator[](int idx) {
+    if (table.isValid()) return table[idx];
+
     // return null when idx is negative
     if (idx < 0) {
       LOGE("idx %d is negative", idx);
@@ -117,7 +136,8 @@ class SDIndex {
       LOGE("filename is null");
       return -1;
     }
-    
+    if (table.isValid()) return table.indexOf(filename);
+
     FileT idxfile = p_sd->open(idx_path.c_str());
     if (idxfile.available() == 0) {
       LOGE("Index file is empty");
@@ -165,6 +185,7 @@ class SDIndex {
   }
 
   long size() {
+    if (table.isValid()) return table.size();
     if (max_idx == -1) {
       FileT idxfile = p_sd->open(idx_path.c_str());
       int count = 0;
@@ -184,8 +205,9 @@ class SDIndex {
  protected:
   String result;
   String idx_path;
-  String idx_defpath;
+  String idx_binpath;
   SDT *p_sd = nullptr;
+  SDIndexTable<SDT, FileT> table;
   List<String> file_path_stack;
   String file_path_str;
   const char *start_dir;
@@ -294,18 +316,6 @@ class SDIndex {
     return result;
   }
 
-  String getIndexDef() {
-    FileT idxdef = p_sd->open(idx_defpath.c_str());
-    String key1 = idxdef.readString();
-    idxdef.close();
-    return key1;
-  }
-  void saveIndexDef(String keyNew) {
-    FileT idxdef = p_sd->open(idx_defpath.c_str(), FILE_WRITE);
-    idxdef.write((const uint8_t *)keyNew.c_str(), keyNew.length());
-    idxdef.close();
-  }
-
   size_t indexFileTSize() {
     FileT idxfile = p_sd->open(idx_path.c_str());
     size_t result = idxfile.size();
@@ -0,0 +1,419 @@
+#pragma once
+
+#include "AudioTools/CoreAudio/AudioBasic/Str.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+
+#ifndef MAX_FILE_LEN
+#define MAX_FILE_LEN 256
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Binary lookup table for a text index file which contains one file
+ * name per line. The table is stored in a side file and consists of a header,
+ * one fixed width record per line (offset of the line in the text file and
+ * hashes of the path and of the file name) and an open addressing hash table
+ * over the file names. This way a file name can be accessed by index with one
+ * seek and the index of a file name can be found with a few seeks.
+ *
+ * The names are provided line by line via the Print interface (e.g. with
+ * println()) between beginUpdate() and endUpdate(). If the existing text file
+ * already starts with the same names, only the additional names are appended;
+ * if an existing name has changed or was removed, endUpdate() returns false and
+ * the caller needs to provide all names again after beginRebuild(). Appending
+ * needs FILE_APPEND: without it new names also lead to a rebuild.
+ *
+ * Building the table needs 16 bytes of RAM per file name temporarily.
+ * @ingroup player
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+template <class SDT, class FileT>
+class SDIndexTable : public Print {
+ public:
+  SDIndexTable(SDT &sd) { p_sd = &sd; }
+
+  /// Defines the text and the table file and loads the table header: returns
+  /// true if the table is valid for the indicated key and the text file.
+  bool begin(const char *namesPath, const char *tablePath, uint32_t key) {
+    names_path = namesPath;
+    table_path = tablePath;
+    is_valid = loadHeader(key);
+    header.key = key;
+    LOGI("Index table %s: %s (%d entries)", table_path.c_str(),
+         is_valid ? "valid" : "invalid", is_valid ? (int)header.count : 0);
+    return is_valid;
+  }
+
+  /// Starts to compare the provided names with the existing index
+  void beginUpdate() {
+    TRACED();
+    if (!is_valid) {
+      beginRebuild();
+      return;
+    }
+    mode = Compare;
+    compare_pos = 0;
+    line_len = 0;
+    pending_size = 0;
+    write_names = true;
+    new_entries.clear();
+    table_file = p_sd->open(table_path.c_str());
+  }
+
+  /// Starts to write a new index: all names need to be provided
+  void beginRebuild(bool writeNames = true) {
+    TRACED();
+    mode = Rebuild;
+    compare_pos = 0;
+    line_len = 0;
+    header.count = 0;
+    header.names_size = 0;
+    pending_size = 0;
+    write_names = writeNames;
+    new_entries.clear();
+    if (write_names) {
+      // some file systems do not truncate with FILE_WRITE
+      p_sd->remove(names_path.c_str());
+      names_file = p_sd->open(names_path.c_str(), FILE_WRITE);
+    }
+  }
+
+  /// Completes the update: returns false if the existing index is outdated and
+  /// needs to be rebuilt with beginRebuild().
+  bool endUpdate() {
+    TRACED();
+    if (line_len > 0) addLine();
+    if (mode == Compare || mode == Changed) table_file.close();
+    if (write_names) names_file.close();
+    Mode last_mode = mode;
+    mode = Idle;
+
+    if (last_mode == Changed ||
+        (last_mode == Compare && compare_pos < header.count)) {
+      LOGW("Index is outdated");
+      new_entries.clear();
+      is_valid = false;
+      return false;
+    }
+    if (last_mode == Compare && new_entries.empty()) {
+      LOGI("Index is up to date");
+      return true;
+    }
+    LOGI("Adding %d entries to the index", (int)new_entries.size());
+    is_valid = writeTable(last_mode == Compare);
+    new_entries.clear();
+    return is_valid;
+  }
+
+  /// Builds the table from an existing text file
+  bool importNames() {
+    TRACED();
+    FileT names = p_sd->open(names_path.c_str());
+    if (!names) return false;
+    // the text file exists already: we only record the offsets
+    beginRebuild(false);
+    char buffer[MAX_FILE_LEN];
+    int len;
+    while ((len = names.readBytes((uint8_t *)buffer, sizeof(buffer))) > 0) {
+      write((const uint8_t *)buffer, len);
+    }
+    names.close();
+    return endUpdate();
+  }
+
+  /// Returns true if the table can be used for lookups
+  bool isValid() { return is_valid; }
+
+  /// Provides the number of names
+  long size() { return is_valid ? header.count : 0; }
+
+  /// Access file name by index
+  const char *operator[](int idx) {
+    if (!is_valid || idx < 0 || idx >= (int)header.count) {
+      return nullptr;
+    }
+    FileT table = p_sd->open(table_path.c_str());
+    Entry entry;
+    bool ok = readEntry(table, idx, entry);
+    table.close();
+    if (!ok) return nullptr;
+    return readName(entry.offset) ? result.c_str() : nullptr;
+  }
+
+  /// Find the index of a file name (with or without path). Names starting
+  /// with / are compared with the complete path.
+  int indexOf(const char *filename) {
+    if (!is_valid || filename == nullptr || header.slots == 0) return -1;
+    StrView search(filename);
+    bool is_absolute = search.startsWith("/");
+    uint32_t name_hash = hash(baseName(filename));
+    uint32_t path_hash = hash(filename);
+    uint32_t mask = header.slots - 1;
+    FileT table = p_sd->open(table_path.c_str());
+    int found = -1;
+    for (uint32_t probe = 0; probe < header.slots; probe++) {
+      uint32_t slot_pos = (name_hash + probe) & mask;
+      uint32_t slot = 0;
+      if (!table.seek(slotsOffset() + slot_pos * sizeof(uint32_t)) ||
+          table.readBytes((uint8_t *)&slot, sizeof(slot)) != sizeof(slot)) {
+        break;
+      }
+      // empty slot: name is not in the table
+      if (slot == 0) break;
+      Entry entry;
+      if (!readEntry(table, slot - 1, entry)) break;
+      if (entry.name_hash != name_hash) continue;
+      if (is_absolute && entry.path_hash != path_hash) continue;
+      // verify the candidate
+      if (readName(entry.offset) && isMatch(filename)) {
+        found = slot - 1;
+        break;
+      }
+    }
+    table.close();
+    return found;
+  }
+
+  /// Collects the characters of the names: one name per line
+  size_t write(uint8_t ch) override {
+    if (ch == '\n') {
+      addLine();
+    } else if (ch != '\r' && line_len < MAX_FILE_LEN - 1) {
+      line[line_len++] = ch;
+    }
+    return 1;
+  }
+
+  size_t write(const uint8_t *data, size_t len) override {
+    for (size_t j = 0; j < len; j++) write(data[j]);
+    return len;
+  }
+
+  /// FNV-1a hash e.g. to calculate the key
+  static uint32_t hash(const char *str, uint32_t result = 2166136261u) {
+    while (*str) {
+      result ^= (uint8_t)*str++;
+      result *= 16777619u;
+    }
+    return result;
+  }
+
+ protected:
+  enum Mode { Idle, Compare, Changed, Rebuild };
+  static constexpr uint32_t MAGIC = 0x58444953;  // "SIDX"
+  static constexpr uint16_t VERSION = 1;
+
+  struct Entry {
+    uint32_t offset;
+    uint32_t path_hash;
+    uint32_t name_hash;
+  };
+
+  struct Header {
+    uint32_t magic = MAGIC;
+    uint16_t version = VERSION;
+    uint16_t entry_size = sizeof(Entry);
+    uint32_t count = 0;
+    uint32_t slots = 0;
+    uint32_t key = 0;
+    uint32_t names_size = 0;
+  };
+
+
+  SDT *p_sd = nullptr;
+  Str names_path;
+  Str table_path;
+  Str result;
+  Header header;
+  bool is_valid = false;
+  bool write_names = true;
+  Mode mode = Idle;
+  uint32_t compare_pos = 0;
+  uint32_t pending_size = 0;
+  Vector<Entry> new_entries;
+  FileT table_file;
+  FileT names_file;
+  char line[MAX_FILE_LEN];
+  int line_len = 0;
+
+  uint32_t entriesOffset() { return sizeof(Header); }
+
+  uint32_t slotsOffset() {
+    return sizeof(Header) + header.count * sizeof(Entry);
+  }
+
+  /// checks if the last name that was read is the file name or ends with /
+  /// followed by the file name
+  bool isMatch(const char *filename) {
+    int len = strlen(filename);
+    int candidate_len = result.length();
+    if (candidate_len < len) return false;
+    if (strcmp(result.c_str() + candidate_len - len, filename) != 0) {
+      return false;
+    }
+    return candidate_len == len || filename[0] == '/' ||
+           result.c_str()[candidate_len - len - 1] == '/';
+  }
+
+  static const char *baseName(const char *path) {
+    const char *result = strrchr(path, '/');
+    return result == nullptr ? path : result + 1;
+  }
+
+  bool loadHeader(uint32_t key) {
+    // determine the size of the text file first
+    FileT names = p_sd->open(names_path.c_str());
+    if (!names) return false;
+    size_t names_size = names.size();
+    names.close();
+
+    FileT table = p_sd->open(table_path.c_str());
+    if (!table) return false;
+    Header tmp;
+    bool ok = table.readBytes((uint8_t *)&tmp, sizeof(tmp)) == sizeof(tmp);
+    table.close();
+    if (!ok || tmp.magic != MAGIC || tmp.version != VERSION ||
+        tmp.entry_size != sizeof(Entry)) {
+      return false;
+    }
+    if (tmp.key != key || tmp.names_size != names_size) {
+      LOGI("Index table does not match: key %u/%u, size %u/%u",
+           (unsigned)tmp.key, (unsigned)key, (unsigned)tmp.names_size,
+           (unsigned)names_size);
+      return false;
+    }
+    header = tmp;
+    return true;
+  }
+
+  bool readEntry(FileT &table, uint32_t idx, Entry &entry) {
+    if (!table.seek(entriesOffset() + idx * sizeof(Entry))) return false;
+    return table.readBytes((uint8_t *)&entry, sizeof(Entry)) == sizeof(Entry);
+  }
+
+  bool readName(uint32_t offset) {
+    FileT names = p_sd->open(names_path.c_str());
+    if (!names || !names.seek(offset)) return false;
+    char buffer[MAX_FILE_LEN];
+    int len = names.readBytes((uint8_t *)buffer, MAX_FILE_LEN - 1);
+    names.close();
+    if (len <= 0) return false;
+    buffer[len] = 0;
+    // cut at the end of the line
+    char *end = strpbrk(buffer, "\r\n");
+    if (end != nullptr) *end = 0;
+    result = buffer;
+    return true;
+  }
+
+  /// Processes a complete name
+  void addLine() {
+    line[line_len] = 0;
+    int len = line_len;
+    line_len = 0;
+    if (len == 0) {
+      // empty lines still occupy space in an imported text file
+      if (mode == Rebuild && !write_names) pending_size += 1;
+      return;
+    }
+
+    Entry entry;
+    entry.path_hash = hash(line);
+    entry.name_hash = hash(baseName(line));
+
+    switch (mode) {
+      case Compare:
+        if (compare_pos < header.count) {
+          Entry existing;
+          if (!readEntry(table_file, compare_pos, existing) ||
+              existing.path_hash != entry.path_hash) {
+            LOGI("Index changed at %d: %s", (int)compare_pos, line);
+            mode = Changed;
+            return;
+          }
+          compare_pos++;
+          return;
+        }
+        // names after the end of the existing index are appended
+#ifdef FILE_APPEND
+        if (!names_file) {
+          names_file = p_sd->open(names_path.c_str(), FILE_APPEND);
+        }
+        if (names_file) break;
+#endif
+        // FILE_WRITE may truncate: the names are written again
+        LOGI("Index can not be appended: %s", line);
+        mode = Changed;
+        return;
+      case Rebuild:
+        break;
+      default:
+        return;
+    }
+
+    entry.offset = header.names_size + pending_size;
+    if (write_names) {
+      names_file.write((const uint8_t *)line, len);
+      names_file.write((const uint8_t *)"\n", 1);
+    }
+    pending_size += len + 1;
+    new_entries.push_back(entry);
+  }
+
+  /// Writes the table file: existing entries are reused if we only append
+  bool writeTable(bool append) {
+    Vector<Entry> entries;
+    if (append && header.count > 0) {
+      entries.resize(header.count);
+      FileT table = p_sd->open(table_path.c_str());
+      bool ok = table.seek(entriesOffset()) &&
+                table.readBytes((uint8_t *)entries.data(),
+                                header.count * sizeof(Entry)) ==
+                    header.count * sizeof(Entry);
+      table.close();
+      if (!ok) {
+        LOGE("Could not read %s", table_path.c_str());
+        pending_size = 0;
+        return false;
+      }
+    }
+    for (auto &entry : new_entries) entries.push_back(entry);
+    header.count = entries.size();
+    header.names_size += pending_size;
+    pending_size = 0;
+
+    // hash table with a load factor of at most 0.5
+    uint32_t slot_count = 1;
+    while (slot_count < header.count * 2) slot_count <<= 1;
+    header.slots = slot_count;
+    Vector<uint32_t> slots;
+    slots.resize(slot_count);
+    for (uint32_t j = 0; j < slot_count; j++) slots[j] = 0;
+    for (uint32_t j = 0; j < header.count; j++) {
+      uint32_t pos = entries[j].name_hash & (slot_count - 1);
+      while (slots[pos] != 0) pos = (pos + 1) & (slot_count - 1);
+      slots[pos] = j + 1;
+    }
+
+    p_sd->remove(table_path.c_str());
+    FileT table = p_sd->open(table_path.c_str(), FILE_WRITE);
+    if (!table) {
+      LOGE("Could not write %s", table_path.c_str());
+      return false;
+    }
+    size_t entries_size = header.count * sizeof(Entry);
+    size_t slots_size = slot_count * sizeof(uint32_t);
+    bool ok = table.write((const uint8_t *)&header, sizeof(header)) ==
+                  sizeof(header) &&
+              table.write((const uint8_t *)entries.data(), entries_size) ==
+                  entries_size &&
+              table.write((const uint8_t *)slots.data(), slots_size) ==
+                  slots_size;
+    table.close();
+    return ok;
+  }
+};
+
+}  // namespace audio_tools
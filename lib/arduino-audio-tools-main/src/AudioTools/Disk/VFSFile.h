@@ -4,6 +4,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <string>
 
 #include "AudioToolsConfig.h"
 
@@ -34,16 +35,20 @@ class VFSFile : public Stream {
  public:
   VFSFile() = default;
   VFSFile(const char* fn) { open(fn, VFS_FILE_READ); }
-  VFSFile(const VFSFile& file) { open(file.name(), VFS_FILE_READ); }
+  VFSFile(const VFSFile& file) {
+    if (file.name() != nullptr) open(file.name(), file.reopenMode());
+  }
   ~VFSFile() { end();}
 
   VFSFile& operator=(VFSFile file) {
-    open(file.name(), VFS_FILE_READ);
+    end();
+    if (file.name() != nullptr) open(file.name(), file.reopenMode());
     return *this;
   }
 
   void open(const char* name, FileMode mode = VFS_FILE_READ) {
     file_path = name;
+    file_mode = mode;
     switch (mode) {
       case VFS_FILE_READ:
         stream.open(name, stream.binary | stream.in);
@@ -54,7 +59,7 @@ class VFSFile : public Stream {
         is_read = false;
         break;
       case VFS_FILE_APPEND:
-        stream.open(name, stream.binary | stream.out);
+        stream.open(name, stream.binary | stream.out | stream.app);
         is_read = false;
         break;
     }
@@ -179,14 +184,22 @@ class VFSFile : public Stream {
 
   void close() { stream.close(); }
 
-  const char* name() const { return file_path; }
+  const char* name() const {
+    return file_path.empty() ? nullptr : file_path.c_str();
+  }
 
   operator bool() { return stream.is_open(); }
 
  protected:
   std::fstream stream;
   bool is_read = true;
-  const char* file_path = nullptr;
+  FileMode file_mode = VFS_FILE_READ;
+  std::string file_path;
+
+  /// A copy must not truncate the file again
+  FileMode reopenMode() const {
+    return file_mode == VFS_FILE_READ ? VFS_FILE_READ : VFS_FILE_APPEND;
+  }
 };
 
 }  // namespace audio_tools
\ No newline at end of file
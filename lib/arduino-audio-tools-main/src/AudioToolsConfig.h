@@ -69,6 +69,18 @@
 #  define USE_CHECK_MEMORY false
 #endif
 
+// change USE_AUDIO_PROFILER to true to record the processing time per block
+// (see AudioProfiler.h)
+#ifndef USE_AUDIO_PROFILER
+#  define USE_AUDIO_PROFILER false
+#endif
+
+// change USE_ALLOCATION_GUARD to true to count heap allocations in real-time
+// code (see AllocationGuard.h)
+#ifndef USE_ALLOCATION_GUARD
+#  define USE_ALLOCATION_GUARD false
+#endif
+
 // Activate/deactivate obsolete functionality
 #ifndef USE_OBSOLETE
 #  define USE_OBSOLETE false
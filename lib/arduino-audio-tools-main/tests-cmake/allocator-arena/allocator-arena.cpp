@@ -0,0 +1,88 @@
+// AllocatorArena: first fit, reuse after free, merging of free blocks, peak
+// and fallback. AllocationGuard: only allocations in a real-time section of
+// the same thread are counted.
+#include "AudioTools.h"
+#include <thread>
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+void setup() {
+  AllocatorArena arena;
+  check(arena.begin(4096), "begin");
+  check(arena.size() == 4096 && arena.used() == 0, "empty");
+
+  // aligned, zeroed and inside the arena
+  uint8_t *a = (uint8_t *)arena.allocate(100);
+  uint8_t *b = (uint8_t *)arena.allocate(1000);
+  uint8_t *c = (uint8_t *)arena.allocate(200);
+  check(arena.contains(a) && arena.contains(b) && arena.contains(c), "contains");
+  check(((uintptr_t)a % 8) == 0 && ((uintptr_t)b % 8) == 0, "aligned");
+  bool zero = true;
+  for (int j = 0; j < 1000; j++) zero = zero && b[j] == 0;
+  check(zero, "zeroed");
+  memset(a, 0xff, 100);
+  memset(b, 0xff, 1000);
+  memset(c, 0xff, 200);
+  size_t used = arena.used();
+  check(used >= 1300 && used <= 1300 + 3 * 16, "used");
+
+  // the freed block is reused; free neighbours are merged
+  arena.free(b);
+  check(arena.used() == used - 1008, "used after free");
+  uint8_t *d = (uint8_t *)arena.allocate(1000);
+  check(d == b, "first fit reuses the block");
+  arena.free(a);
+  arena.free(d);
+  uint8_t *e = (uint8_t *)arena.allocate(1100);
+  check(e == a, "merged with the previous block");
+  arena.free(e);
+  arena.free(c);
+  check(arena.used() == 0, "all free");
+  check(arena.peak() == used, "peak");
+  uint8_t *all = (uint8_t *)arena.allocate(4096 - 8);
+  check(arena.contains(all), "everything merged to one block");
+  arena.free(all);
+
+  // full: the memory comes from the fallback allocator
+  void *big = arena.allocate(8192);
+  check(big != nullptr && !arena.contains(big), "fallback");
+  check(arena.fallbackCount() == 1, "fallback count");
+  arena.free(big);
+  arena.setFallback(nullptr);
+  check(arena.allocate(8192) == nullptr, "no fallback");
+
+  // Vector in the arena
+  Vector<int16_t> vector{arena};
+  vector.resize(256);
+  check(arena.contains(vector.data()), "vector in the arena");
+  vector.reset();
+  check(arena.used() == 0, "vector released");
+
+  // AllocationGuard counts only inside the real-time section of its thread
+  AllocationGuard &guard = AllocationGuard::instance();
+  guard.reset();
+  void *outside = DefaultAllocatorRAM.allocate(10);
+  check(guard.count() == 0, "not counted outside");
+  {
+    AUDIO_REALTIME_SCOPE();
+    void *inside = DefaultAllocatorRAM.allocate(64);
+    DefaultAllocatorRAM.free(inside);
+    std::thread other([] {
+      DefaultAllocatorRAM.free(DefaultAllocatorRAM.allocate(32));
+    });
+    other.join();
+  }
+  DefaultAllocatorRAM.free(outside);
+  check(guard.count() == 1 && guard.bytes() == 64, "counted inside");
+  check(!guard.isActive(), "section ended");
+
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
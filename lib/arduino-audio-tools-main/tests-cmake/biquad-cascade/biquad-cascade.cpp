@@ -0,0 +1,157 @@
+// Compares the BiQuadCascade with the per sample BiQuadDF2 / SOSFilter
+// classes and measures the processing time for 1 to 8 sections
+#include "AudioTools.h"
+#include <chrono>
+#include <math.h>
+
+const float sample_rate = 44100;
+const int frames = 4096;
+const int block = 256;
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// section s of a test cascade: alternating low pass, shelves and band pass
+BiQuadDF2<float> *design(int s) {
+  float f = 200.0f * (s + 1);
+  switch (s % 4) {
+    case 0:
+      return new LowPassFilter<float>(f * 8, sample_rate, 0.7071f);
+    case 1:
+      return new LowShelfFilter<float>(f, sample_rate, 6.0f);
+    case 2:
+      return new HighShelfFilter<float>(f * 4, sample_rate, -4.0f);
+    default:
+      return new BandPassFilter<float>(f * 2, sample_rate, 0.5f);
+  }
+}
+
+void fillNoise(Vector<float> &data, int channels) {
+  uint32_t seed = 1;
+  data.resize(frames * channels);
+  for (int j = 0; j < frames * channels; j++) {
+    seed = seed * 1664525u + 1013904223u;
+    data[j] = ((int32_t)seed >> 16) / 32768.0f;
+  }
+}
+
+// DF2 is identical to BiQuadDF2 and SOSFilter, TDF2 matches within the float
+// precision
+void testResponse() {
+  const int sections = 4;
+  Vector<float> input;
+  fillNoise(input, 2);
+
+  // reference: one filter chain per channel, called per sample
+  Vector<float> expected(frames * 2);
+  expected.resize(frames * 2);
+  for (int c = 0; c < 2; c++) {
+    BiQuadDF2<float> *filters[sections];
+    for (int s = 0; s < sections; s++) filters[s] = design(s);
+    for (int j = 0; j < frames; j++) {
+      float value = input[j * 2 + c];
+      for (int s = 0; s < sections; s++) value = filters[s]->process(value);
+      expected[j * 2 + c] = value;
+    }
+    for (int s = 0; s < sections; s++) delete filters[s];
+  }
+
+  BiQuadCascade<float, 2> df2(sections, BiQuadCascade<float, 2>::DF2);
+  BiQuadCascade<float, 2> tdf2(sections, BiQuadCascade<float, 2>::TDF2);
+  for (int s = 0; s < sections; s++) {
+    BiQuadDF2<float> *filter = design(s);
+    df2.setSection(s, *filter);
+    tdf2.setSection(s, *filter);
+    delete filter;
+  }
+  Vector<float> out_df2(input), out_tdf2(input);
+  for (int j = 0; j < frames; j += block) {
+    df2.process(out_df2.data() + j * 2, block);
+    tdf2.process(out_tdf2.data() + j * 2, block);
+  }
+  float max_diff = 0;
+  for (int j = 0; j < frames * 2; j++) {
+    check(out_df2[j] == expected[j], "DF2 identical to BiQuadDF2");
+    float diff = fabs(out_tdf2[j] - expected[j]);
+    if (diff > max_diff) max_diff = diff;
+  }
+  printf("max difference TDF2 to DF2: %g\n", max_diff);
+  check(max_diff < 1e-5f, "TDF2 response");
+
+  // same coefficients from a SOS matrix
+  const float sos[2][6] = {{0.2f, 0.4f, 0.2f, 1.0f, -0.6f, 0.2f},
+                           {1.0f, -1.2f, 0.5f, 1.1f, -0.9f, 0.3f}};
+  const float gain[2] = {0.8f, 1.0f};
+  SOSFilter<float, 2> sos_filter(sos, gain);
+  BiQuadCascade<float, 1> mono(2, BiQuadCascade<float, 1>::DF2);
+  mono.setSOS(sos, gain);
+  for (int j = 0; j < frames; j++) {
+    float frame[1] = {input[j]};
+    mono.process(frame);
+    check(frame[0] == sos_filter.process(input[j]), "SOS identical");
+  }
+}
+
+// per sample and channel through the Filter<T> interface like FilteredStream
+float nsPerSample(int sections) {
+  Vector<float> data;
+  fillNoise(data, 2);
+  Filter<float> *filters[2][8];
+  for (int c = 0; c < 2; c++)
+    for (int s = 0; s < sections; s++) filters[c][s] = design(s);
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < 50; r++) {
+    for (int j = 0; j < frames; j++) {
+      for (int c = 0; c < 2; c++) {
+        float value = data[j * 2 + c];
+        for (int s = 0; s < sections; s++) value = filters[c][s]->process(value);
+        data[j * 2 + c] = value;
+      }
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  for (int c = 0; c < 2; c++)
+    for (int s = 0; s < sections; s++) delete filters[c][s];
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (50.0 * frames);
+}
+
+float nsPerBlock(int sections, BiQuadCascade<float, 2>::Structure structure) {
+  Vector<float> data;
+  fillNoise(data, 2);
+  BiQuadCascade<float, 2> cascade(sections, structure);
+  for (int s = 0; s < sections; s++) {
+    BiQuadDF2<float> *filter = design(s);
+    cascade.setSection(s, *filter);
+    delete filter;
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < 50; r++) {
+    for (int j = 0; j < frames; j += block) {
+      cascade.process(data.data() + j * 2, block);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (50.0 * frames);
+}
+
+void setup() {
+  testResponse();
+  printf("stereo ns/frame, blocks of %d frames\n", block);
+  printf("%-8s %12s %12s %12s\n", "sections", "per sample", "block DF2",
+         "block TDF2");
+  for (int sections = 1; sections <= 8; sections++) {
+    printf("%-8d %12.1f %12.1f %12.1f\n", sections, nsPerSample(sections),
+           nsPerBlock(sections, BiQuadCascade<float, 2>::DF2),
+           nsPerBlock(sections, BiQuadCascade<float, 2>::TDF2));
+  }
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
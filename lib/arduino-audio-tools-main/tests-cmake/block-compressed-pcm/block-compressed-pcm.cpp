@@ -0,0 +1,183 @@
+// Checks the BlockCompressedPCM formats (exact PCM and lossless, IMA ADPCM
+// quality, random access, memory limit) and measures the memory and the
+// decoding time per frame of a voice
+#include "AudioTools.h"
+#include <chrono>
+#include <math.h>
+
+const int frames = 44100 + 100;  // the last block is incomplete
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// drum like: decaying tones with noise every 250 ms
+void drums(Vector<int16_t> &data, int channels) {
+  data.resize(frames * channels);
+  uint32_t seed = 1;
+  for (int j = 0; j < frames; j++) {
+    int t = j % 11025;
+    float env = expf(-t / 2000.0f);
+    seed = seed * 1664525 + 1013904223;
+    float noise = ((int32_t)seed >> 16) / 32768.0f;
+    for (int ch = 0; ch < channels; ch++) {
+      float tone = sinf(2.0f * M_PI * (60 + 40 * ch) * t / 44100.0f);
+      float value = env * (0.6f * tone + 0.2f * noise) * 32767;
+      data[j * channels + ch] = (int16_t)lroundf(value);
+    }
+  }
+}
+
+void encode(BlockCompressedPCM &packed, BlockCompressedPCM::Format format,
+            Vector<int16_t> &data, int channels, size_t chunk) {
+  check(packed.begin(format, channels), "begin");
+  const uint8_t *bytes = (const uint8_t *)data.data();
+  size_t len = data.size() * sizeof(int16_t);
+  for (size_t pos = 0; pos < len; pos += chunk) {
+    packed.write(bytes + pos, len - pos < chunk ? len - pos : chunk);
+  }
+  packed.end();
+}
+
+// signal to noise ratio in dB of all decoded blocks
+float decodeAll(BlockCompressedPCM &packed, Vector<int16_t> &data) {
+  int channels = packed.channels();
+  int16_t block[BlockCompressedPCM::BLOCK_FRAMES * 2];
+  double signal = 0, noise = 0;
+  size_t frame = 0;
+  for (size_t b = 0; b < packed.blocks(); b++) {
+    size_t n = packed.decode(b, block);
+    check(n == packed.blockFrames(b), "block frames");
+    for (size_t j = 0; j < n * channels; j++) {
+      double ref = data[frame * channels + j];
+      double diff = block[j] - ref;
+      signal += ref * ref;
+      noise += diff * diff;
+    }
+    frame += n;
+  }
+  check(frame == (size_t)frames, "all frames");
+  return noise == 0 ? 999.0f : 10.0f * log10(signal / noise);
+}
+
+void testFormats(int channels) {
+  Vector<int16_t> data;
+  drums(data, channels);
+  const BlockCompressedPCM::Format formats[] = {
+      BlockCompressedPCM::PCM, BlockCompressedPCM::IMA_ADPCM,
+      BlockCompressedPCM::Lossless};
+  for (auto format : formats) {
+    BlockCompressedPCM packed;
+    encode(packed, format, data, channels, 1001);
+    check(packed.frames() == (size_t)frames, "frames");
+    check(packed.blocks() == (frames + 255) / 256, "blocks");
+    float snr = decodeAll(packed, data);
+    printf("%d ch format %d: %u of %u bytes, snr %.1f dB\n", channels,
+           (int)format, (unsigned)packed.memoryUsed(),
+           (unsigned)packed.pcmBytes(), snr);
+    if (format == BlockCompressedPCM::IMA_ADPCM) {
+      check(snr > 20.0f, "adpcm quality");
+      check(packed.memoryUsed() < packed.pcmBytes() / 3, "adpcm size");
+    } else {
+      check(snr == 999.0f, "exact");
+    }
+    if (format == BlockCompressedPCM::Lossless) {
+      check(packed.memoryUsed() < packed.pcmBytes(), "lossless size");
+    }
+  }
+}
+
+// each block is decoded on its own: in any order with the same result
+void testRandomAccess() {
+  Vector<int16_t> data;
+  drums(data, 2);
+  BlockCompressedPCM packed;
+  encode(packed, BlockCompressedPCM::IMA_ADPCM, data, 2, 4096);
+  int16_t first[512], again[512], other[512];
+  packed.decode(37, first);
+  packed.decode(120, other);
+  packed.decode(3, other);
+  packed.decode(37, again);
+  check(memcmp(first, again, sizeof(first)) == 0, "random access");
+  // the block starts with the exact sample
+  check(first[0] == data[37 * 256 * 2] && first[1] == data[37 * 256 * 2 + 1],
+        "exact first frame");
+  check(packed.decode(packed.blocks(), other) == 0, "beyond the end");
+}
+
+void testLimit() {
+  Vector<int16_t> data;
+  drums(data, 2);
+  BlockCompressedPCM packed;
+  packed.setMaxBytes(10000);
+  encode(packed, BlockCompressedPCM::Lossless, data, 2, 512);
+  check(packed.isOverflow(), "overflow");
+  check(packed.memoryUsed() <= 10000, "limit");
+  check(packed.frames() == packed.blocks() * 256, "complete blocks");
+}
+
+// the importer passes its frames on instead of collecting them
+void testImporter() {
+  Vector<int16_t> data;
+  drums(data, 1);
+  SampleImporter importer;
+  BlockCompressedPCM packed;
+  importer.begin(AudioInfo(44100, 2, 16));
+  importer.setOutput(packed);
+  importer.setAudioInfo(AudioInfo(44100, 1, 16));
+  packed.begin(BlockCompressedPCM::Lossless, 2);
+  importer.write((const uint8_t *)data.data(), data.size() * sizeof(int16_t));
+  importer.end();
+  packed.end();
+  check(importer.samples().size() == 0, "not collected");
+  check(importer.frames() == (size_t)frames && packed.frames() == (size_t)frames,
+        "importer frames");
+  int16_t block[512];
+  packed.decode(2, block);
+  check(block[0] == data[512] && block[1] == data[512], "importer data");
+}
+
+void benchmark() {
+  Vector<int16_t> data;
+  drums(data, 2);
+  const char *names[] = {"PCM", "IMA ADPCM", "lossless"};
+  printf("stereo 16 bit    bytes  ratio  decode ns/frame\n");
+  for (int format = 0; format < 3; format++) {
+    BlockCompressedPCM packed;
+    encode(packed, (BlockCompressedPCM::Format)format, data, 2, 4096);
+    int16_t block[512];
+    int32_t sum = 0;
+    const int repeat = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+      for (size_t b = 0; b < packed.blocks(); b++) {
+        packed.decode(b, block);
+        sum += block[b & 511];
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    float ns = std::chrono::duration<double, std::nano>(end - start).count() /
+               (repeat * (double)frames);
+    printf("%-12s %9u %6.2f %8.1f (%d)\n", names[format],
+           (unsigned)packed.memoryUsed(),
+           (float)packed.pcmBytes() / packed.memoryUsed(), ns, (int)(sum & 1));
+    // reading 4 bytes from an SD card at 2 MB/s takes 2000 ns
+    check(ns < 500, "decoding faster than an SD read");
+  }
+}
+
+void setup() {
+  testFormats(2);
+  testFormats(1);
+  testRandomAccess();
+  testLimit();
+  testImporter();
+  benchmark();
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,181 @@
+// Checks the response and the gain smoothing of the BlockEqualizer (float
+// and fixed point) and compares the processing time with Equalizer3Bands
+#include "AudioTools.h"
+#include <chrono>
+#include <math.h>
+
+const float sample_rate = 44100;
+const int frames = 8192;
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+class NullOutput : public Print {
+ public:
+  size_t write(const uint8_t *data, size_t len) override { return len; }
+  size_t write(uint8_t) override { return 1; }
+};
+
+void sine(Vector<int16_t> &data, float freq, float amplitude) {
+  data.resize(frames * 2);
+  for (int j = 0; j < frames; j++) {
+    int16_t value = lround(amplitude * sin(2.0 * M_PI * freq * j / sample_rate));
+    data[2 * j] = data[2 * j + 1] = value;
+  }
+}
+
+// gain in dB of a sine after the settling time
+float measure(BlockEqualizer<2> &eq, float freq) {
+  const float amplitude = 4000;
+  Vector<int16_t> data;
+  sine(data, freq, amplitude);
+  eq.reset();
+  for (int j = 0; j < frames; j += 256) eq.process(data.data() + 2 * j, 256);
+  double energy = 0;
+  for (int j = frames / 2; j < frames; j++) energy += (double)data[2 * j] * data[2 * j];
+  double rms = sqrt(energy / (frames / 2));
+  return 20.0f * log10(rms / (amplitude / sqrt(2.0)));
+}
+
+void testResponse(bool fixedPoint) {
+  BlockEqualizer<2> eq;
+  check(eq.begin(sample_rate, 1, fixedPoint), "begin");
+  eq.setLowFrequency(150);
+  eq.setHighFrequency(6000);
+  eq.setMid(0, 1200, 0.7f);
+
+  // flat: the data is not changed
+  Vector<int16_t> data, copy;
+  sine(data, 440, 20000);
+  copy = data;
+  check(eq.isFlat(), "flat");
+  eq.process(data.data(), frames);
+  for (int j = 0; j < frames * 2; j++) check(data[j] == copy[j], "flat identical");
+
+  eq.setGain(BlockEqualizer<2>::Low, 6, 0);
+  eq.setGain(BlockEqualizer<2>::Mid, -6, 0);
+  eq.setGain(BlockEqualizer<2>::High, 9, 0);
+  float low = measure(eq, 40);
+  float mid = measure(eq, 1200);
+  float high = measure(eq, 16000);
+  printf("%s: 40 Hz %.2f dB, 1.2 kHz %.2f dB, 16 kHz %.2f dB\n",
+         fixedPoint ? "fixed" : "float", low, mid, high);
+  check(fabs(low - 6) < 0.5f, "low shelf");
+  check(fabs(mid + 6) < 1.0f, "mid");
+  check(fabs(high - 9) < 0.5f, "high shelf");
+
+  // left and right are filtered identically
+  sine(data, 3000, 8000);
+  eq.process(data.data(), frames);
+  for (int j = 0; j < frames; j++) check(data[2 * j] == data[2 * j + 1], "channels");
+}
+
+// fixed point and float give the same result within a few LSB
+void testFixedAgainstFloat() {
+  BlockEqualizer<2> eq_float, eq_fixed;
+  eq_float.begin(sample_rate, 1, false);
+  eq_fixed.begin(sample_rate, 1, true);
+  BlockEqualizer<2> *eqs[] = {&eq_float, &eq_fixed};
+  for (BlockEqualizer<2> *eq : eqs) {
+    eq->setGain(BlockEqualizer<2>::Low, 4, 0);
+    eq->setGain(BlockEqualizer<2>::Mid, 3, 0);
+    eq->setGain(BlockEqualizer<2>::High, -5, 0);
+  }
+  Vector<int16_t> a, b;
+  sine(a, 300, 12000);
+  for (int j = 0; j < frames * 2; j++) a[j] += (j * 7919) % 2001 - 1000;
+  b = a;
+  eq_float.process(a.data(), frames);
+  eq_fixed.process(b.data(), frames);
+  int max_diff = 0;
+  for (int j = 0; j < frames * 2; j++) {
+    int diff = abs(a[j] - b[j]);
+    if (diff > max_diff) max_diff = diff;
+  }
+  printf("max difference fixed to float: %d\n", max_diff);
+  check(max_diff <= 2, "fixed point precision");
+}
+
+// a new gain is reached after the smoothing time without jumps
+void testSmoothing() {
+  BlockEqualizer<2> eq;
+  eq.setSmoothingTime(20);
+  eq.begin(sample_rate, 0, false);
+  Vector<int16_t> data;
+  sine(data, 50, 8000);
+  eq.setGain(BlockEqualizer<2>::Low, 12);
+  eq.process(data.data(), 441);
+  float gain = eq.gain(BlockEqualizer<2>::Low);
+  check(gain > 4 && gain < 8, "moving");
+  eq.process(data.data() + 882, 441);
+  check(eq.gain(BlockEqualizer<2>::Low) == 12, "reached");
+  check(!eq.isFlat(), "not flat");
+}
+
+// the best of 5 runs: the others were disturbed by the rest of the system
+template <typename F>
+float nsPerFrame(F process) {
+  Vector<int16_t> data;
+  sine(data, 1000, 8000);
+  double best = 0;
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < 20; r++) {
+      for (int j = 0; j < frames; j += 256) process(data.data() + 2 * j, 256);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    if (run == 0 || ns < best) best = ns;
+  }
+  return best / (20.0 * frames);
+}
+
+void benchmark() {
+  NullOutput out;
+  Equalizer3Bands eq3(out);
+  ConfigEqualizer3Bands cfg;
+  cfg.gain_low = 1.5f;
+  cfg.gain_high = 0.7f;
+  eq3.begin(cfg);
+  float t3 = nsPerFrame([&](int16_t *data, size_t n) {
+    eq3.write((uint8_t *)data, n * 4);
+  });
+
+  // all 3 bands in use, and only the low shelf
+  BlockEqualizer<2> eq_float, eq_fixed;
+  eq_float.begin(sample_rate, 1, false);
+  eq_fixed.begin(sample_rate, 1, true);
+  for (int band = 0; band < 3; band++) {
+    eq_float.setGain(band, 3, 0);
+    eq_fixed.setGain(band, 3, 0);
+  }
+  float tf = nsPerFrame([&](int16_t *data, size_t n) { eq_float.process(data, n); });
+  float tx = nsPerFrame([&](int16_t *data, size_t n) { eq_fixed.process(data, n); });
+  for (int band = 1; band < 3; band++) {
+    eq_float.setGain(band, 0, 0);
+    eq_fixed.setGain(band, 0, 0);
+  }
+  float tf1 = nsPerFrame([&](int16_t *data, size_t n) { eq_float.process(data, n); });
+  float tx1 = nsPerFrame([&](int16_t *data, size_t n) { eq_fixed.process(data, n); });
+  printf("stereo ns/frame        3 bands  1 band\n");
+  printf("Equalizer3Bands       %8.1f\n", t3);
+  printf("BlockEqualizer float  %8.1f %7.1f\n", tf, tf1);
+  printf("BlockEqualizer fixed  %8.1f %7.1f\n", tx, tx1);
+  check(tf1 < t3, "block float faster");
+}
+
+void setup() {
+  testResponse(false);
+  testResponse(true);
+  testFixedAgainstFloat();
+  testSmoothing();
+  benchmark();
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,430 @@
+// Decoding speed of the codecs: a fixed corpus which is encoded in memory is
+// written through each AudioDecoder into a sink which only counts the bytes,
+// so that neither a file system nor an audio device is measured. The sample
+// cache formats of BlockCompressedPCM are decoded block by block for
+// comparison. One row per format:
+//   bytes      encoded size of the corpus
+//   ratio      encoded size / 16 bit PCM size
+//   mb_s       encoded MB decoded per second
+//   x_rt       seconds of audio decoded per second
+//   heap       peak heap of the decoder (object included)
+//   p50..max   time per write() (per block for the cache) in us
+// Options: --csv (comma separated), --repeat n (passes), --chunk n (bytes per
+// write). MP3 and AAC need arduino-libhelix: -DCODEC_BENCH_HELIX=ON
+#include "AudioTools.h"
+#include "AudioTools/AudioCodecs/CodecWavIMA.h"
+#if USE_HELIX
+#include "AudioTools/AudioCodecs/CodecAACHelix.h"
+#include "AudioTools/AudioCodecs/CodecMP3Helix.h"
+#include "../codec/aac-helix/audio.h"
+#include "../codec/mp3-helix/BabyElephantWalk60_mp3.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <malloc.h>
+#include <math.h>
+#include <vector>
+
+const int rate = 44100;
+const int channels = 2;
+const int frames = rate * 10;
+
+bool csv = false;
+int repeat = 3;
+size_t chunk = 512;
+bool failed = false;
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    failed = true;
+  }
+}
+
+// Heap in use and its peak: malloc and free of glibc are wrapped, so that the
+// Allocator of the library, operator new and C codecs are all counted
+size_t heap_used = 0;
+size_t heap_peak = 0;
+
+#ifdef __GLIBC__
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t align, size_t size);
+void __libc_free(void *ptr);
+
+static void *counted(void *ptr) {
+  if (ptr != nullptr) heap_used += malloc_usable_size(ptr);
+  if (heap_used > heap_peak) heap_peak = heap_used;
+  return ptr;
+}
+
+void *malloc(size_t size) { return counted(__libc_malloc(size)); }
+void *calloc(size_t count, size_t size) {
+  return counted(__libc_calloc(count, size));
+}
+void *memalign(size_t align, size_t size) {
+  return counted(__libc_memalign(align, size));
+}
+void *aligned_alloc(size_t align, size_t size) {
+  return counted(__libc_memalign(align, size));
+}
+int posix_memalign(void **ptr, size_t align, size_t size) {
+  *ptr = counted(__libc_memalign(align, size));
+  return *ptr == nullptr ? ENOMEM : 0;
+}
+void *realloc(void *ptr, size_t size) {
+  size_t old = ptr != nullptr ? malloc_usable_size(ptr) : 0;
+  void *result = __libc_realloc(ptr, size);
+  if (result != nullptr || size == 0) heap_used -= old;
+  return counted(result);
+}
+void free(void *ptr) {
+  if (ptr != nullptr) heap_used -= malloc_usable_size(ptr);
+  __libc_free(ptr);
+}
+}
+#endif
+
+// starts a new peak
+size_t heapBase() {
+  heap_peak = heap_used;
+  return heap_used;
+}
+
+// Counts the decoded bytes: the last byte of each write is read, so that the
+// output can not be optimized away
+class NullSink : public AudioOutput {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    bytes += len;
+    if (len > 0) sum += data[len - 1];
+    return len;
+  }
+  int availableForWrite() override { return 1024 * 1024; }
+  size_t bytes = 0;
+  uint32_t sum = 0;
+};
+
+struct Result {
+  const char *name;
+  size_t encoded = 0;
+  double seconds = 0;  // decoding time of all passes
+  double audio = 0;    // audio of all passes in seconds
+  size_t heap = 0;
+  std::vector<uint32_t> ns;  // per call
+};
+
+// drums, bass and a chord with noise: something between a loop and a one shot
+void corpus(Vector<int16_t> &pcm) {
+  pcm.resize(frames * channels);
+  uint32_t seed = 1;
+  for (int j = 0; j < frames; j++) {
+    int t = j % 11025;
+    float env = expf(-t / 2000.0f);
+    seed = seed * 1664525 + 1013904223;
+    float noise = ((int32_t)seed >> 16) / 32768.0f;
+    float time = (float)j / rate;
+    float chord = sinf(2.0f * M_PI * 220.0f * time) +
+                  0.7f * sinf(2.0f * M_PI * 277.2f * time) +
+                  0.5f * sinf(2.0f * M_PI * 329.6f * time);
+    for (int ch = 0; ch < channels; ch++) {
+      float drum = env * sinf(2.0f * M_PI * (60 + 40 * ch) * t / rate);
+      float value = (0.45f * drum + 0.15f * chord + 0.05f * env * noise) * 32767;
+      pcm[j * channels + ch] = (int16_t)lroundf(value);
+    }
+  }
+}
+
+void add16(std::vector<uint8_t> &out, uint32_t value) {
+  out.push_back(value & 0xFF);
+  out.push_back((value >> 8) & 0xFF);
+}
+
+void add32(std::vector<uint8_t> &out, uint32_t value) {
+  add16(out, value & 0xFFFF);
+  add16(out, value >> 16);
+}
+
+void addTag(std::vector<uint8_t> &out, const char *tag) {
+  for (int j = 0; j < 4; j++) out.push_back(tag[j]);
+}
+
+void wavPCM(Vector<int16_t> &pcm, int bits, std::vector<uint8_t> &out) {
+  int bytes = bits / 8;
+  uint32_t data_size = pcm.size() * bytes;
+  addTag(out, "RIFF");
+  add32(out, 36 + data_size);
+  addTag(out, "WAVE");
+  addTag(out, "fmt ");
+  add32(out, 16);
+  add16(out, 1);
+  add16(out, channels);
+  add32(out, rate);
+  add32(out, rate * channels * bytes);
+  add16(out, channels * bytes);
+  add16(out, bits);
+  addTag(out, "data");
+  add32(out, data_size);
+  for (size_t j = 0; j < pcm.size(); j++) {
+    int32_t value = (int32_t)pcm[j] << (bits - 16);
+    for (int b = 0; b < bytes; b++) out.push_back((value >> (8 * b)) & 0xFF);
+  }
+}
+
+const int16_t ima_steps[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+const int8_t ima_index[16] = {-1, -1, -1, -1, 2, 4, 6, 8,
+                              -1, -1, -1, -1, 2, 4, 6, 8};
+
+uint8_t imaNibble(int16_t sample, int32_t &predictor, int &index) {
+  int32_t step = ima_steps[index];
+  int32_t diff = sample - predictor;
+  uint8_t code = 0;
+  if (diff < 0) {
+    code = 8;
+    diff = -diff;
+  }
+  int32_t delta = step >> 3;
+  if (diff >= step) {
+    code |= 4;
+    diff -= step;
+    delta += step;
+  }
+  if (diff >= step >> 1) {
+    code |= 2;
+    diff -= step >> 1;
+    delta += step >> 1;
+  }
+  if (diff >= step >> 2) {
+    code |= 1;
+    delta += step >> 2;
+  }
+  predictor += (code & 8) ? -delta : delta;
+  predictor = predictor > 32767 ? 32767 : (predictor < -32768 ? -32768 : predictor);
+  index += ima_index[code];
+  index = index < 0 ? 0 : (index > 88 ? 88 : index);
+  return code;
+}
+
+// IMA ADPCM WAV (format 0x11) with 256 bytes per channel and block
+void wavIMA(Vector<int16_t> &pcm, std::vector<uint8_t> &out) {
+  const uint32_t align = 256 * channels;
+  const uint32_t block_frames = (align - 4 * channels) * 2 / channels + 1;
+  uint32_t blocks = (frames + block_frames - 1) / block_frames;
+  addTag(out, "RIFF");
+  add32(out, 4 + 28 + 12 + 8 + blocks * align);
+  addTag(out, "WAVE");
+  addTag(out, "fmt ");
+  add32(out, 20);
+  add16(out, 0x11);
+  add16(out, channels);
+  add32(out, rate);
+  add32(out, rate * align / block_frames);
+  add16(out, align);
+  add16(out, 4);
+  add16(out, 2);
+  add16(out, block_frames);
+  addTag(out, "fact");
+  add32(out, 4);
+  add32(out, frames);
+  addTag(out, "data");
+  add32(out, blocks * align);
+  auto at = [&](uint32_t frame, int ch) -> int16_t {
+    return frame < (uint32_t)frames ? pcm[frame * channels + ch] : 0;
+  };
+  int32_t predictor[channels] = {0};
+  int index[channels] = {0};
+  for (uint32_t b = 0; b < blocks; b++) {
+    uint32_t first = b * block_frames;
+    for (int ch = 0; ch < channels; ch++) {
+      predictor[ch] = at(first, ch);
+      add16(out, (uint16_t)predictor[ch]);
+      out.push_back(index[ch]);
+      out.push_back(0);
+    }
+    for (uint32_t f = first + 1; f < first + block_frames; f += 8) {
+      for (int ch = 0; ch < channels; ch++) {
+        for (uint32_t j = 0; j < 8; j += 2) {
+          uint8_t low = imaNibble(at(f + j, ch), predictor[ch], index[ch]);
+          uint8_t high = imaNibble(at(f + j + 1, ch), predictor[ch], index[ch]);
+          out.push_back(low | (high << 4));
+        }
+      }
+    }
+  }
+}
+
+// unsigned 8 bit without header, as expected by DecoderL8
+void rawL8(Vector<int16_t> &pcm, std::vector<uint8_t> &out) {
+  out.resize(pcm.size());
+  for (size_t j = 0; j < pcm.size(); j++) out[j] = (pcm[j] >> 8) + 128;
+}
+
+// Writes the corpus in chunks: raw formats get their AudioInfo before begin().
+// Without pcm_frames the length of the audio is taken from the 16 bit output.
+template <class T>
+void benchDecoder(Result &result, const uint8_t *data, size_t len,
+                  size_t pcm_frames, AudioInfo raw = AudioInfo(0, 0, 0)) {
+  NullSink sink;
+  result.ns.reserve(repeat * (len / chunk + 1));
+  size_t base = heapBase();
+  T *decoder = new T();
+  decoder->setOutput(sink);
+  decoder->addNotifyAudioChange(sink);
+  if (raw.sample_rate > 0) decoder->setAudioInfo(raw);
+  result.encoded = len;
+  for (int r = 0; r < repeat; r++) {
+    size_t before = sink.bytes;
+    decoder->begin();
+    for (size_t pos = 0; pos < len; pos += chunk) {
+      size_t n = std::min(chunk, len - pos);
+      auto start = std::chrono::steady_clock::now();
+      decoder->write(data + pos, n);
+      auto end = std::chrono::steady_clock::now();
+      uint32_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+      result.ns.push_back(ns);
+      result.seconds += ns / 1e9;
+    }
+    decoder->end();
+    size_t decoded = sink.bytes - before;
+    AudioInfo info = sink.audioInfo();
+    if (pcm_frames > 0) {
+      check(decoded >= pcm_frames * channels * 2, result.name);
+      result.audio += (double)pcm_frames / rate;
+    } else {
+      check(decoded > 0 && info.sample_rate > 0, result.name);
+      if (info.sample_rate > 0 && info.channels > 0) {
+        result.audio += (double)decoded / (info.channels * 2) / info.sample_rate;
+      }
+    }
+  }
+  result.heap = heap_peak - base;
+  delete decoder;
+}
+
+void benchCache(Result &result, Vector<int16_t> &pcm, BlockCompressedPCM::Format format) {
+  BlockCompressedPCM packed;
+  packed.begin(format, channels);
+  packed.write((const uint8_t *)pcm.data(), pcm.size() * sizeof(int16_t));
+  packed.end();
+  result.encoded = packed.memoryUsed();
+  int16_t block[BlockCompressedPCM::BLOCK_FRAMES * channels];
+  int32_t sum = 0;
+  result.ns.reserve(repeat * packed.blocks());
+  size_t base = heapBase();
+  for (int r = 0; r < repeat; r++) {
+    size_t decoded = 0;
+    for (size_t b = 0; b < packed.blocks(); b++) {
+      auto start = std::chrono::steady_clock::now();
+      decoded += packed.decode(b, block);
+      auto end = std::chrono::steady_clock::now();
+      uint32_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+      result.ns.push_back(ns);
+      result.seconds += ns / 1e9;
+      sum += block[b & 255];
+    }
+    check(decoded == (size_t)frames, result.name);
+    result.audio += (double)frames / rate;
+  }
+  result.heap = heap_peak - base;
+  if (sum == 1) printf(" ");  // keeps the decoding
+}
+
+double percentile(std::vector<uint32_t> &sorted, int percent) {
+  if (sorted.size() == 0) return 0;
+  size_t pos = (sorted.size() - 1) * percent / 100;
+  return sorted[pos] / 1000.0;
+}
+
+void printHeader() {
+  if (csv) {
+    printf("format,bytes,ratio,mb_s,x_rt,heap,p50_us,p90_us,p99_us,max_us\n");
+  } else {
+    printf("%-14s %9s %6s %8s %8s %8s %8s %8s %8s %8s\n", "format", "bytes",
+           "ratio", "mb_s", "x_rt", "heap", "p50_us", "p90_us", "p99_us",
+           "max_us");
+  }
+}
+
+void printResult(Result &result) {
+  std::sort(result.ns.begin(), result.ns.end());
+  double mb_s = result.seconds > 0 ? result.encoded * repeat / result.seconds / 1e6 : 0;
+  double x_rt = result.seconds > 0 ? result.audio / result.seconds : 0;
+  double pcm_bytes = result.audio / repeat * rate * channels * 2;
+  double ratio = pcm_bytes > 0 ? result.encoded / pcm_bytes : 0;
+  const char *fmt = csv ? "%s,%u,%.3f,%.1f,%.0f,%u,%.2f,%.2f,%.2f,%.2f\n"
+                        : "%-14s %9u %6.3f %8.1f %8.0f %8u %8.2f %8.2f %8.2f %8.2f\n";
+  printf(fmt, result.name, (unsigned)result.encoded, ratio, mb_s, x_rt,
+         (unsigned)result.heap, percentile(result.ns, 50),
+         percentile(result.ns, 90), percentile(result.ns, 99),
+         percentile(result.ns, 100));
+}
+
+int main(int argc, char **argv) {
+  for (int j = 1; j < argc; j++) {
+    if (strcmp(argv[j], "--csv") == 0) {
+      csv = true;
+    } else if (strcmp(argv[j], "--repeat") == 0 && j + 1 < argc) {
+      repeat = std::max(1, atoi(argv[++j]));
+    } else if (strcmp(argv[j], "--chunk") == 0 && j + 1 < argc) {
+      chunk = std::max(1, atoi(argv[++j]));
+    } else {
+      printf("usage: %s [--csv] [--repeat n] [--chunk bytes]\n", argv[0]);
+      return 2;
+    }
+  }
+  Vector<int16_t> pcm;
+  corpus(pcm);
+  std::vector<uint8_t> wav16, wav24, ima, l8;
+  wavPCM(pcm, 16, wav16);
+  wavPCM(pcm, 24, wav24);
+  wavIMA(pcm, ima);
+  rawL8(pcm, l8);
+  const uint8_t *raw16 = (const uint8_t *)pcm.data();
+  AudioInfo info(rate, channels, 16);
+
+  if (!csv) {
+    printf("# %d s stereo %d Hz, %u bytes per write, %d passes\n", frames / rate,
+           rate, (unsigned)chunk, repeat);
+  }
+  printHeader();
+  Result results[10];
+  int count = 0;
+  results[count].name = "pcm-copy";
+  benchDecoder<CopyDecoder>(results[count++], raw16, pcm.size() * 2, frames, info);
+  results[count].name = "wav-16";
+  benchDecoder<WAVDecoder>(results[count++], wav16.data(), wav16.size(), frames);
+  results[count].name = "wav-24";
+  benchDecoder<WAVDecoder>(results[count++], wav24.data(), wav24.size(), frames);
+  results[count].name = "wav-ima-adpcm";
+  benchDecoder<WavIMADecoder>(results[count++], ima.data(), ima.size(), frames);
+  results[count].name = "l8";
+  benchDecoder<DecoderL8>(results[count++], l8.data(), l8.size(), frames, info);
+#if USE_HELIX
+  results[count].name = "mp3-helix";
+  benchDecoder<MP3DecoderHelix>(results[count++], BabyElephantWalk60_mp3,
+                                BabyElephantWalk60_mp3_len, 0);
+  results[count].name = "aac-helix";
+  benchDecoder<AACDecoderHelix>(results[count++], gs_16b_2c_44100hz_aac,
+                                gs_16b_2c_44100hz_aac_len, 0);
+#endif
+  results[count].name = "cache-pcm";
+  benchCache(results[count++], pcm, BlockCompressedPCM::PCM);
+  results[count].name = "cache-ima";
+  benchCache(results[count++], pcm, BlockCompressedPCM::IMA_ADPCM);
+  results[count].name = "cache-lossless";
+  benchCache(results[count++], pcm, BlockCompressedPCM::Lossless);
+  for (int j = 0; j < count; j++) printResult(results[j]);
+  return failed ? 1 : 0;
+}
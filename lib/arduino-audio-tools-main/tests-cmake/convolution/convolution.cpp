@@ -0,0 +1,134 @@
+// Compares the FFTConvolver with a direct convolution and measures the
+// processing time per block for different impulse response lengths
+#include "AudioTools.h"
+#include "AudioTools/AudioLibs/AudioRealFFT.h"
+#include "AudioTools/AudioLibs/FFTConvolver.h"
+#include <chrono>
+
+const int block = 256;
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// decaying noise like a room response
+void createIR(Vector<float> &ir, int len) {
+  ir.resize(len);
+  uint32_t seed = 1;
+  for (int j = 0; j < len; j++) {
+    seed = seed * 1664525 + 1013904223;
+    float noise = ((int32_t)seed / 2147483648.0f);
+    ir[j] = 0.5f * noise * expf(-5.0f * j / len);
+  }
+}
+
+void testCorrectness() {
+  const int ir_len = 1000;  // not a multiple of the block size
+  const int len = 4000;
+  Vector<float> ir;
+  createIR(ir, ir_len);
+  static int16_t input[len];
+  static int16_t output[len];
+  uint32_t seed = 7;
+  for (int j = 0; j < len; j++) {
+    seed = seed * 1664525 + 1013904223;
+    input[j] = (int32_t)seed >> 20;  // +-2048: no clipping
+  }
+
+  FFTDriverRealFFT driver;
+  FFTConvolver conv(driver, block);
+  check(conv.setIR(ir.data(), ir.size()), "setIR");
+  // mix of block and sample processing
+  conv.processBlock(input, output, 1000);
+  for (int j = 1000; j < 1100; j++) output[j] = conv.process(input[j]);
+  conv.processBlock(input + 1100, output + 1100, len - 1100);
+
+  float max_error = 0;
+  for (int n = 0; n < len; n++) {
+    // output is delayed by one block
+    int t = n - conv.latency();
+    float expected = 0;
+    for (int k = 0; k < ir_len && k <= t; k++) expected += ir[k] * input[t - k];
+    float error = fabsf(expected - output[n]);
+    if (error > max_error) max_error = error;
+  }
+  printf("max error against direct convolution: %.2f\n", max_error);
+  check(max_error <= 1.0f, "direct convolution");
+  driver.end();
+}
+
+/// Collects the written bytes
+class Collector : public Print {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    for (size_t j = 0; j < len; j++) bytes.push_back((uint8_t)data[j]);
+    return len;
+  }
+  size_t write(uint8_t ch) override { return write(&ch, 1); }
+  Vector<uint8_t> bytes;
+};
+
+void testLoadWAV() {
+  // stereo 16 bit wav: only the left channel is used
+  Collector out;
+  WAVEncoder encoder;
+  encoder.setOutput(out);
+  WAVAudioInfo info;
+  info.channels = 2;
+  info.sample_rate = 44100;
+  info.bits_per_sample = 16;
+  encoder.begin(info);
+  for (int j = 0; j < 600; j++) {
+    int16_t frame[2] = {(int16_t)(j == 0 ? 16384 : 0), (int16_t)1000};
+    encoder.write((uint8_t *)frame, sizeof(frame));
+  }
+  encoder.end();
+
+  FFTDriverRealFFT driver;
+  FFTConvolver conv(driver, block);
+  MemoryStream wav(out.bytes.data(), out.bytes.size());
+  wav.begin();
+  check(conv.loadWAV(wav), "loadWAV");
+  check(conv.size() == 3 * block, "ir size");
+  // ir is a 0.5 impulse: the output is the input * 0.5 delayed by one block
+  static int16_t data[4 * block];
+  for (int j = 0; j < 4 * block; j++) data[j] = j;
+  conv.processBlock(data, data, 4 * block);
+  for (int j = block; j < 4 * block; j++) {
+    check(abs(data[j] - (j - block) / 2) <= 1, "wav ir");
+  }
+  driver.end();
+}
+
+void benchmark(int ir_len) {
+  Vector<float> ir;
+  createIR(ir, ir_len);
+  FFTDriverRealFFT driver;
+  FFTConvolver conv(driver, block);
+  conv.setIR(ir.data(), ir.size());
+  static int16_t data[block];
+  for (int j = 0; j < block; j++) data[j] = 1000 * sin(j * 0.1);
+  int blocks = 2000000 / ir_len + 100;
+  auto start = std::chrono::steady_clock::now();
+  for (int b = 0; b < blocks; b++) conv.processBlock(data, data, block);
+  auto end = std::chrono::steady_clock::now();
+  double us = std::chrono::duration<double, std::micro>(end - start).count() / blocks;
+  double budget = 1000000.0 * block / 44100;
+  driver.end();
+  printf("ir %6d samples (%4d partitions): %8.1f us/block %5.1f%% of %.0f us\n",
+         ir_len, (ir_len + block - 1) / block, us, 100.0 * us / budget, budget);
+}
+
+void setup() {
+  testCorrectness();
+  testLoadWAV();
+  int lengths[] = {256, 1024, 4096, 16384, 44100};
+  for (int len : lengths) benchmark(len);
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,82 @@
+// Delay: an integer delay puts the echo of an impulse at its sample, a
+// fractional one between two samples, the block and the per sample path
+// agree, and a new delay with a glide moves the echo without a jump
+#include "AudioTools.h"
+
+const int rate = 44100;
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// Wet only, no feedback: the output is the delayed input
+void wetOnly(Delay &delay, double samples) {
+  delay.setSampleRate(rate);
+  delay.setMaxDuration(1000);
+  delay.setDepth(1.0);
+  delay.setFeedback(0.0);
+  delay.setDelaySamples(samples);
+}
+
+void setup() {
+  static int16_t in[4096];
+  static int16_t out[4096];
+
+  // integer: the impulse comes out 1000 samples later, unchanged
+  Delay integer;
+  wetOnly(integer, 1000);
+  in[0] = 10000;
+  integer.processBlock(in, out, 4096);
+  check(out[1000] == 10000, "integer delay");
+  int energy = 0;
+  for (int j = 0; j < 4096; j++) energy += abs(out[j]);
+  check(energy == 10000, "integer delay: one sample");
+
+  // fractional: split over the two neighbours
+  Delay fractional;
+  wetOnly(fractional, 1000.25);
+  fractional.processBlock(in, out, 4096);
+  check(out[1000] == 7500 && out[1001] == 2500, "fractional delay");
+  check(fractional.getDelaySamples() == 1000.25, "delay in samples");
+
+  // per sample as per block
+  Delay block, sample;
+  wetOnly(block, 1234.5);
+  wetOnly(sample, 1234.5);
+  for (int j = 0; j < 4096; j++) in[j] = 8000 * sin(2.0 * M_PI * 440.0 * j / rate);
+  block.processBlock(in, out, 4096);
+  for (int j = 0; j < 4096; j++) {
+    check(sample.process(in[j]) == out[j], "block equals per sample");
+  }
+
+  // glide: a sine through a delay which moves from 1000 to 1500 samples
+  // bends in pitch; no sample jumps more than the sine itself can
+  Delay glide;
+  wetOnly(glide, 1000);
+  glide.setGlide(rate * 0.06f);
+  int16_t previous = 0;
+  int maxStep = 0;
+  for (int b = 0; b < 40; b++) {
+    for (int j = 0; j < 256; j++) {
+      int n = b * 256 + j;
+      in[j] = 8000 * sin(2.0 * M_PI * 220.0 * n / rate);
+    }
+    if (b == 10) glide.setDelaySamples(1500);
+    glide.processBlock(in, out, 256);
+    for (int j = 0; j < 256; j++) {
+      if (b * 256 + j > 1000) maxStep = max(maxStep, abs(out[j] - previous));
+      previous = out[j];
+    }
+  }
+  int sineStep = 8000 * 2.0 * M_PI * 220.0 / rate + 2;
+  check(maxStep <= sineStep, "glide without a jump");
+  check(glide.getDelaySamples() == 1500, "glide target");
+
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
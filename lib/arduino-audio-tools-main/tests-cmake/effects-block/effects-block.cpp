@@ -0,0 +1,145 @@
+// Benchmark of a 4 effect chain per block of 512 stereo frames: the per
+// sample processing (as AudioEffectStream used to do it) against
+// AudioEffectStream with AudioEffect::processBlock()
+#include "AudioTools.h"
+#include <chrono>
+
+const int frames = 512;
+const int channels = 2;
+const int blocks = 2000;
+
+int16_t input[frames * channels];
+
+/// Output which just counts the bytes
+class NullOutput : public Print {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    if (len > 0) last = ((int16_t *)data)[0];
+    total += len;
+    return len;
+  }
+  size_t write(uint8_t) override { return 1; }
+  size_t total = 0;
+  int16_t last = 0;
+};
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+struct Chain {
+  Boost boost{0.8};
+  Distortion distortion{8000, 9000};
+  Tremolo tremolo{2000, 50, 44100};
+  Delay delay{300, 0.5, 0.4, 44100};
+  AudioEffect *all[4] = {&boost, &distortion, &tremolo, &delay};
+};
+
+/// the previous implementation: mix down and run all effects per frame
+void perSample(Chain &chain, const int16_t *in, int16_t *out) {
+  for (int f = 0; f < frames; f++) {
+    int16_t sample = 0;
+    for (int ch = 0; ch < channels; ch++) sample += in[f * channels + ch] / channels;
+    for (int j = 0; j < 4; j++) sample = chain.all[j]->process(sample);
+    for (int ch = 0; ch < channels; ch++) out[f * channels + ch] = sample;
+  }
+}
+
+double nsPerBlock(std::chrono::steady_clock::time_point start) {
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / blocks;
+}
+
+void setup() {
+  for (int j = 0; j < frames * channels; j++) {
+    input[j] = 12000 * sin(2.0 * M_PI * 440.0 * (j / channels) / 44100.0);
+  }
+
+  // same result for both implementations
+  Chain reference, block;
+  NullOutput out;
+  AudioEffectStream check_stream;
+  for (auto e : block.all) check_stream.addEffect(e);
+  check_stream.begin(check_stream.defaultConfig());
+  static int16_t expected[frames * channels];
+  static int16_t result[frames * channels];
+  for (int b = 0; b < 20; b++) {
+    perSample(reference, input, expected);
+    MemoryStream mem((const uint8_t *)input, sizeof(input));
+    check_stream.setStream(mem);
+    check(check_stream.readBytes((uint8_t *)result, sizeof(result)) == sizeof(result), "read size");
+    check(memcmp(result, expected, sizeof(result)) == 0, "block result equals per sample result");
+  }
+
+  // multi channel: a parameter which is set after begin() only changes the
+  // effect of channel 0; the copies of the other channels are set one by one
+  static int16_t stereo[2 * 2000];
+  static int16_t stereo_out[2 * 2000];
+  for (int j = 0; j < 2 * 2000; j++) stereo[j] = 1000;
+  Boost gain{1.0};
+  AudioEffectStream split;
+  split.addEffect(gain);
+  split.setMultiChannel(true);
+  split.begin(split.defaultConfig());
+  gain.setVolume(2.0);
+  MemoryStream mem((const uint8_t *)stereo, sizeof(stereo));
+  split.setStream(mem);
+  check(split.readBytes((uint8_t *)result, 4) == 4, "multi channel read");
+  check(result[0] == 2000 && result[1] == 1000, "parameter of the original: channel 0 only");
+  for (int ch = 0; ch < channels; ch++) {
+    ((Boost *)split.effect(0, ch))->setVolume(2.0);
+  }
+  // longer than the work buffer of begin(): processed in pieces
+  mem.begin();
+  check(split.readBytes((uint8_t *)stereo_out, sizeof(stereo_out)) == sizeof(stereo), "long read");
+  for (int j = 0; j < 2 * 2000; j++) check(stereo_out[j] == 2000, "parameter on each channel");
+  AudioEffectStream pieces(out);
+  pieces.addEffect(gain);
+  pieces.begin(pieces.defaultConfig());
+  size_t written = out.total;
+  check(pieces.write((uint8_t *)stereo, sizeof(stereo)) == sizeof(stereo), "long write");
+  check(out.total - written == sizeof(stereo) && out.last == 2000, "long write in pieces");
+
+  // benchmark
+  Chain before;
+  static int16_t tmp[frames * channels];
+  auto start = std::chrono::steady_clock::now();
+  for (int b = 0; b < blocks; b++) {
+    perSample(before, input, tmp);
+    out.write((uint8_t *)tmp, sizeof(tmp));
+  }
+  double before_ns = nsPerBlock(start);
+
+  Chain after;
+  AudioEffectStream stream(out);
+  for (auto e : after.all) stream.addEffect(e);
+  stream.begin(stream.defaultConfig());
+  start = std::chrono::steady_clock::now();
+  for (int b = 0; b < blocks; b++) {
+    stream.write((uint8_t *)input, sizeof(input));
+  }
+  double after_ns = nsPerBlock(start);
+
+  AudioEffectStream multi(out);
+  Chain multi_chain;
+  for (auto e : multi_chain.all) multi.addEffect(e);
+  multi.setMultiChannel(true);
+  multi.begin(multi.defaultConfig());
+  check(multi.effect(0, 1) != multi.effect(0, 0), "channel copies");
+  start = std::chrono::steady_clock::now();
+  for (int b = 0; b < blocks; b++) {
+    multi.write((uint8_t *)input, sizeof(input));
+  }
+  double multi_ns = nsPerBlock(start);
+
+  printf("per sample:            %8.0f ns/block %6.2f ns/frame\n", before_ns, before_ns / frames);
+  printf("processBlock:          %8.0f ns/block %6.2f ns/frame\n", after_ns, after_ns / frames);
+  printf("processBlock (stereo): %8.0f ns/block %6.2f ns/frame\n", multi_ns, multi_ns / frames);
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,66 @@
+// MidiParser: complete messages from a byte stream with running status,
+// interleaved real time bytes and skipped system exclusive data
+#include "AudioTools.h"
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// Parses the bytes and returns the number of messages in result
+int parseAll(MidiParser &parser, const uint8_t *bytes, int len,
+             MidiMessage *result, int max) {
+  int count = 0;
+  MidiMessage message;
+  for (int j = 0; j < len; j++) {
+    if (parser.parse(bytes[j], message) && count < max) result[count++] = message;
+  }
+  return count;
+}
+
+bool is(const MidiMessage &msg, MidiType type, int channel, int data1, int data2) {
+  return msg.type == type && msg.channel == channel && msg.data1 == data1 &&
+         msg.data2 == data2;
+}
+
+void setup() {
+  MidiParser parser;
+  MidiMessage msg[8];
+
+  // note on, running status, velocity 0 as note off
+  const uint8_t notes[] = {0x91, 36, 100, 38, 90, 36, 0};
+  check(parseAll(parser, notes, sizeof(notes), msg, 8) == 3, "note count");
+  check(is(msg[0], MidiType::NoteOn, 1, 36, 100), "note on");
+  check(is(msg[1], MidiType::NoteOn, 1, 38, 90), "running status");
+  check(is(msg[2], MidiType::NoteOff, 1, 36, 0), "velocity 0");
+
+  // a clock in the middle of a control change, program change with one byte
+  parser.reset();
+  const uint8_t mixed[] = {0xB0, 74, 0xF8, 64, 0xC2, 5, 0xFE, 6};
+  check(parseAll(parser, mixed, sizeof(mixed), msg, 8) == 4, "mixed count");
+  check(is(msg[0], MidiType::Clock, 0, 0, 0), "clock");
+  check(is(msg[1], MidiType::ControlChange, 0, 74, 64), "control change");
+  check(is(msg[2], MidiType::ProgramChange, 2, 5, 0), "program change");
+  check(is(msg[3], MidiType::ProgramChange, 2, 6, 0), "active sensing ignored");
+
+  // system exclusive ends the running status; its data is skipped
+  parser.reset();
+  const uint8_t sysex[] = {0x90, 40, 1, 0xF0, 0x7E, 40, 2, 0xF7, 41, 3, 0x80, 40, 64, 0xFA, 0xFC};
+  check(parseAll(parser, sysex, sizeof(sysex), msg, 8) == 4, "sysex count");
+  check(is(msg[0], MidiType::NoteOn, 0, 40, 1), "before sysex");
+  check(is(msg[1], MidiType::NoteOff, 0, 40, 64), "after sysex");
+  check(msg[2].type == MidiType::Start && msg[3].type == MidiType::Stop, "start stop");
+
+  // pitch bend: 14 bit value in two bytes
+  parser.reset();
+  const uint8_t bend[] = {0xE3, 0x00, 0x40};
+  check(parseAll(parser, bend, sizeof(bend), msg, 8) == 1, "bend count");
+  check(is(msg[0], MidiType::PitchBend, 3, 0x00, 0x40), "pitch bend");
+
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,180 @@
+// Checks the OnsetDetector with a synthetic drum loop (positions, no false
+// onsets on sustained material, any write size and sample format) and
+// measures the analysis time
+#include "AudioTools.h"
+#include "AudioTools/AudioCodecs/CodecWAV.h"
+#include <chrono>
+#include <math.h>
+
+const int sample_rate = 44100;
+const int frames = sample_rate * 2;
+// hits of the loop: kick, hat, snare, hat, kick, hat, snare, hat
+enum Drum { Kick, Hat, Snare };
+const uint32_t hits[] = {0, 11025, 22050, 33075, 44100, 49612, 66150, 77175};
+const Drum drums[] = {Kick, Hat, Snare, Hat, Kick, Hat, Snare, Hat};
+const int hit_count = sizeof(hits) / sizeof(hits[0]);
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+uint32_t seed = 1;
+float noise() {
+  seed = seed * 1664525u + 1013904223u;
+  return (int32_t)seed / 2147483648.0f;
+}
+
+// stereo loop with a quiet noise floor: kicks are a low sine with a click,
+// snares a tone with noise and hats short noise bursts
+void drumLoop(Vector<int16_t> &data) {
+  data.resize(frames * 2);
+  for (int j = 0; j < frames; j++) {
+    float value = 0.001f * noise();
+    for (int h = 0; h < hit_count; h++) {
+      if (j < (int)hits[h]) continue;
+      float t = (float)(j - hits[h]) / sample_rate;
+      switch (drums[h]) {
+        case Kick:
+          value += 0.6f * expf(-t * 12.0f) * sinf(2.0f * M_PI * 60.0f * t) +
+                   0.2f * expf(-t * 400.0f) * noise();
+          break;
+        case Snare:
+          value += expf(-t * 20.0f) *
+                   (0.2f * sinf(2.0f * M_PI * 180.0f * t) + 0.25f * noise());
+          break;
+        case Hat:
+          value += 0.15f * expf(-t * 60.0f) * noise();
+          break;
+      }
+    }
+    int16_t sample = lroundf(value * 32767.0f);
+    data[2 * j] = sample;
+    data[2 * j + 1] = sample;
+  }
+}
+
+Vector<uint32_t> detect(const uint8_t *data, size_t len, AudioInfo info,
+                        size_t chunk) {
+  OnsetDetector detector;
+  check(detector.begin(info), "begin");
+  for (size_t pos = 0; pos < len; pos += chunk) {
+    detector.write(data + pos, pos + chunk < len ? chunk : len - pos);
+  }
+  return detector.onsets();
+}
+
+void testPositions() {
+  Vector<int16_t> data;
+  drumLoop(data);
+  AudioInfo info(sample_rate, 2, 16);
+  Vector<uint32_t> onsets =
+      detect((uint8_t *)data.data(), data.size() * 2, info, 512);
+  printf("onsets:");
+  for (uint32_t onset : onsets) printf(" %u", (unsigned)onset);
+  printf("\n");
+  check(onsets.size() == hit_count, "number of onsets");
+  for (int h = 0; h < hit_count; h++) {
+    // at most the pre-roll in front and never after the attack
+    check(onsets[h] <= hits[h], "not late");
+    check(onsets[h] + 100 >= hits[h], "not early");
+  }
+
+  // the result does not depend on the write size
+  Vector<uint32_t> odd = detect((uint8_t *)data.data(), data.size() * 2, info, 37);
+  check(odd.size() == onsets.size(), "chunk size count");
+  for (int h = 0; h < onsets.size(); h++) check(odd[h] == onsets[h], "chunk size");
+
+  // 24 bit mono gives the same positions
+  Vector<uint8_t> data24(frames * 3);
+  data24.resize(frames * 3);
+  for (int j = 0; j < frames; j++) {
+    uint32_t value = (uint32_t)(int32_t)data[2 * j] << 8;
+    data24[3 * j] = value & 0xFF;
+    data24[3 * j + 1] = (value >> 8) & 0xFF;
+    data24[3 * j + 2] = (value >> 16) & 0xFF;
+  }
+  Vector<uint32_t> onsets24 =
+      detect(data24.data(), data24.size(), AudioInfo(sample_rate, 1, 24), 500);
+  check(onsets24.size() == onsets.size(), "24 bit count");
+  for (int h = 0; h < onsets.size(); h++) check(onsets24[h] == onsets[h], "24 bit");
+}
+
+// a tone with slow tremolo and a fade in has no onsets
+void testSustained() {
+  Vector<int16_t> data;
+  data.resize(frames);
+  for (int j = 0; j < frames; j++) {
+    float t = (float)j / sample_rate;
+    float fade = t < 0.5f ? t / 0.5f : 1.0f;
+    float tremolo = 0.6f + 0.4f * sinf(2.0f * M_PI * 4.0f * t);
+    data[j] = lroundf(20000.0f * fade * tremolo * sinf(2.0f * M_PI * 220.0f * t));
+  }
+  Vector<uint32_t> onsets = detect((uint8_t *)data.data(), data.size() * 2,
+                                   AudioInfo(sample_rate, 1, 16), 1024);
+  check(onsets.size() == 1 && onsets[0] == 0, "sustained");
+}
+
+// the WAV decoder reports the file position of the PCM data
+void testDataStart() {
+  AudioInfo info(sample_rate, 2, 16);
+  WAVHeader header;
+  WAVAudioInfo wav(info);
+  wav.byte_rate = sample_rate * 4;
+  wav.block_align = 4;
+  wav.data_length = 4000;
+  wav.file_size = 4036 + 8;
+  header.setAudioInfo(wav);
+  Vector<uint8_t> file;
+  struct : public Print {
+    Vector<uint8_t> *p_file;
+    size_t write(const uint8_t *data, size_t len) override {
+      for (size_t j = 0; j < len; j++) {
+        uint8_t value = data[j];
+        p_file->push_back(value);
+      }
+      return len;
+    }
+    size_t write(uint8_t value) override { return write(&value, 1); }
+  } sink;
+  sink.p_file = &file;
+  header.writeHeader(&sink);
+  size_t header_len = file.size();
+  for (int j = 0; j < 4000; j++) file.push_back(0);
+  WAVDecoder decoder;
+  sink.p_file = nullptr;
+  NullStream out;
+  decoder.setOutput(out);
+  decoder.begin();
+  decoder.write(file.data(), file.size());
+  check(decoder.audioInfoEx().data_start == header_len, "data start");
+}
+
+void benchmark() {
+  Vector<int16_t> data;
+  drumLoop(data);
+  OnsetDetector detector;
+  detector.begin(AudioInfo(sample_rate, 2, 16));
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < 10; r++) {
+    detector.begin();
+    detector.write((uint8_t *)data.data(), data.size() * 2);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count() /
+              (10.0 * frames);
+  printf("analysis: %.1f ns/frame (stereo 16 bit)\n", ns);
+}
+
+void setup() {
+  testPositions();
+  testSustained();
+  testDataStart();
+  benchmark();
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,62 @@
+// Checks the statistics of the AudioProfiler histogram and measures the
+// overhead of one AUDIO_PROFILE_SCOPE
+#include "AudioTools.h"
+#include <math.h>
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// percentiles are reported with the resolution of 1/8 octave
+bool near(uint32_t value, uint32_t expected) {
+  return value >= expected && value <= expected + expected / 8;
+}
+
+volatile float sink = 0;
+
+void work() {
+  AUDIO_PROFILE_SCOPE("work");
+  for (int j = 0; j < 1000; j++) sink = sink + sqrtf(j);
+}
+
+void empty() { AUDIO_PROFILE_SCOPE("empty"); }
+
+void setup() {
+  ProfileStage stage;
+  stage.begin("test");
+  // 1..1000 us: p50 = 500us, p99 = 990us
+  for (uint32_t us = 1; us <= 1000; us++) stage.add(us * 1000);
+  printf("p50: %u ns, p99: %u ns\n", (unsigned)stage.percentileNs(50),
+         (unsigned)stage.percentileNs(99));
+  check(stage.size() == 1000, "count");
+  check(stage.minNs() == 1000 && stage.maxNs() == 1000000, "min/max");
+  check(stage.avgNs() == 500500, "avg");
+  check(near(stage.percentileNs(50), 500000), "p50");
+  check(near(stage.percentileNs(99), 990000), "p99");
+  check(stage.percentileNs(100) == 1000000, "p100");
+
+  // one outlier is hidden by p99 but not by max
+  stage.reset();
+  for (int j = 0; j < 999; j++) stage.add(2000);
+  stage.add(50000000);
+  check(near(stage.percentileNs(99), 2000) && stage.maxNs() == 50000000,
+        "outlier");
+
+  AudioProfiler &profiler = AudioProfiler::instance();
+  for (int j = 0; j < 1000; j++) work();
+  for (int j = 0; j < 100000; j++) empty();
+  profiler.setBudgetUs(5805);
+  profiler.printReport(Serial);
+  ProfileStage *p_work = profiler.stage("work");
+  check(p_work->size() == 1000 && p_work->minNs() > 0, "scope");
+  check(profiler.stage("empty")->avgNs() < 1000, "overhead");
+  printf("scope overhead: %u ns\n", (unsigned)profiler.stage("empty")->avgNs());
+
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
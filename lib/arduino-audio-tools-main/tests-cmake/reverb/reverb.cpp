@@ -0,0 +1,135 @@
+// Checks the Q15 Reverb (memory budget, decay to digital silence, block vs
+// sample processing) and measures the processing time of the stereo output
+#include "AudioTools.h"
+#include <chrono>
+
+const int sample_rate = 44100;
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// frames until the energy of 10ms windows drops below -40dB of the first window
+// after the impulse
+int decayFrames(Reverb &reverb) {
+  const int window = sample_rate / 100;
+  static int16_t left[sample_rate * 4], right[sample_rate * 4];
+  static int16_t input[sample_rate * 4];
+  memset(input, 0, sizeof(input));
+  input[0] = 32767;
+  reverb.reset();
+  reverb.processStereo(input, left, right, sample_rate * 4);
+  double max_energy = 0;
+  int result = 0;
+  for (int start = 0; start + window <= sample_rate * 4; start += window) {
+    double energy = 0;
+    for (int j = start; j < start + window; j++) {
+      energy += (double)left[j] * left[j] + (double)right[j] * right[j];
+    }
+    if (energy > max_energy) max_energy = energy;
+    if (energy > max_energy / 10000) result = start + window;
+  }
+  return result;
+}
+
+void testBudget() {
+  size_t full = Reverb::memoryNeeded(sample_rate);
+  Reverb large;
+  check(large.begin(sample_rate), "begin");
+  check(large.memoryUsed() == full, "full size");
+  Reverb small(32 * 1024);
+  check(small.begin(sample_rate), "begin with budget");
+  check(small.memoryUsed() <= 32 * 1024, "budget");
+  check(small.sizeFactor() < 1.0f, "size factor");
+  Reverb tiny(200);
+  check(!tiny.begin(sample_rate), "budget too small");
+
+  int full_decay = decayFrames(large);
+  int small_decay = decayFrames(small);
+  printf("arena: %u bytes full size, %u bytes with a 32k budget\n",
+         (unsigned)full, (unsigned)small.memoryUsed());
+  printf("decay to -40dB: %d ms full size, %d ms with a 32k budget\n",
+         full_decay * 1000 / sample_rate, small_decay * 1000 / sample_rate);
+  check(full_decay > sample_rate / 4, "decay time");
+  check(abs(full_decay - small_decay) < full_decay / 4, "decay time is kept");
+}
+
+void testSilence() {
+  Reverb reverb(32 * 1024);
+  reverb.setRoomSize(1.0f);
+  reverb.setDamping(0.0f);
+  reverb.begin(sample_rate);
+  static int16_t data[sample_rate];
+  static int16_t left[sample_rate];
+  static int16_t right[sample_rate];
+  uint32_t seed = 3;
+  for (int j = 0; j < sample_rate; j++) {
+    seed = seed * 1664525 + 1013904223;
+    data[j] = (int32_t)seed >> 16;  // full scale noise
+  }
+  reverb.processStereo(data, data, right, sample_rate);
+  memset(data, 0, sizeof(data));
+  bool silent = false;
+  for (int block = 0; block < 60 && !silent; block++) {
+    reverb.processStereo(data, left, right, sample_rate);
+    silent = true;
+    for (int j = 0; j < sample_rate; j++) {
+      if (left[j] != 0 || right[j] != 0) silent = false;
+    }
+  }
+  check(silent, "decays to digital silence");
+}
+
+void testBlockAndSample() {
+  Reverb a, b;
+  a.begin(sample_rate);
+  b.begin(sample_rate);
+  static int16_t input[4000], out_a[4000], out_b[4000];
+  uint32_t seed = 5;
+  for (int j = 0; j < 4000; j++) {
+    seed = seed * 1664525 + 1013904223;
+    input[j] = (int32_t)seed >> 18;
+  }
+  a.processBlock(input, out_a, 4000);
+  for (int j = 0; j < 4000; j++) out_b[j] = b.process(input[j]);
+  check(memcmp(out_a, out_b, sizeof(out_a)) == 0, "block vs sample");
+
+  // width 0: both channels are identical
+  int16_t left[4000], right[4000];
+  a.setWidth(0.0f);
+  a.processStereo(input, left, right, 4000);
+  check(memcmp(left, right, sizeof(left)) == 0, "mono width");
+}
+
+void benchmark(size_t budget) {
+  Reverb reverb(budget);
+  reverb.begin(sample_rate);
+  const int block = 256;
+  const int blocks = 2000;
+  static int16_t input[block], left[block], right[block];
+  for (int j = 0; j < block; j++) input[j] = (j % 100) * 300 - 15000;
+  auto start = std::chrono::steady_clock::now();
+  for (int j = 0; j < blocks; j++) {
+    reverb.processStereo(input, left, right, block);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count() /
+              (blocks * block);
+  printf("stereo reverb (%6u bytes): %6.1f ns/frame, %.2f%% of real time\n",
+         (unsigned)reverb.memoryUsed(), ns, 100.0 * ns * sample_rate / 1e9);
+}
+
+void setup() {
+  testBudget();
+  testSilence();
+  testBlockAndSample();
+  benchmark(0);
+  benchmark(32 * 1024);
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
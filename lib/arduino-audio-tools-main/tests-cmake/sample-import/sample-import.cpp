@@ -0,0 +1,200 @@
+// Checks the SampleImporter conversions (bit depth, dither, channels, sample
+// rate, memory limit) and measures the import time
+#include "AudioTools.h"
+#include <chrono>
+#include <math.h>
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// writes a little endian sample of the indicated size
+void put(Vector<uint8_t> &data, int32_t value, int bytes) {
+  for (int b = 0; b < bytes; b++) data.push_back((uint32_t)value >> (8 * b));
+}
+
+void import(SampleImporter &importer, AudioInfo from, AudioInfo to,
+            Vector<uint8_t> &data, size_t chunk) {
+  check(importer.begin(to), "begin");
+  importer.setExpectedBytes(data.size());
+  importer.setAudioInfo(from);
+  for (size_t pos = 0; pos < data.size(); pos += chunk) {
+    size_t len = data.size() - pos < chunk ? data.size() - pos : chunk;
+    importer.write(data.data() + pos, len);
+  }
+  importer.end();
+}
+
+// 8 and 16 bit are converted without loss, also with incomplete frames
+void testExact() {
+  Vector<uint8_t> data;
+  for (int j = 0; j < 256; j++) put(data, j, 1);
+  SampleImporter importer;
+  import(importer, AudioInfo(44100, 1, 8), AudioInfo(44100, 1, 16), data, 7);
+  check(importer.frames() == 256, "8 bit frames");
+  for (int j = 0; j < 256; j++) {
+    check(importer.samples()[j] == (j - 128) * 256, "8 bit");
+  }
+
+  data.clear();
+  for (int j = 0; j < 1000; j++) {
+    put(data, j * 61 - 30000, 2);
+    put(data, 30000 - j * 53, 2);
+  }
+  import(importer, AudioInfo(44100, 2, 16), AudioInfo(44100, 2, 16), data, 13);
+  check(importer.frames() == 1000, "16 bit frames");
+  for (int j = 0; j < 1000; j++) {
+    check(importer.samples()[2 * j] == j * 61 - 30000, "16 bit left");
+    check(importer.samples()[2 * j + 1] == 30000 - j * 53, "16 bit right");
+  }
+}
+
+// mono is duplicated, stereo is averaged
+void testChannels() {
+  Vector<uint8_t> data;
+  for (int j = 0; j < 100; j++) put(data, j * 100, 2);
+  SampleImporter importer;
+  import(importer, AudioInfo(44100, 1, 16), AudioInfo(44100, 2, 16), data, 64);
+  check(importer.frames() == 100, "mono frames");
+  for (int j = 0; j < 100; j++) {
+    check(importer.samples()[2 * j] == j * 100, "mono left");
+    check(importer.samples()[2 * j + 1] == j * 100, "mono right");
+  }
+
+  data.clear();
+  for (int j = 0; j < 100; j++) {
+    put(data, j * 100, 2);
+    put(data, -j * 50, 2);
+  }
+  import(importer, AudioInfo(44100, 2, 16), AudioInfo(44100, 1, 16), data, 64);
+  check(importer.frames() == 100, "stereo frames");
+  for (int j = 0; j < 100; j++) {
+    check(importer.samples()[j] == j * 25, "stereo to mono");
+  }
+}
+
+// 24 bit: the dither removes the bias of the truncation and the error stays
+// within the triangular dither range
+void testDither() {
+  Vector<uint8_t> data;
+  const int n = 20000;
+  // a DC of a quarter LSB disappears without dither
+  for (int j = 0; j < n; j++) put(data, 64, 3);
+  SampleImporter importer;
+  import(importer, AudioInfo(44100, 1, 24), AudioInfo(44100, 1, 16), data, 999);
+  check(importer.frames() == n, "24 bit frames");
+  double sum = 0;
+  for (int j = 0; j < n; j++) {
+    int16_t value = importer.samples()[j];
+    check(value >= -1 && value <= 1, "dither range");
+    sum += value;
+  }
+  printf("mean of 0.25 LSB with dither: %.3f\n", sum / n);
+  check(fabs(sum / n - 0.25) < 0.03, "dither without bias");
+}
+
+// 48 kHz to 44.1 kHz: number of frames and accuracy of a 1 kHz sine
+void testSampleRate() {
+  Vector<uint8_t> data;
+  const int n = 48000;
+  const double amplitude = 16000;
+  for (int j = 0; j < n; j++) {
+    put(data, lround(amplitude * sin(2.0 * M_PI * 1000 * j / 48000.0) * 256), 3);
+  }
+  SampleImporter importer;
+  import(importer, AudioInfo(48000, 1, 24), AudioInfo(44100, 2, 16), data, 1000);
+  int frames = importer.frames();
+  check(abs(frames - 44100) <= 2, "resampled frames");
+  double signal = 0, noise = 0;
+  for (int j = 200; j < frames - 200; j++) {
+    double ideal = amplitude * sin(2.0 * M_PI * 1000 * j / 44100.0);
+    double error = importer.samples()[2 * j] - ideal;
+    signal += ideal * ideal;
+    noise += error * error;
+    check(importer.samples()[2 * j] == importer.samples()[2 * j + 1],
+          "same dither on both channels");
+  }
+  float db = 10.0f * log10(noise / signal);
+  printf("48 kHz to 44.1 kHz THD+N: %.1f dB\n", db);
+  check(db < -75, "resampling accuracy");
+  check(importer.memoryUsed() >= (size_t)frames * 4, "memory");
+}
+
+// data beyond the limit is dropped
+void testLimit() {
+  Vector<uint8_t> data;
+  for (int j = 0; j < 1000; j++) put(data, j, 2);
+  SampleImporter importer;
+  importer.begin(AudioInfo(44100, 2, 16));
+  importer.setMaxBytes(1000);
+  importer.setAudioInfo(AudioInfo(44100, 1, 16));
+  importer.write(data.data(), data.size());
+  importer.end();
+  check(importer.isOverflow(), "overflow");
+  check(importer.frames() == 250, "frames within the limit");
+  check(importer.memoryUsed() <= 1000, "memory within the limit");
+}
+
+// an import which ends with an incomplete frame does not leave bytes for the
+// next imports
+void testAfterPartial() {
+  Vector<uint8_t> data;
+  for (int j = 0; j < 100; j++) {
+    put(data, j << 8, 3);
+    put(data, -j << 8, 3);
+  }
+  put(data, 0x7f7f7f7f, 4);
+  SampleImporter importer;
+  import(importer, AudioInfo(44100, 2, 24), AudioInfo(44100, 2, 16), data, 64);
+  check(importer.frames() == 100, "frames before the incomplete frame");
+
+  data.clear();
+  for (int j = 0; j < 100; j++) {
+    put(data, j * 300, 2);
+    put(data, -j * 300, 2);
+  }
+  for (int run = 0; run < 2; run++) {
+    import(importer, AudioInfo(44100, 2, 16), AudioInfo(44100, 2, 16), data,
+           64);
+    check(importer.frames() == 100, "frames after an incomplete frame");
+    for (int j = 0; j < 100; j++) {
+      check(importer.samples()[2 * j] == j * 300, "left after partial");
+      check(importer.samples()[2 * j + 1] == -j * 300, "right after partial");
+    }
+  }
+}
+
+// import time of one second of audio
+void benchmark(const char *name, AudioInfo from) {
+  Vector<uint8_t> data;
+  int bytes = from.bits_per_sample / 8;
+  for (int j = 0; j < from.sample_rate * from.channels; j++) {
+    put(data, sin(j * 0.01) * ((1 << (bytes * 8 - 1)) - 1), bytes);
+  }
+  SampleImporter importer;
+  auto start = std::chrono::steady_clock::now();
+  import(importer, from, AudioInfo(44100, 2, 16), data, 512);
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  printf("%-24s %8.1f ns/frame %8u bytes\n", name, ns / importer.frames(),
+         (unsigned)importer.memoryUsed());
+}
+
+void setup() {
+  testExact();
+  testChannels();
+  testDither();
+  testSampleRate();
+  testLimit();
+  testAfterPartial();
+  benchmark("16 bit 44.1 kHz stereo", AudioInfo(44100, 2, 16));
+  benchmark("24 bit 44.1 kHz mono", AudioInfo(44100, 1, 24));
+  benchmark("24 bit 48 kHz stereo", AudioInfo(48000, 2, 24));
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
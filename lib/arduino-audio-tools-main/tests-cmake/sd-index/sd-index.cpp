@@ -0,0 +1,157 @@
+// Benchmark for the index lookup on a directory tree with 5000 files: we
+// compare the directory walk of AudioSourceSTD with the binary index table
+#include "AudioTools.h"
+#include "AudioTools/Disk/AudioSourceSTD.h"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+const int dir_count = 50;
+const int files_per_dir = 100;
+const int file_count = dir_count * files_per_dir;
+const int sample_count = 100;  // lookups w/o index are slow
+std::string root = (fs::temp_directory_path() / "sd-index-test").string();
+std::string music = root + "/music";
+
+void createFile(const std::string &path) { std::ofstream out(path); }
+
+void createTree() {
+  fs::remove_all(root);
+  fs::create_directories(music);
+  for (int d = 0; d < dir_count; d++) {
+    std::string dir = music + "/dir" + std::to_string(d);
+    fs::create_directories(dir);
+    for (int f = 0; f < files_per_dir; f++) {
+      createFile(dir + "/file" + std::to_string(f) + ".wav");
+    }
+  }
+}
+
+void report(const char *title, unsigned long us, int n) {
+  printf("%-32s %10lu us total %10.2f us/lookup\n", title, us,
+                (float)us / n);
+}
+
+// Names which sort after the indexed ones are appended to the text file:
+// the existing offsets stay valid and nothing is rebuilt
+void testAppend() {
+  std::string names = root + "/append.txt";
+  std::string table = root + "/append.bin";
+  SDIndexTable<FS, File> index{SD};
+  index.begin(names.c_str(), table.c_str(), 1);
+  index.beginRebuild();
+  for (int f = 0; f < 20; f++) index.println(("/a/file" + std::to_string(f) + ".wav").c_str());
+  if (!index.endUpdate() || index.size() != 20) {
+    printf("append: build failed\n");
+    exit(1);
+  }
+  std::string first = index[0];
+  uintmax_t size_before = fs::file_size(names);
+
+  // a new instance, as after a reboot: the table is loaded from the files
+  SDIndexTable<FS, File> reopened{SD};
+  if (!reopened.begin(names.c_str(), table.c_str(), 1)) {
+    printf("append: table not valid\n");
+    exit(1);
+  }
+  reopened.beginUpdate();
+  for (int f = 0; f < 20; f++) reopened.println(("/a/file" + std::to_string(f) + ".wav").c_str());
+  for (int f = 0; f < 5; f++) reopened.println(("/b/new" + std::to_string(f) + ".wav").c_str());
+  // true: appended, false would ask for a rebuild
+  if (!reopened.endUpdate()) {
+    printf("append: rebuilt instead of appended\n");
+    exit(1);
+  }
+  uintmax_t appended = 5 * strlen("/b/newN.wav\n");
+  if (reopened.size() != 25 || fs::file_size(names) != size_before + appended) {
+    printf("append: %ld entries, %u bytes\n", reopened.size(), (unsigned)fs::file_size(names));
+    exit(1);
+  }
+  if (first != reopened[0] || std::string("/b/new3.wav") != reopened[23] ||
+      reopened.indexOf("new4.wav") != 24 || reopened.indexOf("file7.wav") != 7) {
+    printf("append: lookup failed\n");
+    exit(1);
+  }
+}
+
+void setup() {
+  AudioToolsLogger.begin(Serial, AudioToolsLogLevel::Warning);
+  createTree();
+  testAppend();
+
+  // directory walk
+  AudioSourceSTD walk(music.c_str(), ".wav");
+  walk.begin();
+  unsigned long start = micros();
+  long size = walk.size();
+  report("walk: size()", micros() - start, 1);
+  if (size != file_count) {
+    printf("size: %ld, expected %d\n", size, file_count);
+    exit(1);
+  }
+  std::vector<std::string> expected;
+  start = micros();
+  for (int j = 0; j < sample_count; j++) {
+    walk.selectStream(j * (file_count / sample_count));
+    expected.push_back(walk.toStr());
+  }
+  report("walk: selectStream()", micros() - start, sample_count);
+
+  // index table
+  AudioSourceSTD indexed(music.c_str(), ".wav");
+  indexed.setIndexDirectory(root.c_str());
+  start = micros();
+  indexed.begin();
+  report("index: build", micros() - start, 1);
+  start = micros();
+  indexed.begin();
+  report("index: verify unchanged", micros() - start, 1);
+  if (indexed.size() != file_count) {
+    printf("size: %ld, expected %d\n", indexed.size(), file_count);
+    exit(1);
+  }
+  for (int j = 0; j < sample_count; j++) {
+    indexed.selectStream(j * (file_count / sample_count));
+    if (expected[j] != indexed.toStr()) {
+      printf("%d: %s != %s\n", j, indexed.toStr(), expected[j].c_str());
+      exit(1);
+    }
+  }
+  start = micros();
+  for (int j = 0; j < file_count; j++) {
+    indexed.selectStream(j);
+  }
+  report("index: selectStream()", micros() - start, file_count);
+  start = micros();
+  for (int j = 0; j < sample_count; j++) {
+    int idx = indexed.indexOf(expected[j].c_str());
+    if (idx != j * (file_count / sample_count)) {
+      printf("indexOf %s: %d\n", expected[j].c_str(), idx);
+      exit(1);
+    }
+  }
+  report("index: indexOf()", micros() - start, sample_count);
+
+  // new files are appended to the existing index if the file system reports
+  // them at the end; otherwise (as with the unsorted directory walk here) the
+  // index is rebuilt
+  std::string dir = music + "/new";
+  fs::create_directories(dir);
+  for (int f = 0; f < 10; f++) {
+    createFile(dir + "/new" + std::to_string(f) + ".wav");
+  }
+  start = micros();
+  indexed.begin();
+  report("index: update", micros() - start, 1);
+  if (indexed.size() != file_count + 10 || indexed.indexOf("new5.wav") < 0) {
+    printf("update failed: %ld\n", indexed.size());
+    exit(1);
+  }
+
+  fs::remove_all(root);
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,101 @@
+// Measures the zipper energy of a gain sweep which is updated at control rate
+// (every 30 ms): stepped vs. SmoothedParameter (Linear and OnePole)
+#include "AudioTools.h"
+#include <math.h>
+
+const float sample_rate = 44100;
+const int control_interval = 1323;  // 30 ms
+const int steps = 34;               // 0..1 in ~1 second
+
+// energy of the sample to sample changes of a 440 Hz sine scaled by the gain:
+// the part which is caused by the gain changes is the zipper noise
+float zipperEnergy(SmoothedParameter *param) {
+  float energy = 0;
+  float last = 0;
+  float gain = 0;
+  for (int j = 0; j < steps * control_interval; j++) {
+    if (j % control_interval == 0) {
+      float target = (float)(j / control_interval) / (steps - 1);
+      if (param == nullptr) {
+        gain = target;
+      } else {
+        param->setTarget(target);
+      }
+    }
+    if (param != nullptr) gain = param->next();
+    float sine = sinf(2.0f * M_PI * 440.0f * j / sample_rate);
+    float out = gain * sine;
+    // remove the change of the sine itself
+    float diff = (out - last) - gain * (sine - sinf(2.0f * M_PI * 440.0f * (j - 1) / sample_rate));
+    energy += diff * diff;
+    last = out;
+  }
+  return energy;
+}
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+void setup() {
+  float stepped = zipperEnergy(nullptr);
+
+  SmoothedParameter linear(0.0f, SmoothedParameter::Linear);
+  linear.begin(sample_rate, 20);
+  float linear_energy = zipperEnergy(&linear);
+
+  SmoothedParameter one_pole(0.0f, SmoothedParameter::OnePole);
+  one_pole.begin(sample_rate, 15);
+  float one_pole_energy = zipperEnergy(&one_pole);
+
+  printf("zipper energy stepped: %g\n", stepped);
+  printf("zipper energy linear:  %g (%.1f dB)\n", linear_energy,
+         10 * log10f(linear_energy / stepped));
+  printf("zipper energy onepole: %g (%.1f dB)\n", one_pole_energy,
+         10 * log10f(one_pole_energy / stepped));
+  check(linear_energy < stepped / 100, "linear smoothing");
+  check(one_pole_energy < stepped / 100, "one pole smoothing");
+
+  // settles exactly on the target and stops moving
+  for (int j = 0; j < sample_rate; j++) linear.next();
+  check(!linear.isSmoothing() && linear.value() == 1.0f, "linear settled");
+  for (int j = 0; j < sample_rate; j++) one_pole.next();
+  check(!one_pole.isSmoothing() && one_pole.value() == 1.0f, "one pole settled");
+
+  // per block evaluation matches the per sample evaluation
+  SmoothedParameter a(100.0f), b(100.0f);
+  a.begin(sample_rate, 20);
+  b.begin(sample_rate, 20);
+  a.setTarget(2000.0f);
+  b.setTarget(2000.0f);
+  for (int j = 0; j < 256; j++) a.next();
+  b.skip(256);
+  check(fabsf(a.value() - b.value()) < 0.01f, "linear skip");
+  a.setMode(SmoothedParameter::OnePole);
+  b.setMode(SmoothedParameter::OnePole);
+  a.setTarget(100.0f);
+  b.setTarget(100.0f);
+  for (int j = 0; j < 256; j++) a.next();
+  b.skip(256);
+  check(fabsf(a.value() - b.value()) < 0.1f, "one pole skip");
+
+  // a move with its own time constant does not change the smoothing time
+  SmoothedParameter once(1.0f, SmoothedParameter::OnePole);
+  SmoothedParameter reference(0.0f, SmoothedParameter::OnePole);
+  once.begin(sample_rate, 15);
+  reference.begin(sample_rate, 15);
+  once.setTarget(0.0f, 10);
+  for (int j = 0; j < 1000; j++) once.next();
+  check(!once.isSmoothing() && once.value() == 0.0f, "own time constant");
+  once.setTarget(1.0f);
+  reference.setTarget(1.0f);
+  for (int j = 0; j < 100; j++) check(once.next() == reference.next(), "smoothing time kept");
+
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
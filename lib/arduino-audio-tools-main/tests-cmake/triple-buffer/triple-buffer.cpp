@@ -0,0 +1,67 @@
+// TripleBuffer: the reader gets the latest published value, published values
+// are skipped but never torn, also while another thread publishes
+#include "AudioTools.h"
+#include "AudioTools/Concurrency/LockFree.h"
+#include <thread>
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// every field is derived from seq: a mix of two values is detected
+struct Value {
+  uint32_t seq = 0;
+  uint32_t data[63] = {0};
+};
+
+bool isConsistent(const Value &value) {
+  for (int j = 0; j < 63; j++) {
+    if (value.data[j] != value.seq * 3 + j) return false;
+  }
+  return true;
+}
+
+void setup() {
+  TripleBuffer<int> buffer(7);
+  check(!buffer.update() && buffer.front() == 7, "initial");
+  buffer.write(1);
+  buffer.write(2);
+  check(buffer.update() && buffer.front() == 2, "latest wins");
+  check(!buffer.update() && buffer.front() == 2, "read once");
+  buffer.back() = 3;
+  check(!buffer.update(), "not before publish()");
+  buffer.publish();
+  int value = 0;
+  check(buffer.read(value) && value == 3, "read");
+
+  // one writer and one reader thread
+  const uint32_t count = 2000000;
+  TripleBuffer<Value> values;
+  std::thread writer([&] {
+    for (uint32_t seq = 1; seq <= count; seq++) {
+      Value &next = values.back();
+      next.seq = seq;
+      for (int j = 0; j < 63; j++) next.data[j] = seq * 3 + j;
+      values.publish();
+    }
+  });
+  uint32_t last = 0, reads = 0;
+  while (last < count) {
+    if (!values.update()) continue;
+    const Value &current = values.front();
+    check(isConsistent(current), "torn value");
+    check(current.seq > last, "older value");
+    last = current.seq;
+    reads++;
+  }
+  writer.join();
+  check(!values.update(), "nothing left");
+  printf("%u of %u values read\n", (unsigned)reads, (unsigned)count);
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,183 @@
+// Measures the quality (THD+N against the ideal resampled sine, aliasing of a
+// high tone one octave up) and the processing time of the VarispeedResampler
+// kernels
+#include "AudioTools.h"
+#include <chrono>
+#include <math.h>
+#include <vector>
+
+const float sample_rate = 44100;
+const int in_frames = 44100;
+const char *names[] = {"linear", "hermite", "sinc"};
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+// resamples a stereo sine in blocks of 256 input frames
+int resample(VarispeedResampler &rs, float freq, float step, float amplitude,
+             Vector<int16_t> &out) {
+  static int16_t input[in_frames * 2];
+  for (int j = 0; j < in_frames; j++) {
+    int16_t value = lround(amplitude * sin(2.0 * M_PI * freq * j / sample_rate));
+    input[2 * j] = input[2 * j + 1] = value;
+  }
+  rs.reset();
+  rs.setStep(step);
+  out.resize(in_frames * 2 * 16);
+  int produced = 0;
+  for (int j = 0; j < in_frames; j += 256) {
+    const int16_t *in = input + 2 * j;
+    size_t frames = in_frames - j < 256 ? in_frames - j : 256;
+    size_t n;
+    while ((n = rs.process(in, frames, out.data() + 2 * produced, 128)) > 0) {
+      produced += n;
+      frames = 0;
+    }
+  }
+  return produced;
+}
+
+// error against the ideal output sin(w * n * step) in dB relative to the
+// signal
+float thdn(VarispeedResampler::Kernel kernel, float freq, float step) {
+  VarispeedResampler rs;
+  rs.begin(2, kernel, 2.0f);
+  Vector<int16_t> out;
+  const float amplitude = 16000;
+  int produced = resample(rs, freq, step, amplitude, out);
+  double signal = 0, noise = 0;
+  // skip the start
+  for (int n = 200; n < produced - 200; n++) {
+    double ideal = amplitude * sin(2.0 * M_PI * freq * n * (double)step / sample_rate);
+    double error = out[2 * n] - ideal;
+    signal += ideal * ideal;
+    noise += error * error;
+  }
+  return 10.0f * log10(noise / signal);
+}
+
+// a 15 kHz tone one octave up is above Nyquist: everything in the output is
+// aliasing
+float aliasing(VarispeedResampler::Kernel kernel) {
+  VarispeedResampler rs;
+  rs.begin(2, kernel, 2.0f);
+  Vector<int16_t> out;
+  const float amplitude = 16000;
+  int produced = resample(rs, 15000, 2.0f, amplitude, out);
+  double energy = 0;
+  for (int n = 200; n < produced - 200; n++) energy += (double)out[2 * n] * out[2 * n];
+  energy /= (produced - 400);
+  return 10.0f * log10(energy / (amplitude * amplitude / 2));
+}
+
+float nsPerFrame(VarispeedResampler::Kernel kernel, float step) {
+  VarispeedResampler rs;
+  rs.begin(2, kernel, 2.0f);
+  Vector<int16_t> out;
+  auto start = std::chrono::steady_clock::now();
+  int produced = 0;
+  for (int j = 0; j < 10; j++) produced += resample(rs, 440, step, 16000, out);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / produced;
+}
+
+void testGlide() {
+  VarispeedResampler rs;
+  rs.begin(1, VarispeedResampler::Sinc, 2.0f);
+  rs.setStep(1.5f, 1000);
+  check(rs.isRamping(), "ramping");
+  int16_t in[4000] = {0}, out[4000];
+  size_t produced = rs.process(in, 4000, out, 4000);
+  check(!rs.isRamping() && rs.getStep() == 1.5f, "glide reaches the target");
+  // 1000 frames with an average step of 1.25, then 1.5
+  size_t expected = 1000 + (4000 - rs.latency() - 1250) / 1.5f;
+  check(abs((int)produced - (int)expected) <= 2, "glide length");
+
+  // a step of 1 only delays the input
+  VarispeedResampler copy;
+  copy.begin(1, VarispeedResampler::Hermite);
+  for (int j = 0; j < 4000; j++) in[j] = j;
+  produced = copy.process(in, 4000, out, 4000);
+  check(produced == 4000 - copy.latency(), "identity length");
+  for (size_t j = 0; j < produced; j++) check(out[j] == in[j], "identity");
+}
+
+// output which accepts at most limit bytes per call and nothing on every
+// third call
+class LimitedOutput : public Print {
+ public:
+  LimitedOutput(size_t limit) : limit(limit) {}
+  size_t write(uint8_t ch) override { return write(&ch, 1); }
+  size_t write(const uint8_t *data, size_t len) override {
+    if (limit > 0 && ++calls % 3 == 0) return 0;
+    if (limit > 0 && len > limit) len = limit;
+    data_bytes.insert(data_bytes.end(), data, data + len);
+    return len;
+  }
+  std::vector<uint8_t> data_bytes;
+
+ protected:
+  size_t limit;
+  int calls = 0;
+};
+
+void testLimitedOutput() {
+  int16_t in[2 * 3000];
+  for (int j = 0; j < 3000; j++) in[2 * j] = in[2 * j + 1] = j * 7;
+  LimitedOutput all(0), limited(37);
+  VarispeedStream stream_all(all), stream_limited(limited);
+  AudioInfo info(44100, 2, 16);
+  stream_all.begin(info);
+  stream_limited.begin(info);
+  stream_all.setSpeed(1.0595f);
+  stream_limited.setSpeed(1.0595f);
+  const uint8_t *data = (const uint8_t *)in;
+  check(stream_all.write(data, sizeof(in)) == sizeof(in), "unlimited write");
+  size_t used = 0;
+  for (int j = 0; j < 10000 && used < sizeof(in); j++) {
+    size_t len = sizeof(in) - used < 1000 ? sizeof(in) - used : 1000;
+    size_t result = stream_limited.write(data + used, len);
+    check(result <= len && result % 4 == 0, "used input");
+    used += result;
+  }
+  check(used == sizeof(in), "all input used");
+  // the pending output is passed on by the next write
+  for (int j = 0; j < 100; j++) stream_limited.write(data, 0);
+  check(all.data_bytes.size() > 10000, "output");
+  check(limited.data_bytes == all.data_bytes, "same output");
+}
+
+void setup() {
+  testGlide();
+  testLimitedOutput();
+  float steps[] = {0.749f, 1.0595f, 1.5f};
+  VarispeedResampler::Kernel kernels[] = {VarispeedResampler::Linear,
+                                          VarispeedResampler::Hermite,
+                                          VarispeedResampler::Sinc};
+  float low[3][3], high[3];
+  printf("THD+N of 1 kHz at -5, +1 and +7 semitones, 8 kHz at +1 semitone\n");
+  printf("%-8s %10s %10s %10s %10s %10s %10s\n", "kernel", "1k -5", "1k +1",
+         "1k +7", "8k +1", "aliasing", "ns/frame");
+  for (int k = 0; k < 3; k++) {
+    for (int s = 0; s < 3; s++) low[k][s] = thdn(kernels[k], 1000, steps[s]);
+    high[k] = thdn(kernels[k], 8000, steps[1]);
+    printf("%-8s %7.1f dB %7.1f dB %7.1f dB %7.1f dB %7.1f dB %10.1f\n",
+           names[k], low[k][0], low[k][1], low[k][2], high[k],
+           aliasing(kernels[k]), nsPerFrame(kernels[k], 1.0595f));
+  }
+  for (int s = 0; s < 3; s++) {
+    check(low[1][s] < low[0][s], "hermite better than linear");
+    check(low[2][s] < -80, "sinc at 1 kHz");
+  }
+  check(high[1] < high[0], "hermite better than linear at 8 kHz");
+  check(high[2] < high[1], "sinc better than hermite at 8 kHz");
+  check(aliasing(VarispeedResampler::Sinc) < -60, "sinc aliasing");
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,122 @@
+// Checks that the WAV decoder reads the loop of a 'smpl' chunk in front of
+// the data, that parseSampleChunk() reads a chunk behind the data and that
+// the chunk behind the data is not output as audio
+#include "AudioTools.h"
+#include "AudioTools/AudioCodecs/CodecWAV.h"
+
+void check(bool ok, const char *msg) {
+  if (!ok) {
+    printf("failed: %s\n", msg);
+    exit(1);
+  }
+}
+
+Vector<uint8_t> file;
+
+class CountingOutput : public Print {
+ public:
+  size_t count = 0;
+  size_t write(const uint8_t *data, size_t len) override {
+    count += len;
+    return len;
+  }
+  size_t write(uint8_t) override { return 1; }
+};
+
+void add(const char *tag) {
+  for (int j = 0; j < 4; j++) {
+    uint8_t value = tag[j];
+    file.push_back(value);
+  }
+}
+
+void add16(uint32_t value) {
+  for (int j = 0; j < 2; j++) {
+    uint8_t byte = (value >> (8 * j)) & 0xFF;
+    file.push_back(byte);
+  }
+}
+
+void add32(uint32_t value) {
+  add16(value & 0xFFFF);
+  add16(value >> 16);
+}
+
+// sampler chunk with one loop
+void addSmpl(uint32_t type, uint32_t start, uint32_t end) {
+  add("smpl");
+  add32(60);
+  for (int j = 0; j < 7; j++) add32(0);  // manufacturer .. smpte offset
+  add32(1);                              // number of loops
+  add32(0);                              // sampler data
+  add32(0);                              // cue id
+  add32(type);
+  add32(start);
+  add32(end);
+  add32(0);  // fraction
+  add32(0);  // play count: infinite
+}
+
+void wav(bool smplFirst, int frames) {
+  file.clear();
+  add("RIFF");
+  add32(4 + 24 + 68 + 8 + frames * 2);
+  add("WAVE");
+  add("fmt ");
+  add32(16);
+  add16(1);  // PCM
+  add16(1);
+  add32(44100);
+  add32(88200);
+  add16(2);
+  add16(16);
+  if (smplFirst) addSmpl(1, 100, 899);
+  add("data");
+  add32(frames * 2);
+  for (int j = 0; j < frames; j++) add16(j);
+  if (!smplFirst) addSmpl(0, 200, 799);
+}
+
+void setup() {
+  CountingOutput out;
+  WAVDecoder decoder;
+  decoder.setOutput(out);
+
+  // in front of the data: part of the header
+  wav(true, 1000);
+  decoder.begin();
+  decoder.write(file.data(), file.size());
+  WAVAudioInfo &info = decoder.audioInfoEx();
+  check(info.has_loop, "loop found");
+  check(info.loop_type == 1 && info.loop_start == 100 && info.loop_end == 899,
+        "loop values");
+  check(info.data_start == 12 + 24 + 68 + 8, "data start");
+
+  // behind the data: the header has no loop
+  wav(false, 1000);
+  decoder.begin();
+  out.count = 0;
+  for (size_t pos = 0; pos < file.size(); pos += 100) {
+    size_t len = min((size_t)100, file.size() - pos);
+    check(decoder.write(file.data() + pos, len) == len, "consumed");
+  }
+  check(out.count == 2000, "only the data chunk is output");
+  check(!decoder.audioInfoEx().has_loop, "no loop in header");
+  size_t chunk = decoder.audioInfoEx().data_start + 2000;
+  check(memcmp(file.data() + chunk, "smpl", 4) == 0, "chunk position");
+  WAVAudioInfo trailing;
+  check(WAVHeader::parseSampleChunk(file.data() + chunk + 8,
+                                    file.size() - chunk - 8, trailing),
+        "parse trailing");
+  check(trailing.loop_type == 0 && trailing.loop_start == 200 &&
+            trailing.loop_end == 799,
+        "trailing values");
+  WAVAudioInfo truncated;
+  check(!WAVHeader::parseSampleChunk(file.data() + chunk + 8, 20, truncated) &&
+            !truncated.has_loop,
+        "short chunk");
+  printf("ok\n");
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,32 @@
+// Global operator new and delete which report to the AllocationGuard: with
+// USE_ALLOCATION_GUARD the allocations of the audio loop which do not go
+// through an Allocator (String, std::vector ...) are counted as well. In a
+// translation unit of their own, so that the compiler does not inline them
+// into callers and match new against free().
+#include <AudioToolsConfig.h>
+#include "AudioTools/CoreAudio/AllocationGuard.h"
+
+#if USE_ALLOCATION_GUARD
+#include <cstdlib>
+#include <new>
+
+using audio_tools::AllocationGuard;
+
+static void* allocate(size_t size, bool abortOnFailure) {
+  AllocationGuard::instance().onAllocate(size);
+  void* result = malloc(size == 0 ? 1 : size);
+  if (result == nullptr && abortOnFailure) abort();
+  return result;
+}
+
+static void release(void* memory) { free(memory); }
+
+void* operator new(size_t size) { return allocate(size, true); }
+void* operator new[](size_t size) { return allocate(size, true); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, false); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, false); }
+void operator delete(void* memory) noexcept { release(memory); }
+void operator delete[](void* memory) noexcept { release(memory); }
+void operator delete(void* memory, size_t) noexcept { release(memory); }
+void operator delete[](void* memory, size_t) noexcept { release(memory); }
+#endif
@@ -0,0 +1,603 @@
+#include "audio_engine.h"
+
+#include <SD.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Arenas of the mixer and varispeed blocks (internal RAM) and of the delay and
+// reverb lines (PSRAM): defined first, so that they are released after them
+AudioMemory audioMemory;
+// Audio stack
+AudioSourceSD source("/", "wav");
+WAVDecoder wavDecoder;
+DryWetMixerStream mixerStream;
+VarispeedStream varispeed;
+AudioPlayer player(source, varispeed, wavDecoder);
+Delay delayEffect;
+// The impulse response alternates between two convolvers: one plays while
+// the sample loader fills the other
+FFTDriverRealFFT convolverFft;
+FFTConvolver convolver(convolverFft, CONVOLVER_BLOCK_FRAMES);
+FFTDriverRealFFT convolverSpareFft;
+FFTConvolver convolverSpare(convolverSpareFft, CONVOLVER_BLOCK_FRAMES);
+Reverb reverb(REVERB_RAM_BUDGET_BYTES);
+// Button samples in the output format; files which do not fit are streamed
+// by the player
+SampleBank sampleBank;
+SampleVoice sampleVoice;
+// Slice points of the samples; in chop mode the buttons play the slices of
+// one file (slot 0 of the bank)
+SampleManifest manifest;
+ManifestEntry* chopEntry = nullptr;
+// Takes of the pads; saved by the sample loader
+SampleRecorder sampleRecorder;
+static Stream* recordInput = nullptr;
+// after the bank, the manifest, the convolvers and the recorder: its task
+// stops first
+SampleLoader sampleLoader;
+// MIDI: the event which is due in a later block waits here
+MidiInput midiInput;
+TempoSync tempoSync;
+static MidiEvent midiEvent;
+static bool midiEventHeld = false;
+static uint64_t (*audioClock)() = nullptr;
+// Clock at frame 0 of the mixer (see updateFrameClock())
+static int64_t frameZeroUs = 0;
+static bool frameClockValid = false;
+static uint32_t audioSampleRate = 44100;
+static EffectParams* midiParams = nullptr;
+static void (*midiParamsChanged)() = nullptr;
+static int midiPad = -1;
+static MidiTiming timing;
+// File position where a streamed slice ends (0: play to the end)
+static uint32_t streamedSliceEnd = 0;
+static char playingPath[MANIFEST_PATH_LEN] = "";
+// Files of the buttons (/1.wav or e.g. /1.mp3), found by loadSampleBank()
+static char bankPaths[BUTTON_COUNT][MANIFEST_PATH_LEN] = {};
+DryWetMixerStream* DryWetMixerStream::s_instance = nullptr;
+
+// Reserves the block arena and the line arena for the delay line (at its max
+// duration) and the reverb lines, and places the effects in them. When an
+// arena is not available its users are allocated from the heap as before.
+static void beginAudioMemory(uint32_t sampleRate) {
+  size_t delayBytes = static_cast<size_t>(sampleRate * DELAY_TIME_MAX_MS / 1000) * sizeof(effect_t);
+  // the arena adds a header of 8 bytes to each of the reverb lines
+  audioMemory.begin(AUDIO_BLOCK_ARENA_BYTES, delayBytes + REVERB_RAM_BUDGET_BYTES + 1024);
+  delayEffect.setSampleRate(sampleRate);
+  delayEffect.setMaxDuration(static_cast<uint16_t>(DELAY_TIME_MAX_MS));
+  delayEffect.setAllocator(audioMemory.lines());
+  reverb.setAllocator(audioMemory.lines());
+  mixerStream.setAllocator(audioMemory.blocks());
+  varispeed.setAllocator(audioMemory.blocks());
+  audioMemory.add("delay line", audioMemory.lineRegion(), delayBytes);
+}
+
+void initAudio(AudioStream& output, AudioInfo info, const EffectParams& params) {
+  uint32_t effectiveSampleRate = info.sample_rate > 0 ? info.sample_rate : 44100;
+  audioSampleRate = effectiveSampleRate;
+  beginAudioMemory(effectiveSampleRate);
+  mixerStream.begin(output, delayEffect);
+  AudioInfo mixInfo;
+  mixInfo.sample_rate = effectiveSampleRate;
+  mixInfo.channels = info.channels > 0 ? info.channels : 2;
+  mixInfo.bits_per_sample = info.bits_per_sample > 0 ? info.bits_per_sample : 16;
+  mixerStream.setAudioInfo(mixInfo);
+  mixerStream.updateEffectSampleRate(effectiveSampleRate);
+  reverb.setRoomSize(REVERB_ROOM_SIZE);
+  reverb.setDamping(REVERB_DAMPING);
+  reverb.setWidth(REVERB_WIDTH);
+  reverb.setLevel(REVERB_LEVEL);
+  if (reverb.begin(effectiveSampleRate)) {
+    mixerStream.setReverb(&reverb);
+    Serial.printf("Reverb: %u bytes\n", static_cast<unsigned>(reverb.memoryUsed()));
+    audioMemory.add("reverb", audioMemory.lineRegion(), reverb.memoryUsed());
+  }
+  mixerStream.setParams(params);
+  varispeed.setKernel(PITCH_HIGH_QUALITY ? VarispeedResampler::Sinc
+                                         : VarispeedResampler::Hermite);
+  varispeed.setMaxSpeed(powf(2.0f, PITCH_MAX_SEMITONES / 12.0f));
+  varispeed.setOutput(mixerStream);
+  varispeed.begin(mixInfo);
+  player.setOutput(varispeed);
+  player.setSilenceOnInactive(true);
+  player.setDelayIfOutputFull(0);
+  player.setFadeTime(BUTTON_FADE_MS);
+  player.begin();
+  player.stop();
+  // after begin(), which takes it from the source: at the end of a streamed
+  // sample the player must not open the next file in the audio loop
+  player.setAutoNext(false);
+  sampleVoice.begin(varispeed, mixInfo, BUTTON_FADE_MS);
+  // the take is in the format of the bank, which is the mix format
+  size_t recordBytes = ESP.getPsramSize() > 0 ? RECORD_BUFFER_BYTES : RECORD_BUFFER_NO_PSRAM;
+  if (sampleRecorder.begin(mixInfo, recordBytes / (mixInfo.channels * sizeof(int16_t)))) {
+    mixerStream.setTap(&sampleRecorder);
+    audioMemory.add("record buffer", AudioMemory::heapRegion(), recordBytes);
+  }
+  audioMemory.add("audio blocks", MemoryRegion::Internal, audioMemory.blocks().used());
+#if USE_AUDIO_PROFILER
+  // One copy() moves DEFAULT_BUFFER_SIZE bytes of 16 bit PCM: the time budget
+  // for the whole chain is the playback duration of that block.
+  uint32_t frameBytes = mixInfo.channels * (mixInfo.bits_per_sample / 8);
+  AudioProfiler::instance().setBudgetUs(
+      1000000ull * (DEFAULT_BUFFER_SIZE / frameBytes) / effectiveSampleRate);
+#endif
+#if USE_ALLOCATION_GUARD
+  AllocationGuard::instance().setTrap(ALLOCATION_GUARD_TRAP);
+#endif
+}
+
+void printAudioMemoryReport(Print& out) {
+  audioMemory.printUsage(out);
+#if USE_ALLOCATION_GUARD
+  AllocationGuard& guard = AllocationGuard::instance();
+  out.printf("Allocations in the audio loop: %u (%u bytes, max %u)\n",
+             static_cast<unsigned>(guard.count()),
+             static_cast<unsigned>(guard.bytes()),
+             static_cast<unsigned>(guard.maxSize()));
+#endif
+}
+
+// The IR is shortened to what fits in the largest free PSRAM (or heap) block.
+void initConvolver() {
+  if (!SD.exists(CONVOLVER_IR_PATH)) return;
+  bool hasPsram = ESP.getPsramSize() > 0;
+  size_t available = hasPsram ? ESP.getMaxAllocPsram() : ESP.getMaxAllocHeap() / 2;
+  size_t maxFrames = CONVOLVER_MAX_IR_FRAMES;
+  // two spectra blocks plus the temporary float copy of the IR
+  while (maxFrames > CONVOLVER_BLOCK_FRAMES &&
+         FFTConvolver::memoryNeeded(maxFrames, CONVOLVER_BLOCK_FRAMES) / 2 +
+                 maxFrames * sizeof(float) > available) {
+    maxFrames /= 2;
+  }
+  sampleLoader.loadImpulseResponse(CONVOLVER_IR_PATH, maxFrames);
+}
+
+// Playback does not depend on the SD card for the samples that fit.
+void initSampleBank(const char* const paths[BUTTON_COUNT]) {
+  bool hasPsram = ESP.getPsramSize() > 0;
+  sampleBank.begin(varispeed.audioInfo(), hasPsram ? SAMPLE_CACHE_BUDGET_BYTES
+                                                   : SAMPLE_CACHE_BUDGET_NO_PSRAM);
+  manifest.load();
+  const char* chop = manifest.chopPath();
+  if (chop != nullptr) chopEntry = manifest.add(chop);
+  sampleLoader.setRecorder(sampleRecorder);
+  sampleLoader.begin(sampleBank, manifest, convolver, convolverSpare);
+  loadSampleBank(paths);
+}
+
+void loadSampleBank(const char* const paths[BUTTON_COUNT]) {
+  sampleLoader.cancelAll();
+  if (chopEntry != nullptr) {
+    // the whole budget goes to the chop file; slices are detected once
+    sampleLoader.loadSample(0, chopEntry->path);
+    return;
+  }
+  for (size_t i = 0; i < BUTTON_COUNT; ++i) {
+    // empty paths clear what a previous bank left in the slot
+    bankPaths[i][0] = '\0';
+    if (paths[i] != nullptr && paths[i][0] != '\0') {
+      SampleBank::findFile(paths[i], bankPaths[i], MANIFEST_PATH_LEN);
+      sampleLoader.loadSample(i, bankPaths[i]);
+    } else if (sampleBank.get(i) != nullptr) {
+      sampleLoader.loadSample(i, "");
+    }
+  }
+}
+
+// A sample which is still played fades out first; a sample which could not be
+// loaded leaves the slot empty, so that the button streams from the SD card
+// (PCM WAV only).
+static bool publishSample(const LoadRequest& done) {
+  SampleSlot* slot = sampleBank.get(done.slot);
+  if (slot != nullptr && sampleVoice.uses(*slot)) {
+    sampleVoice.stop();
+    return false;
+  }
+  // the limit was counted when the request was queued: when other slots
+  // have grown since, the sample is loaded again with what is left now
+  if (sampleLoader.readyLoaded() &&
+      sampleLoader.stagingSlot().bytes() > sampleBank.budgetLeft(done.slot)) {
+    sampleLoader.loadSample(done.slot, done.path);
+    return true;
+  }
+  sampleBank.publish(done.slot, sampleLoader.stagingSlot());
+  if (!sampleLoader.readyLoaded() && done.path[0] != '\0') {
+    if (sampleBank.isStreamable(done.slot, done.path)) {
+      Serial.printf("Sample %s past niet in het geheugen, wordt gestreamd\n", done.path);
+    } else {
+      Serial.printf("Sample %s kon niet geladen worden\n", done.path);
+    }
+  }
+  if (chopEntry != nullptr && done.slot == 0) {
+    // the slices of the import, which release() copies to chopEntry
+    Serial.printf("Chop %s: %u slices\n", chopEntry->path,
+                  static_cast<unsigned>(done.entry.sliceCount));
+  }
+  return true;
+}
+
+static void publishImpulseResponse(const LoadRequest& done) {
+  if (!sampleLoader.readyLoaded()) {
+    Serial.printf("Kon impulsrespons %s niet laden\n", done.path);
+    return;
+  }
+  FFTConvolver& ir = sampleLoader.stagingConvolver();
+  mixerStream.setWetStage(&ir);
+  Serial.printf("Convolver: %u samples IR (%s)\n", static_cast<unsigned>(ir.size()),
+                ESP.getPsramSize() > 0 ? "PSRAM" : "RAM");
+  audioMemory.add("convolver IR", AudioMemory::heapRegion(),
+                  FFTConvolver::memoryNeeded(ir.size(), CONVOLVER_BLOCK_FRAMES));
+}
+
+bool updateSampleLoader() {
+  static bool reportDue = false;
+  static bool mapPrinted = false;
+  const LoadRequest* done = sampleLoader.ready();
+  if (done != nullptr) {
+    if (done->kind == LoadKind::ImpulseResponse) {
+      publishImpulseResponse(*done);
+    } else if (!publishSample(*done)) {
+      return true;
+    }
+    sampleLoader.release();
+    reportDue = true;
+  }
+  bool busy = sampleLoader.status().busy;
+  if (!busy && reportDue) {
+    sampleBank.printReport(Serial);
+    audioMemory.add("sample cache", AudioMemory::heapRegion(), sampleBank.memoryUsed());
+    // the memory map at boot, once everything is loaded
+    if (!mapPrinted) audioMemory.printMap(Serial);
+    mapPrinted = true;
+    reportDue = false;
+  }
+  return busy;
+}
+
+bool isSamplePlaying() {
+  return player.isActive() || sampleVoice.isActive();
+}
+
+void releaseSample() {
+  if (player.isActive()) player.stop();
+  sampleVoice.noteOff();
+}
+
+const char* playingSamplePath() {
+  return playingPath;
+}
+
+// From RAM: the slot is already in the output format. The varispeed is not
+// reset, so that the fade out of a retriggered sample continues seamlessly.
+static void prepareRamPlayback(size_t idx) {
+  if (player.isActive()) player.stop();
+  if (varispeed.audioInfo() != sampleBank.audioInfo()) {
+    varispeed.setAudioInfo(sampleBank.audioInfo());
+    varispeed.reset();
+  }
+  varispeed.setSemitones(BUTTON_PITCH_SEMITONES[idx]);
+}
+
+// Opens a file in the player and moves to a byte offset in the PCM data: the
+// decoder gets the header as usual, then the file (AudioSourceSD) seeks.
+static bool startStreamedSlice(const ManifestEntry& entry, uint32_t startByte) {
+  if (!player.setPath(entry.path)) return false;
+  File* file = static_cast<File*>(player.getStream());
+  uint8_t header[64];
+  uint32_t remaining = entry.dataStart;
+  while (remaining > 0) {
+    size_t n = remaining < sizeof(header) ? remaining : sizeof(header);
+    int len = file->read(header, n);
+    if (len <= 0) return false;
+    wavDecoder.write(header, len);
+    remaining -= len;
+  }
+  return file->seek(startByte);
+}
+
+// Chop mode: button idx plays slice idx of the chop file, from RAM without
+// any seek or from the SD card at the precomputed byte offset.
+static bool playSlice(size_t idx) {
+  uint32_t start = 0, end = 0;
+  SampleSlot* slot = sampleBank.get(0);
+  if (slot != nullptr) {
+    if (!chopEntry->sliceFrames(idx, sampleBank.audioInfo().sample_rate, start, end)) {
+      return false;
+    }
+    prepareRamPlayback(idx);
+    sampleVoice.play(*slot, start, end);
+  } else {
+    if (!chopEntry->sliceBytes(idx, start, end)) return false;
+    if (!startStreamedSlice(*chopEntry, start)) {
+      Serial.printf("Kon slice %u van %s niet starten\n",
+                    static_cast<unsigned>(idx + 1), chopEntry->path);
+      return false;
+    }
+    sampleVoice.stop();
+    varispeed.reset();
+    varispeed.setSemitones(BUTTON_PITCH_SEMITONES[idx]);
+    player.play();
+    streamedSliceEnd = end;
+  }
+  snprintf(playingPath, sizeof(playingPath), "%s", chopEntry->path);
+  return true;
+}
+
+bool playSample(size_t idx, const char* path) {
+  if (idx >= BUTTON_COUNT) return false;
+  if (chopEntry != nullptr) return playSlice(idx);
+  if (bankPaths[idx][0] != '\0') path = bankPaths[idx];
+  SampleSlot* slot = sampleBank.get(idx);
+  if (slot != nullptr) {
+    prepareRamPlayback(idx);
+    sampleVoice.play(*slot);
+  } else {
+    // not loaded yet: streamed now, loaded next
+    if (sampleLoader.isPending(idx)) sampleLoader.loadSample(idx, path, LOAD_PRIORITY_PRESSED);
+    // the other formats only play once they are decoded
+    if (!sampleBank.isStreamable(idx, path)) return false;
+    if (!player.setPath(path)) {
+      Serial.printf("Kon bestand %s niet openen\n", path);
+      return false;
+    }
+    sampleVoice.stop();
+    varispeed.reset();
+    varispeed.setSemitones(BUTTON_PITCH_SEMITONES[idx]);
+    player.play();
+    streamedSliceEnd = 0;
+  }
+  snprintf(playingPath, sizeof(playingPath), "%s", path);
+  return true;
+}
+
+bool startRecording(size_t idx, RecordSource from) {
+  if (idx >= BUTTON_COUNT || chopEntry != nullptr || !sampleRecorder.isAvailable()) return false;
+  if (from == RecordSource::Input && recordInput == nullptr) return false;
+  if (!sampleRecorder.start(idx, from)) return false;
+  // a load which finishes later must not replace the take
+  sampleLoader.cancel(idx);
+  return true;
+}
+
+void stopRecording() {
+  sampleRecorder.stop();
+}
+
+void setRecordInput(Stream* input) {
+  recordInput = input;
+}
+
+void setAudioClock(uint64_t (*clockUs)()) {
+  audioClock = clockUs;
+  frameClockValid = false;
+}
+
+void setMidiEffectParams(EffectParams* params, void (*changed)()) {
+  midiParams = params;
+  midiParamsChanged = changed;
+}
+
+const MidiTiming& midiTiming() {
+  return timing;
+}
+
+void resetMidiTiming() {
+  timing = MidiTiming();
+}
+
+void printMidiReport(Print& out) {
+  if (timing.notes == 0) {
+    out.printf("MIDI: no notes (%u lost)\n", static_cast<unsigned>(midiInput.overflows()));
+    return;
+  }
+  double mean = static_cast<double>(timing.sumUs) / timing.notes;
+  double variance = static_cast<double>(timing.sumSquaresUs) / timing.notes - mean * mean;
+  out.printf("MIDI: %u notes, scheduling lateness %.1f us (%d..%d, std dev %.1f us) "
+             "after %u us, %u late, %u lost\n",
+             static_cast<unsigned>(timing.notes), mean, static_cast<int>(timing.minUs),
+             static_cast<int>(timing.maxUs), sqrt(variance > 0 ? variance : 0),
+             static_cast<unsigned>(MIDI_SCHEDULE_LATENCY_US), static_cast<unsigned>(timing.late),
+             static_cast<unsigned>(midiInput.overflows()));
+}
+
+static uint64_t audioClockUs() {
+  return audioClock != nullptr ? audioClock() : micros();
+}
+
+void tapTempo() {
+  tempoSync.tap(audioClockUs());
+}
+
+void printTempoReport(Print& out) {
+  static const char* const kSources[] = {"none", "tap", "MIDI clock"};
+  double samples = tempoSync.delaySamples(audioSampleRate);
+  out.printf("Tempo: %.2f bpm (%s), delay %s = %.2f samples (%.3f ms)\n", tempoSync.bpm(),
+             kSources[static_cast<int>(tempoSync.source())],
+             TempoSync::divisionName(tempoSync.getDivision()), samples,
+             samples * 1000.0 / audioSampleRate);
+}
+
+// With a tempo the delay time is the beat division: published when it moved
+// by more than DELAY_SYNC_DEADBAND_SAMPLES, the delay line glides there. The
+// params carry it in ms for the display, the delay gets the exact samples.
+static void updateTempo(uint64_t nowUs) {
+  tempoSync.setClockBpm(midiInput.clockBpm(nowUs));
+  if (midiParams == nullptr || !tempoSync.isSynced()) return;
+  double samples = tempoSync.delaySamples(audioSampleRate);
+  double current = static_cast<double>(midiParams->delayTimeMs) * audioSampleRate / 1000.0;
+  if (fabs(samples - current) < DELAY_SYNC_DEADBAND_SAMPLES) return;
+  midiParams->delayTimeMs = static_cast<float>(samples * 1000.0 / audioSampleRate);
+  mixerStream.setParams(*midiParams);
+  mixerStream.setDelaySamples(samples);
+  if (midiParamsChanged != nullptr) midiParamsChanged();
+}
+
+static int64_t framesToUs(uint64_t frames) {
+  return static_cast<int64_t>(frames * 1000000ull / audioSampleRate);
+}
+
+// The clock at frame 0 of the mixer. processAudio() may start late (display,
+// buttons, a blocking write), never early: the smallest offset is the right
+// one. It may grow by 1 us per block for the drift between the two clocks.
+static void updateFrameClock(uint64_t nowUs) {
+  int64_t offset = static_cast<int64_t>(nowUs) - framesToUs(mixerStream.framesMixed());
+  frameZeroUs = frameClockValid ? std::min(offset, frameZeroUs + 1) : offset;
+  frameClockValid = true;
+}
+
+// Renders up to the frame in shorter blocks than usual. The player copies
+// whole buffers only: while a sample streams from the SD card the event
+// starts at the end of the last block instead.
+static void renderUntil(uint64_t frame) {
+  AUDIO_PROFILE_SCOPE("copy");
+  while (mixerStream.framesMixed() < frame && !player.isActive()) {
+    uint64_t before = mixerStream.framesMixed();
+    size_t frames = static_cast<size_t>(std::min<uint64_t>(frame - before, SAMPLE_VOICE_BLOCK_FRAMES));
+    if (sampleVoice.isActive()) {
+      sampleVoice.copy(frames);
+    } else {
+      mixerStream.pumpSilenceFrames(frames);
+    }
+    // e.g. the varispeed keeps the frames for its kernel
+    if (mixerStream.framesMixed() == before) break;
+  }
+}
+
+// 0..127 over min..max
+static float controlValue(uint8_t value, float min, float max) {
+  return min + (max - min) * value / 127.0f;
+}
+
+static void applyControlChange(uint8_t controller, uint8_t value) {
+  if (midiParams == nullptr) return;
+  EffectParams& params = *midiParams;
+  switch (controller) {
+    case MIDI_CC_DELAY_TIME:
+      // a delay time of its own ends the tempo sync
+      tempoSync.setDivision(BeatDivision::Off);
+      params.delayTimeMs = controlValue(value, DELAY_TIME_MIN_MS, DELAY_TIME_MAX_MS);
+      break;
+    case MIDI_CC_DELAY_DIVISION:
+      // the delay follows in updateTempo()
+      tempoSync.setDivision(TempoSync::divisionOfControl(value));
+      return;
+    case MIDI_CC_DELAY_DEPTH:
+      params.delayDepth = controlValue(value, DELAY_DEPTH_MIN, DELAY_DEPTH_MAX);
+      break;
+    case MIDI_CC_DELAY_FEEDBACK:
+      params.delayFeedback = controlValue(value, DELAY_FEEDBACK_MIN, DELAY_FEEDBACK_MAX);
+      break;
+    case MIDI_CC_DRY:
+      params.dryMix = controlValue(value, MIXER_DRY_MIN, MIXER_DRY_MAX);
+      break;
+    case MIDI_CC_WET:
+      params.wetMix = controlValue(value, MIXER_WET_MIN, MIXER_WET_MAX);
+      break;
+    case MIDI_CC_FILTER_CUTOFF:
+      // exponential: equal steps per octave
+      params.filterCutoffHz = LOW_PASS_MIN_HZ * powf(LOW_PASS_MAX_HZ / LOW_PASS_MIN_HZ, value / 127.0f);
+      break;
+    case MIDI_CC_FILTER_Q:
+      params.filterQ = controlValue(value, LOW_PASS_Q_MIN, LOW_PASS_Q_MAX);
+      break;
+    default:
+      return;
+  }
+  mixerStream.setParams(params);
+  if (midiParamsChanged != nullptr) midiParamsChanged();
+}
+
+static void recordTiming(int32_t latenessUs) {
+  if (timing.notes == 0 || latenessUs < timing.minUs) timing.minUs = latenessUs;
+  if (timing.notes == 0 || latenessUs > timing.maxUs) timing.maxUs = latenessUs;
+  timing.notes++;
+  timing.sumUs += latenessUs;
+  timing.sumSquaresUs += static_cast<int64_t>(latenessUs) * latenessUs;
+  if (latenessUs > static_cast<int32_t>(1000000 / audioSampleRate)) timing.late++;
+}
+
+static void applyMidi(const MidiEvent& event, int64_t startUs) {
+  const MidiMessage& message = event.message;
+  int pad = static_cast<int>(message.data1) - MIDI_NOTE_FIRST_PAD;
+  switch (message.type) {
+    case MidiType::NoteOn: {
+      if (pad < 0 || pad >= static_cast<int>(BUTTON_COUNT)) return;
+      char path[MANIFEST_PATH_LEN];
+      snprintf(path, sizeof(path), "/%d.wav", pad + 1);
+      if (!playSample(pad, path)) return;
+      midiPad = pad;
+      int64_t dueUs = static_cast<int64_t>(event.arrivalUs + MIDI_SCHEDULE_LATENCY_US);
+      recordTiming(static_cast<int32_t>(startUs - dueUs));
+      break;
+    }
+    case MidiType::NoteOff:
+      if (pad == midiPad) releaseSample();
+      midiPad = -1;
+      break;
+    case MidiType::ControlChange:
+      applyControlChange(message.data1, message.data2);
+      break;
+    default:
+      break;
+  }
+}
+
+// Each event starts MIDI_SCHEDULE_LATENCY_US after its arrival: the frames
+// up to it are rendered as soon as it is taken from the queue, so neither
+// the polling of the MIDI task nor the size of the blocks adds jitter. An
+// event further ahead than twice the latency (the clock jumped) waits.
+static void dispatchMidi(uint64_t nowUs) {
+  updateFrameClock(nowUs);
+  uint64_t horizon = mixerStream.framesMixed() +
+                     2ull * MIDI_SCHEDULE_LATENCY_US * audioSampleRate / 1000000;
+  while (midiEventHeld || midiInput.next(midiEvent)) {
+    midiEventHeld = true;
+    int64_t dueUs = static_cast<int64_t>(midiEvent.arrivalUs + MIDI_SCHEDULE_LATENCY_US) - frameZeroUs;
+    uint64_t due = dueUs > 0 ? (static_cast<uint64_t>(dueUs) * audioSampleRate + 500000) / 1000000 : 0;
+    if (due > horizon) return;
+    renderUntil(due);
+    midiEventHeld = false;
+    AUDIO_PROFILE_SCOPE("midi");
+    applyMidi(midiEvent, frameZeroUs + framesToUs(mixerStream.framesMixed()));
+  }
+}
+
+// The events are applied in the real-time scope as well: a note must not
+// allocate. A note on a pad whose sample is not loaded yet opens its file to
+// stream it, and the SD library allocates for that; the goldens start with
+// all samples loaded. The rendering up to an event is profiled as "copy".
+void processAudio() {
+  AUDIO_REALTIME_SCOPE();
+  uint64_t nowUs = audioClockUs();
+  dispatchMidi(nowUs);
+  {
+    AUDIO_PROFILE_SCOPE("midi");
+    updateTempo(nowUs);
+  }
+  {
+    AUDIO_PROFILE_SCOPE("copy");
+    // the player writes silence while inactive: only one source at a time
+    if (sampleVoice.isActive()) {
+      sampleVoice.copy();
+    } else {
+      player.copy();
+      // a streamed slice ends within one copy buffer after its last byte
+      if (streamedSliceEnd > 0 && player.isActive() &&
+          static_cast<File*>(player.getStream())->position() >= streamedSliceEnd) {
+        player.stop();
+      }
+    }
+  }
+  // When nothing plays, pump a small amount of silence through the
+  // mixer so delay/feedback buffers continue to advance and tails decay.
+  if (!isSamplePlaying()) {
+    mixerStream.pumpSilenceFrames(64);
+  }
+  {
+    AUDIO_PROFILE_SCOPE("record");
+    if (recordInput != nullptr) sampleRecorder.readInput(*recordInput);
+    sampleRecorder.update(sampleBank, sampleVoice);
+  }
+}
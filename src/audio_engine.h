@@ -0,0 +1,131 @@
+// audio_engine.h - sample playback and the effect chain up to the output
+// stream. Nothing in here touches I2S, the display or the buttons, so the
+// same code runs on the ESP32 and in the desktop build (see desktop/).
+#pragma once
+
+#include <AudioTools.h>
+#include "AudioTools/Disk/AudioSourceSD.h"
+#include "AudioTools/AudioCodecs/CodecWAV.h"
+#include "AudioTools/AudioLibs/AudioRealFFT.h"
+#include "AudioTools/AudioLibs/FFTConvolver.h"
+#include "config.h"
+#include "audio_mixer.h"
+#include "audio_memory.h"
+#include "effect_params.h"
+#include "midi_input.h"
+#include "sample_bank.h"
+#include "sample_loader.h"
+#include "sample_manifest.h"
+#include "sample_recorder.h"
+#include "tempo_sync.h"
+
+// Chain: player (SD) or sampleVoice (RAM) -> varispeed -> mixer -> output
+extern AudioSourceSD source;
+extern WAVDecoder wavDecoder;
+extern AudioPlayer player;
+extern DryWetMixerStream mixerStream;
+extern VarispeedStream varispeed;
+extern AudioMemory audioMemory;
+extern Delay delayEffect;
+extern FFTConvolver convolver;
+extern FFTConvolver convolverSpare;
+extern Reverb reverb;
+extern SampleBank sampleBank;
+extern SampleVoice sampleVoice;
+extern SampleManifest manifest;
+extern SampleLoader sampleLoader;
+extern SampleRecorder sampleRecorder;
+extern MidiInput midiInput;
+extern TempoSync tempoSync;
+// Manifest entry of the chop file; nullptr when the buttons play samples
+extern ManifestEntry* chopEntry;
+
+// Connects the chain to the output, which is already started with info
+void initAudio(AudioStream& output, AudioInfo info, const EffectParams& params);
+
+// Usage and peak of the audio arenas; with USE_ALLOCATION_GUARD also the heap
+// allocations in processAudio() since the last AllocationGuard reset
+void printAudioMemoryReport(Print& out);
+
+// Starts the sample loader, which converts the sample of each button (empty
+// paths are skipped) or the chop file to the output format and keeps it in
+// PSRAM (or heap). Until then the buttons stream from the SD card.
+void initSampleBank(const char* const paths[BUTTON_COUNT]);
+
+// Switches to other samples: cancels what is still loading. A path whose
+// file is missing is replaced by the same name with another of the
+// SAMPLE_FILE_EXTENSIONS (/1.wav -> /1.mp3).
+void loadSampleBank(const char* const paths[BUTTON_COUNT]);
+
+// Queues the impulse response for the wet path convolver
+void initConvolver();
+
+// Takes finished loads over (between two audio blocks, from the audio task);
+// true while the loader is busy
+bool updateSampleLoader();
+
+// Starts sample idx from RAM or streamed from path (the file found by
+// loadSampleBank() instead); in chop mode slice idx of the chop file (path is
+// not used then)
+bool playSample(size_t idx, const char* path);
+
+// File of the sample that was started last
+const char* playingSamplePath();
+
+bool isSamplePlaying();
+
+// Button released: a hold loop plays the rest of its sample
+void releaseSample();
+
+// Live sampling into pad idx: the master output, or the input which was set
+// with setRecordInput(). false in chop mode, without a record buffer or while
+// the previous take is saved. A load of the pad is cancelled.
+bool startRecording(size_t idx, RecordSource from = RecordSource::Output);
+
+// Ends the take: the pad plays it from the next block on, the WAV file
+// follows in the background
+void stopRecording();
+
+// Stream of RecordSource::Input, read in processAudio() without waiting
+void setRecordInput(Stream* input);
+
+// Clock of the MIDI arrival times in microseconds, micros() by default. The
+// desktop build passes the clock of its capture.
+void setAudioClock(uint64_t (*clockUs)());
+
+// MIDI control changes and the delay time of the tempo sync are written to
+// params and published to the mixer, then changed is called (may be
+// nullptr), e.g. to update the settings screen. Without params they are
+// ignored.
+void setMidiEffectParams(EffectParams* params, void (*changed)());
+
+// Scheduling lateness of the MIDI notes: the frame at which the sample of a
+// note on starts against the frame it was scheduled for, its arrival plus
+// MIDI_SCHEDULE_LATENCY_US. The arrival is what the MIDI task derives from
+// the time of its poll, so errors of that estimate are not part of it.
+struct MidiTiming {
+  uint32_t notes = 0;
+  uint32_t late = 0;  // more than a frame late: MIDI_SCHEDULE_LATENCY_US too short
+  int32_t minUs = 0;
+  int32_t maxUs = 0;
+  int64_t sumUs = 0;
+  int64_t sumSquaresUs = 0;
+};
+const MidiTiming& midiTiming();
+void resetMidiTiming();
+
+// Scheduling lateness of the MIDI notes since the last reset
+void printMidiReport(Print& out);
+
+// A tap of the tap tempo, on the clock of setAudioClock()
+void tapTempo();
+
+// Tempo, its source and the synced delay
+void printTempoReport(Print& out);
+
+// Moves one buffer of the playing source through the chain. When nothing
+// plays, silence is pumped instead so that the effect tails decay. MIDI
+// events of midiInput which are due within the buffer are started at their
+// frame. Must not allocate: a real-time section of the AllocationGuard,
+// except for the start of a MIDI note, which may open its file like a button.
+void processAudio();
@@ -0,0 +1,145 @@
+#include "audio_memory.h"
+
+#include <Arduino.h>
+
+// The allocators of the regions are created on first use, so that they are
+// released after the arenas which return their memory to them.
+static Allocator& internalAllocator() {
+#if defined(ESP32) && defined(ARDUINO)
+  static AllocatorESP32 allocator(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+  static Allocator allocator;
+#endif
+  return allocator;
+}
+
+static Allocator& psramAllocator() {
+#if defined(ESP32) && defined(ARDUINO)
+  static AllocatorPSRAM allocator;
+  return allocator;
+#else
+  return internalAllocator();
+#endif
+}
+
+// PSRAM first, like the DefaultAllocator
+static Allocator& heapAllocator() {
+  static AllocatorExt allocator;
+  return allocator;
+}
+
+static const char* regionName(MemoryRegion region) {
+  return region == MemoryRegion::PSRAM ? "PSRAM" : "internal";
+}
+
+AudioMemory::AudioMemory() : blockArena(internalAllocator()), lineArena(heapAllocator()) {}
+
+void AudioMemory::begin(size_t blockBytes, size_t lineBytes) {
+  if (blockBytes > ESP.getMaxAllocHeap() || !blockArena.begin(blockBytes, internalAllocator())) {
+    Serial.printf("Geen interne audio arena van %u bytes\n", static_cast<unsigned>(blockBytes));
+  }
+  linesInPsram = ESP.getPsramSize() > 0;
+  size_t available = linesInPsram ? ESP.getMaxAllocPsram() : ESP.getMaxAllocHeap();
+  Allocator& source = linesInPsram ? psramAllocator() : internalAllocator();
+  if (lineBytes > available || !lineArena.begin(lineBytes, source)) {
+    Serial.printf("Geen audio arena van %u bytes\n", static_cast<unsigned>(lineBytes));
+  }
+  add("block arena", MemoryRegion::Internal, blockArena.size());
+  add("line arena", lineRegion(), lineArena.size());
+}
+
+MemoryRegion AudioMemory::heapRegion() {
+  return ESP.getPsramSize() > 0 ? MemoryRegion::PSRAM : MemoryRegion::Internal;
+}
+
+void AudioMemory::add(const char* name, MemoryRegion region, size_t bytes) {
+  for (size_t i = 0; i < entryCount; ++i) {
+    if (strcmp(entries[i].name, name) == 0) {
+      entries[i].region = region;
+      entries[i].bytes = bytes;
+      return;
+    }
+  }
+  if (entryCount == MAX_ENTRIES) return;
+  entries[entryCount++] = Entry{name, region, bytes};
+}
+
+void AudioMemory::printMap(Print& out) {
+  out.printf("Internal RAM: %u bytes, %u free (largest block %u)\n",
+             static_cast<unsigned>(ESP.getHeapSize()),
+             static_cast<unsigned>(ESP.getFreeHeap()),
+             static_cast<unsigned>(ESP.getMaxAllocHeap()));
+  if (ESP.getPsramSize() > 0) {
+    out.printf("PSRAM: %u bytes, %u free (largest block %u)\n",
+               static_cast<unsigned>(ESP.getPsramSize()),
+               static_cast<unsigned>(ESP.getFreePsram()),
+               static_cast<unsigned>(ESP.getMaxAllocPsram()));
+  } else {
+    out.printf("PSRAM: none\n");
+  }
+  for (size_t i = 0; i < entryCount; ++i) {
+    out.printf("  %-16s %-8s %8u bytes\n", entries[i].name, regionName(entries[i].region),
+               static_cast<unsigned>(entries[i].bytes));
+  }
+  printUsage(out);
+}
+
+void AudioMemory::printUsage(Print& out) {
+  out.printf("Block arena (internal): %u of %u bytes (peak %u), %u allocations outside\n",
+             static_cast<unsigned>(blockArena.used()),
+             static_cast<unsigned>(blockArena.size()),
+             static_cast<unsigned>(blockArena.peak()),
+             static_cast<unsigned>(blockArena.fallbackCount()));
+  out.printf("Line arena (%s): %u of %u bytes (peak %u), %u allocations outside\n",
+             regionName(lineRegion()),
+             static_cast<unsigned>(lineArena.used()),
+             static_cast<unsigned>(lineArena.size()),
+             static_cast<unsigned>(lineArena.peak()),
+             static_cast<unsigned>(lineArena.fallbackCount()));
+}
+
+// One second of audio through a delay of lineMs, block by block and sample by
+// sample. The line does not fit the 32 KB cache, so the PSRAM is read for
+// (almost) every cache line of 16 samples.
+static void timeDelay(Print& out, MemoryRegion region, Allocator& allocator,
+                      uint32_t sampleRate, uint32_t lineMs) {
+  static constexpr size_t FRAMES = 256;
+  effect_t in[FRAMES];
+  effect_t wet[FRAMES];
+  uint32_t seed = 1;
+  for (size_t i = 0; i < FRAMES; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    in[i] = static_cast<effect_t>(static_cast<int16_t>(seed >> 16) / 4);
+  }
+  Delay delay(0, 0.5f, 0.45f, sampleRate);
+  delay.setAllocator(allocator);
+  delay.setMaxDuration(static_cast<uint16_t>(lineMs));
+  delay.setDuration(static_cast<int16_t>(lineMs));
+  size_t blocks = sampleRate / FRAMES;
+  float frames = static_cast<float>(blocks * FRAMES);
+
+  uint32_t start = AudioProfiler::ticks();
+  for (size_t b = 0; b < blocks; ++b) delay.processBlock(in, wet, FRAMES);
+  uint32_t blockNs = AudioProfiler::ticksToNs(AudioProfiler::ticks() - start);
+  start = AudioProfiler::ticks();
+  for (size_t b = 0; b < blocks; ++b) {
+    for (size_t i = 0; i < FRAMES; ++i) wet[i] = delay.process(in[i]);
+  }
+  uint32_t sampleNs = AudioProfiler::ticksToNs(AudioProfiler::ticks() - start);
+  out.printf("  %-8s %7.1f ns/frame (per sample %7.1f)\n", regionName(region),
+             blockNs / frames, sampleNs / frames);
+}
+
+void benchmarkDelayPlacement(Print& out, uint32_t sampleRate, uint32_t lineMs) {
+  size_t bytes = static_cast<size_t>(sampleRate) * lineMs / 1000 * sizeof(effect_t);
+  out.printf("Delay %u ms (%u bytes):\n", static_cast<unsigned>(lineMs),
+             static_cast<unsigned>(bytes));
+  if (bytes <= ESP.getMaxAllocHeap()) {
+    timeDelay(out, MemoryRegion::Internal, internalAllocator(), sampleRate, lineMs);
+  } else {
+    out.printf("  internal: no free block of %u bytes\n", static_cast<unsigned>(bytes));
+  }
+  if (ESP.getPsramSize() > 0 && bytes <= ESP.getMaxAllocPsram()) {
+    timeDelay(out, MemoryRegion::PSRAM, psramAllocator(), sampleRate, lineMs);
+  }
+}
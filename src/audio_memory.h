@@ -0,0 +1,53 @@
+// audio_memory.h - where the audio buffers live. Small buffers which are
+// touched for every block (mixer blocks, filter state, resampler history) are
+// kept in internal RAM. The long buffers which are read once per sample
+// (delay and reverb lines, sample cache, convolver IR) go to PSRAM when the
+// module has it: PSRAM is read through the flash cache in 32 byte lines, so
+// these buffers must be accessed front to back.
+#pragma once
+
+#include <AudioTools.h>
+
+enum class MemoryRegion { Internal, PSRAM };
+
+class AudioMemory {
+public:
+  AudioMemory();
+
+  // Reserves the block arena in internal RAM and the line arena in PSRAM
+  // (internal RAM without PSRAM). An arena which cannot be reserved is left
+  // empty: its users are then allocated from the heap of its region.
+  void begin(size_t blockBytes, size_t lineBytes);
+
+  AllocatorArena& blocks() { return blockArena; }
+  AllocatorArena& lines() { return lineArena; }
+  MemoryRegion lineRegion() const { return linesInPsram ? MemoryRegion::PSRAM : MemoryRegion::Internal; }
+  // Region of the buffers of the DefaultAllocator (sample cache, convolver)
+  static MemoryRegion heapRegion();
+
+  // Records the memory of a user for the map; a known name is updated
+  void add(const char* name, MemoryRegion region, size_t bytes);
+
+  // Sizes of both regions, then the users and the arenas
+  void printMap(Print& out);
+  // Usage and peak of the arenas
+  void printUsage(Print& out);
+
+private:
+  struct Entry {
+    const char* name;
+    MemoryRegion region;
+    size_t bytes;
+  };
+  static constexpr size_t MAX_ENTRIES = 12;
+
+  AllocatorArena blockArena;
+  AllocatorArena lineArena;
+  bool linesInPsram = false;
+  Entry entries[MAX_ENTRIES];
+  size_t entryCount = 0;
+};
+
+// Time of Delay::processBlock() (and of the per sample process()) with a
+// delay line of lineMs in internal RAM and in PSRAM, in ns per frame
+void benchmarkDelayPlacement(Print& out, uint32_t sampleRate, uint32_t lineMs);
@@ -2,112 +2,155 @@
 #pragma once
 
 #include <AudioTools.h>
-#include <vector>
-#include <memory>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include "AudioTools/Concurrency/LockFree/TripleBuffer.h"
 #include "AudioTools/CoreAudio/AudioEffects/AudioEffects.h"
 #include "AudioTools/CoreAudio/AudioFilter/Filter.h"
 #include <Arduino.h> // voor Serial debug
 #include "config.h"
-
+#include "effect_params.h"
+
+// The controls (setParams(), the pots and the switches) are called from the
+// control task while the callback runs in the audio task. They only change a
+// copy of the control state and publish it through a TripleBuffer: the
+// callback takes the latest state over once per write, so the control task
+// can set values as often as it likes without locks, and the audio task never
+// sees a half written state.
 class DryWetMixerStream : public ModifyingStream {
 public:
-  // Backwards-compatible begin() delegates to ModifyingStream-style setters
-  void begin(I2SStream& outStream, Delay& effect) {
+  // Backwards-compatible begin() delegates to ModifyingStream-style setters;
+  // the output is I2S on the board and a file or capture on the desktop.
+  void begin(AudioStream& outStream, Delay& effect) {
     setOutput(outStream);
+    dryOutput = &outStream;
     setEffect(&effect);
   }
 
   void setMix(float dry, float wet) {
-    dryMix = clampFloat(dry, MIXER_DRY_MIN, MIXER_DRY_MAX);
-    wetMixActive = clampFloat(wet, MIXER_WET_MIN, MIXER_WET_MAX);
-    targetWetMix = effectEnabled ? wetMixActive : 0.0f;
-    currentWetMix = targetWetMix;
-    wetRampFramesRemaining = 0;
-
+    control.params.dryMix = dry;
+    control.params.wetMix = wet;
+    publishParams(nullptr, control.params, 0);
   }
 
+  // The filter switch: jumps to the cutoff
   void configureMasterLowPass(float cutoffHz, float q = LOW_PASS_Q,
                               bool enabled = true) {
-    inputFilterCutoff = clampFloat(cutoffHz, LOW_PASS_MIN_HZ, LOW_PASS_MAX_HZ);
-    inputFilterTargetCutoff = inputFilterCutoff;
-    setInputLowPassQ(q);
-    inputFilterEnabled = enabled;
-    refreshInputFilterState();
-
+    control.lowPassCutoffHz = cutoffHz;
+    control.lowPassQ = q;
+    control.lowPassEnabled = enabled;
+    publishControl(LowPass);
   }
 
   void configureMasterCompressor(uint16_t attackMs, uint16_t releaseMs,
                                  uint16_t holdMs, uint8_t thresholdPercent,
                                  float compressionRatio,
                                  bool enabled = true) {
-    compAttackMs = attackMs;
-    compReleaseMs = releaseMs;
-    compHoldMs = holdMs;
-    compThresholdPercent = thresholdPercent;
-    compRatio = compressionRatio;
-    masterCompressorEnabled = enabled;
-    refreshMasterCompressor();
+    EffectParams& p = control.params;
+    p.compAttackMs = attackMs;
+    p.compReleaseMs = releaseMs;
+    p.compHoldMs = holdMs;
+    p.compThresholdPercent = thresholdPercent;
+    p.compRatio = compressionRatio;
+    p.compEnabled = enabled ? 1 : 0;
+    publishParams(nullptr, p, 0);
+  }
+
+  // Publishes a complete effect snapshot to the audio thread. Only copies the
+  // struct, so it is allocation-free; the callback picks it up at the next
+  // block boundary. A snapshot which was not taken over yet is replaced.
+  // Continuous parameters glide to the new values over morphMs (0 = the
+  // short default smoothing time), discrete ones (delay time, compressor
+  // timing/enable) switch at the start.
+  void setParams(const EffectParams& params, uint32_t morphMs = 0) {
+    publishParams(nullptr, params, morphMs);
+  }
 
+  // Morphs between two snapshots, jumping to `from` first.
+  void morphParams(const EffectParams& from, const EffectParams& to,
+                   uint32_t morphMs) {
+    publishParams(&from, to, morphMs);
+  }
+
+  bool isMorphing() const {
+    return morphFramesRemaining.load(std::memory_order_relaxed) > 0;
+  }
+
+  // Gain applied to the incoming audio (the volume pot), smoothed in the
+  // audio thread.
+  void setInputGain(float gain) {
+    control.inputGain = gain;
+    publishControl(InputGain);
   }
 
   void setMasterCompressorEnabled(bool enabled) {
-    masterCompressorEnabled = enabled;
-    if (masterCompressor) {
-      masterCompressor->setActive(enabled);
-    }
+    control.params.compEnabled = enabled ? 1 : 0;
+    publishParams(nullptr, control.params, 0);
   }
 
+  // The pot in filter mode: glides with the slew rate
   void setInputLowPassCutoff(float cutoffHz) {
-    inputFilterTargetCutoff = clampFloat(cutoffHz, 0.0f, LOW_PASS_MAX_HZ);
-    if (!inputFilterEnabled || !inputFilterInitialized) {
-      inputFilterCutoff = inputFilterTargetCutoff;
-    }
+    control.cutoffTargetHz = cutoffHz;
+    publishControl(LowPassCutoff);
   }
 
   void setInputLowPassQ(float q) {
-    inputFilterQ = clampFloat(q, LOW_PASS_Q_MIN, LOW_PASS_Q_MAX);
-    if (inputFilterEnabled && inputFilterInitialized) {
-      applyInputFilterCutoff(inputFilterCutoff);
-    }
+    control.params.filterQ = q;
+    publishParams(nullptr, control.params, 0);
   }
 
   void setInputLowPassSlewRate(float hzPerSec) {
-    inputFilterSlewRateHzPerSec = clampFloat(hzPerSec,
-                                             FILTER_SLEW_MIN_HZ_PER_SEC,
-                                             FILTER_SLEW_MAX_HZ_PER_SEC);
+    control.slewHzPerSec = hzPerSec;
+    publishControl(SlewRate);
+  }
+
+  // Where the block buffers and the input filters are allocated, e.g. in an
+  // AllocatorArena: call before begin().
+  void setAllocator(Allocator& allocator) {
+    moveTo(allocator, mixBuffer);
+    moveTo(allocator, convertedInput);
+    moveTo(allocator, expandedOutput);
+    moveTo(allocator, reverbSend);
+    moveTo(allocator, reverbRight);
+    moveTo(allocator, reverbGain);
+    moveTo(allocator, wetBuffer);
+    moveTo(allocator, silence);
+    moveTo(allocator, inputLowPassFilters);
+    formatReady = false;
   }
 
+  // Allocates everything the callback needs for the format. The players
+  // announce their format at every start: nothing is done (and the effect
+  // tails are kept) while it stays the same.
   void setAudioInfo(AudioInfo newInfo) override {
+    bool unchanged = formatReady && newInfo == audioInfo();
     AudioStream::setAudioInfo(newInfo);
     if (dryOutput) dryOutput->setAudioInfo(newInfo);
     // propagate to internal callback stream as well
     cbStream.setAudioInfo(newInfo);
+    if (unchanged) return;
+    formatReady = true;
     sampleBytes = std::max<int>(1, newInfo.bits_per_sample / 8);
     channels = std::max<int>(1, newInfo.channels);
     frameBytes = sampleBytes * channels;
-    pendingLen = 0;
-    pendingBuffer.clear();
     sampleRate = newInfo.sample_rate > 0 ? newInfo.sample_rate : 44100;
     fadeFrames = std::max<uint32_t>(1, (sampleRate * EFFECT_TOGGLE_FADE_MS) / 1000);
     attackFrames = std::max<uint32_t>(1, (sampleRate * SAMPLE_ATTACK_FADE_MS) / 1000);
-    targetWetMix = effectEnabled ? wetMixActive : 0.0f;
-    currentWetMix = targetWetMix;
-    wetRampFramesRemaining = 0;
+    beginSmoothing();
+    wetLevel.setValue(effectEnabled ? wetMixActive : 0.0f);
     attackFramesRemaining = 0;
-    const size_t reserveFrames = 256; // tweak if needed
-    mixBuffer.clear();
-    mixBuffer.reserve(reserveFrames * channels);
-    inputFilterTargetCutoff = inputFilterCutoff;
+    allocateBlockBuffers();
+    filterCutoff.setValue(filterCutoff.value());
     refreshInputFilterState();
     refreshMasterCompressor();
-
+    beginMasterEq();
+    if (delay) delay->setMaxDuration(static_cast<uint16_t>(DELAY_TIME_MAX_MS));
   }
 
   // ModifyingStream API: allow this mixer to be used like other AudioTools
   // components. We keep internal pointers to the provided stream/print
-  // objects but still prefer typed I2SStream for the dry output.
+  // objects; the typed dry output is set by begin().
   void setStream(Stream &in) override {
   p_in = &in;
 
@@ -117,10 +160,6 @@ public:
   }
 
   void setOutput(Print &out) override {
-    // Try to treat out as an I2SStream if possible. This cast is safe when
-    // callers pass the same I2SStream instance used previously.
-    dryOutput = reinterpret_cast<I2SStream*>(&out);
-
   p_out = &out;
   cbStream.setOutput(out);
   s_instance = this;
@@ -131,33 +170,72 @@ public:
   // this mixer – we ensure it stays active so internal buffers keep running.
   void setEffect(Delay* d) {
     delay = d;
-    if (delay) delay->setActive(true);
+    if (delay) {
+      delay->setActive(true);
+      // Preallocate the longest delay line so preset recalls never allocate.
+      delay->setMaxDuration(static_cast<uint16_t>(DELAY_TIME_MAX_MS));
+    }
     s_instance = this;
     cbStream.setUpdateCallback(staticUpdate);
   }
 
-  void setEffectActive(bool active) {
+  // A delay time in samples, e.g. a beat division of the tempo: kept exactly
+  // instead of going through the ms of the params. Publish the params with
+  // the same time first, later params with that time leave it alone.
+  void setDelaySamples(double samples) {
+    control.delaySamples = samples;
+    publishControl(DelaySamples);
+  }
+
+  // Optional stage after the delay on the wet signal, e.g. an FFTConvolver
+  // with a cabinet or room impulse response. Set it before audio starts.
+  void setWetStage(AudioEffect* stage) {
+    wetStage = stage;
+  }
+
+  // Optional stereo reverb in parallel with the delay. It is fed from the same
+  // send and returned with the wet level. Call begin() on it before audio
+  // starts.
+  void setReverb(Reverb* r) {
+    reverb = r;
+  }
+
+  // Optional tap on the master output after the EQ, in 16 bit: gets what the
+  // output gets, e.g. a SampleRecorder. It is called in the audio thread and
+  // must not wait. Set it before audio starts.
+  void setTap(Print* out) {
+    tap = out;
+  }
+
+  // Frames which were mixed (and written to the output) since begin; the
+  // position of the audio thread, e.g. to schedule events at a frame
+  uint64_t framesMixed() const {
+    return mixedFrames;
+  }
+
   // Do not disable the Delay object itself here. We want the delay line to
   // keep running so echoes / feedback continue even when the wet mix is
   // turned off. The effectEnabled flag only controls audibility (wet mix).
-  effectEnabled = active;
-  targetWetMix = effectEnabled ? wetMixActive : 0.0f;
-  scheduleWetRamp();
+  void setEffectActive(bool active) {
+    control.effectActive = active;
+    publishControl(EffectActive);
   }
 
   void updateEffectSampleRate(uint32_t sampleRate) {
     if (delay && sampleRate > 0) {
       delay->setSampleRate(sampleRate);
+      // a new delay time bends the echoes instead of clicking
+      delay->setGlide(sampleRate * DELAY_TIME_GLIDE_MS / 1000.0f);
     }
 
   }
 
-  // When true we actually feed the incoming audio into the delay. When false
-  // we still call delay->process(0) so the delay's internal buffer advances
-  // and the effect tail keeps playing without new input.
+  // When true we actually feed the incoming audio into the delay and the
+  // reverb. When false we still process silence so their internal buffers
+  // advance and the effect tails keep playing without new input.
   void setSendActive(bool send) {
-    sendActive = send;
-
+    control.sendActive = send;
+    publishControl(SendActive);
   }
   // Delegate write to internal CallbackStream which will call our
   // update callback to mix the buffer before sending it to the real output.
@@ -169,35 +247,58 @@ public:
   // advance internal effects (e.g., delay buffer) so tails continue to decay.
   // frames: number of audio frames (samples per channel) to push.
   void pumpSilenceFrames(size_t frames) {
-    if (frames == 0) return;
-    size_t sampleCount = frames * std::max<int>(1, channels);
-    size_t byteCount = sampleCount * static_cast<size_t>(sampleBytes);
-    // allocate a temporary zero buffer on the heap to avoid stack pressure
-    std::vector<uint8_t> zeros(byteCount);
-    // write will call the CallbackStream which will call our updateCallback
-    // and thus call delay->process(0) for each frame.
-    write(zeros.data(), byteCount);
+    if (silence.size() == 0) return;
+    while (frames > 0) {
+      size_t blockFrames = std::min(frames, MIXER_BLOCK_FRAMES);
+      size_t byteCount = blockFrames * frameBytes;
+      // the callback mixes in place: clear the block before every write
+      memset(silence.data(), 0, byteCount);
+      // write will call the CallbackStream which will call our updateCallback
+      // and thus call delay->process(0) for each frame.
+      write(silence.data(), byteCount);
+      frames -= blockFrames;
+    }
   }
 
 private:
-  I2SStream* dryOutput = nullptr;
+  AudioStream* dryOutput = nullptr;
   Delay* delay = nullptr;
-  float dryMix = MIXER_DEFAULT_DRY_LEVEL;
+  AudioEffect* wetStage = nullptr;
+  Reverb* reverb = nullptr;
+  Print* tap = nullptr;
+  uint64_t mixedFrames = 0;
+  // Every continuous parameter glides to its target: the per-sample ones
+  // are advanced in the frame loop, the per-block ones once per callback.
+  SmoothedParameter dryLevel{MIXER_DEFAULT_DRY_LEVEL};
+  SmoothedParameter wetLevel{MIXER_DEFAULT_WET_LEVEL};
+  SmoothedParameter delayDepth{DEFAULT_DELAY_DEPTH};
+  SmoothedParameter delayFeedback{DEFAULT_DELAY_FEEDBACK};
+  SmoothedParameter inputGain{1.0f, SmoothedParameter::OnePole};
+  SmoothedParameter filterCutoff{LOW_PASS_CUTOFF_HZ};
+  SmoothedParameter filterQ{LOW_PASS_Q};
+  SmoothedParameter compThreshold{MASTER_COMPRESSOR_THRESHOLD_PERCENT};
+  SmoothedParameter compRatio{MASTER_COMPRESSOR_RATIO};
   float wetMixActive = MIXER_DEFAULT_WET_LEVEL;
-  float currentWetMix = MIXER_DEFAULT_WET_LEVEL;
-  float targetWetMix = MIXER_DEFAULT_WET_LEVEL;
-  float wetRampDelta = 0.0f;
   int sampleBytes = sizeof(int16_t);
   int channels = 2;
-  std::vector<int16_t> mixBuffer;
-  std::vector<int16_t> convertedInput;
-  std::vector<int32_t> expandedOutput;
-  std::vector<uint8_t> pendingBuffer;
-  size_t pendingLen = 0;
+  // Block buffers of MIXER_BLOCK_FRAMES, allocated in setAudioInfo(): the
+  // callback mixes longer writes block by block and never allocates.
+  Vector<int16_t> mixBuffer{DefaultAllocatorRAM};
+  Vector<int16_t> convertedInput{DefaultAllocatorRAM};
+  Vector<int32_t> expandedOutput{DefaultAllocatorRAM};
+  // delay and reverb send (and left return), right return and per frame
+  // return gain
+  Vector<int16_t> reverbSend{DefaultAllocatorRAM};
+  Vector<int16_t> reverbRight{DefaultAllocatorRAM};
+  Vector<float> reverbGain{DefaultAllocatorRAM};
+  // output of the delay and the wet stage
+  Vector<effect_t> wetBuffer{DefaultAllocatorRAM};
+  // zeros for pumpSilenceFrames()
+  Vector<uint8_t> silence{DefaultAllocatorRAM};
+  bool formatReady = false;
   size_t frameBytes = sizeof(int16_t) * 2;
   uint32_t sampleRate = 44100;
   uint32_t fadeFrames = 1;
-  uint32_t wetRampFramesRemaining = 0;
   bool effectEnabled = false;
   // When false we do not feed the incoming audio into the delay; the delay
   // still runs and is called with silence (0) so its buffer advances.
@@ -206,21 +307,52 @@ private:
   uint32_t attackFramesRemaining = 0;
 
   // Input filter state (applied before wet send and dry output)
-  std::vector<std::unique_ptr<LowPassFilter<float>>> inputLowPassFilters;
+  Vector<LowPassFilter<float>> inputLowPassFilters{DefaultAllocatorRAM};
   bool inputFilterEnabled = false;
   bool inputFilterInitialized = false;
-  float inputFilterCutoff = LOW_PASS_CUTOFF_HZ;
-  float inputFilterTargetCutoff = LOW_PASS_CUTOFF_HZ;
-  float inputFilterQ = LOW_PASS_Q;
   float inputFilterSlewRateHzPerSec = FILTER_SLEW_DEFAULT_HZ_PER_SEC;
-  std::vector<float> filteredDryScratch;
-  std::unique_ptr<Compressor> masterCompressor;
+  // assigned when the sample rate changes; it holds no heap memory
+  Compressor masterCompressor;
+  bool masterCompressorReady = false;
   bool masterCompressorEnabled = false;
   uint16_t compAttackMs = MASTER_COMPRESSOR_ATTACK_MS;
   uint16_t compReleaseMs = MASTER_COMPRESSOR_RELEASE_MS;
   uint16_t compHoldMs = MASTER_COMPRESSOR_HOLD_MS;
-  uint8_t compThresholdPercent = MASTER_COMPRESSOR_THRESHOLD_PERCENT;
-  float compRatio = MASTER_COMPRESSOR_RATIO;
+  // Master EQ (stereo only) after the compressor, gains in dB
+  BlockEqualizer<2> masterEq;
+  float eqGainDb[3] = {MASTER_EQ_DEFAULT_DB, MASTER_EQ_DEFAULT_DB,
+                       MASTER_EQ_DEFAULT_DB};
+
+  // Controls of the control task. Each one has a version which is counted up
+  // when it is set: the audio thread applies the controls whose version
+  // differs from the one it applied last, so a state which replaced an
+  // unread one still carries all changes.
+  enum Control : uint8_t {
+    Params, InputGain, LowPass, LowPassCutoff, SlewRate, EffectActive,
+    SendActive, DelaySamples, CONTROL_COUNT
+  };
+  struct ControlState {
+    uint32_t version[CONTROL_COUNT] = {};
+    EffectParams params = defaultEffectParams();
+    EffectParams from = defaultEffectParams();
+    bool hasFrom = false;
+    uint32_t morphMs = 0;
+    float inputGain = 1.0f;
+    float lowPassCutoffHz = LOW_PASS_CUTOFF_HZ;
+    float lowPassQ = LOW_PASS_Q;
+    bool lowPassEnabled = false;
+    float cutoffTargetHz = LOW_PASS_CUTOFF_HZ;
+    float slewHzPerSec = FILTER_SLEW_DEFAULT_HZ_PER_SEC;
+    bool effectActive = false;
+    bool sendActive = false;
+    double delaySamples = 0.0;
+  };
+  // written by the control task only
+  ControlState control;
+  TripleBuffer<ControlState> controlMailbox;
+  // audio thread
+  uint32_t appliedVersion[CONTROL_COUNT] = {};
+  std::atomic<uint32_t> morphFramesRemaining{0};
 
   // debug counters
   uint32_t debugFrameCounter = 0;
@@ -250,18 +382,32 @@ private:
   // the provided byte buffer. Returns number of bytes written (len) or 0 on
   // error.
   size_t updateCallback(uint8_t* chunk, size_t chunkLen) {
+    AUDIO_PROFILE_SCOPE("mixer");
     size_t frames = chunkLen / frameBytes;
-    if (!dryOutput || !delay || frames == 0) return 0;
-    size_t sampleCount = frames * channels;
-    mixBuffer.resize(sampleCount);
+    if (!dryOutput || !delay || frames == 0 || mixBuffer.size() == 0) return 0;
+    applyControls();
+    size_t result = 0;
+    while (frames > 0) {
+      size_t blockFrames = std::min(frames, MIXER_BLOCK_FRAMES);
+      size_t written = mixBlock(chunk + result, blockFrames);
+      if (written == 0) return 0;
+      result += written;
+      frames -= blockFrames;
+      mixedFrames += blockFrames;
+    }
+    return result;
+  }
 
-  advanceInputFilterCutoff(frames);
+  // Mixes up to MIXER_BLOCK_FRAMES in place
+  size_t mixBlock(uint8_t* chunk, size_t frames) {
+    size_t sampleCount = frames * channels;
+    advanceBlockParams(frames);
+    bool delayParamsMoving = delayDepth.isSmoothing() || delayFeedback.isSmoothing();
 
     const int16_t* input = nullptr;
     if (sampleBytes == sizeof(int16_t)) {
       input = reinterpret_cast<const int16_t*>(chunk);
     } else if (sampleBytes == sizeof(int32_t)) {
-      convertedInput.resize(sampleCount);
       const int32_t* input32 = reinterpret_cast<const int32_t*>(chunk);
       for (size_t i = 0; i < sampleCount; ++i) {
         int32_t value = input32[i] >> 16;
@@ -275,46 +421,67 @@ private:
     }
 
     int16_t* mixed = mixBuffer.data();
-    if (filteredDryScratch.size() < static_cast<size_t>(channels)) {
-      filteredDryScratch.resize(static_cast<size_t>(channels), 0.0f);
-    }
+    effect_t* send = reverbSend.data();
+    effect_t* wetBlock = wetBuffer.data();
 
+    // The block is processed in passes, so that each buffer is read front to
+    // back: the delay line sits in PSRAM and is only fast when it is streamed
+    // through the cache. 1. filtered dry signal and the mono send
     for (size_t frame = 0; frame < frames; ++frame) {
       float monoSum = 0.0f;
+      float gain = inputGain.next();
       for (int ch = 0; ch < channels; ++ch) {
-        float sampleValue = static_cast<float>(input[frame * channels + ch]);
+        float sampleValue = gain * static_cast<float>(input[frame * channels + ch]);
         float filtered = processInputLowPass(sampleValue, ch);
         if (filtered > 32767.0f) filtered = 32767.0f;
         if (filtered < -32768.0f) filtered = -32768.0f;
-        filteredDryScratch[ch] = filtered;
+        mixed[frame * channels + ch] = static_cast<int16_t>(filtered);
         monoSum += filtered;
       }
       float filteredMono = (channels > 0) ? (monoSum / static_cast<float>(channels)) : monoSum;
-      effect_t wetInput = sendActive ? static_cast<effect_t>(filteredMono) : 0;
-      // Always run the delay process so its internal buffer advances.
       // When send is muted we still feed silence so the delay tail keeps moving.
-      effect_t wetSample = delay->process(wetInput);
-      float wetLevel = advanceWetMix();
-      float attackGain = advanceAttackGain();
-
-      // debug: print a sample occasionally to observe wet sample and levels
+      send[frame] = sendActive ? static_cast<effect_t>(filteredMono) : 0;
+    }
 
+    // 2. the delay runs over the whole block so its buffer advances
+    if (delayParamsMoving) {
+      for (size_t frame = 0; frame < frames; ++frame) {
+        delay->setDepth(delayDepth.next());
+        delay->setFeedback(delayFeedback.next());
+        wetBlock[frame] = delay->process(send[frame]);
+      }
+    } else {
+      delay->processBlock(send, wetBlock, frames);
+    }
+    if (wetStage) wetStage->processBlock(wetBlock, wetBlock, frames);
 
+    // 3. dry/wet mix
+    for (size_t frame = 0; frame < frames; ++frame) {
+      float dry = dryLevel.next();
+      float wet = wetLevel.next();
+      float attackGain = advanceAttackGain();
+      if (reverb) {
+        reverbGain[frame] = attackGain < 0.999f ? wet * attackGain : wet;
+      }
       for (int ch = 0; ch < channels; ++ch) {
-        int32_t dryVal = static_cast<int32_t>(filteredDryScratch[ch]);
-        int32_t mixedVal = static_cast<int32_t>(dryMix * dryVal + wetLevel * wetSample);
+        int32_t dryVal = mixed[frame * channels + ch];
+        int32_t mixedVal = static_cast<int32_t>(dry * dryVal + wet * wetBlock[frame]);
         if (attackGain < 0.999f) {
           mixedVal = static_cast<int32_t>(mixedVal * attackGain);
         }
         if (mixedVal > 32767) mixedVal = 32767;
         if (mixedVal < -32768) mixedVal = -32768;
-        int16_t outputSample = static_cast<int16_t>(mixedVal);
-        if (masterCompressor) {
-          outputSample = masterCompressor->process(static_cast<effect_t>(outputSample));
-        }
-        mixed[frame * channels + ch] = outputSample;
+        mixed[frame * channels + ch] = static_cast<int16_t>(mixedVal);
       }
     }
+    if (reverb) addReverbReturn(mixed, frames);
+    // The compressor runs over the interleaved block, in the same sample order
+    // as the per-sample call it replaces.
+    if (masterCompressorReady) {
+      masterCompressor.processBlock(mixed, mixed, sampleCount);
+    }
+    if (channels == 2) masterEq.process(mixed, frames);
+    if (tap) tap->write(reinterpret_cast<const uint8_t*>(mixed), sampleCount * sizeof(int16_t));
 
     // Write mixed samples back into chunk
     if (sampleBytes == sizeof(int16_t)) {
@@ -323,7 +490,6 @@ private:
     }
 
     if (sampleBytes == sizeof(int32_t)) {
-      expandedOutput.resize(sampleCount);
       for (size_t i = 0; i < sampleCount; ++i) {
         expandedOutput[i] = static_cast<int32_t>(mixed[i]) << 16;
       }
@@ -334,44 +500,24 @@ private:
     return 0;
   }
 
-  void writeMixedFrames(const int16_t* mixed, size_t frames) {
-    size_t sampleCount = frames * channels;
-    if (sampleBytes == sizeof(int16_t)) {
-      dryOutput->write(reinterpret_cast<const uint8_t*>(mixed), sampleCount * sizeof(int16_t));
-    } else if (sampleBytes == sizeof(int32_t)) {
-      expandedOutput.resize(sampleCount);
-      for (size_t i = 0; i < sampleCount; ++i) {
-        expandedOutput[i] = static_cast<int32_t>(mixed[i]) << 16;
-      }
-      dryOutput->write(reinterpret_cast<const uint8_t*>(expandedOutput.data()), sampleCount * sizeof(int32_t));
-    }
-  }
-
-  void scheduleWetRamp() {
-    if (fadeFrames <= 1) {
-      currentWetMix = targetWetMix;
-      wetRampFramesRemaining = 0;
-      wetRampDelta = 0.0f;
-      return;
-    }
-    wetRampFramesRemaining = fadeFrames;
-    wetRampDelta = (targetWetMix - currentWetMix) / static_cast<float>(fadeFrames);
-  }
-
-  float advanceWetMix() {
-    if (wetRampFramesRemaining > 0) {
-      currentWetMix += wetRampDelta;
-      --wetRampFramesRemaining;
-      if ((wetRampDelta > 0.0f && currentWetMix > targetWetMix) ||
-          (wetRampDelta < 0.0f && currentWetMix < targetWetMix)) {
-        currentWetMix = targetWetMix;
-        wetRampFramesRemaining = 0;
-        wetRampDelta = 0.0f;
+  // The reverb processes the whole block of sends at once; its stereo return
+  // is added with the wet level of each frame.
+  void addReverbReturn(int16_t* mixed, size_t frames) {
+    AUDIO_PROFILE_SCOPE("reverb");
+    int16_t* left = reverbSend.data();
+    int16_t* right = reverbRight.data();
+    reverb->processStereo(left, left, right, frames);
+    for (size_t frame = 0; frame < frames; ++frame) {
+      float gain = reverbGain[frame];
+      for (int ch = 0; ch < channels; ++ch) {
+        float ret = channels == 1 ? 0.5f * (left[frame] + right[frame])
+                                  : (ch & 1) ? right[frame] : left[frame];
+        int32_t value = mixed[frame * channels + ch] + static_cast<int32_t>(gain * ret);
+        if (value > 32767) value = 32767;
+        if (value < -32768) value = -32768;
+        mixed[frame * channels + ch] = static_cast<int16_t>(value);
       }
-    } else {
-      currentWetMix = targetWetMix;
     }
-    return currentWetMix;
   }
 
   float advanceAttackGain() {
@@ -384,50 +530,52 @@ private:
     return gain;
   }
 
-  void refreshInputFilterState() {
-    inputFilterInitialized = false;
-    if (channels <= 0) {
-      inputLowPassFilters.clear();
-      filteredDryScratch.clear();
-      return;
-    }
+  template <class T>
+  static void moveTo(Allocator& allocator, Vector<T>& vector) {
+    vector.reset();
+    vector.setAllocator(allocator);
+  }
 
-    filteredDryScratch.assign(static_cast<size_t>(channels), 0.0f);
+  // One block for every buffer of the callback; a Vector only allocates
+  // when it has to grow.
+  void allocateBlockBuffers() {
+    size_t samples = MIXER_BLOCK_FRAMES * channels;
+    mixBuffer.resize(samples);
+    if (sampleBytes == sizeof(int32_t)) {
+      convertedInput.resize(samples);
+      expandedOutput.resize(samples);
+    }
+    reverbSend.resize(MIXER_BLOCK_FRAMES);
+    reverbRight.resize(MIXER_BLOCK_FRAMES);
+    reverbGain.resize(MIXER_BLOCK_FRAMES);
+    wetBuffer.resize(MIXER_BLOCK_FRAMES);
+    silence.resize(MIXER_BLOCK_FRAMES * frameBytes);
+    inputLowPassFilters.resize(channels);
+  }
 
-    if (!inputFilterEnabled || sampleRate == 0) {
-      inputFilterCutoff = inputFilterTargetCutoff;
+  void refreshInputFilterState() {
+    inputFilterInitialized = false;
+    if (!inputFilterEnabled || sampleRate == 0 ||
+        inputLowPassFilters.size() < channels) {
+      filterCutoff.setValue(filterCutoff.target());
+      filterQ.setValue(filterQ.target());
       return;
     }
 
-    if (inputLowPassFilters.size() < static_cast<size_t>(channels)) {
-      inputLowPassFilters.resize(static_cast<size_t>(channels));
-    }
-
-    for (int ch = 0; ch < channels; ++ch) {
-      if (!inputLowPassFilters[ch]) {
-        inputLowPassFilters[ch].reset(new LowPassFilter<float>());
-      }
-    }
-
-    if (inputFilterTargetCutoff <= 0.0f) {
-      inputFilterTargetCutoff = std::max(0.0f, inputFilterCutoff);
-    }
-    inputFilterCutoff = inputFilterTargetCutoff;
+    filterCutoff.setValue(std::max(0.0f, filterCutoff.target()));
+    filterQ.setValue(filterQ.target());
     inputFilterInitialized = true;
-    applyInputFilterCutoff(inputFilterCutoff);
+    applyInputFilterCutoff(filterCutoff.value());
   }
 
   float processInputLowPass(float sample, int channelIndex) {
     if (!inputFilterEnabled || !inputFilterInitialized) {
       return sample;
     }
-    if (channelIndex < 0 ||
-        channelIndex >= static_cast<int>(inputLowPassFilters.size())) {
+    if (channelIndex < 0 || channelIndex >= inputLowPassFilters.size()) {
       return sample;
     }
-    LowPassFilter<float>* filter = inputLowPassFilters[channelIndex].get();
-    if (filter == nullptr) return sample;
-    return filter->process(sample);
+    return inputLowPassFilters[channelIndex].process(sample);
   }
 
   void applyInputFilterCutoff(float cutoffHz) {
@@ -441,63 +589,235 @@ private:
     if (clampedCutoff < 0.0f) {
       clampedCutoff = 0.0f;
     }
-    for (size_t i = 0; i < inputLowPassFilters.size(); ++i) {
-      LowPassFilter<float>* filter = inputLowPassFilters[i].get();
-      if (filter) {
-        filter->begin(clampedCutoff, static_cast<float>(sampleRate), inputFilterQ);
-      }
+    for (int i = 0; i < inputLowPassFilters.size(); ++i) {
+      inputLowPassFilters[i].begin(clampedCutoff, static_cast<float>(sampleRate),
+                                   filterQ.value());
     }
   }
 
-  void advanceInputFilterCutoff(size_t frames) {
-    if (!inputFilterEnabled || !inputFilterInitialized) {
+  // The cutoff moves with the configured slew rate (or over the morph time);
+  // coefficients are only recomputed once per block while it is moving.
+  void setFilterCutoffTarget(float cutoffHz, uint32_t frames) {
+    if (!inputFilterEnabled || !inputFilterInitialized || sampleRate == 0) {
+      filterCutoff.setValue(cutoffHz);
       return;
     }
-    if (sampleRate == 0) {
-      return;
+    if (frames == 0) {
+      float seconds = fabsf(cutoffHz - filterCutoff.value()) / inputFilterSlewRateHzPerSec;
+      frames = static_cast<uint32_t>(seconds * static_cast<float>(sampleRate));
+      if (frames == 0) frames = 1;
     }
-    float delta = inputFilterTargetCutoff - inputFilterCutoff;
-    const float epsilon = 0.05f;
-    if (fabs(delta) <= epsilon) {
-      if (inputFilterCutoff != inputFilterTargetCutoff) {
-        inputFilterCutoff = inputFilterTargetCutoff;
-        applyInputFilterCutoff(inputFilterCutoff);
+    filterCutoff.setTarget(cutoffHz, frames);
+  }
+
+  void beginSmoothing() {
+    float rate = static_cast<float>(sampleRate);
+    dryLevel.begin(rate, PARAM_SMOOTHING_MS);
+    wetLevel.begin(rate, PARAM_SMOOTHING_MS);
+    delayDepth.begin(rate, PARAM_SMOOTHING_MS);
+    delayFeedback.begin(rate, PARAM_SMOOTHING_MS);
+    inputGain.begin(rate, VOLUME_SMOOTHING_MS);
+    filterCutoff.begin(rate, PARAM_SMOOTHING_MS);
+    filterQ.begin(rate, PARAM_SMOOTHING_MS);
+    compThreshold.begin(rate, PARAM_SMOOTHING_MS);
+    compRatio.begin(rate, PARAM_SMOOTHING_MS);
+  }
+
+  // Per-block parameters: only do work while one of them is moving.
+  void advanceBlockParams(size_t frames) {
+    uint32_t n = static_cast<uint32_t>(frames);
+    uint32_t morphFrames = morphFramesRemaining.load(std::memory_order_relaxed);
+    if (morphFrames > 0) {
+      morphFramesRemaining.store(morphFrames - std::min(morphFrames, n),
+                                 std::memory_order_relaxed);
+    }
+    if (filterCutoff.isSmoothing() || filterQ.isSmoothing()) {
+      filterCutoff.skip(n);
+      filterQ.skip(n);
+      applyInputFilterCutoff(filterCutoff.value());
+    }
+    if (compThreshold.isSmoothing() || compRatio.isSmoothing()) {
+      compThreshold.skip(n);
+      compRatio.skip(n);
+      if (masterCompressorReady) {
+        masterCompressor.setThresholdPercent(static_cast<uint8_t>(compThreshold.value()));
+        masterCompressor.setCompressionRatio(compRatio.value());
       }
-      return;
     }
+  }
 
-    float seconds;
-    if (frames > 0) {
-      seconds = static_cast<float>(frames) / static_cast<float>(sampleRate);
-    } else {
-      seconds = 1.0f / static_cast<float>(sampleRate);
-    }
-    float maxStep = inputFilterSlewRateHzPerSec * seconds;
-    if (maxStep <= 0.0f) {
-      maxStep = inputFilterSlewRateHzPerSec / static_cast<float>(sampleRate);
+  // Resets the compressor; only needed when the sample rate changes.
+  void refreshMasterCompressor() {
+    masterCompressorReady = sampleRate > 0;
+    if (!masterCompressorReady) return;
+    masterCompressor = Compressor(sampleRate, compAttackMs, compReleaseMs,
+                                  compHoldMs,
+                                  static_cast<uint8_t>(compThreshold.value()),
+                                  compRatio.value());
+    masterCompressor.setActive(masterCompressorEnabled);
+  }
+
+  // Only needed when the sample rate changes; keeps the current gains.
+  void beginMasterEq() {
+    masterEq.setSmoothingTime(PARAM_SMOOTHING_MS);
+    masterEq.begin(static_cast<float>(sampleRate), 1, MASTER_EQ_FIXED_POINT);
+    masterEq.setLowFrequency(MASTER_EQ_LOW_HZ);
+    masterEq.setHighFrequency(MASTER_EQ_HIGH_HZ);
+    masterEq.setMid(0, MASTER_EQ_MID_HZ, MASTER_EQ_MID_Q);
+    setMasterEqGains(0);
+  }
+
+  // Band order of eqGainDb: low, mid, high. frames == 0 jumps.
+  void setMasterEqGains(uint32_t frames) {
+    masterEq.setGain(BlockEqualizer<2>::Low, eqGainDb[0], frames);
+    masterEq.setGain(BlockEqualizer<2>::Mid, eqGainDb[1], frames);
+    masterEq.setGain(BlockEqualizer<2>::High, eqGainDb[2], frames);
+  }
+
+  // Updates the existing compressor in place (no allocation).
+  void applyMasterCompressorSettings() {
+    if (!masterCompressorReady) return;
+    masterCompressor.setAttack(compAttackMs);
+    masterCompressor.setRelease(compReleaseMs);
+    masterCompressor.setHold(compHoldMs);
+    masterCompressor.setThresholdPercent(static_cast<uint8_t>(compThreshold.value()));
+    masterCompressor.setCompressionRatio(compRatio.value());
+    masterCompressor.setActive(masterCompressorEnabled);
+  }
+
+  // Single writer (the control task); the audio thread never blocks on it.
+  void publishControl(Control changed) {
+    control.version[changed]++;
+    controlMailbox.write(control);
+  }
+
+  void publishParams(const EffectParams* from, const EffectParams& to,
+                     uint32_t morphMs) {
+    control.params = to;
+    control.hasFrom = from != nullptr;
+    if (from) control.from = *from;
+    control.morphMs = morphMs;
+    publishControl(Params);
+  }
+
+  // Audio thread: takes the latest published state, if any, and applies what
+  // was changed since the last one. The switches and pots come before the
+  // effect snapshot, as they did when they were set directly.
+  void applyControls() {
+    if (!controlMailbox.update()) return;
+    const ControlState& c = controlMailbox.front();
+    auto changed = [&](Control which) {
+      if (c.version[which] == appliedVersion[which]) return false;
+      appliedVersion[which] = c.version[which];
+      return true;
+    };
+    if (changed(InputGain)) inputGain.setTarget(clampFloat(c.inputGain, 0.0f, 1.0f));
+    if (changed(SlewRate)) {
+      inputFilterSlewRateHzPerSec = clampFloat(c.slewHzPerSec,
+                                               FILTER_SLEW_MIN_HZ_PER_SEC,
+                                               FILTER_SLEW_MAX_HZ_PER_SEC);
+    }
+    if (changed(LowPass)) {
+      filterCutoff.setValue(clampFloat(c.lowPassCutoffHz, LOW_PASS_MIN_HZ, LOW_PASS_MAX_HZ));
+      filterQ.setValue(clampFloat(c.lowPassQ, LOW_PASS_Q_MIN, LOW_PASS_Q_MAX));
+      inputFilterEnabled = c.lowPassEnabled;
+      refreshInputFilterState();
+    }
+    if (changed(LowPassCutoff)) {
+      setFilterCutoffTarget(clampFloat(c.cutoffTargetHz, 0.0f, LOW_PASS_MAX_HZ), 0);
+    }
+    if (changed(EffectActive)) {
+      effectEnabled = c.effectActive;
+      wetLevel.setTarget(effectEnabled ? wetMixActive : 0.0f, fadeFrames);
+    }
+    if (changed(SendActive)) sendActive = c.sendActive;
+    if (changed(Params)) {
+      uint32_t morphFrames = static_cast<uint32_t>((static_cast<uint64_t>(sampleRate) * c.morphMs) / 1000);
+      applyDiscreteParams(c.params);
+      if (c.hasFrom) jumpContinuousParams(c.from);
+      setContinuousTargets(c.params, morphFrames);
+      morphFramesRemaining.store(morphFrames, std::memory_order_relaxed);
+    }
+    if (changed(DelaySamples) && delay) delay->setDelaySamples(c.delaySamples);
+  }
+
+  void applyDiscreteParams(const EffectParams& p) {
+    // fractions of a ms are kept; a synced delay comes in samples with
+    // setDelaySamples() and has these ms, so it is not rounded here
+    if (delay && p.delayTimeMs != delay->getDuration()) {
+      delay->setDuration(p.delayTimeMs);
     }
-    if (delta > maxStep) {
-      delta = maxStep;
-    } else if (delta < -maxStep) {
-      delta = -maxStep;
+    inputFilterSlewRateHzPerSec = clampFloat(p.filterSlewHzPerSec,
+                                             FILTER_SLEW_MIN_HZ_PER_SEC,
+                                             FILTER_SLEW_MAX_HZ_PER_SEC);
+    compAttackMs = static_cast<uint16_t>(p.compAttackMs);
+    compReleaseMs = static_cast<uint16_t>(p.compReleaseMs);
+    compHoldMs = static_cast<uint16_t>(p.compHoldMs);
+    masterCompressorEnabled = p.compEnabled != 0;
+    if (masterCompressorReady) {
+      masterCompressor.setAttack(compAttackMs);
+      masterCompressor.setRelease(compReleaseMs);
+      masterCompressor.setHold(compHoldMs);
+      masterCompressor.setActive(masterCompressorEnabled);
     }
+  }
 
-    inputFilterCutoff += delta;
-    if (inputFilterCutoff < 0.0f) {
-      inputFilterCutoff = 0.0f;
-    }
-    applyInputFilterCutoff(inputFilterCutoff);
+  // Starting point of a morph: the next block starts at these values.
+  void jumpContinuousParams(const EffectParams& p) {
+    dryLevel.setValue(clampFloat(p.dryMix, MIXER_DRY_MIN, MIXER_DRY_MAX));
+    wetMixActive = clampFloat(p.wetMix, MIXER_WET_MIN, MIXER_WET_MAX);
+    wetLevel.setValue(effectEnabled ? wetMixActive : 0.0f);
+    delayDepth.setValue(p.delayDepth);
+    delayFeedback.setValue(p.delayFeedback);
+    filterCutoff.setValue(clampFloat(p.filterCutoffHz, 0.0f, LOW_PASS_MAX_HZ));
+    filterQ.setValue(clampFloat(p.filterQ, LOW_PASS_Q_MIN, LOW_PASS_Q_MAX));
+    compThreshold.setValue(p.compThresholdPercent);
+    compRatio.setValue(p.compRatio);
+    if (delay) {
+      delay->setDepth(delayDepth.value());
+      delay->setFeedback(delayFeedback.value());
+    }
+    applyInputFilterCutoff(filterCutoff.value());
+    applyMasterCompressorSettings();
+    eqGainDb[0] = p.eqLowDb;
+    eqGainDb[1] = p.eqMidDb;
+    eqGainDb[2] = p.eqHighDb;
+    setMasterEqGains(0);
   }
 
-  void refreshMasterCompressor() {
-    if (sampleRate == 0) {
-      masterCompressor.reset();
-      return;
+  // frames == 0 uses each parameter's default smoothing time.
+  void setContinuousTargets(const EffectParams& p, uint32_t frames) {
+    auto glide = [frames](SmoothedParameter& param, float target) {
+      if (frames > 0) {
+        param.setTarget(target, frames);
+      } else {
+        param.setTarget(target);
+      }
+    };
+    glide(dryLevel, clampFloat(p.dryMix, MIXER_DRY_MIN, MIXER_DRY_MAX));
+    wetMixActive = clampFloat(p.wetMix, MIXER_WET_MIN, MIXER_WET_MAX);
+    glide(wetLevel, effectEnabled ? wetMixActive : 0.0f);
+    glide(delayDepth, p.delayDepth);
+    glide(delayFeedback, p.delayFeedback);
+    setFilterCutoffTarget(clampFloat(p.filterCutoffHz, 0.0f, LOW_PASS_MAX_HZ), frames);
+    float q = clampFloat(p.filterQ, LOW_PASS_Q_MIN, LOW_PASS_Q_MAX);
+    if (inputFilterEnabled && inputFilterInitialized) {
+      glide(filterQ, q);
+    } else {
+      filterQ.setValue(q);
+    }
+    glide(compThreshold, p.compThresholdPercent);
+    glide(compRatio, p.compRatio);
+    eqGainDb[0] = p.eqLowDb;
+    eqGainDb[1] = p.eqMidDb;
+    eqGainDb[2] = p.eqHighDb;
+    if (frames > 0) {
+      setMasterEqGains(frames);
+    } else {
+      masterEq.setGain(BlockEqualizer<2>::Low, eqGainDb[0]);
+      masterEq.setGain(BlockEqualizer<2>::Mid, eqGainDb[1]);
+      masterEq.setGain(BlockEqualizer<2>::High, eqGainDb[2]);
     }
-  masterCompressor.reset(new Compressor(sampleRate, compAttackMs,
-                      compReleaseMs, compHoldMs,
-                      compThresholdPercent, compRatio));
-    masterCompressor->setActive(masterCompressorEnabled);
   }
 
   static float clampFloat(float value, float minValue, float maxValue) {
@@ -2,27 +2,18 @@
 #include <SD.h>
 #include <Wire.h>
 #include <AudioTools.h>
-#include "AudioTools/Disk/AudioSourceSD.h"
-#include "AudioTools/AudioCodecs/CodecWAV.h"
 #include <ScopeI2SStream.h>
 #include <algorithm>
 #include <cstring>
 #include <vector>
 #include "AudioTools/CoreAudio/AudioEffects/AudioEffects.h"
 #include "config.h"
-#include "audio_mixer.h"
+#include "audio_engine.h"
 #include "input.h"
+#include "effect_params.h"
+#include "presets.h"
 #include "settings_storage.h"
 
-// Audio stack
-AudioSourceSD source("/", "wav");
-I2SStream i2s;
-WAVDecoder wavDecoder;
-AudioPlayer player(source, i2s, wavDecoder);
-DryWetMixerStream mixerStream;
-Delay delayEffect;
-DryWetMixerStream* DryWetMixerStream::s_instance = nullptr;
-
 // Display & scope (moved to ui module)
 #include "ui.h"
 #include "SettingsScreenU8g2.h"
@@ -33,21 +24,11 @@ DryWetMixerStream* DryWetMixerStream::s_instance = nullptr;
 #include "settings_storage.h"
 // State
 int activeButtonIndex = -1;
-String currentSamplePath = "";
-float currentFilterCutoffHz = LOW_PASS_CUTOFF_HZ;
-float currentFilterQ = LOW_PASS_Q;
-float currentFilterSlewHzPerSec = FILTER_SLEW_DEFAULT_HZ_PER_SEC;
-float currentDelayTimeMs = DEFAULT_DELAY_TIME_MS;
-float currentDelayDepth = DEFAULT_DELAY_DEPTH;
-float currentDelayFeedback = DEFAULT_DELAY_FEEDBACK;
-float currentDryMix = MIXER_DEFAULT_DRY_LEVEL;
-float currentWetMix = MIXER_DEFAULT_WET_LEVEL;
-bool currentCompEnabled = MASTER_COMPRESSOR_ENABLED;
-uint16_t currentCompAttackMs = MASTER_COMPRESSOR_ATTACK_MS;
-uint16_t currentCompReleaseMs = MASTER_COMPRESSOR_RELEASE_MS;
-uint16_t currentCompHoldMs = MASTER_COMPRESSOR_HOLD_MS;
-uint8_t currentCompThresholdPercent = MASTER_COMPRESSOR_THRESHOLD_PERCENT;
-float currentCompRatio = MASTER_COMPRESSOR_RATIO;
+const char* currentSamplePath = "";
+// Complete live effect state; every change is published to the mixer as one
+// snapshot instead of through individual setters.
+EffectParams liveParams = defaultEffectParams();
+PresetBank presets;
 
 // Settings screen instance (created at runtime after display init)
 SettingsScreenU8g2* settingsScreen = nullptr;
@@ -83,6 +64,9 @@ Button buttons[BUTTON_COUNT] = {
 };
 
 VolumeManager volume(POT_PIN);
+#if USE_I2S_INPUT
+I2SStream i2sIn;
+#endif
 
 
 // Audio/display init helpers
@@ -100,63 +84,162 @@ void initDisplay() {
   }
 }
 
-//check which parts and lines arent used anymore and delete them
-void initAudio() {
+// The I2S output (with the scope tap) feeds the engine's chain
+void initI2sAudio() {
   auto cfg = scopeI2s.defaultConfig(TX_MODE);
   cfg.pin_bck = I2S_PIN_BCK;
   cfg.pin_ws  = I2S_PIN_WS;
   cfg.pin_data = I2S_PIN_DATA;
   scopeI2s.begin(cfg);
-  mixerStream.begin(scopeI2s, delayEffect);
-  uint32_t effectiveSampleRate = cfg.sample_rate > 0 ? cfg.sample_rate : 44100;
-  AudioInfo mixInfo;
-  mixInfo.sample_rate = effectiveSampleRate;
-  mixInfo.channels = cfg.channels > 0 ? cfg.channels : 2;
-  mixInfo.bits_per_sample = cfg.bits_per_sample > 0 ? cfg.bits_per_sample : 16;
-  mixerStream.setAudioInfo(mixInfo);
-  mixerStream.updateEffectSampleRate(effectiveSampleRate);
-  mixerStream.setMix(currentDryMix, currentWetMix);
-  mixerStream.configureMasterCompressor(currentCompAttackMs,
-                                        currentCompReleaseMs,
-                                        currentCompHoldMs,
-                                        currentCompThresholdPercent,
-                                        currentCompRatio,
-                                        currentCompEnabled);
-  mixerStream.setInputLowPassSlewRate(currentFilterSlewHzPerSec);
-  delayEffect.setDuration(static_cast<uint32_t>(currentDelayTimeMs));      // milliseconds
-  delayEffect.setDepth(currentDelayDepth);       // wet mix ratio handled in mixer
-  delayEffect.setFeedback(currentDelayFeedback);    // repeats
-  player.setOutput(mixerStream);
-  player.setSilenceOnInactive(true);
-  player.setAutoNext(false);
-  player.setDelayIfOutputFull(0);
-  player.setFadeTime(BUTTON_FADE_MS);
-  player.begin();
-  player.stop();
+  initAudio(scopeI2s, cfg, liveParams);
+#if USE_I2S_INPUT
+  // line in for live sampling on the second port; it is read between two
+  // blocks, so a read must never wait for the DMA
+  auto inCfg = i2sIn.defaultConfig(RX_MODE);
+  inCfg.copyFrom(cfg);
+  inCfg.port_no = 1;
+  inCfg.pin_bck = I2S_IN_PIN_BCK;
+  inCfg.pin_ws = I2S_IN_PIN_WS;
+  inCfg.pin_data = I2S_IN_PIN_DATA;
+  if (i2sIn.begin(inCfg)) {
+    i2sIn.driver()->setWaitTimeReadMs(0);
+    setRecordInput(&i2sIn);
+  } else {
+    Serial.println("I2S ingang kon niet starten");
+  }
+#endif
+}
+
+// Record switch on: a pad press records into that pad, the next press ends
+// the take, which the pad plays from then on.
+static bool recordSwitchOn() {
+  return SWITCH_PIN_RECORD >= 0 && digitalRead(SWITCH_PIN_RECORD) == LOW;
+}
+
+static void handleRecordTrigger(size_t idx) {
+  if (sampleRecorder.status().recording) {
+    stopRecording();
+    return;
+  }
+  RecordSource from = USE_I2S_INPUT ? RecordSource::Input : RecordSource::Output;
+  if (startRecording(idx, from)) {
+    Serial.printf("Recording pad %u\n", static_cast<unsigned>(idx + 1));
+  } else {
+    Serial.printf("Opname op pad %u kan niet starten\n", static_cast<unsigned>(idx + 1));
+  }
 }
 
+#if USE_AUDIO_PROFILER
+// Prints the per stage processing times and shows the load of the whole
+// block on the settings screen. Stage times are inclusive: each stage
+// contains the stages it writes to.
+static void reportProfiler(uint32_t now) {
+  static uint32_t lastReport = 0;
+  if (now - lastReport < PROFILER_REPORT_INTERVAL_MS) return;
+  lastReport = now;
+  AudioProfiler& profiler = AudioProfiler::instance();
+  if (settingsScreen) settingsScreen->setCpuLoadPercent(profiler.loadPercent("copy"));
+  profiler.printReport(Serial);
+  profiler.reset();
+}
+#endif
+
+#if USE_ALLOCATION_GUARD
+// Heap allocations in processAudio() since the last report: should stay 0
+static void reportAllocations(uint32_t now) {
+  static uint32_t lastReport = 0;
+  if (now - lastReport < PROFILER_REPORT_INTERVAL_MS) return;
+  lastReport = now;
+  printAudioMemoryReport(Serial);
+  AllocationGuard::instance().reset();
+}
+#endif
+
+// Tap tempo: one pad of TEMPO_TAP_BUTTONS is tapped while the other is held
+static bool isTempoTap(size_t idx) {
+  if (idx == TEMPO_TAP_BUTTONS[0]) return buttons[TEMPO_TAP_BUTTONS[1]].readRaw();
+  if (idx == TEMPO_TAP_BUTTONS[1]) return buttons[TEMPO_TAP_BUTTONS[0]].readRaw();
+  return false;
+}
+
+#if USE_MIDI_INPUT
+// Scheduling lateness of the MIDI notes
+static void reportMidi(uint32_t now) {
+  static uint32_t lastReport = 0;
+  if (now - lastReport < MIDI_REPORT_INTERVAL_MS) return;
+  lastReport = now;
+  printMidiReport(Serial);
+  resetMidiTiming();
+}
+#endif
+
 void applyFilterSwitchState(bool enabled) {
-  mixerStream.setInputLowPassSlewRate(currentFilterSlewHzPerSec);
-  mixerStream.configureMasterLowPass(currentFilterCutoffHz,
-                                     currentFilterQ, enabled);
+  mixerStream.setInputLowPassSlewRate(liveParams.filterSlewHzPerSec);
+  mixerStream.configureMasterLowPass(liveParams.filterCutoffHz,
+                                     liveParams.filterQ, enabled);
+}
+
+static void publishLiveParams() {
+  mixerStream.setParams(liveParams);
+}
+
+// Mirrors the live state on the settings screen without re-publishing each
+// value through its change callback.
+static void syncSettingsScreenFromLiveParams() {
+  if (!settingsScreen) return;
+  settingsScreen->withCallbacksMuted([]() {
+    settingsScreen->setDelayTimeMs(liveParams.delayTimeMs);
+    settingsScreen->setDelayDepth(liveParams.delayDepth);
+    settingsScreen->setDelayFeedback(liveParams.delayFeedback);
+    settingsScreen->setFilterCutoffHz(liveParams.filterCutoffHz);
+    settingsScreen->setFilterQ(liveParams.filterQ);
+    settingsScreen->setFilterSlewHzPerSec(liveParams.filterSlewHzPerSec);
+    settingsScreen->setDryMix(liveParams.dryMix);
+    settingsScreen->setWetMix(liveParams.wetMix);
+    settingsScreen->setCompressorEnabled(liveParams.compEnabled != 0);
+    settingsScreen->setCompressorAttackMs(liveParams.compAttackMs);
+    settingsScreen->setCompressorReleaseMs(liveParams.compReleaseMs);
+    settingsScreen->setCompressorHoldMs(liveParams.compHoldMs);
+    settingsScreen->setCompressorThresholdPercent(liveParams.compThresholdPercent);
+    settingsScreen->setCompressorRatio(liveParams.compRatio);
+  });
+}
+
+// Recalls a preset: one snapshot copy to the mixer, which morphs to it per
+// sample over morphMs.
+bool recallPreset(size_t slot, uint32_t morphMs) {
+  const EffectParams* preset = presets.get(slot);
+  if (!preset) {
+    Serial.printf("Preset %u is empty\n", static_cast<unsigned>(slot + 1));
+    return false;
+  }
+  liveParams = *preset;
+  mixerStream.setParams(liveParams, morphMs);
+  syncSettingsScreenFromLiveParams();
+  return true;
+}
+
+bool storePreset(size_t slot) {
+  if (!presets.store(slot, liveParams)) return false;
+  if (settingsScreen) settingsScreen->setPresetUsedMask(presets.getUsedMask());
+  Serial.printf("Stored preset %u\n", static_cast<unsigned>(slot + 1));
+  return true;
 }
 
 // play helper
 bool playSampleForButton(size_t idx) {
   if (idx >= BUTTON_COUNT) return false;
-  const char* path = buttons[idx].getPath();
-  if (path == nullptr || path[0] == '\0') {
-    Serial.println("Geen geldig pad om af te spelen");
-    return false;
-  }
-  String full = String(path);
-  if (full.charAt(0) != '/') full = String("/") + full;
-  if (!player.setPath(full.c_str())) {
-    Serial.printf("Kon bestand %s niet openen\n", full.c_str());
-    return false;
+  char full[MANIFEST_PATH_LEN] = "";
+  if (chopEntry == nullptr) {
+    const char* path = buttons[idx].getPath();
+    if (path == nullptr || path[0] == '\0') {
+      Serial.println("Geen geldig pad om af te spelen");
+      return false;
+    }
+    snprintf(full, sizeof(full), "%s%s", path[0] == '/' ? "" : "/", path);
   }
-  currentSamplePath = full;
-  player.play();
+  if (!playSample(idx, full)) return false;
+  currentSamplePath = playingSamplePath();
   // No per-play attack fade: the delay always runs and sending is controlled
   // by the hardware switch via setSendActive().
   activeButtonIndex = (int)idx;
@@ -176,88 +259,73 @@ static void initSettingsScreen() {
     setScopeHorizZoom(zoomFactor);
   });
   settingsScreen->setDelayTimeCallback([](float durationMs) {
-    currentDelayTimeMs = durationMs;
-    delayEffect.setDuration(static_cast<uint32_t>(durationMs));
+    // a delay time of its own ends the tempo sync
+    tempoSync.setDivision(BeatDivision::Off);
+    liveParams.delayTimeMs = durationMs;
+    publishLiveParams();
   });
   settingsScreen->setDelayDepthCallback([](float depth) {
-    currentDelayDepth = depth;
-    delayEffect.setDepth(depth);
+    liveParams.delayDepth = depth;
+    publishLiveParams();
   });
   settingsScreen->setDelayFeedbackCallback([](float feedback) {
-    currentDelayFeedback = feedback;
-    delayEffect.setFeedback(feedback);
+    liveParams.delayFeedback = feedback;
+    publishLiveParams();
   });
   settingsScreen->setFilterCutoffCallback([](float cutoffHz) {
-    currentFilterCutoffHz = cutoffHz;
+    liveParams.filterCutoffHz = cutoffHz;
     applyFilterSwitchState(filterSwitchDebouncedState);
   });
   settingsScreen->setFilterQCallback([](float q) {
-    currentFilterQ = q;
-    mixerStream.setInputLowPassQ(q);
+    liveParams.filterQ = q;
+    publishLiveParams();
   });
   settingsScreen->setFilterSlewCallback([](float hzPerSec) {
-    currentFilterSlewHzPerSec = hzPerSec;
-    mixerStream.setInputLowPassSlewRate(hzPerSec);
+    liveParams.filterSlewHzPerSec = hzPerSec;
+    publishLiveParams();
+  });
+  settingsScreen->setDryMixCallback([](float dry) {
+    liveParams.dryMix = dry;
+    publishLiveParams();
+  });
+  settingsScreen->setWetMixCallback([](float wet) {
+    liveParams.wetMix = wet;
+    publishLiveParams();
   });
-  auto applyMix = []() {
-    mixerStream.setMix(currentDryMix, currentWetMix);
-  };
-  settingsScreen->setDryMixCallback([applyMix](float dry) {
-    currentDryMix = dry;
-    applyMix();
+  settingsScreen->setCompressorEnabledCallback([](bool enabled) {
+    liveParams.compEnabled = enabled ? 1 : 0;
+    publishLiveParams();
   });
-  settingsScreen->setWetMixCallback([applyMix](float wet) {
-    currentWetMix = wet;
-    applyMix();
+  settingsScreen->setCompressorAttackCallback([](float attackMs) {
+    liveParams.compAttackMs = attackMs;
+    publishLiveParams();
   });
-  auto rebuildCompressor = []() {
-    mixerStream.configureMasterCompressor(currentCompAttackMs,
-                                          currentCompReleaseMs,
-                                          currentCompHoldMs,
-                                          currentCompThresholdPercent,
-                                          currentCompRatio,
-                                          currentCompEnabled);
-  };
-  settingsScreen->setCompressorEnabledCallback([rebuildCompressor](bool enabled) {
-    currentCompEnabled = enabled;
-    rebuildCompressor();
+  settingsScreen->setCompressorReleaseCallback([](float releaseMs) {
+    liveParams.compReleaseMs = releaseMs;
+    publishLiveParams();
   });
-  settingsScreen->setCompressorAttackCallback([rebuildCompressor](float attackMs) {
-    currentCompAttackMs = static_cast<uint16_t>(attackMs);
-    rebuildCompressor();
+  settingsScreen->setCompressorHoldCallback([](float holdMs) {
+    liveParams.compHoldMs = holdMs;
+    publishLiveParams();
   });
-  settingsScreen->setCompressorReleaseCallback([rebuildCompressor](float releaseMs) {
-    currentCompReleaseMs = static_cast<uint16_t>(releaseMs);
-    rebuildCompressor();
+  settingsScreen->setCompressorThresholdCallback([](float thresholdPercent) {
+    liveParams.compThresholdPercent = thresholdPercent;
+    publishLiveParams();
   });
-  settingsScreen->setCompressorHoldCallback([rebuildCompressor](float holdMs) {
-    currentCompHoldMs = static_cast<uint16_t>(holdMs);
-    rebuildCompressor();
+  settingsScreen->setCompressorRatioCallback([](float ratio) {
+    liveParams.compRatio = ratio;
+    publishLiveParams();
   });
-  settingsScreen->setCompressorThresholdCallback([rebuildCompressor](float thresholdPercent) {
-    currentCompThresholdPercent = static_cast<uint8_t>(thresholdPercent);
-    rebuildCompressor();
+  settingsScreen->setPresetRecallCallback([](uint8_t slot, float morphMs) {
+    recallPreset(slot, static_cast<uint32_t>(morphMs));
   });
-  settingsScreen->setCompressorRatioCallback([rebuildCompressor](float ratio) {
-    currentCompRatio = ratio;
-    rebuildCompressor();
+  settingsScreen->setPresetStoreCallback([](uint8_t slot) {
+    storePreset(slot);
   });
 
   settingsScreen->setZoom(DEFAULT_HORIZ_ZOOM);
-  settingsScreen->setDelayTimeMs(currentDelayTimeMs);
-  settingsScreen->setDelayDepth(currentDelayDepth);
-  settingsScreen->setDelayFeedback(currentDelayFeedback);
-  settingsScreen->setFilterCutoffHz(currentFilterCutoffHz);
-  settingsScreen->setFilterQ(currentFilterQ);
-  settingsScreen->setFilterSlewHzPerSec(currentFilterSlewHzPerSec);
-  settingsScreen->setDryMix(currentDryMix);
-  settingsScreen->setWetMix(currentWetMix);
-  settingsScreen->setCompressorEnabled(currentCompEnabled);
-  settingsScreen->setCompressorAttackMs(currentCompAttackMs);
-  settingsScreen->setCompressorReleaseMs(currentCompReleaseMs);
-  settingsScreen->setCompressorHoldMs(currentCompHoldMs);
-  settingsScreen->setCompressorThresholdPercent(currentCompThresholdPercent);
-  settingsScreen->setCompressorRatio(currentCompRatio);
+  syncSettingsScreenFromLiveParams();
+  settingsScreen->setPresetUsedMask(presets.getUsedMask());
 }
 
 static void releaseAllButtons() {
@@ -282,7 +350,8 @@ static void applyOperatingModeChange(OperatingMode newMode) {
     if (settingsScreen) settingsScreen->exit();
     setScopeDisplaySuspended(false);
     releaseAllButtons();
-  saveSettingsToSd(settingsScreen);
+    // Queued for the background storage task; never blocks the audio loop.
+    saveSettingsToSd(settingsScreen, &presets);
   }
   lastOperatingMode = newMode;
 }
@@ -330,27 +399,38 @@ void setup() {
   bool filterInit = (digitalRead(SWITCH_PIN_ENABLE_FILTER) == LOW);
   filterSwitchRawState = filterSwitchDebouncedState = filterInit;
 
+  if (SWITCH_PIN_RECORD >= 0) pinMode(SWITCH_PIN_RECORD, INPUT_PULLUP);
+
   pinMode(SWITCH_PIN_SETTINGS_MODE, INPUT_PULLUP);
   bool settingsModeInit = (digitalRead(SWITCH_PIN_SETTINGS_MODE) == LOW);
   settingsModeRawState = settingsModeDebouncedState = settingsModeInit;
 
   initSd();
+  beginSettingsStorage();
   initDisplay();
   if (auto mutexPtr = static_cast<SemaphoreHandle_t*>(getDisplayMutex())) {
     displayMutex = *mutexPtr;
   }
 
-  initAudio();
+  initI2sAudio();
+  const char* samplePaths[BUTTON_COUNT];
+  for (size_t i = 0; i < BUTTON_COUNT; ++i) samplePaths[i] = buttons[i].getPath();
+  initSampleBank(samplePaths);
+  initConvolver();
   initSettingsScreen();
-  loadSettingsFromSd(settingsScreen);
+  loadSettingsFromSd(settingsScreen, &presets);
   if (settingsScreen) {
     setScopeHorizZoom(settingsScreen->getZoom());
+    settingsScreen->setPresetUsedMask(presets.getUsedMask());
   }
   applyOperatingModeChange(operatingMode);
 
+  volume.setVolumeUpdateCallback([](float gain) {
+    mixerStream.setInputGain(gain);
+  });
   volume.begin();
   volume.setCutoffUpdateCallback([](float cutoffHz) {
-    currentFilterCutoffHz = cutoffHz;
+    liveParams.filterCutoffHz = cutoffHz;
     mixerStream.setInputLowPassCutoff(cutoffHz);
   });
   volume.setFilterControlActive(filterSwitchDebouncedState);
@@ -360,6 +440,19 @@ void setup() {
   mixerStream.setEffectActive(true);
   mixerStream.setSendActive(switchDebouncedState);
   applyFilterSwitchState(filterSwitchDebouncedState);
+  // control changes and the tempo sync write the live parameters
+  setMidiEffectParams(&liveParams, syncSettingsScreenFromLiveParams);
+#if USE_MIDI_INPUT
+  // receive only: the TX pin stays free
+  Serial2.begin(MIDI_BAUD, SERIAL_8N1, MIDI_RX_PIN, -1);
+  if (!midiInput.begin(Serial2)) Serial.println("MIDI ingang kon niet starten");
+#endif
+  // the scope buffer is written for every sample: a static array in internal
+  // RAM. The memory map is printed when the sample loader is done.
+  audioMemory.add("scope buffer", MemoryRegion::Internal, NUM_WAVEFORM_SAMPLES * sizeof(int16_t));
+  if (MEMORY_BENCHMARK_AT_BOOT) {
+    benchmarkDelayPlacement(Serial, mixerStream.audioInfo().sample_rate, MEMORY_BENCHMARK_LINE_MS);
+  }
 }
 
 void loop() {
@@ -424,7 +517,18 @@ void loop() {
   if (!suppressButtonHandling) {
     if (operatingMode == OperatingMode::Performance) {
       for (size_t i = 0; i < BUTTON_COUNT; ++i) {
-        if (triggered[i]) {
+        if (triggered[i] && recordSwitchOn()) {
+          handleRecordTrigger(i);
+        } else if (triggered[i] && isTempoTap(i)) {
+          // the held pad of the combo does not go on playing
+          if (activeButtonIndex == static_cast<int>(TEMPO_TAP_BUTTONS[0]) ||
+              activeButtonIndex == static_cast<int>(TEMPO_TAP_BUTTONS[1])) {
+            releaseSample();
+            activeButtonIndex = -1;
+          }
+          tapTempo();
+          printTempoReport(Serial);
+        } else if (triggered[i]) {
           if (playSampleForButton(i)) {
             // trigger handled
           }
@@ -432,7 +536,7 @@ void loop() {
       }
       for (size_t i = 0; i < BUTTON_COUNT; ++i) {
         if (!buttons[i].isLatched() && activeButtonIndex == static_cast<int>(i)) {
-          player.stop();
+          releaseSample();
           buttons[i].release();
           activeButtonIndex = -1;
         }
@@ -449,13 +553,9 @@ void loop() {
     activeButtonIndex = -1;
   }
 
-  player.copy();
-  // When player is inactive, pump a small amount of silence through the
-  // mixer so delay/feedback buffers continue to advance and tails decay.
-  if (!player.isActive()) {
-    mixerStream.pumpSilenceFrames(64);
-  }
-  if (!player.isActive() && activeButtonIndex >= 0) {
+  bool loading = updateSampleLoader();
+  processAudio();
+  if (!isSamplePlaying() && activeButtonIndex >= 0) {
     // sample finished: release latched state so next press works cleanly
     buttons[activeButtonIndex].release();
     activeButtonIndex = -1;
@@ -463,10 +563,26 @@ void loop() {
 
   // Update display state (handled by UI module)
   if (operatingMode == OperatingMode::Performance) {
-    bool currentPlayingState = player.isActive();
-    updateUi(currentPlayingState, currentSamplePath);
+    bool currentPlayingState = isSamplePlaying();
+    const char* status = currentSamplePath;
+    char loadText[24];
+    if (loading) {
+      LoadStatus load = sampleLoader.status();
+      snprintf(loadText, sizeof(loadText), "laden %u%% (%u)",
+               static_cast<unsigned>(load.percent), static_cast<unsigned>(load.pending));
+      status = loadText;
+    }
+    updateUi(currentPlayingState, status);
   } else {
     updateSettingsScreenUi();
   }
-
+#if USE_AUDIO_PROFILER
+  reportProfiler(now);
+#endif
+#if USE_ALLOCATION_GUARD
+  reportAllocations(now);
+#endif
+#if USE_MIDI_INPUT
+  reportMidi(now);
+#endif
 }
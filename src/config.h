@@ -38,6 +38,12 @@ constexpr bool DISPLAY_INVERT_COLORS = false;
 constexpr std::array<int, 6> BUTTON_PINS = {13, 4, 16, 17, 12, 25};
 constexpr size_t BUTTON_COUNT = BUTTON_PINS.size();
 constexpr bool BUTTONS_ACTIVE_LOW = true;
+// Pitch of each button's sample in semitones (tuned kits). 0 plays the file
+// unchanged without resampling.
+constexpr std::array<float, 6> BUTTON_PITCH_SEMITONES = {0, 0, 0, 0, 0, 0};
+constexpr float    PITCH_MAX_SEMITONES  = 12.0f;
+// true: windowed sinc (no aliasing when pitching up), false: cubic Hermite
+constexpr bool     PITCH_HIGH_QUALITY   = true;
 constexpr int SWITCH_PIN_DELAY_SEND = 27;
 constexpr int SWITCH_PIN_ENABLE_FILTER = 26;
 constexpr int SWITCH_PIN_SETTINGS_MODE = 35; // new pin for entering settings mode on boot
@@ -46,9 +52,14 @@ constexpr uint32_t BUTTON_RETRIGGER_GUARD_MS = 20;
  constexpr uint32_t BUTTON_FADE_MS = 12;
 constexpr uint32_t EFFECT_TOGGLE_FADE_MS = 6;
 constexpr uint32_t SAMPLE_ATTACK_FADE_MS = 10;
+constexpr float PARAM_SMOOTHING_MS = 20.0f;   // glide time for mixer/effect parameter changes
+constexpr float VOLUME_SMOOTHING_MS = 15.0f;  // time constant of the volume pot smoothing
 constexpr int POT_PIN = 34;
 constexpr uint32_t VOLUME_READ_INTERVAL_MS = 30;
 constexpr float VOLUME_DEADBAND = 0.12f;
+// Serial report interval of the block profiler (build with
+// -DUSE_AUDIO_PROFILER=true, see platformio.ini)
+constexpr uint32_t PROFILER_REPORT_INTERVAL_MS = 5000;
 
 // -----------------------------------------------------------------------------
 // Audio mixer / delay defaults exposed to UI and storage
@@ -69,6 +80,21 @@ constexpr float DELAY_FEEDBACK_MIN       = 0.0f;
 constexpr float DELAY_FEEDBACK_MAX       = 0.95f;
 constexpr float DELAY_FEEDBACK_STEP      = 0.02f;
 
+// A new delay time is reached within about this time: the read head of the
+// delay line glides (the echoes bend in pitch) instead of jumping
+constexpr float DELAY_TIME_GLIDE_MS      = 60.0f;
+
+// Tempo sync of the delay: with a tempo the delay time is a beat division
+// (exact in samples). The tempo comes from the MIDI clock or from tapping:
+// hold one of the pads TEMPO_TAP_BUTTONS and tap the other one.
+constexpr uint8_t  DELAY_SYNC_DIVISION          = 5;   // BeatDivision (tempo_sync.h): 1/8.
+constexpr float    DELAY_SYNC_DEADBAND_SAMPLES  = 0.5f;
+constexpr std::array<size_t, 2> TEMPO_TAP_BUTTONS = {4, 5};  // pads 5 and 6
+constexpr size_t   TEMPO_TAP_COUNT              = 4;   // intervals which are averaged
+constexpr uint32_t TEMPO_TAP_TIMEOUT_MS         = 2000;
+constexpr float    TEMPO_MIN_BPM                = 30.0f;
+constexpr float    TEMPO_MAX_BPM                = 300.0f;
+
 constexpr float MIXER_DRY_MIN            = 0.0f;
 constexpr float MIXER_DRY_MAX            = 1.0f;
 constexpr float MIXER_DRY_STEP           = 0.02f;
@@ -124,6 +150,153 @@ constexpr float    MASTER_COMPRESSOR_RATIO_MIN        = 0.1f;
 constexpr float    MASTER_COMPRESSOR_RATIO_MAX        = 1.0f;
 constexpr float    MASTER_COMPRESSOR_RATIO_STEP       = 0.05f;
 
+// Convolution stage in the wet path: the impulse response is loaded from the SD
+// card at boot when the file exists. Latency is one block.
+constexpr const char* CONVOLVER_IR_PATH      = "/ir.wav";
+constexpr int         CONVOLVER_BLOCK_FRAMES = 256;
+constexpr size_t      CONVOLVER_MAX_IR_FRAMES = 44100; // 1 s at 44.1 kHz
+
+// Stereo reverb in parallel with the delay (same send switch). The delay lines
+// are shortened to fit the RAM budget; the decay time is kept.
+constexpr size_t REVERB_RAM_BUDGET_BYTES = 32 * 1024;
+constexpr float  REVERB_ROOM_SIZE        = 0.6f;
+constexpr float  REVERB_DAMPING          = 0.5f;
+constexpr float  REVERB_WIDTH            = 1.0f;
+constexpr float  REVERB_LEVEL            = 0.35f;
+
+// Audio memory: everything the audio loop uses is allocated once at boot, so
+// that it never calls the heap. The small buffers which are touched for every
+// block (mixer, filters, varispeed history) come from an arena in internal
+// RAM; the delay and reverb lines, like the sample cache and the convolver IR,
+// go to PSRAM when present (see audio_memory.h). The mixer works in blocks of
+// MIXER_BLOCK_FRAMES; longer writes are mixed block by block.
+constexpr size_t MIXER_BLOCK_FRAMES      = 256;
+constexpr size_t AUDIO_BLOCK_ARENA_BYTES = 16 * 1024; // mixer blocks, filters, varispeed
+// Times the delay with its line in internal RAM and in PSRAM at boot
+constexpr bool     MEMORY_BENCHMARK_AT_BOOT = false;
+constexpr uint32_t MEMORY_BENCHMARK_LINE_MS = 500;
+// Build with -DUSE_ALLOCATION_GUARD=true (see platformio.ini) to count the
+// heap allocations in processAudio(); true stops at the first one instead.
+constexpr bool   ALLOCATION_GUARD_TRAP   = false;
+
+// RAM sample cache: every button sample is converted once at boot to the
+// output format (rate, channels, 16 bit) and played from memory. Samples which
+// do not fit are streamed from the SD card as before.
+constexpr size_t SAMPLE_CACHE_BUDGET_BYTES       = 3 * 1024 * 1024; // with PSRAM
+constexpr size_t SAMPLE_CACHE_BUDGET_NO_PSRAM    = 48 * 1024;
+constexpr size_t SAMPLE_VOICE_BLOCK_FRAMES       = 256;
+// Format of the samples in the cache: 0 PCM, 1 IMA ADPCM (a quarter of the
+// memory, lossy), 2 lossless (about 2/3). Compressed samples are kept in
+// blocks of 256 frames, each decoded on its own while playing, so slices and
+// loops start at any frame.
+constexpr int    SAMPLE_CACHE_FORMAT             = 0;
+// Sample files: /1.wav../6.wav, or with the same name one of the other
+// extensions (first match wins). Every format is decoded once by the sample
+// loader into the cache; only PCM WAV files which do not fit are streamed.
+// MP3 and FLAC need arduino-libhelix and arduino-libfoxenflac (see
+// platformio.ini): build with -DUSE_SAMPLE_CODECS=false without them.
+#ifndef USE_SAMPLE_CODECS
+	#define USE_SAMPLE_CODECS true
+#endif
+constexpr std::array<const char*, 3> SAMPLE_FILE_EXTENSIONS = {".wav", ".mp3", ".flac"};
+
+// Sample loader: the samples and the impulse response are read by a task of
+// their own in chunks of SAMPLE_LOAD_CHUNK_BYTES, so audio and UI keep running.
+// Until its sample is loaded a button streams from the SD card. Requests with
+// a lower priority value are loaded first.
+constexpr size_t   SAMPLE_LOAD_CHUNK_BYTES      = 4096;
+constexpr uint32_t SAMPLE_LOADER_TASK_STACK     = 16384;  // MP3 and FLAC are decoded on it
+constexpr uint8_t  SAMPLE_LOADER_TASK_PRIORITY  = 1;
+constexpr int      SAMPLE_LOADER_TASK_CORE      = 0;    // keep SD reads off the audio core
+constexpr uint32_t SAMPLE_LOADER_IDLE_MS        = 5;
+constexpr size_t   SAMPLE_LOADER_QUEUE_NODES    = 2 * BUTTON_COUNT + 2; // queued without heap calls
+constexpr uint8_t  LOAD_PRIORITY_PRESSED        = 0;    // button pressed before its sample was loaded
+constexpr uint8_t  LOAD_PRIORITY_BANK           = 1;
+constexpr uint8_t  LOAD_PRIORITY_IR             = 2;
+
+// Live sampling: a pad records the master output (or the I2S input) into a
+// buffer which is allocated at boot and plays the take right away; the take
+// is then saved as RECORD_DIR/<pad>-<n>.wav by the sample loader task. 512 KB
+// hold about 3 s of stereo at 44.1 kHz; without PSRAM there is no room.
+constexpr size_t      RECORD_BUFFER_BYTES          = 512 * 1024;  // with PSRAM
+constexpr size_t      RECORD_BUFFER_NO_PSRAM       = 0;
+constexpr const char* RECORD_DIR                   = "/rec";
+constexpr size_t      RECORD_FLUSH_CHUNK_BYTES     = 32 * 1024;   // per SD write
+// Pad pressed while this switch is on (LOW): records into the pad, the next
+// press stops. -1: no switch, recording only through startRecording().
+constexpr int         SWITCH_PIN_RECORD            = -1;
+// Records the I2S input (line in, same format as the output) instead of the
+// master output; build with -DUSE_I2S_INPUT=true
+#ifndef USE_I2S_INPUT
+	#define USE_I2S_INPUT false
+#endif
+
+// MIDI input (DIN through an optocoupler on UART2): notes from
+// MIDI_NOTE_FIRST_PAD on play the pads, control changes set the effects. Each
+// event is started MIDI_SCHEDULE_LATENCY_US after its last byte arrived, at
+// its frame within the block, so the jitter of the polling and of the block
+// size is not heard. Build with -DUSE_MIDI_INPUT=true.
+#ifndef USE_MIDI_INPUT
+	#define USE_MIDI_INPUT false
+#endif
+constexpr int      MIDI_RX_PIN               = 36;     // input only
+constexpr uint32_t MIDI_BAUD                 = 31250;
+constexpr uint32_t MIDI_BYTE_US              = 320;    // 10 bits at 31250 baud
+constexpr uint8_t  MIDI_CHANNEL              = 0;      // 1..16, 0: all channels
+constexpr uint8_t  MIDI_NOTE_FIRST_PAD       = 36;     // C1: first pad of GM drums
+constexpr uint32_t MIDI_SCHEDULE_LATENCY_US  = 8000;   // > poll interval + block
+constexpr size_t   MIDI_QUEUE_SIZE           = 64;     // power of 2
+constexpr uint32_t MIDI_CLOCK_TIMEOUT_MS     = 500;    // no tick: no clock tempo
+constexpr double   MIDI_CLOCK_PLL_BANDWIDTH_HZ = 0.5;  // lower: less jitter, slower
+constexpr uint32_t MIDI_TASK_STACK           = 3072;
+constexpr uint8_t  MIDI_TASK_PRIORITY        = 3;
+constexpr int      MIDI_TASK_CORE            = 0;
+constexpr uint32_t MIDI_POLL_MS              = 1;
+constexpr uint32_t MIDI_REPORT_INTERVAL_MS   = 5000;
+// Control changes: value 0..127 over the range of the settings menu
+constexpr uint8_t  MIDI_CC_DELAY_TIME        = 12;
+constexpr uint8_t  MIDI_CC_DELAY_DEPTH       = 13;
+constexpr uint8_t  MIDI_CC_DELAY_FEEDBACK    = 14;
+constexpr uint8_t  MIDI_CC_DRY               = 15;
+constexpr uint8_t  MIDI_CC_WET               = 91;
+constexpr uint8_t  MIDI_CC_FILTER_CUTOFF     = 74;
+constexpr uint8_t  MIDI_CC_FILTER_Q          = 71;
+constexpr uint8_t  MIDI_CC_DELAY_DIVISION    = 75;     // 0: off, then 1/2 .. 1/16T
+
+// Sample manifest (/samples.txt): per file the slice points and the data
+// offset, so that nothing has to be analyzed again at the next boot. With
+// chop=/file.wav the buttons play the slices of that file instead of
+// /1.wav../6.wav; the slices are found with an onset detector.
+constexpr const char* SAMPLE_MANIFEST_PATH       = "/samples.txt";
+constexpr size_t MANIFEST_PATH_LEN               = 32;
+constexpr size_t SLICE_MAX_COUNT                 = 16;
+constexpr float  SLICE_THRESHOLD_DB              = 9.0f;  // rise above the envelope
+constexpr float  SLICE_FLOOR_DBFS                = -45.0f;
+constexpr float  SLICE_MIN_GAP_MS                = 80.0f;
+
+// Loop playback from RAM. The mode of each sample is set in the manifest
+// (loop=oneshot|forward|pingpong|hold, loop_start/loop_end in frames of the
+// file); the loop points default to the WAV smpl chunk. Releasing the button
+// fades out, except in hold mode which plays the rest of the sample. The
+// forward seam is crossfaded with the frames in front of loop_start.
+constexpr uint32_t LOOP_CROSSFADE_MS             = 10;
+
+// Master EQ after the compressor: low shelf, parametric mid and high shelf.
+// Gains in dB are part of the effect state (presets, settings.txt).
+constexpr float MASTER_EQ_LOW_HZ        = 150.0f;
+constexpr float MASTER_EQ_MID_HZ        = 1200.0f;
+constexpr float MASTER_EQ_MID_Q         = 0.7f;
+constexpr float MASTER_EQ_HIGH_HZ       = 6000.0f;
+constexpr float MASTER_EQ_DEFAULT_DB    = 0.0f;
+constexpr bool  MASTER_EQ_FIXED_POINT   = false; // true: integer DF1 instead of float
+
+// Presets: snapshots of the complete effect state, recalled or morphed
+constexpr size_t   PRESET_SLOT_COUNT          = 8;
+constexpr float    PRESET_MORPH_MIN_MS        = 0.0f;
+constexpr float    PRESET_MORPH_MAX_MS        = 8000.0f;
+constexpr float    PRESET_MORPH_STEP_MS       = 50.0f;
+constexpr float    PRESET_MORPH_DEFAULT_MS    = 0.0f;
+
 // zoom screen defaults
 constexpr float DEFAULT_HORIZ_ZOOM = 8.0f; //>1 = inzoomen (minder samples weergegeven), <1 = uitzoomen
 constexpr float DEFAULT_VERT_SCALE = 2.0f; // amplitude schaal factor
@@ -135,6 +308,12 @@ constexpr float ZOOM_BIG_STEP = 0.5f;
 // Settings menu rendering
 constexpr uint8_t SETTINGS_VISIBLE_MENU_ITEMS = 6;
 
+// Settings persistence (binary blob on SD, written by a background task)
+constexpr uint32_t SETTINGS_SAVE_DEBOUNCE_MS   = 1500; // coalesce bursts of changes
+constexpr uint32_t SETTINGS_SAVE_TASK_STACK    = 4096;
+constexpr uint8_t  SETTINGS_SAVE_TASK_PRIORITY = 1;
+constexpr int      SETTINGS_SAVE_TASK_CORE     = 0;    // keep SD writes off the audio core
+
 
 // --- Additional hardware pins for new features ---
 constexpr int SD_CS_PIN    = 5;  // already in use by SD
@@ -145,3 +324,7 @@ constexpr int I2S_PIN_BCK  = 14;
 constexpr int I2S_PIN_WS   = 15;
 constexpr int I2S_PIN_DATA = 32;
 
+// I2S input (USE_I2S_INPUT) on the second port, at the rate of the output
+constexpr int I2S_IN_PIN_BCK  = 33;
+constexpr int I2S_IN_PIN_WS   = 2;  // strapping pin: low or floating at boot
+constexpr int I2S_IN_PIN_DATA = 39; // input only
@@ -0,0 +1,51 @@
+// effect_params.h - flat snapshot of the complete effect state
+#pragma once
+
+#include <cstdint>
+#include "config.h"
+
+// Everything the mixer needs to render the effect chain. Kept as a plain
+// struct so it can be copied atomically into the audio thread, stored in
+// preset slots and written to the settings blob as-is.
+struct EffectParams {
+  float delayTimeMs;
+  float delayDepth;
+  float delayFeedback;
+  float filterCutoffHz;
+  float filterQ;
+  float filterSlewHzPerSec;
+  float dryMix;
+  float wetMix;
+  float compAttackMs;
+  float compReleaseMs;
+  float compHoldMs;
+  float compThresholdPercent;
+  float compRatio;
+  uint8_t compEnabled;
+  uint8_t reserved[3];
+  float eqLowDb;
+  float eqMidDb;
+  float eqHighDb;
+};
+
+inline EffectParams defaultEffectParams() {
+  EffectParams p{};
+  p.delayTimeMs = DEFAULT_DELAY_TIME_MS;
+  p.delayDepth = DEFAULT_DELAY_DEPTH;
+  p.delayFeedback = DEFAULT_DELAY_FEEDBACK;
+  p.filterCutoffHz = LOW_PASS_CUTOFF_HZ;
+  p.filterQ = LOW_PASS_Q;
+  p.filterSlewHzPerSec = FILTER_SLEW_DEFAULT_HZ_PER_SEC;
+  p.dryMix = MIXER_DEFAULT_DRY_LEVEL;
+  p.wetMix = MIXER_DEFAULT_WET_LEVEL;
+  p.compAttackMs = MASTER_COMPRESSOR_ATTACK_MS;
+  p.compReleaseMs = MASTER_COMPRESSOR_RELEASE_MS;
+  p.compHoldMs = MASTER_COMPRESSOR_HOLD_MS;
+  p.compThresholdPercent = MASTER_COMPRESSOR_THRESHOLD_PERCENT;
+  p.compRatio = MASTER_COMPRESSOR_RATIO;
+  p.compEnabled = MASTER_COMPRESSOR_ENABLED ? 1 : 0;
+  p.eqLowDb = MASTER_EQ_DEFAULT_DB;
+  p.eqMidDb = MASTER_EQ_DEFAULT_DB;
+  p.eqHighDb = MASTER_EQ_DEFAULT_DB;
+  return p;
+}
@@ -64,8 +64,6 @@ const char* Button::getPath() const { return samplePath; }
 VolumeManager::VolumeManager(int adcPin)
   : adcPin(adcPin), cachedVolumeControl(expoControl) {}
 
-extern AudioPlayer player; // defined in bankrasampler.cpp
-
 namespace {
 float normalizeVolumeFromAdc(int raw) {
   const float adcMax = 4095.0f;
@@ -77,11 +75,8 @@ float normalizeVolumeFromAdc(int raw) {
 void VolumeManager::begin() {
   pinMode(adcPin, INPUT);
   lastSampleTime = 0;
-  lastVolume = normalizeVolumeFromAdc(analogRead(adcPin));
-  rampVolume = lastVolume;
-  float curved = applyVolumeCurve(lastVolume);
-  rampVolume = curved;
-  player.setVolume(curved);
+  lastVolume = applyVolumeCurve(normalizeVolumeFromAdc(analogRead(adcPin)));
+  if (volumeCallback) volumeCallback(lastVolume);
 }
 
 void VolumeManager::update(uint32_t now) {
@@ -111,6 +106,10 @@ void VolumeManager::setCutoffUpdateCallback(CutoffCallback cb) {
   cutoffCallback = cb;
 }
 
+void VolumeManager::setVolumeUpdateCallback(VolumeCallback cb) {
+  volumeCallback = cb;
+}
+
 void VolumeManager::forceImmediateSample() { lastSampleTime = 0; }
 
 float VolumeManager::applyVolumeCurve(float input) {
@@ -119,19 +118,10 @@ float VolumeManager::applyVolumeCurve(float input) {
 
 void VolumeManager::handleVolumeMode(float normalized) {
   float target = applyVolumeCurve(normalized);
-  if (lastVolume < 0.0f || fabs(target - lastVolume) >= VOLUME_DEADBAND) {
-    lastVolume = target;
-  }
-  float rampStep = 0.05f;
-  if (fabs(rampVolume - lastVolume) > rampStep) {
-    if (rampVolume < lastVolume) rampVolume += rampStep;
-    else rampVolume -= rampStep;
-    rampVolume = constrain(rampVolume, 0.0f, 1.0f);
-    player.setVolume(rampVolume);
-  } else {
-    rampVolume = lastVolume;
-    player.setVolume(rampVolume);
-  }
+  if (lastVolume >= 0.0f && fabs(target - lastVolume) < VOLUME_DEADBAND) return;
+  lastVolume = target;
+  // The mixer glides to the new gain per sample, so no stepping here.
+  if (volumeCallback) volumeCallback(lastVolume);
 }
 
 void VolumeManager::handleCutoffMode(float normalized) {
@@ -35,6 +35,9 @@ public:
   void setFilterControlActive(bool active);
   using CutoffCallback = std::function<void(float)>;
   void setCutoffUpdateCallback(CutoffCallback cb);
+  // Receives the curved volume (0..1); the audio side smooths it.
+  using VolumeCallback = std::function<void(float)>;
+  void setVolumeUpdateCallback(VolumeCallback cb);
   void forceImmediateSample();
 private:
   enum class Mode { Volume, Cutoff };
@@ -42,10 +45,10 @@ private:
   int adcPin;
   uint32_t lastSampleTime = 0;
   float lastVolume = -1.0f;
-  float rampVolume = -1.0f;
   float lastCutoffHz = -1.0f;
   float smoothedCutoffHz = -1.0f;
   CutoffCallback cutoffCallback;
+  VolumeCallback volumeCallback;
   audio_tools::ExponentialVolumeControl expoControl;
   audio_tools::CachedVolumeControl cachedVolumeControl;
   float applyVolumeCurve(float input);
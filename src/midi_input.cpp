@@ -0,0 +1,75 @@
+#include "midi_input.h"
+
+bool MidiInput::begin(Stream& in) {
+	if (running) return true;
+	input = &in;
+	task.create("MidiInput", MIDI_TASK_STACK, MIDI_TASK_PRIORITY, MIDI_TASK_CORE);
+	running = task.begin([this]() { step(); });
+	return running;
+}
+
+void MidiInput::end() {
+	if (!running) return;
+	task.remove();
+	running = false;
+}
+
+// Reads what the UART received since the last poll. The bytes are assumed to
+// have come one after the other: the last one now, each one before it a byte
+// time earlier. Only an estimate: a pause between the bytes, or bytes which
+// waited longer than the poll interval, shift it.
+void MidiInput::step() {
+	uint8_t buffer[32];
+	int available = input->available();
+	while (available > 0) {
+		size_t n = input->readBytes(buffer, std::min(static_cast<size_t>(available), sizeof(buffer)));
+		if (n == 0) break;
+		available -= n;
+		uint64_t now = micros();
+		for (size_t j = 0; j < n; ++j) {
+			uint64_t behind = static_cast<uint64_t>(n - 1 - j + available) * MIDI_BYTE_US;
+			receive(buffer[j], now > behind ? now - behind : 0);
+		}
+	}
+	delay(MIDI_POLL_MS);
+}
+
+void MidiInput::receive(uint8_t byte, uint64_t arrivalUs) {
+	MidiEvent event;
+	if (!parser.parse(byte, event.message)) return;
+	event.arrivalUs = arrivalUs;
+	switch (event.message.type) {
+		case MidiType::Clock:
+			onClock(arrivalUs);
+			return;
+		case MidiType::NoteOn:
+		case MidiType::NoteOff:
+		case MidiType::ControlChange:
+			if (MIDI_CHANNEL != 0 && event.message.channel != MIDI_CHANNEL - 1) return;
+			break;
+		case MidiType::Start:
+		case MidiType::Continue:
+		case MidiType::Stop:
+			break;
+		default:
+			return;
+	}
+	if (!queue.enqueue(event)) overflowCount++;
+}
+
+// 24 ticks per quarter note; the PLL averages out the jitter of the sender
+// and of the polling
+void MidiInput::onClock(uint64_t arrivalUs) {
+	clockPll.tick(arrivalUs);
+	tickNs = static_cast<uint32_t>(clockPll.period() * 1000.0);
+	lastTickUs = static_cast<uint32_t>(arrivalUs);
+}
+
+float MidiInput::clockBpm(uint64_t nowUs) {
+	uint32_t interval = tickNs;
+	if (interval == 0) return 0.0f;
+	// signed: a tick which arrived after nowUs was taken is not old
+	int32_t age = static_cast<int32_t>(static_cast<uint32_t>(nowUs) - lastTickUs);
+	if (age > static_cast<int32_t>(MIDI_CLOCK_TIMEOUT_MS * 1000)) return 0.0f;
+	return static_cast<float>(60e9 / (interval * 24.0));
+}
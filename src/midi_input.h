@@ -0,0 +1,65 @@
+// midi_input.h - serial MIDI (DIN through an optocoupler on a UART). A task
+// of its own parses the bytes and stamps each message with the time its last
+// byte arrived. Notes, control changes, start and stop go to the audio task
+// through a lock free queue of MIDI_QUEUE_SIZE; the audio task starts each
+// one at a fixed latency after its arrival, at its frame within the block
+// (see processAudio()). The clock (24 ticks per quarter note) is turned into
+// a tempo here by a PLL and not queued.
+#pragma once
+
+#include <Arduino.h>
+#include <AudioTools.h>
+#include <atomic>
+#include "AudioTools/Concurrency/LockFree.h"
+#ifdef USE_CPP_TASK
+#include "AudioTools/Concurrency/Desktop/Task.h"
+#else
+#include "AudioTools/Concurrency/RTOS/Task.h"
+#endif
+#include "config.h"
+#include "tempo_sync.h"
+
+struct MidiEvent {
+	MidiMessage message;
+	uint64_t arrivalUs = 0;  // last byte of the message
+};
+
+class MidiInput {
+public:
+	~MidiInput() { end(); }
+
+	// Starts the task which reads the stream (e.g. Serial2 with MIDI_BAUD)
+	bool begin(Stream& in);
+	void end();
+
+	// Parses one byte which arrived at arrivalUs: called by the task, or
+	// directly when there is no stream. One producer only.
+	void receive(uint8_t byte, uint64_t arrivalUs);
+
+	// Audio task: the oldest event of MIDI_CHANNEL
+	bool next(MidiEvent& event) { return queue.dequeue(event); }
+
+	// Tempo of the MIDI clock; 0 without a tick in the last
+	// MIDI_CLOCK_TIMEOUT_MS before nowUs (the clock of the arrival times)
+	float clockBpm(uint64_t nowUs);
+
+	// Events which were lost because the audio task did not take them
+	uint32_t overflows() { return overflowCount; }
+
+private:
+	Stream* input = nullptr;
+	MidiParser parser;
+	QueueLockFree<MidiEvent> queue{MIDI_QUEUE_SIZE};
+	std::atomic<uint32_t> overflowCount{0};
+	// clock: the PLL of the task, published as the arrival of the last tick
+	// (lower 32 bits) and the interval between two ticks
+	ClockPll clockPll;
+	std::atomic<uint32_t> lastTickUs{0};
+	std::atomic<uint32_t> tickNs{0};
+	bool running = false;
+	// last member: the task stops before the rest is destroyed
+	Task task;
+
+	void onClock(uint64_t arrivalUs);
+	void step();
+};
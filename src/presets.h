@@ -0,0 +1,49 @@
+// presets.h - fixed bank of effect snapshots
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "config.h"
+#include "effect_params.h"
+
+// Holds PRESET_SLOT_COUNT complete effect snapshots in a flat array. Storing
+// and recalling only copies structs; nothing is allocated.
+class PresetBank {
+public:
+  PresetBank() { reset(); }
+
+  void reset() {
+    slots.fill(defaultEffectParams());
+    usedMask = 0;
+  }
+
+  static constexpr size_t size() { return PRESET_SLOT_COUNT; }
+
+  bool store(size_t slot, const EffectParams& params) {
+    if (slot >= PRESET_SLOT_COUNT) return false;
+    slots[slot] = params;
+    usedMask |= (1u << slot);
+    return true;
+  }
+
+  // Returns nullptr for empty or out-of-range slots.
+  const EffectParams* get(size_t slot) const {
+    if (slot >= PRESET_SLOT_COUNT || !isUsed(slot)) return nullptr;
+    return &slots[slot];
+  }
+
+  bool isUsed(size_t slot) const {
+    return slot < PRESET_SLOT_COUNT && (usedMask & (1u << slot)) != 0;
+  }
+
+  uint32_t getUsedMask() const { return usedMask; }
+  void setUsedMask(uint32_t mask) { usedMask = mask; }
+
+  const EffectParams* data() const { return slots.data(); }
+  EffectParams* data() { return slots.data(); }
+
+private:
+  std::array<EffectParams, PRESET_SLOT_COUNT> slots;
+  uint32_t usedMask = 0;
+  static_assert(PRESET_SLOT_COUNT <= 32, "usedMask holds one bit per slot");
+};
@@ -0,0 +1,573 @@
+#include "sample_bank.h"
+
+#include <SD.h>
+#include <cstring>
+#include <utility>
+
+namespace {
+const char* MIME_WAV = "audio/vnd.wave";
+const char* MIME_IMA_ADPCM = "audio/vnd.wave; codecs=ima-adpcm";
+const char* MIME_MP3 = "audio/mpeg";
+const char* MIME_FLAC = "audio/flac";
+
+bool checkImaWav(uint8_t* data, size_t len) {
+	if (len < 12 || memcmp(data, "RIFF", 4) != 0) return false;
+	WAVHeader header;
+	header.write(data, len);
+	return header.parse() && header.audioInfo().format == AudioFormat::DVI_ADPCM;
+}
+
+bool checkPcmWav(uint8_t* data, size_t len) {
+	return len >= 12 && memcmp(data, "RIFF", 4) == 0 && !checkImaWav(data, len);
+}
+
+// Loop of a smpl chunk behind the PCM data, where most editors put it
+bool readTrailingLoop(File& file, WAVAudioInfo& wav) {
+	if (wav.is_streamed) return false;
+	uint32_t size = file.size();
+	uint32_t pos = wav.data_start + wav.data_length + (wav.data_length & 1);
+	for (int chunk = 0; chunk < 16 && pos + 8 <= size; ++chunk) {
+		uint8_t head[8];
+		if (!file.seek(pos) || file.read(head, sizeof(head)) != sizeof(head)) return false;
+		uint32_t len = head[4] | (head[5] << 8) | (head[6] << 16) |
+		               (static_cast<uint32_t>(head[7]) << 24);
+		if (memcmp(head, "smpl", 4) == 0) {
+			uint8_t data[60];
+			if (len < sizeof(data) || file.read(data, sizeof(data)) != sizeof(data)) return false;
+			return WAVHeader::parseSampleChunk(data, sizeof(data), wav);
+		}
+		pos += 8 + len + (len & 1);
+	}
+	return false;
+}
+}
+
+void SampleBank::begin(AudioInfo target, size_t budgetBytes) {
+	targetInfo = target;
+	targetInfo.bits_per_sample = 16;
+	budget = budgetBytes;
+	// WAV before MP3: the MP3 check only looks for a frame sync
+	addFormat(ima, MIME_IMA_ADPCM, checkImaWav);
+	addFormat(wav, MIME_WAV, checkPcmWav);
+#if USE_SAMPLE_CODECS
+	addFormat(flac, MIME_FLAC, MimeDetector::checkFLAC);
+	addFormat(mp3, MIME_MP3, MimeDetector::checkMP3);
+#endif
+	decoder.setMimeSource(formats);
+	detector.setThreshold(SLICE_THRESHOLD_DB);
+	detector.setFloor(SLICE_FLOOR_DBFS);
+	detector.setMinGapMs(SLICE_MIN_GAP_MS);
+	detector.setMaxOnsets(SLICE_MAX_COUNT);
+}
+
+void SampleBank::addFormat(AudioDecoder& format, const char* mime,
+                           bool (*check)(uint8_t*, size_t)) {
+	decoder.addDecoder(format, mime);
+	formats.setCheck(mime, check);
+	format.addNotifyAudioChange(importer);
+	format.addNotifyAudioChange(detector);
+}
+
+// The MultiDecoder only passes its output to a decoder which has none
+void SampleBank::setDecoderOutput(Print& out) {
+	decoder.setOutput(out);
+	wav.setOutput(out);
+	ima.setOutput(out);
+#if USE_SAMPLE_CODECS
+	mp3.setOutput(out);
+	flac.setOutput(out);
+#endif
+}
+
+// The mimes are the pointers which were registered in begin()
+bool SampleBank::isPcmWav() {
+	return decoder.selectedMime() == MIME_WAV;
+}
+
+const char* SampleBank::formatName() {
+	const char* mime = decoder.selectedMime();
+	if (mime == MIME_WAV) return "WAV";
+	if (mime == MIME_IMA_ADPCM) return "IMA ADPCM";
+	if (mime == MIME_MP3) return "MP3";
+	if (mime == MIME_FLAC) return "FLAC";
+	return "?";
+}
+
+bool SampleBank::findFile(const char* path, char* result, size_t len) {
+	snprintf(result, len, "%s", path);
+	if (SD.exists(result)) return true;
+	const char* dot = strrchr(path, '.');
+	int stem = dot != nullptr ? static_cast<int>(dot - path) : static_cast<int>(strlen(path));
+	for (const char* extension : SAMPLE_FILE_EXTENSIONS) {
+		snprintf(result, len, "%.*s%s", stem, path, extension);
+		if (SD.exists(result)) return true;
+	}
+	snprintf(result, len, "%s", path);
+	return false;
+}
+
+bool SampleBank::isStreamable(size_t index, const char* path) {
+	if (index < slots.size() && slots[index].format[0] != '\0') {
+		return strcmp(slots[index].format, "WAV") == 0;
+	}
+	return StrView(path).endsWithIgnoreCase(".wav");
+}
+
+void SampleSlot::swap(SampleSlot& other) {
+	pcm.swap(other.pcm);
+	packed.swap(other.packed);
+	std::swap(compressed, other.compressed);
+	std::swap(frames, other.frames);
+	std::swap(source, other.source);
+	std::swap(format, other.format);
+	std::swap(importUs, other.importUs);
+	std::swap(decodeNsPerFrame, other.decodeNsPerFrame);
+	std::swap(loaded, other.loaded);
+	std::swap(loopMode, other.loopMode);
+	std::swap(loopStart, other.loopStart);
+	std::swap(loopEnd, other.loopEnd);
+	seam.swap(other.seam);
+	std::swap(seamFrames, other.seamFrames);
+}
+
+void SampleSlot::clear() {
+	pcm.reset();
+	packed.clear();
+	compressed = false;
+	format = "";
+	decodeNsPerFrame = 0;
+	seam.reset();
+	seamFrames = 0;
+	frames = 0;
+	loaded = false;
+	loopMode = LoopMode::OneShot;
+}
+
+bool SampleBank::load(size_t index, const char* path, ManifestEntry* entry) {
+	if (index >= slots.size()) return false;
+	size_t limit = available(index);
+	slots[index].clear();
+	return import(slots[index], path, entry, limit);
+}
+
+size_t SampleBank::budgetLeft(size_t index) {
+	size_t used = memoryUsed();
+	if (index < slots.size()) used -= slots[index].bytes();
+	return used >= budget ? 0 : budget - used;
+}
+
+// stay within the budget and the largest free block: a failed allocation is
+// fatal
+size_t SampleBank::available(size_t index) {
+	size_t limit = budgetLeft(index);
+	if (limit == 0) return 0;
+	size_t largest = ESP.getPsramSize() > 0 ? ESP.getMaxAllocPsram()
+	                                        : ESP.getMaxAllocHeap() / 2;
+	return limit < largest ? limit : largest;
+}
+
+void SampleBank::publish(size_t index, SampleSlot& slot) {
+	if (index < slots.size()) slots[index].swap(slot);
+}
+
+bool SampleBank::import(SampleSlot& slot, const char* path, ManifestEntry* entry,
+                        size_t limit, LoadProgress* progress) {
+	slot.clear();
+	if (limit == 0) return false;
+
+	File file = SD.open(path);
+	if (!file) return false;
+	uint32_t fileSize = file.size();
+	if (progress) progress->bytesTotal = fileSize;
+	bool detect = entry != nullptr && !entry->matches(fileSize);
+	uint32_t start = micros();
+	if (!importer.begin(targetInfo)) {
+		file.close();
+		return false;
+	}
+	importer.setExpectedBytes(file.size());
+	importer.setMaxBytes(limit);
+	// compressed on the way: the PCM never has to fit into memory
+	auto format = static_cast<BlockCompressedPCM::Format>(SAMPLE_CACHE_FORMAT);
+	bool compress = format != BlockCompressedPCM::PCM &&
+	                slot.packed.begin(format, targetInfo.channels);
+	if (compress) {
+		slot.packed.setMaxBytes(limit);
+		importer.setOutput(slot.packed);
+	}
+	if (detect) detector.begin();
+	setDecoderOutput(detect ? static_cast<Print&>(analysis) : importer);
+	formats.begin();
+	decoder.begin();
+	bool cancelled = false;
+	bool first = true;
+	int len;
+	while ((len = file.read(chunk, sizeof(chunk))) > 0) {
+		// the decoder is picked from the first chunk
+		if (first) formats.write(chunk, len);
+		first = false;
+		decoder.write(chunk, len);
+		if (progress) {
+			progress->bytesRead += len;
+			if (progress->cancel) {
+				cancelled = true;
+				break;
+			}
+		}
+		if (importer.isOverflow() || slot.packed.isOverflow()) {
+			// too large for RAM: the slices are still needed for streaming,
+			// which only plays PCM WAV files
+			if (!detect || !isPcmWav()) {
+				detect = false;
+				break;
+			}
+			setDecoderOutput(detector);
+		}
+	}
+	if (detect && !cancelled) {
+		// other formats have no file layout: their slices play from RAM only
+		WAVAudioInfo info(importer.sourceInfo());
+		if (isPcmWav()) {
+			info = wav.audioInfoEx();
+			if (!info.has_loop) readTrailingLoop(file, info);
+		}
+		updateEntry(*entry, fileSize, info);
+	}
+	slot.format = formatName();
+	file.close();
+	decoder.end();
+	importer.end();
+	if (compress) slot.packed.end();
+	slot.importUs = micros() - start;
+	slot.source = importer.sourceInfo();
+	if (cancelled || importer.isOverflow() || slot.packed.isOverflow() ||
+	    importer.frames() == 0) {
+		importer.samples().reset();
+		slot.packed.clear();
+		return false;
+	}
+	if (compress) {
+		slot.frames = slot.packed.frames();
+		slot.compressed = true;
+		measureDecode(slot);
+	} else {
+		slot.frames = importer.frames();
+		slot.pcm = std::move(importer.samples());
+	}
+	slot.loaded = true;
+	if (entry) setupLoop(slot, *entry);
+	return true;
+}
+
+// Slices in frames of the file, the file layout for streamed slices and the
+// loop of the smpl chunk
+void SampleBank::updateEntry(ManifestEntry& entry, uint32_t fileSize,
+                             const WAVAudioInfo& wav) {
+	entry.fileSize = fileSize;
+	entry.dataStart = wav.data_start;
+	entry.frameBytes = static_cast<uint16_t>(wav.block_align);
+	entry.sampleRate = wav.sample_rate;
+	entry.frames = detector.frames();
+	Vector<uint32_t>& onsets = detector.onsets();
+	entry.sliceCount = 0;
+	for (uint32_t onset : onsets) {
+		if (entry.sliceCount < SLICE_MAX_COUNT) entry.slices[entry.sliceCount++] = onset;
+	}
+	if (wav.has_loop) {
+		// backward loops are played forward
+		entry.loopMode = wav.loop_type == 1 ? LoopMode::PingPong : LoopMode::Forward;
+		entry.loopStart = wav.loop_start;
+		entry.loopEnd = wav.loop_end + 1;
+	}
+	entry.dirty = true;
+}
+
+// Loop points at the output rate and the crossfaded seam, computed once so
+// that looping needs no work per cycle
+void SampleBank::setupLoop(SampleSlot& slot, const ManifestEntry& entry) {
+	if (entry.loopMode == LoopMode::OneShot || entry.sampleRate == 0) return;
+	uint64_t rate = targetInfo.sample_rate;
+	uint32_t end = entry.loopEnd > 0 ? entry.loopEnd : entry.frames;
+	slot.loopStart = static_cast<size_t>(entry.loopStart * rate / entry.sampleRate);
+	slot.loopEnd = static_cast<size_t>(end * rate / entry.sampleRate);
+	if (slot.loopEnd > slot.frames) slot.loopEnd = slot.frames;
+	if (slot.loopStart + 2 > slot.loopEnd) return;
+	slot.loopMode = entry.loopMode;
+	// the turns of a ping-pong loop are continuous
+	if (slot.loopMode == LoopMode::PingPong) return;
+
+	// the crossfade needs as many frames in front of loopStart
+	size_t n = targetInfo.sample_rate * LOOP_CROSSFADE_MS / 1000;
+	if (n > slot.loopStart) n = slot.loopStart;
+	if (n > (slot.loopEnd - slot.loopStart) / 2) n = (slot.loopEnd - slot.loopStart) / 2;
+	if (n == 0) return;
+	int ch = targetInfo.channels;
+	slot.seam.resize(n * ch);
+	Vector<int16_t> out(n * ch), in(n * ch);
+	out.resize(n * ch);
+	in.resize(n * ch);
+	readFrames(slot, slot.loopEnd - n, n, out.data());
+	readFrames(slot, slot.loopStart - n, n, in.data());
+	for (size_t f = 0; f < n; ++f) {
+		int32_t gain = static_cast<int32_t>((f + 1) * 32768 / (n + 1));
+		for (int c = 0; c < ch; ++c) {
+			size_t i = f * ch + c;
+			slot.seam[i] = static_cast<int16_t>((out[i] * (32768 - gain) + in[i] * gain) >> 15);
+		}
+	}
+	slot.seamFrames = n;
+}
+
+void SampleBank::readFrames(SampleSlot& slot, size_t start, size_t frames, int16_t* out) {
+	int ch = targetInfo.channels;
+	if (!slot.compressed) {
+		memcpy(out, slot.pcm.data() + start * ch, frames * ch * sizeof(int16_t));
+		return;
+	}
+	const size_t blockFrames = BlockCompressedPCM::BLOCK_FRAMES;
+	int16_t block[BlockCompressedPCM::BLOCK_FRAMES * 2];
+	size_t index = SIZE_MAX;
+	for (size_t f = 0; f < frames; ++f) {
+		size_t pos = start + f;
+		if (pos / blockFrames != index) {
+			index = pos / blockFrames;
+			slot.packed.decode(index, block);
+		}
+		memcpy(out + f * ch, block + (pos % blockFrames) * ch, ch * sizeof(int16_t));
+	}
+}
+
+// Decoding time of the first blocks, as the voice does it while playing
+void SampleBank::measureDecode(SampleSlot& slot) {
+	int16_t block[BlockCompressedPCM::BLOCK_FRAMES * 2];
+	size_t blocks = slot.packed.blocks() < 16 ? slot.packed.blocks() : 16;
+	size_t frames = 0;
+	uint32_t start = micros();
+	for (size_t b = 0; b < blocks; ++b) frames += slot.packed.decode(b, block);
+	uint32_t us = micros() - start;
+	if (frames > 0) slot.decodeNsPerFrame = static_cast<uint32_t>(us * 1000ull / frames);
+}
+
+SampleSlot* SampleBank::get(size_t index) {
+	if (index >= slots.size() || !slots[index].loaded) return nullptr;
+	return &slots[index];
+}
+
+size_t SampleBank::memoryUsed() {
+	size_t result = 0;
+	for (auto& slot : slots) result += slot.bytes();
+	return result;
+}
+
+void SampleBank::printReport(Print& out) {
+	size_t pcmBytes = 0;
+	for (size_t i = 0; i < slots.size(); ++i) {
+		SampleSlot& slot = slots[i];
+		if (!slot.loaded) {
+			out.printf("Sample %u: streamed from SD\n", static_cast<unsigned>(i + 1));
+			continue;
+		}
+		out.printf("Sample %u: %s %u Hz %u ch %u bit -> %u frames, %u bytes, import %u ms",
+		           static_cast<unsigned>(i + 1), slot.format,
+		           static_cast<unsigned>(slot.source.sample_rate),
+		           static_cast<unsigned>(slot.source.channels),
+		           static_cast<unsigned>(slot.source.bits_per_sample),
+		           static_cast<unsigned>(slot.frames),
+		           static_cast<unsigned>(slot.bytes()),
+		           static_cast<unsigned>(slot.importUs / 1000));
+		if (slot.compressed) {
+			// cycles per frame of one voice
+			out.printf(", %u%% of PCM, decode %u cycles/frame",
+			           static_cast<unsigned>(slot.packed.memoryUsed() * 100 / slot.packed.pcmBytes()),
+			           static_cast<unsigned>(slot.decodeNsPerFrame * ESP.getCpuFreqMHz() / 1000));
+		}
+		out.println();
+		pcmBytes += slot.frames * targetInfo.channels * sizeof(int16_t);
+	}
+	out.printf("Sample cache: %u of %u bytes (as PCM %u bytes)\n",
+	           static_cast<unsigned>(memoryUsed()),
+	           static_cast<unsigned>(budget),
+	           static_cast<unsigned>(pcmBytes));
+}
+
+bool SampleVoice::begin(Print& out, AudioInfo info, uint32_t fadeMs) {
+	if (info.channels < 1 || info.channels > 2) return false;
+	output = &out;
+	channels = info.channels;
+	fadeFrames = static_cast<size_t>(info.sample_rate) * fadeMs / 1000;
+	if (fadeFrames == 0) fadeFrames = 1;
+	main = Playhead();
+	tail = Playhead();
+	faded.resize(fadeFrames * channels);
+	fadedPos = fadedFrames = 0;
+	return true;
+}
+
+void SampleVoice::play(SampleSlot& slot) {
+	start(slot, 0, slot.frames, slot.loopMode);
+}
+
+void SampleVoice::play(SampleSlot& slot, size_t start, size_t end) {
+	if (end > slot.frames) end = slot.frames;
+	if (start >= end) return;
+	this->start(slot, start, end, LoopMode::OneShot);
+}
+
+void SampleVoice::stop() {
+	fadeOut(main);
+	fadeOut(tail);
+}
+
+void SampleVoice::noteOff() {
+	if (main.slot != nullptr && main.mode == LoopMode::Hold && !main.releasing) {
+		main.leaveLoop = true;
+	} else {
+		stop();
+	}
+}
+
+// The running sample keeps fading out next to the new one
+void SampleVoice::start(SampleSlot& slot, size_t start, size_t end, LoopMode mode) {
+	if (main.slot != nullptr) {
+		// the tail is still fading: its rest goes to faded
+		if (tail.slot != nullptr) renderAhead(tail);
+		tail = main;
+		fadeOut(tail);
+	}
+	main = Playhead();
+	main.slot = &slot;
+	main.position = start;
+	main.end = end;
+	main.mode = mode;
+	main.looping = mode != LoopMode::OneShot;
+}
+
+void SampleVoice::fadeOut(Playhead& head) {
+	if (head.slot != nullptr && !head.releasing) {
+		head.releasing = true;
+		// during the attack the fade starts at the current gain
+		head.release = head.attack < fadeFrames ? head.attack : fadeFrames;
+		if (head.release == 0) head.slot = nullptr;
+	}
+}
+
+// Adds the rest of the fade out of head to faded, behind the frames of an
+// earlier fade which were not written yet. A fade is at most fadeFrames long.
+void SampleVoice::renderAhead(Playhead& head) {
+	fadeOut(head);
+	size_t left = fadedFrames - fadedPos;
+	int32_t* data = faded.data();
+	memmove(data, data + fadedPos * channels, left * channels * sizeof(int32_t));
+	memset(data + left * channels, 0, (fadeFrames - left) * channels * sizeof(int32_t));
+	size_t frames = render(head, data, fadeFrames);
+	fadedPos = 0;
+	fadedFrames = frames > left ? frames : left;
+	head = Playhead();
+}
+
+// Moves to the next frame; loops wrap without any I/O
+void SampleVoice::advance(Playhead& head) {
+	SampleSlot& slot = *head.slot;
+	if (!head.looping) {
+		++head.position;
+		return;
+	}
+	if (head.mode == LoopMode::PingPong) {
+		if (head.forward) {
+			if (head.leaveLoop) {
+				head.looping = false;
+				++head.position;
+			} else if (head.position + 1 >= slot.loopEnd) {
+				head.forward = false;
+				--head.position;
+			} else {
+				++head.position;
+			}
+		} else if (head.position <= slot.loopStart) {
+			head.forward = true;
+			++head.position;
+		} else {
+			--head.position;
+		}
+		return;
+	}
+	++head.position;
+	// leave the loop in front of the seam: the original frames follow
+	if (head.leaveLoop && head.position < slot.loopEnd - slot.seamFrames) {
+		head.looping = false;
+	} else if (head.position >= slot.loopEnd) {
+		head.position = slot.loopStart;
+	}
+}
+
+// Adds up to frames frames to dst; returns the number of frames
+size_t SampleVoice::render(Playhead& head, int32_t* dst, size_t frames) {
+	if (head.slot == nullptr) return 0;
+	SampleSlot& slot = *head.slot;
+	size_t seamStart = slot.loopEnd - slot.seamFrames;
+	size_t f = 0;
+	for (; f < frames; ++f) {
+		if (!head.looping && head.position >= head.end) break;
+		// Q15 gain ramps at the start and after a fade out
+		int32_t gain = 32768;
+		if (head.releasing) {
+			gain = static_cast<int32_t>(head.release * 32768 / fadeFrames);
+		} else if (head.attack < fadeFrames) {
+			gain = static_cast<int32_t>(head.attack * 32768 / fadeFrames);
+			++head.attack;
+		}
+		const int16_t* src;
+		if (slot.compressed) {
+			const size_t blockFrames = BlockCompressedPCM::BLOCK_FRAMES;
+			size_t index = head.position / blockFrames;
+			if (index != head.blockIndex) {
+				slot.packed.decode(index, head.block);
+				head.blockIndex = index;
+			}
+			src = head.block + (head.position % blockFrames) * channels;
+		} else {
+			src = slot.pcm.data() + head.position * channels;
+		}
+		if (head.looping && slot.seamFrames > 0 && head.position >= seamStart &&
+		    head.mode != LoopMode::PingPong) {
+			src = slot.seam.data() + (head.position - seamStart) * channels;
+		}
+		for (int ch = 0; ch < channels; ++ch) {
+			*dst++ += (*src++ * gain) >> 15;
+		}
+		advance(head);
+		if (head.releasing && --head.release == 0) {
+			++f;
+			break;
+		}
+	}
+	if ((head.releasing && head.release == 0) ||
+	    (!head.looping && head.position >= head.end)) {
+		head.slot = nullptr;
+	}
+	return f;
+}
+
+size_t SampleVoice::copy(size_t maxFrames) {
+	if (output == nullptr || !isActive()) return 0;
+	if (maxFrames > SAMPLE_VOICE_BLOCK_FRAMES) maxFrames = SAMPLE_VOICE_BLOCK_FRAMES;
+	memset(mix, 0, sizeof(mix));
+	size_t frames = render(main, mix, maxFrames);
+	size_t tailFrames = render(tail, mix, maxFrames);
+	if (tailFrames > frames) frames = tailFrames;
+	if (fadedPos < fadedFrames) {
+		size_t n = fadedFrames - fadedPos;
+		if (n > maxFrames) n = maxFrames;
+		const int32_t* src = faded.data() + fadedPos * channels;
+		for (size_t i = 0; i < n * channels; ++i) mix[i] += src[i];
+		fadedPos += n;
+		if (n > frames) frames = n;
+	}
+	size_t samples = frames * channels;
+	for (size_t i = 0; i < samples; ++i) {
+		int32_t value = mix[i];
+		block[i] = static_cast<int16_t>(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+	}
+	size_t bytes = samples * sizeof(int16_t);
+	return bytes > 0 ? output->write(reinterpret_cast<const uint8_t*>(block), bytes) : 0;
+}
@@ -0,0 +1,214 @@
+// sample_bank.h - button samples converted once and played from RAM
+#pragma once
+
+#include <Arduino.h>
+#include <AudioTools.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "AudioTools/AudioCodecs/CodecWAV.h"
+#include "AudioTools/AudioCodecs/CodecWavIMA.h"
+#include "AudioTools/AudioCodecs/MultiDecoder.h"
+#if USE_SAMPLE_CODECS
+#include "AudioTools/AudioCodecs/CodecFLACFoxen.h"
+#include "AudioTools/AudioCodecs/CodecMP3Helix.h"
+#endif
+#include "config.h"
+#include "sample_manifest.h"
+
+// One imported sample: interleaved 16 bit PCM in the output format, or the
+// same in compressed blocks (SAMPLE_CACHE_FORMAT).
+struct SampleSlot {
+	Vector<int16_t> pcm{0};
+	BlockCompressedPCM packed;
+	bool compressed = false;  // packed instead of pcm
+	size_t frames = 0;
+	AudioInfo source;    // format of the file (after decoding)
+	const char* format = "";  // WAV, IMA ADPCM, MP3 or FLAC
+	uint32_t importUs = 0;
+	uint32_t decodeNsPerFrame = 0;  // measured at load for compressed slots
+	bool loaded = false;
+	LoopMode loopMode = LoopMode::OneShot;
+	size_t loopStart = 0;  // frames; loopEnd is exclusive
+	size_t loopEnd = 0;
+	// Replaces the last seamFrames frames before loopEnd while looping
+	// forward: they are crossfaded into the frames in front of loopStart, so
+	// the wrap to loopStart is continuous.
+	Vector<int16_t> seam{0};
+	size_t seamFrames = 0;
+
+	size_t bytes() {
+		return (pcm.capacity() + seam.capacity()) * sizeof(int16_t) + packed.memoryUsed();
+	}
+
+	// Exchanges the content with other without copying any samples
+	void swap(SampleSlot& other);
+
+	// Releases the memory
+	void clear();
+};
+
+// Progress of an import which another task may follow and cancel: the import
+// stops after the chunk which is read when cancel is set.
+struct LoadProgress {
+	std::atomic<uint32_t> bytesRead{0};
+	std::atomic<uint32_t> bytesTotal{0};
+	std::atomic<bool> cancel{false};
+
+	void reset() {
+		bytesRead = 0;
+		bytesTotal = 0;
+		cancel = false;
+	}
+};
+
+// Decodes the files of the buttons (WAV, IMA ADPCM WAV, MP3, FLAC: the
+// decoder is picked from the content) through the SampleImporter, so that the
+// audio path only ever sees the output format. Memory comes from PSRAM when
+// available; PCM WAV files which exceed the budget are left to the SD player.
+class SampleBank {
+public:
+	// target: format of the audio chain, budgetBytes: total cache size
+	void begin(AudioInfo target, size_t budgetBytes);
+
+	// The file of a button: path, or the first file with the same name and
+	// one of the SAMPLE_FILE_EXTENSIONS. Returns false if there is none.
+	static bool findFile(const char* path, char* result, size_t len);
+
+	// Only PCM WAV files can be played from the SD card: the format of the
+	// last import of the slot, before that the extension of path
+	bool isStreamable(size_t slot, const char* path);
+
+	// Imports the file for a slot; returns false if it stays on the SD card.
+	// With an entry which does not match the file, the slices are detected
+	// on the way (also for files which do not fit) and the entry is updated.
+	bool load(size_t slot, const char* path, ManifestEntry* entry = nullptr);
+
+	// Same as load() into a slot outside of the bank, e.g. in the task of the
+	// SampleLoader, which hands it over with publish(). limitBytes: see
+	// available(); progress is optional.
+	bool import(SampleSlot& slot, const char* path, ManifestEntry* entry, size_t limitBytes,
+	            LoadProgress* progress = nullptr);
+
+	// Memory for a new import of the slot, which replaces its current content
+	size_t available(size_t slot);
+	// Same within the budget only, e.g. for an import which is already in memory
+	size_t budgetLeft(size_t slot);
+
+	// Exchanges the content of the bank slot with slot (the previous content
+	// is left in slot). Call it from the audio task while no voice plays it.
+	void publish(size_t index, SampleSlot& slot);
+
+	// Returns nullptr for slots which are not in memory
+	SampleSlot* get(size_t slot);
+
+	size_t memoryUsed();
+
+	// Format of all slots
+	AudioInfo audioInfo() { return targetInfo; }
+
+	// Prints the source format, import time and memory of each slot
+	void printReport(Print& out);
+
+private:
+	std::array<SampleSlot, BUTTON_COUNT> slots;
+	AudioInfo targetInfo;
+	size_t budget = 0;
+	// picked by formats from the first chunk of the file
+	MultiDecoder decoder;
+	MimeDetector formats{false};
+	WAVDecoder wav;
+	WavIMADecoder ima;
+#if USE_SAMPLE_CODECS
+	MP3DecoderHelix mp3;
+	FLACDecoderFoxen flac;
+#endif
+	SampleImporter importer;
+	OnsetDetector detector;
+	MultiOutput analysis{importer, detector};
+	uint8_t chunk[SAMPLE_LOAD_CHUNK_BYTES];
+
+	void addFormat(AudioDecoder& format, const char* mime, bool (*check)(uint8_t*, size_t));
+	void setDecoderOutput(Print& out);
+	bool isPcmWav();
+	const char* formatName();
+	void updateEntry(ManifestEntry& entry, uint32_t fileSize, const WAVAudioInfo& wav);
+	void setupLoop(SampleSlot& slot, const ManifestEntry& entry);
+	void readFrames(SampleSlot& slot, size_t start, size_t frames, int16_t* out);
+	void measureDecode(SampleSlot& slot);
+};
+
+// Plays a SampleSlot into the audio chain with short attack and release
+// ramps, in the loop mode of the slot. A new play() starts at once: the
+// running sample fades out in the same blocks, so a retrigger has no gap.
+// When it is retriggered again within the fade, the rest of the older fade
+// is rendered at once and mixed into the next blocks.
+// copy() writes at most SAMPLE_VOICE_BLOCK_FRAMES frames, never allocates
+// and loops entirely in memory: compressed slots are decoded one block at a
+// time. A slice is just a frame range of the slot,
+// so it starts without any seek.
+class SampleVoice {
+public:
+	// info: format of the slots and of the output (mono or stereo)
+	bool begin(Print& out, AudioInfo info, uint32_t fadeMs);
+
+	// Plays the slot in its loop mode
+	void play(SampleSlot& slot);
+
+	// Plays the frames start..end-1 of the slot once
+	void play(SampleSlot& slot, size_t start, size_t end);
+
+	// Fades out; isActive() stays true until the ramp was written
+	void stop();
+
+	// Button released: hold mode leaves the loop and plays the rest of the
+	// sample, all other modes fade out
+	void noteOff();
+
+	bool isActive() {
+		return main.slot != nullptr || tail.slot != nullptr || fadedPos < fadedFrames;
+	}
+
+	// true while the slot is played (also by a fade out)
+	bool uses(const SampleSlot& slot) { return main.slot == &slot || tail.slot == &slot; }
+
+	// Writes the next block of at most maxFrames (up to
+	// SAMPLE_VOICE_BLOCK_FRAMES); returns the number of bytes
+	size_t copy(size_t maxFrames = SAMPLE_VOICE_BLOCK_FRAMES);
+
+private:
+	// One running sample
+	struct Playhead {
+		SampleSlot* slot = nullptr;
+		size_t position = 0;
+		size_t end = 0;          // exclusive
+		LoopMode mode = LoopMode::OneShot;
+		bool looping = false;    // wraps at the loop points
+		bool leaveLoop = false;  // hold mode after noteOff()
+		bool forward = true;     // direction in ping-pong loops
+		size_t attack = 0;       // frames of the attack ramp which were written
+		size_t release = 0;      // frames of the release ramp which are still to write
+		bool releasing = false;
+		// decoded block of a compressed slot
+		size_t blockIndex = SIZE_MAX;
+		int16_t block[BlockCompressedPCM::BLOCK_FRAMES * 2];
+	};
+
+	Print* output = nullptr;
+	int channels = 2;
+	size_t fadeFrames = 1;
+	Playhead main;
+	Playhead tail;  // fades out after a retrigger
+	// rest of an earlier tail, rendered ahead (fadeFrames frames)
+	Vector<int32_t> faded{0};
+	size_t fadedPos = 0;
+	size_t fadedFrames = 0;
+	int32_t mix[SAMPLE_VOICE_BLOCK_FRAMES * 2];
+	int16_t block[SAMPLE_VOICE_BLOCK_FRAMES * 2];
+
+	void start(SampleSlot& slot, size_t start, size_t end, LoopMode mode);
+	void fadeOut(Playhead& head);
+	void renderAhead(Playhead& head);
+	size_t render(Playhead& head, int32_t* dst, size_t frames);
+	void advance(Playhead& head);
+};
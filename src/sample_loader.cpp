@@ -0,0 +1,219 @@
+#include "sample_loader.h"
+
+#include <SD.h>
+#include <cstring>
+#include <utility>
+
+// Lower priority value first, then in the order of the requests
+int SampleLoader::compare(LoadRequest& a, LoadRequest& b) {
+	if (a.priority != b.priority) return a.priority > b.priority ? 1 : -1;
+	return a.sequence > b.sequence ? 1 : -1;
+}
+
+bool SampleLoader::begin(SampleBank& sampleBank, SampleManifest& sampleManifest,
+                         FFTConvolver& first, FFTConvolver& second) {
+	if (running) return true;
+	bank = &sampleBank;
+	manifest = &sampleManifest;
+	irActive = &first;
+	irStaging = &second;
+	// a pad which is pressed before its sample is loaded queues the load again
+	// from the audio task, under the mutex: no heap call for the node
+	queueMemory.begin(SAMPLE_LOADER_QUEUE_NODES * (sizeof(LoadRequest) + 32));
+	queue.setAllocator(queueMemory);
+	task.create("SampleLoader", SAMPLE_LOADER_TASK_STACK, SAMPLE_LOADER_TASK_PRIORITY,
+	            SAMPLE_LOADER_TASK_CORE);
+	running = task.begin([this]() { step(); });
+	return running;
+}
+
+void SampleLoader::end() {
+	if (!running) return;
+	cancelAll();
+	task.remove();
+	running = false;
+}
+
+bool SampleLoader::loadSample(size_t slot, const char* path, uint8_t priority) {
+	if (slot >= BUTTON_COUNT) return false;
+	if (path == nullptr) path = "";
+	std::lock_guard<std::mutex> lock(mutex);
+	bool runningSlot = state == Loading && current.kind == LoadKind::Sample && current.slot == slot;
+	if (runningSlot && !isStale(current) && strcmp(current.path, path) == 0) return true;
+	if (runningSlot) progress.cancel = true;
+	LoadRequest request;
+	request.kind = LoadKind::Sample;
+	request.priority = priority;
+	request.slot = static_cast<uint8_t>(slot);
+	request.sequence = nextSequence++;
+	request.target = path[0] != '\0' ? manifest->add(path) : nullptr;
+	if (request.target != nullptr) request.entry = *request.target;
+	request.limitBytes = bank->available(slot);
+	snprintf(request.path, sizeof(request.path), "%s", path);
+	latestSample[slot] = request.sequence;
+	pending[slot] = true;
+	return queue.enqueue(std::move(request));
+}
+
+bool SampleLoader::loadImpulseResponse(const char* path, size_t maxFrames, uint8_t priority) {
+	if (path == nullptr || path[0] == '\0') return false;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (state == Loading && current.kind == LoadKind::ImpulseResponse) progress.cancel = true;
+	LoadRequest request;
+	request.kind = LoadKind::ImpulseResponse;
+	request.priority = priority;
+	request.sequence = nextSequence++;
+	request.maxFrames = maxFrames;
+	snprintf(request.path, sizeof(request.path), "%s", path);
+	latestIr = request.sequence;
+	return queue.enqueue(std::move(request));
+}
+
+void SampleLoader::cancelAll() {
+	std::lock_guard<std::mutex> lock(mutex);
+	queue.clear();
+	cancelledBefore = nextSequence;
+	for (bool& flag : pending) flag = false;
+	if (state == Loading) progress.cancel = true;
+}
+
+void SampleLoader::cancel(size_t slot) {
+	if (slot >= BUTTON_COUNT) return;
+	std::lock_guard<std::mutex> lock(mutex);
+	// a sequence which no request has: all requests of the slot are stale
+	latestSample[slot] = nextSequence++;
+	pending[slot] = false;
+	if (state == Loading && current.kind == LoadKind::Sample && current.slot == slot) {
+		progress.cancel = true;
+	}
+}
+
+bool SampleLoader::isPending(size_t slot) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return slot < BUTTON_COUNT && pending[slot];
+}
+
+// Replaced by a newer request for the same target or cancelled
+bool SampleLoader::isStale(const LoadRequest& request) {
+	if (request.sequence < cancelledBefore) return true;
+	uint32_t latest = request.kind == LoadKind::Sample ? latestSample[request.slot] : latestIr;
+	return request.sequence != latest;
+}
+
+const LoadRequest* SampleLoader::ready() {
+	if (state != Ready) return nullptr;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (isStale(current)) {
+		state = Recycle;
+		return nullptr;
+	}
+	return &current;
+}
+
+void SampleLoader::release() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (state != Ready) return;
+	if (current.kind == LoadKind::Sample) {
+		// a request which the audio task queued again stays pending
+		if (!isStale(current)) pending[current.slot] = false;
+		if (current.target != nullptr && current.entry.dirty) *current.target = current.entry;
+	} else if (resultLoaded) {
+		// the old impulse response is released by the task
+		std::swap(irActive, irStaging);
+	}
+	state = Recycle;
+}
+
+LoadStatus SampleLoader::status() {
+	std::lock_guard<std::mutex> lock(mutex);
+	LoadStatus result;
+	bool active = state == Loading || state == Ready;
+	result.pending = queue.size() + (active ? 1 : 0);
+	result.busy = result.pending > 0;
+	uint32_t total = progress.bytesTotal;
+	if (active && total > 0) {
+		uint64_t read = progress.bytesRead;
+		result.percent = static_cast<uint8_t>(read >= total ? 100 : read * 100 / total);
+	}
+	return result;
+}
+
+bool SampleLoader::next() {
+	std::lock_guard<std::mutex> lock(mutex);
+	LoadRequest request;
+	while (queue.dequeue(request)) {
+		if (isStale(request)) continue;
+		current = request;
+		progress.reset();
+		resultLoaded = false;
+		state = Loading;
+		return true;
+	}
+	return false;
+}
+
+// Loads the current request into the staging slot or convolver
+void SampleLoader::run() {
+	bool loaded = false;
+	if (current.kind == LoadKind::Sample) {
+		// an empty path publishes the empty staging slot
+		if (current.path[0] != '\0') {
+			ManifestEntry* entry = current.target != nullptr ? &current.entry : nullptr;
+			loaded = bank->import(staging, current.path, entry, current.limitBytes, &progress);
+		}
+	} else {
+		File file = SD.open(current.path);
+		if (file) {
+			// read in one go by the convolver: it can only be cancelled afterwards
+			progress.bytesTotal = file.size();
+			loaded = irStaging->loadWAV(file, current.maxFrames);
+			progress.bytesRead = progress.bytesTotal.load();
+			file.close();
+		}
+	}
+	resultLoaded = loaded && !progress.cancel;
+	manifestDue = true;
+	state = progress.cancel ? Recycle : Ready;
+}
+
+void SampleLoader::step() {
+	switch (state) {
+		case Recycle:
+			// the previous content of the published slot, an impulse response
+			// which was replaced or a cancelled load
+			staging.clear();
+			irStaging->end();
+			state = Idle;
+			return;
+		case Idle:
+			if (next()) {
+				run();
+				return;
+			}
+			// a published take: no load is waiting to be published, so the
+			// bank slot stays as it is while it is written
+			if (recorder != nullptr && recorder->saveDue()) {
+				recorder->save(*bank);
+				return;
+			}
+			if (manifestDue) {
+				// slices and loops which were found on the way: copied under the
+				// mutex, written after it, as the audio task waits for the mutex
+				bool due = manifestUnsaved;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (manifest->isDirty()) {
+						manifestCopy = *manifest;
+						manifest->clearDirty();
+						due = true;
+					}
+				}
+				if (due) manifestUnsaved = !manifestCopy.save();
+				manifestDue = false;
+			}
+			break;
+		default:
+			break;
+	}
+	delay(SAMPLE_LOADER_IDLE_MS);
+}
@@ -0,0 +1,127 @@
+// sample_loader.h - loads the button samples and the impulse response in a
+// task of its own, so that audio and UI keep running while megabytes come
+// from the SD card. Requests are served by priority; a new request for the
+// same slot replaces a queued or running one. A finished load waits in a
+// staging slot until the audio task takes it over between two blocks: the
+// buffers are swapped, nothing is copied, and the previous content is
+// released again by the loader task. The manifest entry is imported into a
+// copy as well, which replaces the entry in the manifest when the audio task
+// releases the request: the audio task reads the slices of the manifest
+// without a lock. Takes of the SampleRecorder are written
+// to the SD card by the same task while it has nothing to load.
+#pragma once
+
+#include <Arduino.h>
+#include <AudioTools.h>
+#include <atomic>
+#include <mutex>
+#include "AudioTools/AudioLibs/FFTConvolver.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/PriorityQueue.h"
+#ifdef USE_CPP_TASK
+#include "AudioTools/Concurrency/Desktop/Task.h"
+#else
+#include "AudioTools/Concurrency/RTOS/Task.h"
+#endif
+#include "config.h"
+#include "sample_bank.h"
+#include "sample_manifest.h"
+#include "sample_recorder.h"
+
+enum class LoadKind : uint8_t { Sample, ImpulseResponse };
+
+struct LoadRequest {
+	LoadKind kind = LoadKind::Sample;
+	uint8_t priority = LOAD_PRIORITY_BANK;
+	uint8_t slot = 0;
+	uint32_t sequence = 0;  // order of the requests: FIFO within a priority
+	ManifestEntry* target = nullptr;  // in the manifest, replaced by release()
+	ManifestEntry entry;    // copy of target which the import updates
+	size_t limitBytes = 0;  // memory for the sample, from when it was queued
+	size_t maxFrames = 0;   // impulse response
+	char path[MANIFEST_PATH_LEN] = "";
+};
+
+// What the UI shows while loading
+struct LoadStatus {
+	bool busy = false;
+	size_t pending = 0;   // requests which are not finished, the running one included
+	uint8_t percent = 0;  // of the running request
+};
+
+class SampleLoader {
+public:
+	~SampleLoader() { end(); }
+
+	// Starts the task. The impulse response alternates between the two
+	// convolvers: one is played while the other one is loaded.
+	bool begin(SampleBank& bank, SampleManifest& manifest, FFTConvolver& first,
+	           FFTConvolver& second);
+	void end();
+
+	// Saves the takes of the recorder; call it before begin()
+	void setRecorder(SampleRecorder& sampleRecorder) { recorder = &sampleRecorder; }
+
+	// Queues the file of a button slot; an empty path empties the slot. Call
+	// it from the audio task: the memory of the other slots is counted now.
+	bool loadSample(size_t slot, const char* path, uint8_t priority = LOAD_PRIORITY_BANK);
+
+	// Queues an impulse response which is shortened to maxFrames
+	bool loadImpulseResponse(const char* path, size_t maxFrames,
+	                         uint8_t priority = LOAD_PRIORITY_IR);
+
+	// Drops the queue and stops the running request after its current chunk
+	void cancelAll();
+
+	// Same for the requests of one slot, e.g. before a take is recorded into it
+	void cancel(size_t slot);
+
+	// true while a request for the slot is queued or running
+	bool isPending(size_t slot);
+
+	// Audio task: the finished request (loaded or not) or nullptr. It stays
+	// until release() is called.
+	const LoadRequest* ready();
+	// The finished request is in stagingSlot() or stagingConvolver()
+	bool readyLoaded() { return resultLoaded; }
+	SampleSlot& stagingSlot() { return staging; }
+	FFTConvolver& stagingConvolver() { return *irStaging; }
+	// Audio task: the finished request was taken over; slices and loops which
+	// were detected go to the manifest
+	void release();
+
+	LoadStatus status();
+
+private:
+	enum State : uint8_t { Idle, Loading, Ready, Recycle };
+
+	SampleBank* bank = nullptr;
+	SampleManifest* manifest = nullptr;
+	SampleRecorder* recorder = nullptr;
+	FFTConvolver* irActive = nullptr;
+	FFTConvolver* irStaging = nullptr;
+	AllocatorArena queueMemory;  // nodes of the queue: the audio task queues too
+	PriorityQueue<LoadRequest> queue{compare};
+	std::mutex mutex;  // queue, sequences and current
+	uint32_t nextSequence = 1;
+	uint32_t cancelledBefore = 0;  // requests with a lower sequence are dropped
+	uint32_t latestSample[BUTTON_COUNT] = {0};
+	uint32_t latestIr = 0;
+	bool pending[BUTTON_COUNT] = {false};
+	LoadRequest current;
+	LoadProgress progress;
+	SampleSlot staging;
+	std::atomic<uint8_t> state{Idle};
+	std::atomic<bool> resultLoaded{false};
+	bool manifestDue = false;
+	bool manifestUnsaved = false;  // the last save failed
+	SampleManifest manifestCopy;    // saved without the mutex
+	bool running = false;
+	// last member: the task stops before the rest is destroyed
+	Task task;
+
+	static int compare(LoadRequest& a, LoadRequest& b);
+	bool isStale(const LoadRequest& request);
+	bool next();
+	void run();
+	void step();
+};
@@ -0,0 +1,157 @@
+#include "sample_manifest.h"
+
+#include <Arduino.h>
+#include <SD.h>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+const char* const kLoopModeNames[] = {"oneshot", "forward", "pingpong", "hold"};
+
+LoopMode parseLoopMode(const char* value) {
+	for (size_t i = 0; i < sizeof(kLoopModeNames) / sizeof(kLoopModeNames[0]); ++i) {
+		if (strcasecmp(value, kLoopModeNames[i]) == 0) return static_cast<LoopMode>(i);
+	}
+	return LoopMode::OneShot;
+}
+}
+
+bool ManifestEntry::sliceFrames(size_t slice, uint32_t rate, uint32_t& start,
+                                uint32_t& end) const {
+	if (slice >= sliceCount || sampleRate == 0) return false;
+	uint32_t last = slice + 1 < sliceCount ? slices[slice + 1] : frames;
+	start = static_cast<uint32_t>(static_cast<uint64_t>(slices[slice]) * rate / sampleRate);
+	end = static_cast<uint32_t>(static_cast<uint64_t>(last) * rate / sampleRate);
+	return end > start;
+}
+
+bool ManifestEntry::sliceBytes(size_t slice, uint32_t& start, uint32_t& end) const {
+	if (slice >= sliceCount || frameBytes == 0) return false;
+	uint32_t last = slice + 1 < sliceCount ? slices[slice + 1] : frames;
+	start = dataStart + slices[slice] * frameBytes;
+	end = dataStart + last * frameBytes;
+	return end > start;
+}
+
+bool SampleManifest::load(const char* path) {
+	count = 0;
+	chop[0] = '\0';
+	if (!SD.exists(path)) return false;
+	File f = SD.open(path, FILE_READ);
+	if (!f) {
+		Serial.println("Failed to open sample manifest for read");
+		return false;
+	}
+	char line[192];
+	ManifestEntry* entry = nullptr;
+	while (f.available()) {
+		size_t n = f.readBytesUntil('\n', line, sizeof(line) - 1);
+		line[n] = '\0';
+		if (n > 0 && line[n - 1] == '\r') line[n - 1] = '\0';
+		if (line[0] == '[') {
+			char* close = strchr(line, ']');
+			if (close) *close = '\0';
+			entry = add(line + 1);
+			continue;
+		}
+		char* eq = strchr(line, '=');
+		if (!eq) continue;
+		*eq = '\0';
+		const char* value = eq + 1;
+		if (strcmp(line, "chop") == 0) {
+			snprintf(chop, sizeof(chop), "%s", value);
+		} else if (!entry) {
+			continue;
+		} else if (strcmp(line, "size") == 0) {
+			entry->fileSize = strtoul(value, nullptr, 10);
+		} else if (strcmp(line, "data") == 0) {
+			entry->dataStart = strtoul(value, nullptr, 10);
+		} else if (strcmp(line, "frame_bytes") == 0) {
+			entry->frameBytes = static_cast<uint16_t>(strtoul(value, nullptr, 10));
+		} else if (strcmp(line, "rate") == 0) {
+			entry->sampleRate = strtoul(value, nullptr, 10);
+		} else if (strcmp(line, "frames") == 0) {
+			entry->frames = strtoul(value, nullptr, 10);
+		} else if (strcmp(line, "loop") == 0) {
+			entry->loopMode = parseLoopMode(value);
+		} else if (strcmp(line, "loop_start") == 0) {
+			entry->loopStart = strtoul(value, nullptr, 10);
+		} else if (strcmp(line, "loop_end") == 0) {
+			entry->loopEnd = strtoul(value, nullptr, 10);
+		} else if (strcmp(line, "slices") == 0) {
+			// ascending frame offsets separated by commas
+			entry->sliceCount = 0;
+			char* pos = const_cast<char*>(value);
+			while (*pos != '\0' && entry->sliceCount < SLICE_MAX_COUNT) {
+				char* next = nullptr;
+				uint32_t frame = strtoul(pos, &next, 10);
+				if (next == pos) break;
+				if (entry->sliceCount == 0 || frame > entry->slices[entry->sliceCount - 1]) {
+					entry->slices[entry->sliceCount++] = frame;
+				}
+				pos = next;
+				while (*pos == ',' || *pos == ' ') ++pos;
+			}
+		}
+	}
+	f.close();
+	return true;
+}
+
+bool SampleManifest::save(const char* path) {
+	File f = SD.open(path, FILE_WRITE);
+	if (!f) {
+		Serial.println("Failed to open sample manifest for write");
+		return false;
+	}
+	if (chop[0] != '\0') f.printf("chop=%s\n", chop);
+	for (size_t i = 0; i < count; ++i) {
+		ManifestEntry& entry = entries[i];
+		f.printf("[%s]\n", entry.path);
+		f.printf("size=%u\n", static_cast<unsigned>(entry.fileSize));
+		f.printf("data=%u\n", static_cast<unsigned>(entry.dataStart));
+		f.printf("frame_bytes=%u\n", static_cast<unsigned>(entry.frameBytes));
+		f.printf("rate=%u\n", static_cast<unsigned>(entry.sampleRate));
+		f.printf("frames=%u\n", static_cast<unsigned>(entry.frames));
+		f.print("slices=");
+		for (size_t s = 0; s < entry.sliceCount; ++s) {
+			f.printf(s == 0 ? "%u" : ",%u", static_cast<unsigned>(entry.slices[s]));
+		}
+		f.println();
+		if (entry.loopMode != LoopMode::OneShot || entry.loopEnd > 0) {
+			f.printf("loop=%s\n", kLoopModeNames[static_cast<size_t>(entry.loopMode)]);
+			f.printf("loop_start=%u\n", static_cast<unsigned>(entry.loopStart));
+			f.printf("loop_end=%u\n", static_cast<unsigned>(entry.loopEnd));
+		}
+		entry.dirty = false;
+	}
+	f.close();
+	return true;
+}
+
+ManifestEntry* SampleManifest::find(const char* path) {
+	for (size_t i = 0; i < count; ++i) {
+		if (strcmp(entries[i].path, path) == 0) return &entries[i];
+	}
+	return nullptr;
+}
+
+ManifestEntry* SampleManifest::add(const char* path) {
+	if (ManifestEntry* entry = find(path)) return entry;
+	if (count >= entries.size()) return nullptr;
+	ManifestEntry& entry = entries[count++];
+	entry = ManifestEntry();
+	snprintf(entry.path, sizeof(entry.path), "%s", path);
+	return &entry;
+}
+
+void SampleManifest::clearDirty() {
+	for (size_t i = 0; i < count; ++i) entries[i].dirty = false;
+}
+
+bool SampleManifest::isDirty() const {
+	for (size_t i = 0; i < count; ++i) {
+		if (entries[i].dirty) return true;
+	}
+	return false;
+}
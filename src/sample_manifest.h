@@ -0,0 +1,78 @@
+// sample_manifest.h - slices, loops and file layout of the samples on SD
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "config.h"
+
+// Playback of a sample from RAM: once, or repeating between the loop points
+// until the button is released. Hold loops only while the button is held and
+// then plays the rest of the sample.
+enum class LoopMode : uint8_t { OneShot, Forward, PingPong, Hold };
+
+// What is known about one WAV file: the slice points in frames of the file
+// and where the PCM data starts, so that a slice of a streamed file can be
+// started with one seek. The entry is only used while the file size matches.
+struct ManifestEntry {
+	char path[MANIFEST_PATH_LEN] = "";
+	uint32_t fileSize = 0;
+	uint32_t dataStart = 0;    // byte offset of the PCM data
+	uint16_t frameBytes = 0;   // bytes per frame in the file
+	uint32_t sampleRate = 0;
+	uint32_t frames = 0;       // length of the file in frames
+	size_t sliceCount = 0;
+	uint32_t slices[SLICE_MAX_COUNT] = {0};  // first frame of each slice
+	LoopMode loopMode = LoopMode::OneShot;
+	uint32_t loopStart = 0;    // frames of the file, loopEnd is exclusive
+	uint32_t loopEnd = 0;      // 0: end of the file
+	bool dirty = false;        // changed since the manifest was read
+
+	bool matches(uint32_t size) const { return size == fileSize && sliceCount > 0; }
+
+	// Frames of a slice at the indicated sample rate (end is exclusive)
+	bool sliceFrames(size_t slice, uint32_t rate, uint32_t& start, uint32_t& end) const;
+
+	// Byte range of a slice in the file (end is exclusive)
+	bool sliceBytes(size_t slice, uint32_t& start, uint32_t& end) const;
+};
+
+// Text file with one [path] section per file, e.g.
+//   chop=/break.wav
+//   [/break.wav]
+//   size=352844
+//   data=44
+//   frame_bytes=4
+//   rate=44100
+//   frames=88200
+//   slices=0,10981,22007,33031
+//   loop=forward
+//   loop_start=22007
+//   loop_end=44056
+// The slices and loops can be edited by hand; they are only detected again
+// (loops from the smpl chunk) when the file size changes.
+class SampleManifest {
+public:
+	bool load(const char* path = SAMPLE_MANIFEST_PATH);
+	bool save(const char* path = SAMPLE_MANIFEST_PATH);
+
+	// File whose slices are played by the buttons; nullptr without chop mode
+	const char* chopPath() const { return chop[0] != '\0' ? chop : nullptr; }
+
+	ManifestEntry* find(const char* path);
+
+	// Existing entry or a new one; nullptr when the manifest is full
+	ManifestEntry* add(const char* path);
+
+	// true if an entry was updated since load()
+	bool isDirty() const;
+
+	// The changes are written: by a copy, which is saved without holding up
+	// the users of this one
+	void clearDirty();
+
+private:
+	std::array<ManifestEntry, BUTTON_COUNT + 1> entries;
+	size_t count = 0;
+	char chop[MANIFEST_PATH_LEN] = "";
+};
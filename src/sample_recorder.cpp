@@ -0,0 +1,218 @@
+#include "sample_recorder.h"
+
+#include <SD.h>
+#include <algorithm>
+#include <cstring>
+
+bool SampleRecorder::begin(AudioInfo format, size_t frameCount) {
+	info = format;
+	info.bits_per_sample = 16;
+	frameBytes = info.channels * sizeof(int16_t);
+	maxFrames = frameCount;
+	if (maxFrames == 0) return false;
+	return allocate();
+}
+
+// The buffer for the next take: the memory of the last one went to the bank
+bool SampleRecorder::allocate() {
+	take.clear();
+	size_t bytes = maxFrames * frameBytes;
+	size_t available = ESP.getPsramSize() > 0 ? ESP.getMaxAllocPsram() : ESP.getMaxAllocHeap();
+	if (available < bytes) {
+		Serial.printf("Geen geheugen voor een opname van %u bytes\n", static_cast<unsigned>(bytes));
+		state = NoBuffer;
+		return false;
+	}
+	take.pcm.resize(maxFrames * info.channels);
+	state = Ready;
+	return true;
+}
+
+bool SampleRecorder::start(size_t index, RecordSource from) {
+	if (index >= BUTTON_COUNT) return false;
+	// no memory at boot or after the last take: maybe there is now
+	if (state == NoBuffer) allocate();
+	if (state != Ready) return false;
+	pad = index;
+	source = from;
+	frames = 0;
+	dropped = 0;
+	inputBehind = 0;
+	outputFrames = 0;
+	// the audio task sees the fields above once it sees Recording
+	state = Recording;
+	return true;
+}
+
+void SampleRecorder::stop() {
+	uint8_t expected = Recording;
+	state.compare_exchange_strong(expected, Stopping);
+}
+
+RecordStatus SampleRecorder::status() {
+	RecordStatus result;
+	uint8_t now = state;
+	result.recording = now == Recording || now == Stopping;
+	result.saving = now == Saving;
+	result.pad = pad;
+	result.frames = frames;
+	result.dropped = dropped;
+	result.inputBehind = inputBehind;
+	return result;
+}
+
+// Copies the frames which still fit; the rest is counted and ends the take
+size_t SampleRecorder::append(const uint8_t* data, size_t len) {
+	size_t count = len / frameBytes;
+	size_t done = frames.load(std::memory_order_relaxed);
+	size_t n = std::min(count, maxFrames - done);
+	memcpy(take.pcm.data() + done * info.channels, data, n * frameBytes);
+	frames.store(done + n, std::memory_order_relaxed);
+	if (n < count || done + n == maxFrames) {
+		dropped += count - n;
+		stop();
+	}
+	return n * frameBytes;
+}
+
+size_t SampleRecorder::write(const uint8_t* data, size_t len) {
+	if (state != Recording) return len;
+	if (source == RecordSource::Input) {
+		// the clock which the input is compared with
+		outputFrames += len / frameBytes;
+		return len;
+	}
+	append(data, len);
+	return len;
+}
+
+void SampleRecorder::readInput(Stream& input) {
+	if (state != Recording || source != RecordSource::Input) return;
+	int available = input.available();
+	if (available <= 0) return;
+	size_t done = frames.load(std::memory_order_relaxed);
+	size_t n = std::min(static_cast<size_t>(available) / frameBytes, maxFrames - done);
+	size_t len = input.readBytes(reinterpret_cast<uint8_t*>(take.pcm.data() + done * info.channels),
+	                             n * frameBytes);
+	frames.store(done + len / frameBytes, std::memory_order_relaxed);
+	if (done + len / frameBytes == maxFrames) stop();
+}
+
+void SampleRecorder::update(SampleBank& bank, SampleVoice& voice) {
+	if (state == Fitting) {
+		exchangeTake(bank);
+		return;
+	}
+	if (state != Stopping) return;
+	SampleSlot* current = bank.get(pad);
+	if (current != nullptr && voice.uses(*current)) {
+		voice.stop();
+		return;
+	}
+	size_t n = frames;
+	if (source == RecordSource::Input && outputFrames > n) inputBehind = outputFrames - n;
+	if (n == 0) {
+		// nothing recorded: the pad keeps its sample
+		state = Ready;
+		return;
+	}
+	// shorter than the buffer: only the length changes, nothing is allocated
+	describeTake(n);
+	bank.publish(pad, take);
+	published = bank.get(pad)->pcm.data();
+	state = Saving;
+}
+
+// The length of take becomes n frames (an allocation only without the buffer)
+void SampleRecorder::describeTake(size_t n) {
+	take.pcm.resize(n * info.channels);
+	take.frames = n;
+	take.source = info;
+	take.format = "REC";
+	take.loaded = true;
+	take.loopMode = LoopMode::OneShot;
+	take.loopStart = 0;
+	take.loopEnd = n;
+}
+
+// Copies the take of the bank slot into a buffer of its length
+bool SampleRecorder::fitTake(SampleSlot& slot) {
+	size_t bytes = slot.frames * frameBytes;
+	size_t available = ESP.getPsramSize() > 0 ? ESP.getMaxAllocPsram() : ESP.getMaxAllocHeap();
+	if (available < bytes) return false;
+	describeTake(slot.frames);
+	memcpy(take.pcm.data(), slot.pcm.data(), bytes);
+	return true;
+}
+
+// The same samples: a voice which plays the take continues in the copy. The
+// buffer of the recording comes back with its capacity.
+void SampleRecorder::exchangeTake(SampleBank& bank) {
+	SampleSlot* slot = bank.get(pad);
+	if (slot == nullptr || slot->pcm.data() != published) {
+		// replaced by a load in the meantime: the copy is released by start()
+		state = NoBuffer;
+		return;
+	}
+	bank.publish(pad, take);
+	published = bank.get(pad)->pcm.data();
+	take.pcm.resize(maxFrames * info.channels);
+	state = Ready;
+}
+
+// First free RECORD_DIR/<pad>-<n>.wav
+bool SampleRecorder::nextPath() {
+	if (!SD.exists(RECORD_DIR)) SD.mkdir(RECORD_DIR);
+	for (unsigned n = 1; n < 1000; ++n) {
+		snprintf(path, sizeof(path), "%s/%u-%u.wav", RECORD_DIR, static_cast<unsigned>(pad + 1), n);
+		if (!SD.exists(path)) return true;
+	}
+	path[0] = '\0';
+	return false;
+}
+
+void SampleRecorder::save(SampleBank& bank) {
+	SampleSlot* slot = bank.get(pad);
+	// a load which replaced the take in the meantime: nothing to save
+	bool current = slot != nullptr && slot->pcm.data() == published;
+	if (current && nextPath()) {
+		uint32_t start = millis();
+		size_t total = slot->frames * frameBytes;
+		size_t written = 0;
+		File file = SD.open(path, FILE_WRITE);
+		if (file) {
+			// the length is known: the header is written once, in front. The
+			// WAVHeader writes file_size as the size of the data chunk.
+			WAVAudioInfo wav = encoder.defaultConfig();
+			wav.copyFrom(info);
+			wav.is_streamed = false;
+			wav.data_length = total;
+			wav.file_size = total;
+			encoder.setOutput(file);
+			encoder.begin(wav);
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(slot->pcm.data());
+			while (written < total) {
+				size_t n = std::min(RECORD_FLUSH_CHUNK_BYTES, total - written);
+				if (encoder.write(data + written, n) != n) break;
+				written += n;
+			}
+			encoder.end();
+			file.close();
+		}
+		if (written == total) {
+			Serial.printf("Recording %s: %u frames (dropped %u, input behind %u), %u bytes in %u ms\n",
+			              path, static_cast<unsigned>(slot->frames),
+			              static_cast<unsigned>(dropped.load()), static_cast<unsigned>(inputBehind.load()),
+			              static_cast<unsigned>(total), static_cast<unsigned>(millis() - start));
+		} else {
+			Serial.printf("Kon opname %s niet schrijven\n", path);
+		}
+	}
+	// the previous content of the bank slot
+	take.clear();
+	if (current && fitTake(*slot)) {
+		state = Fitting;
+		return;
+	}
+	allocate();
+}
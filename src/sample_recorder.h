@@ -0,0 +1,91 @@
+// sample_recorder.h - live sampling: records the master output (the signal
+// of the I2S output and the scope) or an I2S input into a buffer which is
+// allocated once at boot. When the recording stops the take is handed to the
+// bank slot of a pad like a finished load, so it plays at the next press. The
+// audio task only copies into the buffer and counts what does not fit; the
+// WAV file on the SD card is written afterwards by the sample loader task,
+// which then copies the take at its length. The audio task exchanges the copy
+// for the buffer, which is used again for the next take.
+#pragma once
+
+#include <Arduino.h>
+#include <AudioTools.h>
+#include <atomic>
+#include "config.h"
+#include "sample_bank.h"
+
+enum class RecordSource : uint8_t { Output, Input };
+
+// What the UI shows and the reports print
+struct RecordStatus {
+	bool recording = false;  // also while the take is handed over
+	bool saving = false;
+	size_t pad = 0;
+	size_t frames = 0;       // of the running or the last take
+	uint32_t dropped = 0;    // frames which did not fit into the buffer
+	uint32_t inputBehind = 0;  // input: frames it delivered less than the output
+};
+
+class SampleRecorder : public Print {
+public:
+	// Allocates the buffer for maxFrames in info (16 bit, the format of the
+	// bank). maxFrames 0 disables recording. When there is no memory for it,
+	// start() tries again.
+	bool begin(AudioInfo info, size_t maxFrames);
+	bool isAvailable() { return maxFrames > 0; }
+
+	// Control: starts a take for the pad; false while the last one is saved
+	bool start(size_t pad, RecordSource source);
+	// Control: ends the take, which is handed over in the next update()
+	void stop();
+	RecordStatus status();
+
+	// Audio task: the master output of the mixer (16 bit). Copies what fits;
+	// a full buffer ends the take.
+	size_t write(const uint8_t* data, size_t len) override;
+	size_t write(uint8_t) override { return 0; }
+	// Audio task: takes the whole frames which the input has (its reads must
+	// not wait, e.g. an I2SStream with a read timeout of 0)
+	void readInput(Stream& input);
+	// Audio task: publishes an ended take to the bank slot of its pad. A
+	// voice which plays the slot fades out first: published a block later.
+	// After save() the copy of the take replaces the buffer in the slot.
+	void update(SampleBank& bank, SampleVoice& voice);
+
+	// Loader task: true when a published take waits for its file
+	bool saveDue() { return state == Saving; }
+	// Loader task: writes the take as RECORD_DIR/<pad>-<n>.wav in chunks of
+	// RECORD_FLUSH_CHUNK_BYTES and copies it at its length
+	void save(SampleBank& bank);
+
+	// File of the last take which was saved
+	const char* lastPath() { return path; }
+
+private:
+	// Ready -> Recording -> Stopping -> Saving -> Fitting -> Ready; NoBuffer
+	// when the buffer could not be allocated
+	enum State : uint8_t { Disabled, NoBuffer, Ready, Recording, Stopping, Saving, Fitting };
+
+	AudioInfo info;
+	size_t maxFrames = 0;
+	size_t frameBytes = 4;
+	// the buffer; after the hand over the previous content of the bank slot
+	SampleSlot take;
+	std::atomic<uint8_t> state{Disabled};
+	RecordSource source = RecordSource::Output;
+	size_t pad = 0;
+	std::atomic<size_t> frames{0};
+	std::atomic<uint32_t> dropped{0};
+	std::atomic<uint32_t> inputBehind{0};
+	uint64_t outputFrames = 0;  // output clock while the input is recorded
+	const int16_t* published = nullptr;  // samples of the take in the bank
+	char path[MANIFEST_PATH_LEN] = "";
+	WAVEncoder encoder;
+
+	size_t append(const uint8_t* data, size_t len);
+	bool allocate();
+	void describeTake(size_t n);
+	bool fitTake(SampleSlot& slot);
+	void exchangeTake(SampleBank& bank);
+	bool nextPath();
+};
@@ -0,0 +1,84 @@
+#include "settings_blob.h"
+
+#include <cstring>
+
+#include "config.h"
+
+namespace {
+constexpr size_t kHeaderSize = offsetof(SettingsBlob, payload);
+// Version 2 ended the EffectParams after compEnabled and its padding.
+constexpr size_t kV2ParamsSize = offsetof(EffectParams, eqLowDb);
+constexpr size_t kV2PayloadSize = sizeof(float) + kV2ParamsSize + sizeof(uint32_t) +
+                                  PRESET_SLOT_COUNT * kV2ParamsSize;
+
+static_assert(offsetof(SettingsBlob, crc) == kHeaderSize + sizeof(PersistedSettings),
+              "the CRC follows the payload");
+
+void decodeV2(const uint8_t* payload, PersistedSettings& out) {
+	fillDefaultSettings(out);
+	memcpy(&out.zoom, payload, sizeof(out.zoom));
+	payload += sizeof(out.zoom);
+	memcpy(&out.live, payload, kV2ParamsSize);
+	payload += kV2ParamsSize;
+	memcpy(&out.presetUsedMask, payload, sizeof(out.presetUsedMask));
+	payload += sizeof(out.presetUsedMask);
+	for (EffectParams& preset : out.presets) {
+		memcpy(&preset, payload, kV2ParamsSize);
+		payload += kV2ParamsSize;
+	}
+}
+}
+
+uint32_t settingsCrc32(const uint8_t* data, size_t len) {
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < len; ++i) {
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+	}
+	return ~crc;
+}
+
+void fillDefaultSettings(PersistedSettings& s) {
+	memset(&s, 0, sizeof(s));
+	s.zoom = DEFAULT_HORIZ_ZOOM;
+	s.live = defaultEffectParams();
+	for (EffectParams& preset : s.presets) preset = defaultEffectParams();
+}
+
+void encodeSettingsBlob(const PersistedSettings& settings, SettingsBlob& blob) {
+	memset(&blob, 0, sizeof(blob));
+	blob.magic = kSettingsMagic;
+	blob.version = kSettingsVersion;
+	blob.payloadSize = sizeof(PersistedSettings);
+	blob.payload = settings;
+	blob.crc = settingsCrc32(reinterpret_cast<const uint8_t*>(&blob), offsetof(SettingsBlob, crc));
+}
+
+uint16_t decodeSettingsBlob(const uint8_t* data, size_t len, PersistedSettings& out) {
+	if (len < kHeaderSize) return 0;
+	uint32_t magic;
+	uint16_t version, payloadSize;
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&version, data + offsetof(SettingsBlob, version), sizeof(version));
+	memcpy(&payloadSize, data + offsetof(SettingsBlob, payloadSize), sizeof(payloadSize));
+	if (magic != kSettingsMagic) return 0;
+	if (version == kSettingsVersion) {
+		if (payloadSize != sizeof(PersistedSettings)) return 0;
+	} else if (version == 2) {
+		if (payloadSize != kV2PayloadSize) return 0;
+	} else {
+		return 0;
+	}
+	if (len != kHeaderSize + payloadSize + sizeof(uint32_t)) return 0;
+	uint32_t crc;
+	memcpy(&crc, data + kHeaderSize + payloadSize, sizeof(crc));
+	if (crc != settingsCrc32(data, kHeaderSize + payloadSize)) return 0;
+	if (version == 2) {
+		decodeV2(data + kHeaderSize, out);
+	} else {
+		memcpy(&out, data + kHeaderSize, sizeof(out));
+	}
+	return version;
+}
@@ -0,0 +1,31 @@
+// settings_blob.h - on-disk layout of /settings.bin
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "settings_storage.h"
+
+constexpr uint32_t kSettingsMagic = 0x534B4E42; // "BNKS"
+constexpr uint16_t kSettingsVersion = 3;
+
+// On-disk layout: header, payload, CRC32 over header + payload.
+struct SettingsBlob {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t payloadSize;
+	PersistedSettings payload;
+	uint32_t crc;
+};
+
+uint32_t settingsCrc32(const uint8_t* data, size_t len);
+
+// Zoom, live values and presets at their defaults.
+void fillDefaultSettings(PersistedSettings& s);
+
+// Header, payload and CRC of the current version.
+void encodeSettingsBlob(const PersistedSettings& settings, SettingsBlob& blob);
+
+// Reads a blob of the current version or of version 2, which has no EQ gains:
+// they are set to MASTER_EQ_DEFAULT_DB. Returns the version, 0 when the blob
+// is invalid.
+uint16_t decodeSettingsBlob(const uint8_t* data, size_t len, PersistedSettings& out);
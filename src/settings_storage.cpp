@@ -2,135 +2,283 @@
 
 #include <Arduino.h>
 #include <SD.h>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 #include "SettingsScreenU8g2.h"
+#include "config.h"
+#include "presets.h"
+#include "settings_blob.h"
 
 namespace {
-constexpr const char* kSettingsPath = "/settings.txt";
+constexpr const char* kSettingsPath = "/settings.bin";
+constexpr const char* kSettingsTempPath = "/settings.tmp";
+constexpr const char* kSettingsTextPath = "/settings.txt";
+
+struct TextKey {
+	const char* key;
+	float EffectParams::*field;
+	const char* format;
+};
+
+const TextKey kTextKeys[] = {
+	{"delay_ms", &EffectParams::delayTimeMs, "%.0f"},
+	{"delay_depth", &EffectParams::delayDepth, "%.2f"},
+	{"delay_fb", &EffectParams::delayFeedback, "%.2f"},
+	{"filter_hz", &EffectParams::filterCutoffHz, "%.0f"},
+	{"filter_q", &EffectParams::filterQ, "%.2f"},
+	{"filter_slew", &EffectParams::filterSlewHzPerSec, "%.0f"},
+	{"dry_mix", &EffectParams::dryMix, "%.2f"},
+	{"wet_mix", &EffectParams::wetMix, "%.2f"},
+	{"comp_attack", &EffectParams::compAttackMs, "%.0f"},
+	{"comp_release", &EffectParams::compReleaseMs, "%.0f"},
+	{"comp_hold", &EffectParams::compHoldMs, "%.0f"},
+	{"comp_threshold", &EffectParams::compThresholdPercent, "%.0f"},
+	{"comp_ratio", &EffectParams::compRatio, "%.2f"},
+	{"eq_low_db", &EffectParams::eqLowDb, "%.1f"},
+	{"eq_mid_db", &EffectParams::eqMidDb, "%.1f"},
+	{"eq_high_db", &EffectParams::eqHighDb, "%.1f"},
+};
+constexpr const char* kZoomKey = "zoom";
+constexpr const char* kCompEnabledKey = "comp_enabled";
+
+QueueHandle_t saveQueue = nullptr;
+TaskHandle_t saveTaskHandle = nullptr;
+// Set by loadSettingsFromSd() and by the save task: the CRC first, then
+// valid, which the task reads first
+std::atomic<uint32_t> lastSavedCrc{0};
+std::atomic<bool> lastSavedValid{false};
+
+// Single read of the whole file, then the header and CRC check. Returns the
+// version of the blob, 0 when it can not be used.
+uint16_t readBlob(const char* path, PersistedSettings& out) {
+	if (!SD.exists(path)) return 0;
+	File f = SD.open(path, FILE_READ);
+	if (!f) return 0;
+	// one byte more than the current blob: a longer file is rejected
+	uint8_t data[sizeof(SettingsBlob) + 1];
+	size_t got = f.read(data, sizeof(data));
+	f.close();
+	return decodeSettingsBlob(data, got, out);
 }
 
-void loadSettingsFromSd(SettingsScreenU8g2* settingsScreen) {
-	if (!settingsScreen) return;
-	if (!SD.exists(kSettingsPath)) return;
-	File f = SD.open(kSettingsPath, FILE_READ);
+// Writes the blob to a temp file and renames it over the live file. FAT cannot
+// rename onto an existing file, so the old blob is removed first; if power is
+// lost in between, loading falls back to the (already complete) temp file.
+bool writeBlobAtomically(const SettingsBlob& blob) {
+	File f = SD.open(kSettingsTempPath, FILE_WRITE);
 	if (!f) {
-		Serial.println("Failed to open settings file for read");
+		Serial.println("Failed to open settings temp file for write");
+		return false;
+	}
+	size_t written = f.write(reinterpret_cast<const uint8_t*>(&blob), sizeof(blob));
+	f.flush();
+	f.close();
+	if (written != sizeof(blob)) {
+		Serial.println("Short write on settings temp file");
+		SD.remove(kSettingsTempPath);
+		return false;
+	}
+	if (SD.exists(kSettingsPath)) SD.remove(kSettingsPath);
+	if (!SD.rename(kSettingsTempPath, kSettingsPath)) {
+		Serial.println("Failed to rename settings temp file");
+		return false;
+	}
+	return true;
+}
+
+void persistSnapshot(const PersistedSettings& settings) {
+	SettingsBlob blob;
+	encodeSettingsBlob(settings, blob);
+	// Skip identical writes to spare the card.
+	if (lastSavedValid.load() && blob.crc == lastSavedCrc.load()) return;
+	if (!writeBlobAtomically(blob)) return;
+	lastSavedCrc.store(blob.crc);
+	lastSavedValid.store(true);
+	// The text export is only written when it is missing: each save would
+	// write the card twice. Delete it to get the current values.
+	if (!SD.exists(kSettingsTextPath)) exportSettingsText(settings);
+	Serial.printf("Saved settings (crc=%08lx)\n", static_cast<unsigned long>(blob.crc));
+}
+
+void settingsSaveTaskImpl(void*) {
+	PersistedSettings pending;
+	const TickType_t debounceTicks = pdMS_TO_TICKS(SETTINGS_SAVE_DEBOUNCE_MS);
+	for (;;) {
+		if (xQueueReceive(saveQueue, &pending, portMAX_DELAY) != pdTRUE) continue;
+		// Keep taking newer snapshots until the input has been quiet for the
+		// debounce period, then write only the latest one.
+		while (xQueueReceive(saveQueue, &pending, debounceTicks) == pdTRUE) {
+		}
+		persistSnapshot(pending);
+	}
+}
+
+const TextKey* findTextKey(const char* key) {
+	for (const TextKey& entry : kTextKeys) {
+		if (strcmp(entry.key, key) == 0) return &entry;
+	}
+	return nullptr;
+}
+}
+
+void captureSettings(const SettingsScreenU8g2* settingsScreen, const PresetBank* presets,
+                     PersistedSettings& out) {
+	fillDefaultSettings(out);
+	if (presets) {
+		out.presetUsedMask = presets->getUsedMask();
+		memcpy(out.presets, presets->data(), sizeof(out.presets));
+	}
+	if (!settingsScreen) return;
+	out.zoom = settingsScreen->getZoom();
+	EffectParams& live = out.live;
+	live.delayTimeMs = settingsScreen->getDelayTimeMs();
+	live.delayDepth = settingsScreen->getDelayDepth();
+	live.delayFeedback = settingsScreen->getDelayFeedback();
+	live.filterCutoffHz = settingsScreen->getFilterCutoffHz();
+	live.filterQ = settingsScreen->getFilterQ();
+	live.filterSlewHzPerSec = settingsScreen->getFilterSlewHzPerSec();
+	live.dryMix = settingsScreen->getDryMix();
+	live.wetMix = settingsScreen->getWetMix();
+	live.compAttackMs = settingsScreen->getCompressorAttackMs();
+	live.compReleaseMs = settingsScreen->getCompressorReleaseMs();
+	live.compHoldMs = settingsScreen->getCompressorHoldMs();
+	live.compThresholdPercent = settingsScreen->getCompressorThresholdPercent();
+	live.compRatio = settingsScreen->getCompressorRatio();
+	live.compEnabled = settingsScreen->getCompressorEnabled() ? 1 : 0;
+}
+
+void applySettings(SettingsScreenU8g2* settingsScreen, PresetBank* presets,
+                   const PersistedSettings& in) {
+	if (presets) {
+		memcpy(presets->data(), in.presets, sizeof(in.presets));
+		presets->setUsedMask(in.presetUsedMask);
+	}
+	if (!settingsScreen) return;
+	const EffectParams& live = in.live;
+	settingsScreen->setZoom(in.zoom);
+	settingsScreen->setDelayTimeMs(live.delayTimeMs);
+	settingsScreen->setDelayDepth(live.delayDepth);
+	settingsScreen->setDelayFeedback(live.delayFeedback);
+	settingsScreen->setFilterCutoffHz(live.filterCutoffHz);
+	settingsScreen->setFilterQ(live.filterQ);
+	settingsScreen->setFilterSlewHzPerSec(live.filterSlewHzPerSec);
+	settingsScreen->setDryMix(live.dryMix);
+	settingsScreen->setWetMix(live.wetMix);
+	settingsScreen->setCompressorAttackMs(live.compAttackMs);
+	settingsScreen->setCompressorReleaseMs(live.compReleaseMs);
+	settingsScreen->setCompressorHoldMs(live.compHoldMs);
+	settingsScreen->setCompressorThresholdPercent(live.compThresholdPercent);
+	settingsScreen->setCompressorRatio(live.compRatio);
+	settingsScreen->setCompressorEnabled(live.compEnabled != 0);
+}
+
+void beginSettingsStorage() {
+	if (saveQueue) return;
+	saveQueue = xQueueCreate(1, sizeof(PersistedSettings));
+	if (!saveQueue) {
+		Serial.println("Failed to create settings save queue");
 		return;
 	}
-	while (f.available()) {
-		String line = f.readStringUntil('\n');
-		line.trim();
-		if (line.startsWith("zoom=")) {
-			float z = line.substring(5).toFloat();
-			settingsScreen->setZoom(z);
-			Serial.printf("Loaded zoom=%f from settings\n", z);
-		} else if (line.startsWith("delay_ms=")) {
-			float d = line.substring(9).toFloat();
-			settingsScreen->setDelayTimeMs(d);
-			Serial.printf("Loaded delay_ms=%.0f from settings\n", d);
-		} else if (line.startsWith("delay_depth=")) {
-			float dd = line.substring(12).toFloat();
-			settingsScreen->setDelayDepth(dd);
-			Serial.printf("Loaded delay_depth=%.2f from settings\n", dd);
-		} else if (line.startsWith("delay_fb=")) {
-			float df = line.substring(9).toFloat();
-			settingsScreen->setDelayFeedback(df);
-			Serial.printf("Loaded delay_fb=%.2f from settings\n", df);
-		} else if (line.startsWith("filter_hz=")) {
-			float fh = line.substring(10).toFloat();
-			settingsScreen->setFilterCutoffHz(fh);
-			Serial.printf("Loaded filter_hz=%.0f from settings\n", fh);
-		} else if (line.startsWith("filter_q=")) {
-			float fq = line.substring(9).toFloat();
-			settingsScreen->setFilterQ(fq);
-			Serial.printf("Loaded filter_q=%.2f from settings\n", fq);
-		} else if (line.startsWith("filter_slew=")) {
-			float fs = line.substring(12).toFloat();
-			settingsScreen->setFilterSlewHzPerSec(fs);
-			Serial.printf("Loaded filter_slew=%.0f from settings\n", fs);
-		} else if (line.startsWith("dry_mix=")) {
-			float dm = line.substring(8).toFloat();
-			settingsScreen->setDryMix(dm);
-			Serial.printf("Loaded dry_mix=%.2f from settings\n", dm);
-		} else if (line.startsWith("wet_mix=")) {
-			float wm = line.substring(8).toFloat();
-			settingsScreen->setWetMix(wm);
-			Serial.printf("Loaded wet_mix=%.2f from settings\n", wm);
-		} else if (line.startsWith("comp_attack=")) {
-			float ca = line.substring(12).toFloat();
-			settingsScreen->setCompressorAttackMs(ca);
-			Serial.printf("Loaded comp_attack=%.0f from settings\n", ca);
-		} else if (line.startsWith("comp_release=")) {
-			float cr = line.substring(13).toFloat();
-			settingsScreen->setCompressorReleaseMs(cr);
-			Serial.printf("Loaded comp_release=%.0f from settings\n", cr);
-		} else if (line.startsWith("comp_hold=")) {
-			float ch = line.substring(10).toFloat();
-			settingsScreen->setCompressorHoldMs(ch);
-			Serial.printf("Loaded comp_hold=%.0f from settings\n", ch);
-		} else if (line.startsWith("comp_threshold=")) {
-			float ct = line.substring(15).toFloat();
-			settingsScreen->setCompressorThresholdPercent(ct);
-			Serial.printf("Loaded comp_threshold=%.0f from settings\n", ct);
-		} else if (line.startsWith("comp_ratio=")) {
-			float crat = line.substring(11).toFloat();
-			settingsScreen->setCompressorRatio(crat);
-			Serial.printf("Loaded comp_ratio=%.2f from settings\n", crat);
-		} else if (line.startsWith("comp_enabled=")) {
-			String ceStr = line.substring(13);
-			ceStr.toLowerCase();
-			bool ce = (ceStr == "1" || ceStr == "on" || ceStr == "true");
-			settingsScreen->setCompressorEnabled(ce);
-			Serial.printf("Loaded comp_enabled=%s from settings\n", ce ? "true" : "false");
+	xTaskCreatePinnedToCore(settingsSaveTaskImpl,
+	                        "SettingsSave",
+	                        SETTINGS_SAVE_TASK_STACK,
+	                        nullptr,
+	                        SETTINGS_SAVE_TASK_PRIORITY,
+	                        &saveTaskHandle,
+	                        SETTINGS_SAVE_TASK_CORE);
+}
+
+void loadSettingsFromSd(SettingsScreenU8g2* settingsScreen, PresetBank* presets) {
+	if (!settingsScreen) return;
+	PersistedSettings settings;
+	uint16_t version = readBlob(kSettingsPath, settings);
+	if (version == 0) version = readBlob(kSettingsTempPath, settings);
+	if (version != 0) {
+		// An older blob is written again in the current layout on the next save.
+		if (version == kSettingsVersion) {
+			SettingsBlob blob;
+			encodeSettingsBlob(settings, blob);
+			lastSavedCrc.store(blob.crc);
+			lastSavedValid.store(true);
 		}
+		applySettings(settingsScreen, presets, settings);
+		Serial.printf("Loaded settings from binary blob (version %u)\n", version);
+		return;
+	}
+	// No valid blob (first boot after upgrade, or a hand-edited text file):
+	// import the human readable export instead.
+	captureSettings(settingsScreen, presets, settings);
+	if (importSettingsText(settings)) {
+		applySettings(settingsScreen, presets, settings);
+		Serial.println("Imported settings from text file");
+	}
+}
+
+void saveSettingsToSd(const SettingsScreenU8g2* settingsScreen, const PresetBank* presets) {
+	PersistedSettings settings;
+	captureSettings(settingsScreen, presets, settings);
+	if (!saveQueue) {
+		// Storage task not running: fall back to a synchronous write.
+		persistSnapshot(settings);
+		return;
+	}
+	xQueueOverwrite(saveQueue, &settings);
+}
 
+bool exportSettingsText(const PersistedSettings& settings) {
+	File f = SD.open(kSettingsTextPath, FILE_WRITE);
+	if (!f) {
+		Serial.println("Failed to open settings text file for write");
+		return false;
+	}
+	char line[48];
+	snprintf(line, sizeof(line), "%s=%.2f", kZoomKey, settings.zoom);
+	f.println(line);
+	for (const TextKey& entry : kTextKeys) {
+		int n = snprintf(line, sizeof(line), "%s=", entry.key);
+		snprintf(line + n, sizeof(line) - n, entry.format, settings.live.*(entry.field));
+		f.println(line);
 	}
+	snprintf(line, sizeof(line), "%s=%d", kCompEnabledKey, settings.live.compEnabled ? 1 : 0);
+	f.println(line);
 	f.close();
+	return true;
 }
 
-void saveSettingsToSd(const SettingsScreenU8g2* settingsScreen) {
-	File f = SD.open(kSettingsPath, FILE_WRITE);
+bool importSettingsText(PersistedSettings& settings) {
+	if (!SD.exists(kSettingsTextPath)) return false;
+	File f = SD.open(kSettingsTextPath, FILE_READ);
 	if (!f) {
-		Serial.println("Failed to open settings file for write");
-		return;
+		Serial.println("Failed to open settings text file for read");
+		return false;
 	}
-	float z = settingsScreen ? settingsScreen->getZoom() : 1.0f;
-	char buf[32];
-	snprintf(buf, sizeof(buf), "zoom=%.2f\n", z);
-	f.print(buf);
-	if (settingsScreen) {
-		char buf2[64];
-		snprintf(buf2, sizeof(buf2), "delay_ms=%.0f\n", settingsScreen->getDelayTimeMs());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "delay_depth=%.2f\n", settingsScreen->getDelayDepth());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "delay_fb=%.2f\n", settingsScreen->getDelayFeedback());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "filter_hz=%.0f\n", settingsScreen->getFilterCutoffHz());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "filter_q=%.2f\n", settingsScreen->getFilterQ());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "filter_slew=%.0f\n", settingsScreen->getFilterSlewHzPerSec());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "dry_mix=%.2f\n", settingsScreen->getDryMix());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "wet_mix=%.2f\n", settingsScreen->getWetMix());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "comp_attack=%.0f\n", settingsScreen->getCompressorAttackMs());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "comp_release=%.0f\n", settingsScreen->getCompressorReleaseMs());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "comp_hold=%.0f\n", settingsScreen->getCompressorHoldMs());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "comp_threshold=%.0f\n", settingsScreen->getCompressorThresholdPercent());
-		f.print(buf2);
-		snprintf(buf2, sizeof(buf2), "comp_ratio=%.2f\n", settingsScreen->getCompressorRatio());
-		f.print(buf2);
-		bool ce = settingsScreen->getCompressorEnabled();
-		snprintf(buf2, sizeof(buf2), "comp_enabled=%d\n", ce ? 1 : 0);
-		f.print(buf2);
+	char line[64];
+	bool any = false;
+	while (f.available()) {
+		size_t n = f.readBytesUntil('\n', line, sizeof(line) - 1);
+		line[n] = '\0';
+		char* eq = strchr(line, '=');
+		if (!eq) continue;
+		*eq = '\0';
+		const char* value = eq + 1;
+		if (const TextKey* entry = findTextKey(line)) {
+			settings.live.*(entry->field) = strtof(value, nullptr);
+			any = true;
+		} else if (strcmp(line, kZoomKey) == 0) {
+			settings.zoom = strtof(value, nullptr);
+			any = true;
+		} else if (strcmp(line, kCompEnabledKey) == 0) {
+			settings.live.compEnabled = (value[0] == '1' || strncasecmp(value, "on", 2) == 0 ||
+			                        strncasecmp(value, "true", 4) == 0) ? 1 : 0;
+			any = true;
+		}
 	}
-	f.flush();
 	f.close();
-	Serial.printf("Saved zoom=%.2f to settings\n", z);
+	return any;
 }
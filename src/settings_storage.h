@@ -1,9 +1,46 @@
 #pragma once
 
+#include <cstdint>
+
+#include "config.h"
+#include "effect_params.h"
+
 class SettingsScreenU8g2;
+class PresetBank;
+
+// Flat snapshot of every persisted setting. This is the payload of the binary
+// settings blob, so only append new fields and bump kSettingsVersion in
+// settings_blob.h when the layout changes; settings_blob.cpp converts blobs of
+// the previous version.
+struct PersistedSettings {
+	float zoom;
+	EffectParams live;
+	uint32_t presetUsedMask;
+	EffectParams presets[PRESET_SLOT_COUNT];
+};
+
+// Starts the background task that writes settings to the SD card. Call once
+// after the SD card has been initialised.
+void beginSettingsStorage();
 
 // Loads persisted settings from the SD card into the provided settings screen.
-void loadSettingsFromSd(SettingsScreenU8g2* settingsScreen);
+// Reads the binary blob (falling back to the text export when the blob is
+// missing or corrupt).
+void loadSettingsFromSd(SettingsScreenU8g2* settingsScreen, PresetBank* presets = nullptr);
+
+// Queues the current settings for saving. Returns immediately; the background
+// task debounces bursts of calls and skips the write when nothing changed.
+void saveSettingsToSd(const SettingsScreenU8g2* settingsScreen, const PresetBank* presets = nullptr);
+
+// Copies settings between the settings screen / preset bank and a flat
+// snapshot.
+void captureSettings(const SettingsScreenU8g2* settingsScreen, const PresetBank* presets,
+                     PersistedSettings& out);
+void applySettings(SettingsScreenU8g2* settingsScreen, PresetBank* presets,
+                   const PersistedSettings& in);
 
-// Saves the current settings from the provided settings screen to the SD card.
-void saveSettingsToSd(const SettingsScreenU8g2* settingsScreen);
+// Human readable key=value export/import (/settings.txt) of the live values;
+// presets are only kept in the binary blob. A save only writes the export
+// when the file is missing; call exportSettingsText() for the current values.
+bool exportSettingsText(const PersistedSettings& settings);
+bool importSettingsText(PersistedSettings& settings);
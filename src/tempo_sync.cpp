@@ -0,0 +1,101 @@
+#include "tempo_sync.h"
+
+#include <cmath>
+
+namespace {
+struct Division {
+	const char* name;
+	uint8_t num;
+	uint8_t den;
+};
+
+// in quarter notes, in the order of BeatDivision
+const Division kDivisions[] = {
+	{"off", 0, 1},    {"1/2", 2, 1},    {"1/4.", 3, 2},   {"1/4", 1, 1},
+	{"1/4T", 2, 3},   {"1/8.", 3, 4},   {"1/8", 1, 2},    {"1/8T", 1, 3},
+	{"1/16.", 3, 8},  {"1/16", 1, 4},   {"1/16T", 1, 6},
+};
+}  // namespace
+
+// The loop of F. Adriaensen ("Using a DLL to filter time"): the phase error
+// of each tick corrects the prediction of the next one and, scaled down,
+// the period. The bandwidth sets how fast a new tempo is followed.
+void ClockPll::tick(uint64_t us) {
+	uint64_t interval = us - lastUs;
+	bool restart = lastUs == 0 || interval > MIDI_CLOCK_TIMEOUT_MS * 1000ull;
+	lastUs = us;
+	if (restart) {
+		locked = false;
+		return;
+	}
+	if (!locked) {
+		periodUs = static_cast<double>(interval);
+		predictedUs = static_cast<double>(us) + periodUs;
+		locked = true;
+		return;
+	}
+	double omega = 2.0 * M_PI * MIDI_CLOCK_PLL_BANDWIDTH_HZ * periodUs / 1e6;
+	double error = static_cast<double>(us) - predictedUs;
+	// a lost or an extra tick: start over from this one
+	if (fabs(error) > periodUs / 2) {
+		periodUs = static_cast<double>(interval);
+		predictedUs = static_cast<double>(us) + periodUs;
+		return;
+	}
+	predictedUs += periodUs + sqrt(2.0) * omega * error;
+	periodUs += omega * omega * error;
+}
+
+void TempoSync::tap(uint64_t nowUs) {
+	division = lastDivision;
+	uint64_t interval = nowUs - lastTapUs;
+	bool first = lastTapUs == 0 || interval > TEMPO_TAP_TIMEOUT_MS * 1000ull;
+	lastTapUs = nowUs;
+	if (first) {
+		tapCount = 0;
+		return;
+	}
+	tapIntervals[tapCount % TEMPO_TAP_COUNT] = interval;
+	tapCount++;
+	size_t n = tapCount < TEMPO_TAP_COUNT ? tapCount : TEMPO_TAP_COUNT;
+	uint64_t sum = 0;
+	for (size_t i = 0; i < n; ++i) sum += tapIntervals[i];
+	float bpm = 60e6f * n / sum;
+	if (bpm >= TEMPO_MIN_BPM && bpm <= TEMPO_MAX_BPM) tapBpm = bpm;
+}
+
+void TempoSync::setDivision(BeatDivision value) {
+	division = value;
+	if (value != BeatDivision::Off) lastDivision = value;
+}
+
+float TempoSync::bpm() const {
+	return clockBpm > 0.0f ? clockBpm : tapBpm;
+}
+
+TempoSource TempoSync::source() const {
+	if (clockBpm > 0.0f) return TempoSource::Clock;
+	return tapBpm > 0.0f ? TempoSource::Tap : TempoSource::None;
+}
+
+BeatDivision TempoSync::divisionOfControl(uint8_t value) {
+	if (value == 0) return BeatDivision::Off;
+	size_t count = static_cast<size_t>(BeatDivision::Count) - 1;
+	return static_cast<BeatDivision>(1 + (value - 1) * count / 127);
+}
+
+const char* TempoSync::divisionName(BeatDivision value) {
+	return value < BeatDivision::Count ? kDivisions[static_cast<size_t>(value)].name : "";
+}
+
+double TempoSync::delaySamples(uint32_t sampleRate) const {
+	float tempo = bpm();
+	if (division == BeatDivision::Off || tempo <= 0.0f) return 0.0;
+	const Division& d = kDivisions[static_cast<size_t>(division)];
+	double samples = 60.0 * sampleRate / tempo * d.num / d.den;
+	double minSamples = sampleRate * DELAY_TIME_MIN_MS / 1000.0;
+	double maxSamples = sampleRate * DELAY_TIME_MAX_MS / 1000.0;
+	while (samples > maxSamples) samples /= 2;
+	while (samples < minSamples) samples *= 2;
+	return samples;
+}
@@ -0,0 +1,79 @@
+// tempo_sync.h - tempo for the delay: the MIDI clock, followed by a PLL which
+// filters the jitter of its ticks, or the tap tempo. The delay of a beat
+// division is an exact number of samples; the delay line glides there (see
+// Delay::setGlide()), so a tempo change bends the echoes without a click.
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Delay per beat, in quarter notes: num / den
+enum class BeatDivision : uint8_t {
+	Off,  // the delay time of the settings
+	Half,
+	DottedQuarter,
+	Quarter,
+	QuarterTriplet,
+	DottedEighth,
+	Eighth,
+	EighthTriplet,
+	DottedSixteenth,
+	Sixteenth,
+	SixteenthTriplet,
+	Count
+};
+
+enum class TempoSource : uint8_t { None, Tap, Clock };
+
+// Delay-locked loop (second order) on a stream of ticks, e.g. the 24 ticks
+// per quarter note of the MIDI clock: the period follows the mean tempo,
+// the jitter of single ticks is averaged out. One writer.
+class ClockPll {
+public:
+	void tick(uint64_t us);
+	// Smoothed interval between two ticks in us; 0 until two ticks arrived
+	double period() const { return locked ? periodUs : 0.0; }
+	uint64_t lastTick() const { return lastUs; }
+
+private:
+	bool locked = false;
+	uint64_t lastUs = 0;
+	double predictedUs = 0.0;  // expected time of the next tick
+	double periodUs = 0.0;
+};
+
+class TempoSync {
+public:
+	// Tap tempo: the mean interval of the last TEMPO_TAP_COUNT taps; a pause
+	// of more than TEMPO_TAP_TIMEOUT_MS starts over. Without a division (a
+	// delay time of its own) the last division is taken again.
+	void tap(uint64_t nowUs);
+	// Tempo of the MIDI clock, 0 without clock: then the tap tempo applies
+	void setClockBpm(float bpm) { clockBpm = bpm; }
+
+	float bpm() const;
+	TempoSource source() const;
+
+	void setDivision(BeatDivision value);
+	BeatDivision getDivision() const { return division; }
+	// 0..127 of a control change over the divisions; 0 is Off
+	static BeatDivision divisionOfControl(uint8_t value);
+	static const char* divisionName(BeatDivision value);
+
+	// true with a tempo and a division
+	bool isSynced() const { return division != BeatDivision::Off && bpm() > 0.0f; }
+	// The division at the tempo in samples, moved by octaves into
+	// DELAY_TIME_MIN_MS..DELAY_TIME_MAX_MS
+	double delaySamples(uint32_t sampleRate) const;
+
+private:
+	BeatDivision division = static_cast<BeatDivision>(DELAY_SYNC_DIVISION);
+	// for a tap after Off: 1/8 when the sync is off from the start
+	BeatDivision lastDivision =
+	    division != BeatDivision::Off ? division : BeatDivision::Eighth;
+	float clockBpm = 0.0f;
+	float tapBpm = 0.0f;
+	uint64_t lastTapUs = 0;
+	uint64_t tapIntervals[TEMPO_TAP_COUNT] = {};
+	size_t tapCount = 0;  // intervals since the tapping started
+};
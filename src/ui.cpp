@@ -49,15 +49,15 @@ bool initUi() {
   return true;
 }
 
-void updateUi(bool playing, const String& filename) {
+// Called every loop: only a change of the state reaches the display
+void updateUi(bool playing, const char* filename) {
   static bool lastPlayingState = false;
-  static String lastFileName = "";
-  String fn = filename;
-  if (fn.isEmpty()) fn = "-";
-  if (playing != lastPlayingState || fn != lastFileName) {
+  static char lastFileName[MANIFEST_PATH_LEN] = "";
+  const char* fn = (filename == nullptr || filename[0] == '\0') ? "-" : filename;
+  if (playing != lastPlayingState || strncmp(fn, lastFileName, sizeof(lastFileName)) != 0) {
     lastPlayingState = playing;
-    lastFileName = fn;
-    scopeDisplay.updateStatus(playing, fn);
+    snprintf(lastFileName, sizeof(lastFileName), "%s", fn);
+    scopeDisplay.updateStatus(playing, String(fn));
   }
 }
 
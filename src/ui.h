@@ -10,7 +10,7 @@ extern ScopeI2SStream scopeI2s;
 bool initUi();
 
 // Update UI state (called from main loop)
-void updateUi(bool playing, const String& filename);
+void updateUi(bool playing, const char* filename);
 
 // When using the U8G2 driver, expose the underlying U8G2 instance so other
 // modules (e.g. settings screens) can draw to the display using the same